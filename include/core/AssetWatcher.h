@@ -0,0 +1,121 @@
+#ifndef ASSET_WATCHER_H
+#define ASSET_WATCHER_H
+
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "graphics/shader.h"
+#include "graphics/texture.h"
+
+// Hot reload driven by file system events.
+//
+// A watcher thread listens for changes under the asset roots (inotify on
+// Linux, modification time polling elsewhere) and debounces them: editors
+// often write a file in several steps, so a path is only reported once it
+// has been quiet for the debounce interval.
+//
+// At each frame boundary the render thread calls applyPending(), which
+//   1. maps the settled paths to the shaders (through ShaderDependencyGraph,
+//      so an edited include rebuilds every programme using it) and textures
+//      built from them, and queues rebuilds;
+//   2. installs whatever the watcher thread has finished since last frame.
+// Rebuilds run on the watcher thread in a hidden GL context sharing objects
+// with the main one: shaders compile and link, textures decode and upload,
+// then glFinish() makes the objects complete before they are handed over.
+// The render thread only swaps ids, so it never waits on disk or compiler.
+class AssetWatcher {
+public:
+    struct Stats {
+        int file_events;            // raw events before debouncing
+        int changes;                // settled paths
+        int shaders_rebuilt;
+        int textures_reloaded;
+        int failed;
+        double last_build_ms;       // watcher thread time for the last batch
+    };
+
+    static AssetWatcher& instance();
+
+    // Start watching (call on the main thread once the window exists)
+    bool init(GLFWwindow* share_with, const std::vector<std::string>& roots = {"shaders", "assets"});
+    void shutdown();
+
+    bool isRunning() const { return running; }
+    void setDebounce(double seconds) { debounce_seconds = seconds; }
+
+    // Render thread, once per frame (updateInput calls it)
+    void applyPending();
+
+    // Textures register themselves when loaded from a file
+    void watchTexture(Texture* texture);
+    void unwatchTexture(Texture* texture);
+
+    Stats getStats();
+
+private:
+    AssetWatcher() = default;
+    ~AssetWatcher();
+    AssetWatcher(const AssetWatcher&) = delete;
+    AssetWatcher& operator=(const AssetWatcher&) = delete;
+
+    struct ShaderRequest {
+        Shader* target;
+        std::string vertex_path;
+        std::string fragment_path;
+        std::vector<std::string> defines;
+    };
+    struct ShaderResult {
+        Shader* target;
+        std::string vertex_path;
+        ShaderBuild build;
+    };
+    struct TextureRequest {
+        Texture* target;
+        std::string path;
+        bool flip;
+    };
+    struct TextureResult {
+        Texture* target;
+        std::string path;
+        GLuint id;
+        int width, height, channels;
+    };
+
+    void threadLoop();
+    bool openWatches();
+    void closeWatches();
+    void collectEvents(int timeout_ms);
+    void settleChanges();
+    void runBuilds();
+
+    GLFWwindow* context = nullptr;           // hidden, shared with the main window
+    std::thread thread;
+    std::atomic<bool> running{false};
+    double debounce_seconds = 0.15;
+    std::vector<std::string> roots;
+
+    // Watcher thread only
+    int inotify_fd = -1;
+    std::unordered_map<int, std::string> watch_dirs;            // inotify wd -> directory
+    std::unordered_map<std::string, double> unsettled;          // path -> time of last event
+    std::unordered_map<std::string, long long> mtimes;          // polling fallback
+
+    // Shared, guarded by mutex
+    std::mutex mutex;
+    std::vector<std::string> settled;
+    std::vector<ShaderRequest> shader_requests;
+    std::vector<TextureRequest> texture_requests;
+    std::vector<ShaderResult> shader_results;
+    std::vector<TextureResult> texture_results;
+    Stats stats = {};
+
+    // Render thread only
+    std::unordered_set<Texture*> textures;
+};
+
+#endif
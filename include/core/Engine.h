@@ -3,6 +3,62 @@
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <functional>
+#include "core/FramePacer.h"
+
+// Lighting path for scenes that support both. Forward shades while drawing
+// (cheaper with few lights or MSAA); deferred writes a G-buffer first and
+// shades each pixel once (cheaper with many lights and heavy overdraw).
+enum RenderPath {
+    RENDER_PATH_FORWARD,
+    RENDER_PATH_DEFERRED
+};
+
+// Selected path, read by exercises at startup (see Engine::setRenderPath)
+extern RenderPath g_render_path;
+
+// Scenes that build render packets submit them from a dedicated GL thread
+// unless this is off (--serial, see Engine::setRenderThread)
+extern bool g_render_thread;
+
+struct RenderPacket;
+
+// Main loop timing (see Engine::run)
+struct LoopSettings {
+    double fixed_dt = 1.0 / 60.0;      // simulation step in seconds
+    int max_steps_per_frame = 5;       // a slow frame runs at most this many steps
+    double max_frame_time = 0.25;      // longer gaps (breakpoints, window drags) are cut to this
+};
+
+// Any callback may be empty
+struct LoopCallbacks {
+    std::function<void(double frame_dt)> frame;   // once per frame, first: input, toggles, camera
+    std::function<void(double dt)> update;        // zero or more times per frame, always fixed_dt
+    std::function<void(double alpha)> render;     // once per frame; alpha in [0, 1) blends the
+                                                  // previous simulation state into the current one
+
+    // Packet path, used instead of render when both are set. build makes
+    // no GL calls and copies what it needs into the packet; submit draws
+    // it on the thread that owns the context (see core/RenderThread.h)
+    std::function<void(RenderPacket& packet, double alpha)> build;
+    std::function<void(const RenderPacket& packet)> submit;
+};
+
+struct LoopStats {
+    long long frames;
+    long long updates;
+    int last_steps;             // updates run in the last frame
+    long long clamped_frames;   // frames that hit max_steps_per_frame and dropped time
+    double alpha;               // last interpolation factor
+    double sim_time;            // simulated seconds (updates * fixed_dt)
+
+    // Packet path, last frame
+    bool render_thread;         // submitted from the render thread
+    double build_ms;
+    double acquire_wait_ms;     // main thread blocked waiting for a free packet
+    double submit_ms;           // GL thread (one frame behind when threaded)
+    double swap_ms;
+};
 
 class Engine {
 public:
@@ -14,6 +70,32 @@ public:
     
     GLFWwindow* getWindow() const { return window; }
     bool isInitialized() const { return initialized; }
+
+    void setRenderPath(RenderPath path);
+    RenderPath getRenderPath() const { return g_render_path; }
+
+    void setRenderThread(bool enabled);
+    bool getRenderThread() const { return g_render_thread; }
+
+    // Vsync, frame limiter and latency bound (see core/FramePacer.h);
+    // vsync on and nothing else by default
+    void setFramePacing(const FramePacing& pacing);
+    FramePacing getFramePacing() const { return FramePacer::instance().getPacing(); }
+
+    // Run until the window should close. Simulation advances in fixed
+    // steps from an accumulator, so it behaves the same at any frame rate
+    // and its cost is capped by fixed_dt rather than by the refresh rate:
+    //   frame(frame_dt) -> update(fixed_dt) x N -> render(alpha) -> swap
+    // render() draws lerp(previous, current, alpha). When the simulation
+    // cannot keep up, at most max_steps_per_frame run and the rest of the
+    // backlog is dropped (slow motion instead of a spiral of death).
+    // Swapping buffers and the FPS counter are handled here.
+    //
+    // With build/submit callbacks and g_render_thread, build() for frame
+    // N+1 overlaps submit() and the swap of frame N on the render thread;
+    // the context belongs to that thread until run() returns
+    static void run(GLFWwindow* window, const LoopCallbacks& callbacks, const LoopSettings& settings = LoopSettings());
+    static const LoopStats& getLoopStats();
     
 private:
     GLFWwindow* window;
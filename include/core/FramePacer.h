@@ -0,0 +1,107 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+
+// Swap interval and adaptive sync via glfwSwapInterval. Adaptive (-1)
+// needs EXT_swap_control_tear and falls back to on without it
+enum VsyncMode {
+    VSYNC_OFF,
+    VSYNC_ON,
+    VSYNC_ADAPTIVE,
+    VSYNC_MODE_COUNT
+};
+
+struct FramePacing {
+    VsyncMode vsync = VSYNC_ON;
+    double max_fps = 0.0;           // frame limiter, 0 = off
+    int max_frames_ahead = 0;       // CPU frames queued ahead of the GPU (fences), 0 = driver default
+    bool finish = false;            // glFinish after every swap: least latency, least throughput
+};
+
+// Paces the thread that swaps (the render thread, or the main thread with
+// --serial) and measures the result.
+//
+// Around every glfwSwapBuffers:
+//   beforeSwap()  applies a changed swap interval, then the limiter sleeps
+//                 until ~1 ms before the frame's deadline and spins the
+//                 rest, which holds the rate far tighter than a sleep alone
+//   afterSwap()   records the swap-to-swap interval, then bounds latency:
+//                 glFinish, or a fence per frame and a wait for the one
+//                 max_frames_ahead frames back
+//
+// Swap-to-swap intervals go into a 0.5 ms histogram; mean and standard
+// deviation (jitter) come with it. More vsync and more frames ahead buy
+// throughput and smoothness with input-to-photon latency; the report
+// shows what each setting costs. F2 logs it, F3 cycles the vsync mode.
+//
+// setPacing() may be called from any thread; the GL side is applied by
+// the swapping thread at its next beforeSwap()
+class FramePacer {
+public:
+    static const int HISTOGRAM_BUCKETS = 100;      // 0.5 ms each; the last one is 49.5 ms and up
+    static const int MAX_FRAMES_AHEAD = 4;
+
+    struct Stats {
+        uint64_t frames;
+        double last_interval_ms;    // swap to swap
+        double mean_interval_ms;
+        double jitter_ms;           // standard deviation of the interval
+        double min_interval_ms;
+        double max_interval_ms;
+        double limiter_ms;          // last frame: sleep + spin in the limiter
+        double spin_ms;             //   of which spinning
+        double latency_wait_ms;     // last frame: glFinish or fence wait
+        uint32_t histogram[HISTOGRAM_BUCKETS];
+    };
+
+    static FramePacer& instance();
+
+    void setPacing(const FramePacing& pacing);
+    FramePacing getPacing();
+
+    // Swapping thread, with the context current
+    void beforeSwap();
+    void afterSwap();
+
+    // Drop the samples (e.g. after changing the pacing)
+    void resetStats();
+    Stats getStats();
+    void logReport();
+
+    // Fences still waiting, on the thread that owns the context
+    void shutdown();
+
+    static const char* vsyncName(VsyncMode mode);
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacer();
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    void deleteFences();
+
+    std::mutex mutex;
+    FramePacing pacing;
+    bool dirty;                     // swap interval to apply
+
+    // Swapping thread only
+    Clock::time_point deadline;     // limiter: next frame may not swap before
+    Clock::time_point last_swap;
+    bool has_last_swap;
+    GLsync fences[MAX_FRAMES_AHEAD + 1];
+    int fence_count;
+
+    // Under mutex
+    Stats stats;
+    double interval_sum;
+    double interval_sq_sum;
+};
+
+#endif
@@ -0,0 +1,150 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Keyboard and mouse state built from GLFW callbacks instead of polling.
+//
+// The key, mouse button, cursor and scroll callbacks only timestamp the
+// event and push it into a fixed-size lock-free ring (single producer:
+// whoever calls glfwPollEvents; single consumer: beginFrame). Once per
+// frame Engine::run drains the ring in order and derives:
+//   held      - down at the end of the drained events
+//   pressed   - went down at least once since the last frame
+//   released  - went up at least once since the last frame
+// so a tap shorter than a frame still reads as pressed (and released),
+// however low the frame rate. The age of each press when the frame picks
+// it up is the input latency in getStats().
+//
+// Actions name what a key does, so code asks for "screenshot" rather than
+// GLFW_KEY_P and one action may have several bindings:
+//
+//   static const int jump = Input::instance().addAction("jump", GLFW_KEY_SPACE);
+//   Input::instance().bindButton(jump, GLFW_MOUSE_BUTTON_LEFT);
+//   ... in LoopCallbacks::frame
+//   if (Input::instance().wasPressed(jump)) ...
+//   if (Input::instance().isKeyHeld(GLFW_KEY_W)) ...
+//
+// Queries are for the main thread (the frame callback); build and submit
+// should get what they need through the packet.
+class Input {
+public:
+    static const int KEY_COUNT = GLFW_KEY_LAST + 1;
+    static const int BUTTON_COUNT = GLFW_MOUSE_BUTTON_LAST + 1;
+    static const uint32_t QUEUE_SIZE = 1024;    // events between two frames
+
+    struct Stats {
+        uint64_t events;            // since attach
+        uint64_t dropped;           // ring full
+        int frame_events;           // drained by the last beginFrame
+        int frame_presses;
+        double latency_ms;          // last frame: mean age of its presses
+        double max_latency_ms;      // worst press age since attach
+        double mean_latency_ms;     // over every press since attach
+    };
+
+    static Input& instance();
+
+    // Install the callbacks; Engine::init calls this for its window
+    void attach(GLFWwindow* window);
+
+    // Drain the events queued since the last call. Engine::run calls it
+    // at the start of every frame
+    void beginFrame();
+
+    bool isKeyHeld(int key) const;
+    bool wasKeyPressed(int key) const;
+    bool wasKeyReleased(int key) const;
+
+    bool isButtonHeld(int button) const;
+    bool wasButtonPressed(int button) const;
+    bool wasButtonReleased(int button) const;
+
+    // Window coordinates; the delta and scroll are summed over the frame
+    double getCursorX() const { return cursor_x; }
+    double getCursorY() const { return cursor_y; }
+    double getCursorDeltaX() const { return cursor_dx; }
+    double getCursorDeltaY() const { return cursor_dy; }
+    double getScrollX() const { return scroll_x; }
+    double getScrollY() const { return scroll_y; }
+
+    // Id of the named action, created on first use; key (if >= 0) is
+    // added to its bindings
+    int addAction(const char* name, int key = -1);
+    int findAction(const char* name) const;     // -1 if unknown
+    void bindKey(int action, int key);
+    void bindButton(int action, int button);
+    void clearBindings(int action);
+
+    // Any binding of the action
+    bool isHeld(int action) const;
+    bool wasPressed(int action) const;
+    bool wasReleased(int action) const;
+
+    const Stats& getStats() const { return stats; }
+    void logStats() const;
+
+private:
+    enum EventType : uint8_t {
+        EVENT_KEY,
+        EVENT_BUTTON,
+        EVENT_CURSOR,
+        EVENT_SCROLL
+    };
+
+    struct Event {
+        double time;            // glfwGetTime() in the callback
+        double x, y;            // cursor position or scroll offset
+        int code;               // key or button
+        uint8_t type;
+        uint8_t action;         // GLFW_PRESS, GLFW_RELEASE, GLFW_REPEAT
+    };
+
+    // Bits of key_state / button_state
+    enum : uint8_t {
+        STATE_HELD = 1,
+        STATE_PRESSED = 2,
+        STATE_RELEASED = 4
+    };
+
+    struct Action {
+        std::string name;
+        std::vector<int> keys;
+        std::vector<int> buttons;
+    };
+
+    Input();
+    Input(const Input&) = delete;
+    Input& operator=(const Input&) = delete;
+
+    static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods);
+    static void buttonCallback(GLFWwindow* window, int button, int action, int mods);
+    static void cursorCallback(GLFWwindow* window, double x, double y);
+    static void scrollCallback(GLFWwindow* window, double x, double y);
+
+    void push(const Event& event);
+    static void apply(uint8_t* state, uint8_t action);
+
+    Event queue[QUEUE_SIZE];
+    std::atomic<uint32_t> write_index;      // producer only
+    std::atomic<uint32_t> read_index;       // consumer only
+    std::atomic<uint64_t> dropped;
+
+    uint8_t key_state[KEY_COUNT];
+    uint8_t button_state[BUTTON_COUNT];
+    double cursor_x, cursor_y;
+    double cursor_dx, cursor_dy;
+    double scroll_x, scroll_y;
+    bool has_cursor;
+
+    std::vector<Action> actions;
+    uint64_t presses;
+    double latency_total_ms;
+    Stats stats;
+};
+
+#endif
@@ -0,0 +1,123 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Counts outstanding jobs; wait() on it until every job has finished
+struct JobCounter {
+    std::atomic<int> pending{0};
+};
+
+// A job is a plain function pointer + user data so queueing never allocates
+struct Job {
+    void (*func)(void* data);
+    void* data;
+    JobCounter* counter;
+};
+
+// Fixed pool of worker threads fed from a bounded ring buffer.
+// The calling thread always helps while waiting, so work still completes
+// when the pool has zero workers (single core machines).
+class JobSystem {
+public:
+    static JobSystem& instance();
+
+    // Start the workers (0 = hardware threads - 1)
+    void init(unsigned int num_workers = 0);
+    void shutdown();
+
+    unsigned int getWorkerCount() const { return (unsigned int)workers.size(); }
+
+    // Queue one job; counter (optional) is decremented when it finishes
+    void submit(void (*func)(void*), void* data, JobCounter* counter = nullptr);
+
+    // Block until counter reaches zero, running queued jobs meanwhile
+    void wait(JobCounter& counter);
+
+    // Split [0, count) into batches of batch_size and run func(begin, end)
+    // on the workers and the calling thread. Blocks until all batches are done.
+    template <typename Func>
+    void parallelFor(uint32_t count, uint32_t batch_size, const Func& func);
+
+private:
+    JobSystem() = default;
+    ~JobSystem();
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    static const uint32_t QUEUE_CAPACITY = 4096;
+
+    bool tryPop(Job& job);
+    void execute(const Job& job);
+    void workerLoop();
+
+    std::vector<std::thread> workers;
+    Job queue[QUEUE_CAPACITY];
+    uint32_t queue_head = 0;
+    uint32_t queue_count = 0;
+    std::mutex queue_mutex;
+    std::condition_variable queue_cv;
+    bool running = false;
+};
+
+// parallelFor state lives on the caller's stack; workers pull batches from
+// a shared atomic cursor so uneven batches balance themselves
+template <typename Func>
+void JobSystem::parallelFor(uint32_t count, uint32_t batch_size, const Func& func) {
+    if (count == 0) {
+        return;
+    }
+    if (batch_size == 0) {
+        batch_size = 1;
+    }
+
+    uint32_t num_batches = (count + batch_size - 1) / batch_size;
+    if (workers.empty() || num_batches == 1) {
+        func(0u, count);
+        return;
+    }
+
+    struct Context {
+        const Func* func;
+        std::atomic<uint32_t> next;
+        uint32_t count;
+        uint32_t batch_size;
+
+        static void run(void* data) {
+            Context* ctx = (Context*)data;
+            for (;;) {
+                uint32_t begin = ctx->next.fetch_add(ctx->batch_size);
+                if (begin >= ctx->count) {
+                    break;
+                }
+                uint32_t end = begin + ctx->batch_size;
+                if (end > ctx->count) end = ctx->count;
+                (*ctx->func)(begin, end);
+            }
+        }
+    };
+
+    Context ctx;
+    ctx.func = &func;
+    ctx.next.store(0);
+    ctx.count = count;
+    ctx.batch_size = batch_size;
+
+    // One helper job per worker (at most one per batch); the caller works too
+    JobCounter counter;
+    uint32_t helpers = (uint32_t)workers.size();
+    if (helpers > num_batches - 1) helpers = num_batches - 1;
+    for (uint32_t i = 0; i < helpers; i++) {
+        submit(&Context::run, &ctx, &counter);
+    }
+
+    Context::run(&ctx);
+    wait(counter);
+}
+
+#endif
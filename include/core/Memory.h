@@ -0,0 +1,194 @@
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Transient memory without the heap.
+//
+//   LinearArena   bump allocator; everything is released at once by
+//                 reset(). Memory::frameArena() is reset by Engine::run at
+//                 the end of every frame, Memory::scratch() is one per
+//                 thread for work that ends before the function returns
+//   Pool<T>       fixed-size objects recycled through a free list
+//
+// Arenas never run destructors, so only trivially destructible types go
+// in them. Running out of space falls back to the heap for that frame;
+// the next reset() grows the arena to the size that was needed, so after
+// a few frames nothing is allocated any more.
+//
+// Every operator new / delete is counted (src/core/Memory.cpp, build with
+// -DMEMORY_NO_TRACKING to leave the global operators alone). With the
+// heap check on (--heap-check) Engine::run logs and asserts when a frame
+// past the warm-up allocates on the main or render thread.
+class LinearArena {
+public:
+    explicit LinearArena(size_t capacity = 0);
+    ~LinearArena();
+    LinearArena(const LinearArena&) = delete;
+    LinearArena& operator=(const LinearArena&) = delete;
+
+    void* alloc(size_t size, size_t align = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocArray(size_t count) {
+        static_assert(std::is_trivially_destructible<T>::value, "arena memory is never destructed");
+        return (T*)alloc(sizeof(T) * count, alignof(T));
+    }
+
+    // Free everything allocated after getMarker(). Heap fallbacks are only
+    // released by reset()
+    size_t getMarker() const { return used; }
+    void rewind(size_t marker);
+
+    // Free everything, growing the block if the last cycle overflowed it
+    void reset();
+
+    size_t getUsed() const { return used + overflow_used; }
+    size_t getCapacity() const { return capacity; }
+    size_t getPeak() const { return peak; }                // largest cycle so far
+    uint64_t getOverflowCount() const { return overflow_count; }  // allocations that fell back to the heap
+
+private:
+    uint8_t* block;
+    size_t capacity;
+    size_t used;
+    size_t cycle_peak;         // since the last reset
+    size_t peak;
+    std::vector<void*> overflow;
+    size_t overflow_used;
+    uint64_t overflow_count;
+};
+
+// Rewinds the thread's scratch arena when it goes out of scope. Scopes
+// nest; the outermost one resets the arena instead, which also frees its
+// heap fallbacks
+//
+//   ScratchScope scope;
+//   float* temp = scope.arena().allocArray<float>(count);
+class ScratchScope {
+public:
+    ScratchScope();
+    ~ScratchScope();
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    LinearArena& arena() { return scratch; }
+
+private:
+    LinearArena& scratch;
+    size_t marker;
+};
+
+struct MemoryStats {
+    uint64_t heap_allocs;          // operator new calls since start, all threads
+    uint64_t heap_frees;
+    uint64_t heap_bytes;           // requested by those calls
+    uint64_t frame_heap_allocs;    // main + render thread, last frame
+    uint64_t steady_heap_frames;   // frames past the warm-up that allocated
+    uint64_t frames;
+    size_t frame_arena_used;       // last frame
+    size_t frame_arena_peak;
+    size_t frame_arena_capacity;
+};
+
+class Memory {
+public:
+    // Main thread only, valid until the end of the frame
+    static LinearArena& frameArena();
+
+    // This thread's scratch arena (see ScratchScope)
+    static LinearArena& scratch();
+
+    // operator new calls made by the calling thread so far
+    static uint64_t threadAllocations();
+
+    // Assert on heap use once warmup_frames frames have run
+    static void setHeapCheck(bool enabled, int warmup_frames = 120);
+    static bool getHeapCheck();
+
+    // Engine::run brackets every frame with these. other_thread_allocs is
+    // what the render thread allocated for its last packet
+    static void beginFrame();
+    static void endFrame(uint64_t other_thread_allocs = 0);
+
+    static MemoryStats getStats();
+};
+
+// Free list of fixed-size slots, allocated in blocks that are kept until
+// the pool is destroyed
+template <typename T>
+class Pool {
+public:
+    explicit Pool(size_t objects_per_block = 64)
+        : free_list(nullptr), per_block(objects_per_block ? objects_per_block : 1), live(0), capacity(0) {}
+
+    ~Pool() {
+        for (Slot* block : blocks) {
+            ::operator delete(block);
+        }
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (!free_list) {
+            grow();
+        }
+        Slot* slot = free_list;
+        free_list = slot->next;
+        live++;
+        return new (slot->storage) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* object) {
+        if (!object) {
+            return;
+        }
+        object->~T();
+        Slot* slot = (Slot*)object;
+        slot->next = free_list;
+        free_list = slot;
+        live--;
+    }
+
+    // Allocate slots up front so create() does not hit the heap later
+    void reserve(size_t count) {
+        while (capacity - live < count) {
+            grow();
+        }
+    }
+
+    size_t getLiveCount() const { return live; }
+    size_t getCapacity() const { return capacity; }
+
+private:
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    void grow() {
+        Slot* block = (Slot*)::operator new(sizeof(Slot) * per_block);
+        blocks.push_back(block);
+        for (size_t i = 0; i < per_block; i++) {
+            block[i].next = free_list;
+            free_list = &block[i];
+        }
+        capacity += per_block;
+    }
+
+    std::vector<Slot*> blocks;
+    Slot* free_list;
+    size_t per_block;
+    size_t live;
+    size_t capacity;
+};
+
+#endif
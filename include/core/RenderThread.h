@@ -0,0 +1,112 @@
+#ifndef RENDER_THREAD_H
+#define RENDER_THREAD_H
+
+#include <GLFW/glfw3.h>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "math/mat4.h"
+
+// One object to draw. What mesh and object mean is up to the scene that
+// builds the packet and the submit function that consumes it
+struct DrawItem {
+    uint32_t object;    // scene object index (queries, per-object GL state)
+    uint32_t mesh;      // which mesh / VAO
+    int lod;            // -1 when the mesh has no LODs
+    mat4 model;
+    vec3 colour;
+};
+
+// Everything the GL thread needs for one frame, built on the main thread.
+// It is owned by the GL thread from publish() until it has been drawn, so
+// it must not point at simulation state. Vectors keep their capacity from
+// frame to frame, so building a packet does not allocate in steady state.
+struct RenderPacket {
+    uint64_t frame;
+    double alpha;                   // interpolation factor it was built with
+    mat4 view;
+    mat4 proj;
+    vec3 camera_position;
+    uint32_t flags;                 // scene toggles
+    std::vector<DrawItem> draws;
+    std::vector<float> uniforms;    // scene constants
+
+    void clear() {
+        flags = 0;
+        draws.clear();
+        uniforms.clear();
+    }
+};
+
+// Two-stage frame pipeline: the main thread simulates and builds packet
+// N+1 while this thread, which owns the GL context, submits packet N and
+// blocks in glfwSwapBuffers. Packets are double buffered, so the main
+// thread runs at most one frame ahead: acquire() waits while both packets
+// are in flight, which bounds latency to one extra frame.
+//
+//   render_thread.start(window, submit);   // context moves to the thread
+//   each frame:
+//       RenderPacket& packet = render_thread.acquire();
+//       ... fill packet ...
+//       render_thread.publish();
+//   render_thread.stop();                  // context comes back
+//
+// Before each packet the thread runs updateInputGL() (hot reload swaps,
+// screenshots), since the main thread can no longer make GL calls.
+class RenderThread {
+public:
+    typedef std::function<void(const RenderPacket&)> SubmitFunc;
+
+    struct Stats {
+        uint64_t packets;
+        double acquire_wait_ms;     // main thread waiting for a free packet (GL bound)
+        double packet_wait_ms;      // GL thread waiting for a packet (CPU bound)
+        double submit_ms;           // submit function, last packet
+        double swap_ms;             // glfwSwapBuffers, last packet
+        uint64_t heap_allocs;       // operator new calls on this thread, all packets
+    };
+
+    static const int PACKET_COUNT = 2;
+
+    RenderThread();
+    ~RenderThread();
+
+    // Call with window's context current on this thread; it is released
+    // here and made current on the render thread
+    bool start(GLFWwindow* window, const SubmitFunc& submit);
+
+    // Draw what has been published, join, and make the context current on
+    // the calling thread again
+    void stop();
+
+    bool isRunning() const { return running; }
+
+    // Main thread: next packet to fill (cleared), then hand it over
+    RenderPacket& acquire();
+    void publish();
+
+    Stats getStats();
+
+private:
+    void threadLoop();
+
+    GLFWwindow* window;
+    SubmitFunc submit;
+    std::thread thread;
+    bool running;
+
+    RenderPacket packets[PACKET_COUNT];
+    bool in_flight[PACKET_COUNT];       // published and not drawn yet
+    int write_index;                    // main thread
+    int read_index;                     // render thread
+    uint64_t frame;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable cv;
+    Stats stats;
+};
+
+#endif
@@ -0,0 +1,97 @@
+#ifndef SLOT_MAP_H
+#define SLOT_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Values addressed by generational 32-bit handles: 20 bits of slot index
+// and 12 bits of generation. Removing a value bumps its slot's generation,
+// so old handles to the slot stop resolving instead of aliasing whatever
+// reuses it. Lookup is one array index and a compare; freed slots are
+// recycled through a free list threaded through the array. Handle 0 is
+// never issued.
+//
+//   uint32_t handle = map.insert(value);
+//   if (T* value = map.get(handle)) ...
+//   map.remove(handle);
+template <typename T>
+class SlotMap {
+public:
+    static const uint32_t INDEX_BITS = 20;
+    static const uint32_t INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint32_t GENERATION_MASK = (1u << (32 - INDEX_BITS)) - 1;
+    static const uint32_t MAX_SLOTS = INDEX_MASK;   // index INDEX_MASK marks the end of the free list
+
+    SlotMap() : free_head(INDEX_MASK), count(0) {}
+
+    // 0 when all MAX_SLOTS slots are taken
+    uint32_t insert(const T& value) {
+        uint32_t index;
+        if (free_head != INDEX_MASK) {
+            index = free_head;
+            free_head = slots[index].next_free;
+        } else {
+            if (slots.size() >= MAX_SLOTS) {
+                return 0;
+            }
+            index = (uint32_t)slots.size();
+            slots.push_back(Slot());
+            slots[index].generation = 1;
+        }
+        Slot& slot = slots[index];
+        slot.value = value;
+        slot.next_free = INDEX_MASK;
+        slot.live = true;
+        count++;
+        return (slot.generation << INDEX_BITS) | index;
+    }
+
+    // nullptr for stale or invalid handles
+    T* get(uint32_t handle) {
+        uint32_t index = handle & INDEX_MASK;
+        if (index >= slots.size()) {
+            return nullptr;
+        }
+        Slot& slot = slots[index];
+        return slot.live && slot.generation == handle >> INDEX_BITS ? &slot.value : nullptr;
+    }
+
+    const T* get(uint32_t handle) const { return const_cast<SlotMap*>(this)->get(handle); }
+
+    bool remove(uint32_t handle) {
+        if (!get(handle)) {
+            return false;
+        }
+        uint32_t index = handle & INDEX_MASK;
+        Slot& slot = slots[index];
+        slot.live = false;
+        // Generation 0 would make handle 0 valid
+        slot.generation = (slot.generation + 1) & GENERATION_MASK;
+        if (slot.generation == 0) {
+            slot.generation = 1;
+        }
+        slot.next_free = free_head;
+        free_head = index;
+        count--;
+        return true;
+    }
+
+    void reserve(size_t capacity) { slots.reserve(capacity); }
+    size_t size() const { return count; }
+    size_t capacity() const { return slots.size(); }
+
+private:
+    struct Slot {
+        T value;
+        uint32_t generation;
+        uint32_t next_free;
+        bool live;
+    };
+
+    std::vector<Slot> slots;
+    uint32_t free_head;
+    size_t count;
+};
+
+#endif
@@ -6,6 +6,8 @@
 #include "exercises/exercise3.h"
 #include "exercises/exercise4.h"
 #include "exercises/exercise5.h"
-#include "exercises/exercise6.h" 
+#include "exercises/exercise6.h"
+#include "exercises/exercise7.h"
+#include "exercises/exercise8.h"
 
 #endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef EXERCISE7_H
+#define EXERCISE7_H
+
+#include <GLFW/glfw3.h>
+
+void runExercise7(GLFWwindow* window);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,8 @@
+#ifndef EXERCISE8_H
+#define EXERCISE8_H
+
+#include <GLFW/glfw3.h>
+
+void runExercise8(GLFWwindow* window);
+
+#endif
\ No newline at end of file
@@ -0,0 +1,108 @@
+#ifndef CLUSTERED_LIGHTING_H
+#define CLUSTERED_LIGHTING_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "math/mat4.h"
+
+// Clustered forward shading (Olsson et al. 2012).
+//
+// The view frustum is split into a grid_x * grid_y * grid_z froxel grid:
+// screen tiles in x/y and exponential depth slices in z. Every frame the
+// lights are transformed to view space and tested against each froxel's
+// view-space AABB (4 froxels per SSE test, one depth slice per job), then
+// the per-froxel light lists are compacted and uploaded through texture
+// buffers. A fragment finds its froxel from gl_FragCoord and its view depth
+// and only shades the lights in that list.
+//
+// Per frame:
+//   setProjection(...)              - only when the projection changes
+//   update(view, lights, count)     - assign and upload
+//   shader.use(); bind(programme)   - textures + uniforms for the shader
+//
+// Shader interface (see shaders/include/clustered_lights.glsl):
+//   samplerBuffer  cluster_lights   2 texels per light: view pos + radius, colour
+//   usamplerBuffer cluster_grid     per froxel: offset, count
+//   usamplerBuffer cluster_indices  light indices
+//   uvec3 cluster_dims, vec2 cluster_tile_scale, vec2 cluster_z_params
+struct PointLight {
+    vec3 position;     // world space
+    float radius;      // no contribution past this distance
+    vec3 color;
+    float intensity;
+};
+
+class ClusteredLighting {
+public:
+    struct Stats {
+        int lights;
+        int light_indices;           // total entries over all froxels
+        int max_lights_per_cluster;
+        int overflowed_clusters;     // froxels that hit MAX_LIGHTS_PER_CLUSTER
+        double assign_ms;
+        double upload_ms;
+    };
+
+    static const int MAX_LIGHTS_PER_CLUSTER = 256;
+
+    // grid_x * grid_y is rounded up to a multiple of 4 for the SIMD tests
+    ClusteredLighting(int grid_x = 16, int grid_y = 9, int grid_z = 24);
+    ~ClusteredLighting();
+
+    // Create the texture buffers
+    bool init(int max_lights = 1024);
+
+    // Rebuild the froxel bounds for a perspective() projection
+    void setProjection(float fovy, float aspect, float near, float far);
+
+    // Assign lights to froxels on the job system and upload the lists
+    void update(const mat4& view, const PointLight* lights, int count);
+
+    // Bind the buffers to texture units first_unit..first_unit+2 and set the
+    // cluster uniforms on the current programme
+    void bind(GLuint programme, int first_unit = 4);
+
+    const Stats& getStats() const { return stats; }
+    int getMaxLights() const { return max_lights; }
+    int getClusterCount() const { return grid_x * grid_y * grid_z; }
+
+private:
+    // Structure of arrays, one entry per froxel, slice-major
+    struct ClusterBounds {
+        std::vector<float> min_x, min_y, min_z;
+        std::vector<float> max_x, max_y, max_z;
+    };
+
+    struct ViewLight {
+        float x, y, z, radius;
+        int slice_begin, slice_end;  // inclusive depth slice range
+    };
+
+    void assignSlice(int slice);
+
+    int grid_x;
+    int grid_y;
+    int grid_z;
+    int tiles_per_slice;             // grid_x * grid_y padded to 4
+    int max_lights;
+    float near_plane;
+    float far_plane;
+    float z_scale;                   // slice = log(depth) * z_scale + z_bias
+    float z_bias;
+
+    ClusterBounds bounds;
+    std::vector<ViewLight> view_lights;
+    std::vector<uint16_t> slice_lists;   // [cluster][MAX_LIGHTS_PER_CLUSTER]
+    std::vector<uint32_t> slice_counts;  // per cluster
+    std::vector<uint32_t> grid;          // offset, count per cluster
+    std::vector<uint16_t> indices;
+    std::vector<float> light_data;
+
+    GLuint light_buffer, light_texture;
+    GLuint grid_buffer, grid_texture;
+    GLuint index_buffer, index_texture;
+    Stats stats;
+};
+
+#endif
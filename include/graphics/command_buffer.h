@@ -0,0 +1,135 @@
+#ifndef COMMAND_BUFFER_H
+#define COMMAND_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Backend-agnostic draw recording. Nothing here calls GL, so any thread
+// can record; the context thread replays the result (graphics/command_replay.h).
+//
+// Commands are small PODs written back to back into a linear byte buffer
+// that is reset, not freed, every frame. Recording is split into sort
+// segments: begin(key) starts one, and replay runs the segments of every
+// buffer in key order, so workers can record in any order and the GL
+// thread still sees draws grouped by programme and mesh.
+//
+// Per-draw constants go into the buffer's own uniform data (uniformBlock);
+// at replay they are uploaded in one go and bound as ranges of one buffer.
+//
+//   cmd.reset(uniform_alignment);
+//   cmd.begin(sort_key(programme_index, mesh_index, depth));
+//   cmd.bindProgram(programme);
+//   cmd.bindVertexArray(vao);
+//   cmd.uniformBlock(1, &object, sizeof(object));
+//   cmd.draw(index_count, INDEX_TYPE_U32);
+
+enum CommandType : uint32_t {
+    CMD_BIND_PROGRAM,
+    CMD_BIND_VERTEX_ARRAY,
+    CMD_UNIFORM_BLOCK_RANGE,
+    CMD_DRAW,
+    CMD_DRAW_INSTANCED
+};
+
+enum IndexType : uint32_t {
+    INDEX_TYPE_U16,
+    INDEX_TYPE_U32
+};
+
+struct CmdBindProgram {
+    uint32_t type;
+    uint32_t programme;
+};
+
+struct CmdBindVertexArray {
+    uint32_t type;
+    uint32_t vertex_array;
+};
+
+// buffer == 0 binds a range of the recording buffer's uniform data
+struct CmdUniformBlockRange {
+    uint32_t type;
+    uint32_t binding;
+    uint32_t buffer;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct CmdDraw {
+    uint32_t type;
+    uint32_t index_type;
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+};
+
+struct CmdDrawInstanced {
+    uint32_t type;
+    uint32_t index_type;
+    uint32_t index_count;
+    uint32_t first_index;
+    int32_t base_vertex;
+    uint32_t instance_count;
+};
+
+// Programme in the top bits so state changes are rarest, then mesh, then
+// front to back depth (0 = near) to help early-z
+inline uint64_t sort_key(uint32_t programme, uint32_t mesh, float depth01) {
+    if (depth01 < 0.0f) depth01 = 0.0f;
+    if (depth01 > 1.0f) depth01 = 1.0f;
+    return ((uint64_t)(programme & 0xFFFF) << 48) | ((uint64_t)(mesh & 0xFFFF) << 32) |
+           (uint64_t)(uint32_t)(depth01 * 4294967295.0f);
+}
+
+class CommandBuffer {
+public:
+    struct Segment {
+        uint64_t key;
+        uint32_t begin;     // byte range in commands
+        uint32_t end;
+    };
+
+    CommandBuffer();
+
+    // Start a frame with an open segment of key 0. uniform_alignment is the
+    // backend's offset alignment for uniform ranges
+    // (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+    void reset(uint32_t uniform_alignment);
+
+    // Start a sort segment; commands up to the next begin() belong to it
+    void begin(uint64_t key);
+
+    void bindProgram(uint32_t programme);
+    void bindVertexArray(uint32_t vertex_array);
+    void uniformBlockRange(uint32_t binding, uint32_t buffer, uint32_t offset, uint32_t size);
+    void draw(uint32_t index_count, IndexType index_type, uint32_t first_index = 0, int32_t base_vertex = 0);
+    void drawInstanced(uint32_t index_count, IndexType index_type, uint32_t instance_count,
+                       uint32_t first_index = 0, int32_t base_vertex = 0);
+
+    // Copy data into this buffer's uniform data and bind it at binding
+    void uniformBlock(uint32_t binding, const void* data, uint32_t size);
+
+    const std::vector<Segment>& getSegments() const { return segments; }
+    const uint8_t* getCommands() const { return commands.data(); }
+    const uint8_t* getUniformData() const { return uniforms.data(); }
+    size_t getUniformSize() const { return uniform_size; }
+    uint32_t getDrawCount() const { return draw_count; }
+    size_t getCommandBytes() const { return command_size; }
+
+private:
+    // Bump allocation; the vectors only grow, so steady state frames do
+    // not allocate
+    void* push(size_t bytes);
+    void closeSegment();
+
+    std::vector<uint8_t> commands;
+    std::vector<uint8_t> uniforms;
+    std::vector<Segment> segments;
+    size_t command_size;
+    size_t uniform_size;
+    uint32_t uniform_alignment;
+    uint32_t draw_count;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef COMMAND_REPLAY_H
+#define COMMAND_REPLAY_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "graphics/command_buffer.h"
+#include "graphics/render_state.h"
+
+// GL side of command buffers (graphics/command_buffer.h). On the context
+// thread, submit():
+//   1. uploads the uniform data of every buffer into one streaming uniform
+//      buffer (orphaned each frame, so the GPU never waits on it);
+//   2. sorts all sort segments of all buffers by key (ties keep buffer
+//      and recording order, so the result does not depend on which worker
+//      recorded what);
+//   3. replays them through a RenderStateCache, which drops the program,
+//      VAO and uniform range binds that sorting made redundant.
+class CommandReplay {
+public:
+    struct Stats {
+        int buffers;
+        int segments;
+        int draws;
+        size_t command_bytes;
+        size_t uniform_bytes;
+        double upload_ms;
+        double sort_ms;
+        double replay_ms;
+    };
+
+    CommandReplay();
+    ~CommandReplay();
+
+    bool init();
+
+    // Uniform offset alignment to pass to CommandBuffer::reset
+    uint32_t getUniformAlignment() const { return (uint32_t)alignment; }
+
+    void submit(const CommandBuffer* const* buffers, int count, RenderStateCache& state);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct SortEntry {
+        uint64_t key;
+        uint32_t buffer;
+        uint32_t begin;
+        uint32_t end;
+    };
+
+    void upload(const CommandBuffer* const* buffers, int count);
+    void replay(const CommandBuffer& buffer, uint32_t begin, uint32_t end, GLintptr uniform_base,
+                RenderStateCache& state);
+
+    GLuint uniform_buffer;
+    size_t uniform_capacity;
+    GLint alignment;
+    std::vector<SortEntry> entries;
+    std::vector<GLintptr> uniform_bases;
+    Stats stats;
+};
+
+#endif
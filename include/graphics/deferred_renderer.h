@@ -0,0 +1,81 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include "graphics/shader.h"
+#include "math/mat4.h"
+
+class ClusteredLighting;
+
+// Deferred shading with a thin G-buffer (12 bytes per pixel):
+//   RT0 RGBA8   albedo rgb, specular exponent as log2(exp) / 10
+//   RT1 RG16F   octahedral view space normal
+//   depth 24    view position is reconstructed from depth and proj
+//
+// The lighting pass is one fullscreen triangle that looks up each pixel's
+// froxel in a ClusteredLighting grid and shades only the lights listed
+// there, so the per-pixel cost does not depend on overdraw.
+//
+// The G-buffer is single sampled; the lighting pass writes colour only to
+// the default framebuffer (no depth), so forward passes cannot be layered
+// on top without a depth copy.
+//
+// Per frame:
+//   beginGeometryPass()              - bind and clear the G-buffer
+//   draw with a G-buffer shader      - see exercise7/gbuffer_fragment.glsl
+//   endGeometryPass()
+//   lightingPass(proj, clusters)     - after clusters.update(...)
+class DeferredRenderer {
+public:
+    struct Stats {
+        int width;
+        int height;
+        size_t gbuffer_bytes;
+    };
+
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    // Create the G-buffer and load the lighting shader
+    bool init(int width, int height);
+
+    // Reallocate the attachments if the size changed
+    void resize(int width, int height);
+
+    void beginGeometryPass();
+    void endGeometryPass();
+
+    // Fullscreen clustered lighting into the currently bound framebuffer
+    void lightingPass(const mat4& proj, ClusteredLighting& clusters);
+
+    void setShowHeatmap(bool enabled) { show_heatmap = enabled; }
+    void setClearColour(float r, float g, float b) { clear_colour = vec3(r, g, b); }
+
+    const Stats& getStats() const { return stats; }
+
+    static const int BYTES_PER_PIXEL = 12;
+
+private:
+    void lookupUniforms();
+    void createTargets();
+    void destroyTargets();
+
+    GLuint fbo;
+    GLuint albedo_texture;
+    GLuint normal_texture;
+    GLuint depth_texture;
+    GLuint fullscreen_vao;
+
+    Shader lighting_shader;
+    GLint proj_params_loc;
+    GLint heatmap_loc;
+    GLint clear_colour_loc;
+    unsigned int shader_generation;
+
+    bool show_heatmap;
+    vec3 clear_colour;
+    Stats stats;
+};
+
+#endif
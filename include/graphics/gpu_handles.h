@@ -0,0 +1,182 @@
+#ifndef GPU_HANDLES_H
+#define GPU_HANDLES_H
+
+#include "core/SlotMap.h"
+#include "graphics/gpu_resources.h"
+#include <deque>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Handle-based ownership of GL objects with deferred destruction.
+//
+// A GpuHandle is a generational 32-bit id into a SlotMap of GL names.
+// Destroying one makes every copy stale at once (get() returns 0), and the
+// GL name is not deleted straight away: it is queued and only deleted
+// once a fence placed after the last frame that could use it has
+// signalled, so releasing never stalls and never pulls an object out from
+// under a frame the GPU is still drawing. The GpuBuffer, GpuTexture,
+// GpuVertexArray and GpuProgram wrappers do this in their destructors.
+//
+//   GpuBuffer vbo(RESOURCE_VERTEX_BUFFER, "terrain positions");
+//   gpu_buffer_data(vbo.get(), GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+//   // released at end of scope, deleted when the GPU is done with it
+//
+// Classes that keep raw names use gpu_release_* instead of gpu_delete_*.
+// GpuHandles::endFrame() runs on the GL thread after every swap (Engine::run
+// and RenderThread do this) and Engine::shutdown flushes what is left.
+template <GpuObjectType TYPE>
+struct GpuHandle {
+    uint32_t id;
+
+    GpuHandle() : id(0) {}
+    explicit GpuHandle(uint32_t id) : id(id) {}
+    bool valid() const { return id != 0; }
+    bool operator==(const GpuHandle& other) const { return id == other.id; }
+    bool operator!=(const GpuHandle& other) const { return id != other.id; }
+};
+
+typedef GpuHandle<GPU_OBJECT_BUFFER> BufferHandle;
+typedef GpuHandle<GPU_OBJECT_TEXTURE> TextureHandle;
+typedef GpuHandle<GPU_OBJECT_VERTEX_ARRAY> VertexArrayHandle;
+typedef GpuHandle<GPU_OBJECT_PROGRAM> ProgramHandle;
+
+// Queue a raw name for deletion once in-flight frames are done; name is
+// zeroed. Any thread
+void gpu_release_buffer(GLuint& buffer);
+void gpu_release_texture(GLuint& texture);
+void gpu_release_vertex_array(GLuint& vertex_array);
+void gpu_release_program(GLuint& programme);
+
+class GpuHandles {
+public:
+    struct Stats {
+        size_t live_handles;
+        size_t pending;           // released, waiting for a fence
+        size_t fences;            // fences not yet signalled
+        uint64_t deleted;         // names deleted so far
+    };
+
+    static GpuHandles& instance();
+
+    // GL thread (creates the object)
+    template <GpuObjectType TYPE>
+    GpuHandle<TYPE> create(ResourceCategory category, const char* label) {
+        return GpuHandle<TYPE>(create(TYPE, category, label));
+    }
+
+    // The GL name, or 0 for a destroyed or stale handle
+    template <GpuObjectType TYPE>
+    GLuint get(GpuHandle<TYPE> handle) {
+        return lookup(TYPE, handle.id);
+    }
+
+    // Invalidate the handle and queue its object for deletion. Any thread
+    template <GpuObjectType TYPE>
+    void destroy(GpuHandle<TYPE>& handle) {
+        destroy(TYPE, handle.id);
+        handle = GpuHandle<TYPE>();
+    }
+
+    // Queue a name that has no handle (see gpu_release_*). Any thread
+    void release(GpuObjectType type, GLuint name);
+
+    // GL thread, after the swap: fence what was released before the last
+    // frame and delete everything whose fence has signalled
+    void endFrame();
+
+    // GL thread: wait for the GPU and delete everything queued
+    void flush();
+
+    Stats getStats();
+
+private:
+    struct Entry {
+        GLuint name;
+        GpuObjectType type;
+    };
+
+    struct Pending {
+        GpuObjectType type;
+        GLuint name;
+    };
+
+    struct Batch {
+        GLsync fence;
+        std::vector<Pending> objects;
+    };
+
+    GpuHandles();
+    GpuHandles(const GpuHandles&) = delete;
+    GpuHandles& operator=(const GpuHandles&) = delete;
+
+    uint32_t create(GpuObjectType type, ResourceCategory category, const char* label);
+    GLuint lookup(GpuObjectType type, uint32_t id);
+    void destroy(GpuObjectType type, uint32_t id);
+    void deleteObjects(std::vector<Pending>& objects);
+
+    std::mutex mutex;
+    SlotMap<Entry> entries;
+    std::vector<Pending> released;    // since the last endFrame
+    std::vector<Pending> previous;    // released the frame before; may still be in a packet
+    std::deque<Batch> batches;        // fenced, oldest first
+    std::vector<std::vector<Pending>> spare;  // recycled batch vectors
+    uint64_t deleted;
+};
+
+// Owns one GL object through a GpuHandle; move-only. The name is cached,
+// so get() does not go through the slot map
+template <GpuObjectType TYPE>
+class GpuObject {
+public:
+    GpuObject() : name(0) {}
+
+    GpuObject(ResourceCategory category, const char* label)
+        : handle(GpuHandles::instance().create<TYPE>(category, label)), name(GpuHandles::instance().get(handle)) {}
+
+    // Vertex arrays and programmes, which have a category of their own
+    explicit GpuObject(const char* label)
+        : GpuObject(TYPE == GPU_OBJECT_PROGRAM ? RESOURCE_PROGRAM : RESOURCE_VERTEX_ARRAY, label) {
+        static_assert(TYPE == GPU_OBJECT_VERTEX_ARRAY || TYPE == GPU_OBJECT_PROGRAM, "buffers and textures need a category");
+    }
+
+    ~GpuObject() { reset(); }
+
+    GpuObject(GpuObject&& other) : handle(other.handle), name(other.name) {
+        other.handle = GpuHandle<TYPE>();
+        other.name = 0;
+    }
+
+    GpuObject& operator=(GpuObject&& other) {
+        if (this != &other) {
+            reset();
+            std::swap(handle, other.handle);
+            std::swap(name, other.name);
+        }
+        return *this;
+    }
+
+    GpuObject(const GpuObject&) = delete;
+    GpuObject& operator=(const GpuObject&) = delete;
+
+    void reset() {
+        if (handle.valid()) {
+            GpuHandles::instance().destroy(handle);
+        }
+        name = 0;
+    }
+
+    GLuint get() const { return name; }
+    GpuHandle<TYPE> getHandle() const { return handle; }
+
+private:
+    GpuHandle<TYPE> handle;
+    GLuint name;
+};
+
+typedef GpuObject<GPU_OBJECT_BUFFER> GpuBuffer;
+typedef GpuObject<GPU_OBJECT_TEXTURE> GpuTexture;
+typedef GpuObject<GPU_OBJECT_VERTEX_ARRAY> GpuVertexArray;
+typedef GpuObject<GPU_OBJECT_PROGRAM> GpuProgram;
+
+#endif
@@ -0,0 +1,125 @@
+#ifndef GPU_RESOURCES_H
+#define GPU_RESOURCES_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+
+// Every GL buffer, texture, VAO and programme is created and deleted
+// through the gpu_* functions below, which keep a registry of what is
+// alive: a label, a category and, for buffers and textures, its size.
+// From that the registry keeps bytes per category, the peak and optional
+// budgets, prints a report (F1 in the exercises, and at exit) and lists
+// anything still alive at Engine::shutdown as a leak.
+//
+//   GLuint vbo = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, "terrain positions");
+//   gpu_buffer_data(vbo, GL_ARRAY_BUFFER, size, data, GL_STATIC_DRAW);
+//   ...
+//   gpu_delete_buffer(vbo);
+//
+// Sizes are what was asked for; drivers add padding and alignment, so
+// treat the totals as a lower bound. Safe to call from any thread with a
+// current context (hot reload creates textures and programmes off the
+// render thread).
+enum ResourceCategory {
+    RESOURCE_VERTEX_BUFFER,
+    RESOURCE_INDEX_BUFFER,
+    RESOURCE_UNIFORM_BUFFER,
+    RESOURCE_DATA_BUFFER,      // texture buffers, streamed data
+    RESOURCE_TEXTURE,
+    RESOURCE_RENDER_TARGET,
+    RESOURCE_VERTEX_ARRAY,
+    RESOURCE_PROGRAM,
+    RESOURCE_CATEGORY_COUNT
+};
+
+// GL names are only unique per object type
+enum GpuObjectType {
+    GPU_OBJECT_BUFFER,
+    GPU_OBJECT_TEXTURE,
+    GPU_OBJECT_VERTEX_ARRAY,
+    GPU_OBJECT_PROGRAM
+};
+
+const char* resource_category_name(ResourceCategory category);
+
+GLuint gpu_create_buffer(ResourceCategory category, const char* label);
+// Binds buffer to target and (re)allocates it; the registry records size
+void gpu_buffer_data(GLuint buffer, GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+void gpu_delete_buffer(GLuint& buffer);
+
+GLuint gpu_create_texture(ResourceCategory category, const char* label);
+// Record a texture's storage after glTexImage*; see gpu_texture_bytes
+void gpu_texture_size(GLuint texture, size_t bytes);
+void gpu_delete_texture(GLuint& texture);
+
+// Bytes for one 2D image in internal_format, with a full mip chain when
+// mipmaps is set
+size_t gpu_texture_bytes(GLenum internal_format, int width, int height, bool mipmaps = false);
+
+GLuint gpu_create_vertex_array(const char* label);
+void gpu_delete_vertex_array(GLuint& vertex_array);
+
+GLuint gpu_create_program(const char* label);
+void gpu_delete_program(GLuint& programme);
+
+class GpuResources {
+public:
+    struct CategoryStats {
+        int count;
+        size_t bytes;
+        size_t peak_bytes;
+        size_t budget;            // 0 = none
+    };
+
+    struct Report {
+        CategoryStats categories[RESOURCE_CATEGORY_COUNT];
+        int count;
+        size_t bytes;
+        size_t peak_bytes;
+        size_t budget;            // whole GPU, 0 = none
+    };
+
+    static GpuResources& instance();
+
+    void add(GpuObjectType type, GLuint id, ResourceCategory category, const char* label);
+    void resize(GpuObjectType type, GLuint id, size_t bytes);
+    void remove(GpuObjectType type, GLuint id);
+
+    // Exceeding a budget logs a warning once, until usage drops below it again
+    void setBudget(ResourceCategory category, size_t bytes);
+    void setTotalBudget(size_t bytes);
+
+    Report getReport();
+    size_t getTotalBytes();
+
+    // Table of GPU categories plus CPU heap and arena figures (core/Memory.h)
+    void logReport();
+
+    // Log everything still registered; returns how many
+    int checkLeaks();
+
+private:
+    struct Entry {
+        ResourceCategory category;
+        size_t bytes;
+        char label[48];
+    };
+
+    GpuResources();
+    static uint64_t key(GpuObjectType type, GLuint id) { return ((uint64_t)type << 32) | id; }
+    void checkBudget(ResourceCategory category);
+
+    std::mutex mutex;
+    std::unordered_map<uint64_t, Entry> entries;
+    CategoryStats categories[RESOURCE_CATEGORY_COUNT];
+    bool over_budget[RESOURCE_CATEGORY_COUNT];
+    size_t total_bytes;
+    size_t total_peak;
+    size_t total_budget;
+    bool over_total_budget;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+// GPU time of the whole frame and of named passes, from GL_TIMESTAMP
+// queries (glQueryCounter). Results are read FRAME_LATENCY frames later,
+// when the GPU has long finished them, so reading never stalls; a frame
+// whose queries are somehow still pending keeps the previous results.
+//
+// On the thread that owns the context:
+//   beginFrame()                   - the stats overlay calls this before submit
+//   beginPass("gbuffer") ... endPass()
+//   endFrame()                     - after the last draw, before the swap
+//
+// Pass names must be string literals (they are kept by pointer). Passes
+// may nest; each is timed from its own begin to its own end. Disabled,
+// every call is a branch and nothing is issued.
+class GpuTimers {
+public:
+    static const int MAX_PASSES = 16;
+    static const int MAX_DEPTH = 4;
+    static const int FRAME_LATENCY = 3;
+
+    struct Pass {
+        const char* name;
+        int depth;              // nesting level when it began
+        double ms;
+    };
+
+    static GpuTimers& instance();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled; }
+
+    void beginFrame();
+    void endFrame();
+    void beginPass(const char* name);
+    void endPass();
+
+    // Latest resolved frame
+    double getFrameMs() const { return frame_ms; }
+    int getPassCount() const { return result_count; }
+    const Pass& getPass(int index) const { return results[index]; }
+
+    // Query objects, with the context current
+    void shutdown();
+
+private:
+    struct Slot {
+        GLuint queries[2 + MAX_PASSES * 2];     // frame begin, frame end, then begin/end per pass
+        const char* names[MAX_PASSES];
+        int depths[MAX_PASSES];
+        int pass_count;
+        bool issued;
+    };
+
+    GpuTimers();
+    GpuTimers(const GpuTimers&) = delete;
+    GpuTimers& operator=(const GpuTimers&) = delete;
+
+    void resolve(Slot& slot);
+
+    bool enabled;
+    bool created;
+    bool in_frame;
+    int frame_index;
+    Slot slots[FRAME_LATENCY];
+    int open[MAX_DEPTH];        // pass indices not yet ended
+    int open_count;
+    int dropped;                // begins past MAX_PASSES or MAX_DEPTH, ends to skip
+
+    double frame_ms;
+    Pass results[MAX_PASSES];
+    int result_count;
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef IMAGE_PROCESSING_H
+#define IMAGE_PROCESSING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Gamma-correct image processing for the texture pipeline (texconv and
+// anything preparing pixels before Texture::upload).
+//
+// Filtering and blending happen on linear RGBA float images; 8-bit images
+// are decoded into one, processed, and encoded back:
+//
+//   image_decode(albedo, IMAGE_SRGB, linear);
+//   image_premultiply(linear);
+//   image_downscale_kaiser(linear, w / 2, h / 2, half);
+//   image_encode(half, IMAGE_SRGB, out);
+//
+// sRGB decoding is a 256-entry table; encoding is a 4096-entry table
+// indexed by the linear value, exact for every 8-bit round trip and
+// within one level otherwise. Kernels hold one RGBA pixel per 4-wide
+// vector (SSE2 on x86-64, NEON on AArch64, plain floats elsewhere) and
+// split the rows across the job system, so JobSystem::init should have
+// run; without workers they run on the calling thread.
+
+// How the 8-bit channels encode values
+enum ImageEncoding {
+    IMAGE_SRGB,         // colour: sRGB RGB, linear alpha
+    IMAGE_LINEAR,       // data (masks, roughness, ORM): value / 255
+    IMAGE_NORMAL        // tangent-space normal: RGB = xyz * 0.5 + 0.5, linear alpha
+};
+
+// RGBA8, rows tightly packed, first row on top
+struct Image8 {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// RGBA32F, linear (or decoded normal xyz), rows tightly packed
+struct ImageF {
+    int width = 0;
+    int height = 0;
+    std::vector<float> pixels;
+};
+
+// One channel of a packed image: channel of image, or value where image
+// is null
+struct ChannelSource {
+    const Image8* image;
+    int channel;
+    uint8_t value;
+};
+
+void image_decode(const Image8& in, ImageEncoding encoding, ImageF& out);
+void image_encode(const ImageF& in, ImageEncoding encoding, Image8& out);
+
+// RGB *= A. Do this in linear space, before filtering, so coverage and
+// colour are averaged together
+void image_premultiply(ImageF& image);
+
+// Half size (each side rounded down, at least 1), averaging 2x2 blocks;
+// on an odd side the last row or column is counted twice
+void image_downscale_box(const ImageF& in, ImageF& out);
+
+// Any smaller size, separable Kaiser-windowed sinc: sharper than a box
+// and without its aliasing. radius is in output pixels; alpha trades
+// ringing (higher) against blur
+void image_downscale_kaiser(const ImageF& in, int width, int height, ImageF& out, float radius = 3.0f,
+                            float alpha = 4.0f);
+
+// Scale xyz back to unit length, e.g. after filtering a decoded normal
+// map; zero-length normals become (0, 0, 1)
+void image_renormalize(ImageF& image);
+
+// Gather four channels into one image (e.g. an ORM map from separate
+// occlusion, roughness and metallic maps). Every source image must be the
+// out size; false otherwise
+bool image_pack_channels(const ChannelSource sources[4], int width, int height, Image8& out);
+
+// Vector kernels, or the plain float path (for comparison); on by default
+// when a vector backend is compiled in
+void image_set_simd(bool enabled);
+bool image_get_simd();
+const char* image_simd_name();      // "SSE2", "NEON" or "scalar"
+
+#endif
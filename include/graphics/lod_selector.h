@@ -0,0 +1,49 @@
+#ifndef LOD_SELECTOR_H
+#define LOD_SELECTOR_H
+
+#include "graphics/mesh_format.h"
+#include "math/mat4.h"
+
+// Picks a LOD per object from the projected screen-space error.
+//
+// A LOD's object space error e seen at distance d covers
+//   e * viewport_height / (2 * tan(fovy / 2) * d)
+// pixels, using the same fovy as perspective(). The coarsest LOD under the
+// pixel threshold wins. To stop objects flickering between two levels at a
+// boundary, moving to a coarser LOD needs the error to be a further
+// `hysteresis` fraction below the threshold; refining happens immediately.
+//
+//   LodSelector lod;
+//   lod.setProjection(67.0f, (float)g_fb_height);
+//   state[i] = lod.select(mesh.lods.data(), lods, lod_distance(cam, box), state[i]);
+class LodSelector {
+public:
+    LodSelector();
+
+    // Call again whenever the fov or the framebuffer height changes
+    void setProjection(float fovy_degrees, float viewport_height);
+
+    void setThreshold(float pixels) { threshold = pixels; }
+    void setHysteresis(float fraction) { hysteresis = fraction; }
+    float getThreshold() const { return threshold; }
+
+    // Projected size in pixels of an object space error at a distance
+    float screenError(float object_error, float distance) const;
+
+    // lods are finest first with increasing error; current is the level used
+    // last frame (-1 if none). Returns the level to draw.
+    int select(const MeshLod* lods, int lod_count, float distance, int current) const;
+
+private:
+    int coarsestWithin(const MeshLod* lods, int lod_count, float distance, float pixels) const;
+
+    float pixels_per_unit;     // at distance 1
+    float threshold;
+    float hysteresis;
+};
+
+// Distance from the eye to the closest point of a box (never below 1e-3,
+// so objects around the camera always get LOD 0)
+float lod_distance(const vec3& eye, const AABB& box);
+
+#endif
@@ -0,0 +1,61 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "graphics/mesh_format.h"
+#include "graphics/vertex_format.h"
+#include "math/mat4.h"
+
+// GPU mesh loaded from an .amesh file. The file is memory mapped and each
+// stream is uploaded to its VBO directly from the mapping - no parsing and
+// no intermediate copies. Files written without optimisation (and OBJ
+// files) get a LOD chain and go through the mesh optimiser at load time.
+//
+// Meshes built from memory or OBJ can instead be packed into a single
+// interleaved VBO with a VertexFormat; quantized layouts need the shader to
+// apply `dequant` (see VertexDequant::setUniforms).
+class Mesh {
+public:
+    GLuint vao;
+    GLuint ibo;
+    std::vector<GLuint> vbos;
+    GLsizei vertex_count;
+    GLsizei index_count;
+    GLenum index_type;
+    AABB bounds;
+    std::vector<MeshSubmesh> submeshes;
+    std::vector<MeshLod> lods;
+    VertexDequant dequant;
+    size_t vertex_bytes;        // GPU memory used by vertex data
+
+    Mesh();
+    ~Mesh();
+
+    bool loadFromFile(const char* filename);
+    
+    // Import an OBJ file, optionally generating LODs and optimising it
+    bool loadFromObj(const char* filename, bool optimize = true, const VertexFormat* format = nullptr);
+    
+    // Upload a CPU-side mesh (always with 32-bit indices). Without a format
+    // each stream gets its own VBO; with one, float streams at locations
+    // 0-3 (position, normal, texcoord, colour) are interleaved and quantized.
+    bool loadFromData(const MeshData& data, const char* name = "memory", const VertexFormat* format = nullptr);
+
+    // Draw every index (LOD 0) or a single submesh / LOD range
+    void draw();
+    void drawSubmesh(int submesh);
+    void drawLod(int lod);
+
+private:
+    void drawRange(uint32_t index_offset, uint32_t count);
+    void beginUpload(uint32_t stream_count, const char* label);
+    void uploadStream(uint32_t i, uint32_t location, uint32_t components, uint32_t type, bool normalized,
+                      size_t size, const void* data);
+    void endUpload(size_t index_bytes, const void* indices);
+    void release();
+
+    bool loaded;
+};
+
+#endif
@@ -0,0 +1,141 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "core/SlotMap.h"
+#include "graphics/mesh_format.h"
+#include "graphics/vertex_format.h"
+#include "math/mat4.h"
+
+// Engine-wide store of static geometry, shared between everything that
+// draws the same mesh.
+//
+// Meshes are packed with a VertexFormat and suballocated from large pages:
+// one VBO, one 32-bit IBO and one VAO per page, with a page set per vertex
+// format. Every mesh on a page is drawn from the same VAO with
+// glDrawElementsBaseVertex, so a scene sorted by page binds one VAO for
+// many meshes instead of one per mesh, and a few GL objects replace three
+// per mesh.
+//
+// Meshes are deduplicated: load() by path and format, add() by a 64-bit
+// hash of the packed vertices and indices. Each acquire is counted; the
+// space is returned to its page when the last reference is released, and
+// a page is deleted (deferred, see gpu_handles.h) when it becomes empty.
+//
+// Every page VAO also feeds a per-instance draw index (0, 1, 2, ...) to
+// DRAW_INDEX_LOCATION. Shaders that don't declare it never see it;
+// MultiDrawBatch uses it to find each draw's data (see multi_draw.h).
+//
+//   MeshHandle box = MeshCache::instance().add(data, VertexFormat::standard(true, false), "box");
+//   MeshCache::instance().draw(box);
+//   MeshCache::instance().release(box);
+//
+// GL thread only. Pointers returned by get() are valid until the next
+// add(), load() or release().
+struct MeshHandle {
+    uint32_t id;
+
+    MeshHandle() : id(0) {}
+    explicit MeshHandle(uint32_t id) : id(id) {}
+    bool valid() const { return id != 0; }
+    bool operator==(const MeshHandle& other) const { return id == other.id; }
+    bool operator!=(const MeshHandle& other) const { return id != other.id; }
+};
+
+struct CachedMesh {
+    GLuint vao;                 // shared with every mesh on the page
+    uint32_t page;
+    uint32_t first_index;       // in the page's index buffer
+    int32_t base_vertex;        // added to every index
+    uint32_t index_count;       // LOD 0 (or all indices without LODs)
+    uint32_t vertex_count;
+    AABB bounds;
+    VertexDequant dequant;      // for quantized formats
+    std::vector<MeshSubmesh> submeshes;   // index offsets relative to first_index
+    std::vector<MeshLod> lods;
+};
+
+class MeshCache {
+public:
+    // Default page sizes; a mesh larger than a page gets a page of its own
+    static constexpr uint32_t VERTEX_PAGE_BYTES = 4 * 1024 * 1024;
+    static constexpr uint32_t INDEX_PAGE_COUNT = 1024 * 1024;        // 4 MB of 32-bit indices
+
+    // uint attribute, instance i reads i (offset by the base instance)
+    static constexpr GLuint DRAW_INDEX_LOCATION = 7;
+    static constexpr uint32_t MAX_DRAW_INDEX = 65536;
+
+    struct Stats {
+        int meshes;             // unique meshes resident
+        int references;         // outstanding handles
+        uint64_t hits;          // acquires answered without an upload
+        uint64_t uploads;
+        int pages;              // = VBOs = IBOs = VAOs
+        size_t vertex_bytes;    // used / allocated
+        size_t vertex_capacity;
+        size_t index_bytes;
+        size_t index_capacity;
+    };
+
+    static MeshCache& instance();
+
+    // .amesh or .obj (OBJ files are optimised and get LODs, as Mesh does).
+    // Invalid handle on failure
+    MeshHandle load(const char* path, const VertexFormat& format);
+
+    // Float streams at locations 0-3 are packed with format
+    MeshHandle add(const MeshData& data, const VertexFormat& format, const char* name);
+    MeshHandle add(const VertexSource& source, const uint32_t* indices, uint32_t index_count,
+                   const VertexFormat& format, const char* name);
+
+    // Another reference to a resident mesh
+    MeshHandle acquire(MeshHandle handle);
+    void release(MeshHandle& handle);
+
+    const CachedMesh* get(MeshHandle handle) const;
+
+    // Bind the page VAO and draw one LOD, or LOD 0 / the whole mesh with -1
+    void draw(MeshHandle handle, int lod = -1);
+
+    Stats getStats() const;
+
+private:
+    struct Entry {
+        CachedMesh mesh;
+        uint64_t key;           // content hash
+        uint64_t check;         // second content hash, compared on a key hit
+        uint64_t format;        // format_key of the packed vertices
+        std::string path;       // by_path key, for meshes from load()
+        uint32_t index_total;   // every LOD, as allocated on the page
+        int refs;
+    };
+
+    struct Page;
+
+    MeshCache();
+    ~MeshCache();
+    MeshCache(const MeshCache&) = delete;
+    MeshCache& operator=(const MeshCache&) = delete;
+
+    MeshHandle insert(const VertexSource& source, const uint32_t* indices, uint32_t index_count,
+                      const VertexFormat& format, const char* name, const std::vector<MeshSubmesh>& submeshes,
+                      const std::vector<MeshLod>& lods);
+    uint32_t findPage(const VertexFormat& format, uint32_t vertex_count, uint32_t index_count,
+                      uint32_t& vertex_offset, uint32_t& index_offset);
+
+    SlotMap<Entry> entries;
+    std::unordered_map<uint64_t, uint32_t> by_key;          // content hash -> handle
+    std::unordered_map<std::string, uint32_t> by_path;      // path + format -> handle
+    std::vector<std::unique_ptr<Page>> pages;               // empty slots are reused
+    GLuint draw_index_buffer;                               // 0 .. MAX_DRAW_INDEX-1, while any page exists
+    int references;
+    uint64_t hits;
+    uint64_t uploads;
+};
+
+#endif
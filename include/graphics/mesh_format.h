@@ -0,0 +1,142 @@
+#ifndef MESH_FORMAT_H
+#define MESH_FORMAT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// AceEngine binary mesh container (.amesh)
+//
+//   MeshFileHeader                      80 bytes
+//   MeshStreamDesc[stream_count]        one per vertex attribute
+//   MeshSubmesh[submesh_count]
+//   MeshLod[lod_count]
+//   vertex stream data                  each stream 16-byte aligned
+//   index data                          16-byte aligned
+//
+// Every offset is from the start of the file, and all data is stored in the
+// exact layout GL expects, so a loader can mmap the file and hand the
+// pointers straight to glBufferData. Little-endian only.
+
+#define MESH_FILE_MAGIC 0x48534D41u  // "AMSH"
+#define MESH_FILE_VERSION 1u
+#define MESH_FILE_ALIGNMENT 16u
+
+// Component types use the GL enum values so they can be passed through
+#define MESH_TYPE_FLOAT 0x1406u           // GL_FLOAT
+#define MESH_TYPE_UNSIGNED_SHORT 0x1403u  // GL_UNSIGNED_SHORT
+#define MESH_TYPE_UNSIGNED_INT 0x1405u    // GL_UNSIGNED_INT
+
+// Header flags
+#define MESH_FLAG_OPTIMIZED 0x1u          // vertex cache/overdraw/fetch order applied
+
+// Bytes per component of a MESH_TYPE_*
+inline uint32_t mesh_type_size(uint32_t type) {
+    switch (type) {
+        case MESH_TYPE_FLOAT: return 4;
+        case MESH_TYPE_UNSIGNED_INT: return 4;
+        case MESH_TYPE_UNSIGNED_SHORT: return 2;
+        default: return 1;
+    }
+}
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;      // sizeof(MeshFileHeader), for forward compat
+    uint32_t flags;
+    uint32_t vertex_count;
+    uint32_t index_count;
+    uint32_t index_type;       // MESH_TYPE_UNSIGNED_SHORT or _INT
+    uint32_t stream_count;
+    uint32_t submesh_count;
+    uint32_t lod_count;
+    float bounds_min[3];
+    float bounds_max[3];
+    uint64_t index_offset;
+    uint32_t reserved[2];
+};
+
+struct MeshStreamDesc {
+    uint32_t location;         // vertex attribute location
+    uint32_t components;       // 1-4
+    uint32_t type;             // MESH_TYPE_*
+    uint32_t normalized;
+    uint32_t stride;           // bytes between vertices
+    uint32_t reserved;
+    uint64_t offset;           // file offset of the stream data
+    uint64_t size;             // bytes
+};
+
+struct MeshSubmesh {
+    uint32_t index_offset;     // first index (in indices, not bytes)
+    uint32_t index_count;
+    uint32_t material;
+    uint32_t reserved;
+};
+
+struct MeshLod {
+    uint32_t index_offset;
+    uint32_t index_count;
+    float error;               // simplification error relative to LOD 0
+    uint32_t reserved;
+};
+
+static_assert(sizeof(MeshFileHeader) == 80, "MeshFileHeader must stay 80 bytes");
+static_assert(sizeof(MeshStreamDesc) == 40, "MeshStreamDesc layout changed");
+
+// CPU-side mesh used to write .amesh files
+struct MeshData {
+    struct Stream {
+        uint32_t location;
+        uint32_t components;
+        uint32_t type;
+        bool normalized;
+        std::vector<uint8_t> data;
+    };
+
+    uint32_t vertex_count = 0;
+    uint32_t flags = 0;
+    std::vector<Stream> streams;
+    std::vector<uint32_t> indices;
+    std::vector<MeshSubmesh> submeshes;
+    std::vector<MeshLod> lods;
+    float bounds_min[3] = {0.0f, 0.0f, 0.0f};
+    float bounds_max[3] = {0.0f, 0.0f, 0.0f};
+};
+
+// Axis aligned box centred on the origin with per-face normals: 24
+// vertices, float positions at location 0 and normals at location 1
+void make_box_mesh(MeshData& mesh, float half_x, float half_y, float half_z);
+
+// Write a mesh to disk (16-bit indices are used when they fit)
+bool write_mesh_file(const char* path, const MeshData& mesh);
+
+// Read-only memory mapping of an .amesh file. The pointers stay valid until
+// close() or destruction - nothing is copied or parsed.
+class MeshFileView {
+public:
+    MeshFileView();
+    ~MeshFileView();
+
+    bool open(const char* path);
+    void close();
+
+    const MeshFileHeader* header() const { return (const MeshFileHeader*)data; }
+    const MeshStreamDesc* streams() const;
+    const MeshSubmesh* submeshes() const;
+    const MeshLod* lods() const;
+    const void* streamData(uint32_t i) const;
+    const void* indexData() const;
+    size_t indexDataSize() const;
+    size_t fileSize() const { return size; }
+
+private:
+    bool validate(const char* path) const;
+
+    const uint8_t* data;
+    size_t size;
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+struct MeshData;
+
+// Index buffer optimisation for the post-transform vertex cache, overdraw
+// and vertex fetch. Used offline by meshconv and at load time for meshes
+// that were not optimised on disk.
+
+// FIFO cache size assumed for ACMR/ATVR numbers
+#define VERTEX_CACHE_SIZE 16
+
+// Average cache miss ratio (misses per triangle; 0.5 is ideal for large
+// regular grids, 3.0 is the worst case) and average transform to vertex
+// ratio (misses per referenced vertex; 1.0 is ideal)
+struct VertexCacheStats {
+    float acmr;
+    float atvr;
+};
+
+struct MeshOptimizeStats {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint32_t vertices_before;
+    uint32_t vertices_after;
+    int clusters;
+};
+
+// A tightly packed float vertex attribute
+struct VertexStream {
+    const float* data;
+    int components;
+};
+
+// Index generation: find identical vertices across all streams.
+// remap[i] is the new index of old vertex i; returns the unique count.
+size_t generate_vertex_remap(std::vector<uint32_t>& remap, const VertexStream* streams, int stream_count,
+                             size_t vertex_count);
+
+// Compact a stream with a remap table (dst holds unique_count vertices)
+void remap_vertex_buffer(float* dst, const float* src, size_t vertex_count, int components,
+                         const std::vector<uint32_t>& remap);
+
+// Simulate a FIFO cache of cache_size entries over an index buffer
+VertexCacheStats analyze_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count,
+                                      int cache_size = VERTEX_CACHE_SIZE);
+
+// Tipsify (Sander et al. 2007) triangle reordering. If clusters is given it
+// receives the first triangle of every cluster (dead-end restarts).
+void optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count,
+                           int cache_size = VERTEX_CACHE_SIZE, std::vector<uint32_t>* clusters = nullptr);
+
+// Reorder Tipsify clusters so those most likely to occlude the rest are drawn
+// first (sorted by outward facing distance from the mesh centroid). Triangle
+// order inside each cluster is kept, so cache efficiency barely changes.
+void optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count,
+                       const std::vector<uint32_t>& clusters);
+
+// Renumber vertices in first-use order so fetches walk memory linearly.
+// Fills remap (old -> new, UINT32_MAX if unused) and returns the used count.
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& remap, uint32_t* indices, size_t index_count,
+                                   size_t vertex_count);
+
+// Full pipeline on a MeshData: cache + overdraw per submesh range, then
+// vertex fetch reordering of every stream. Sets MESH_FLAG_OPTIMIZED.
+void optimize_mesh(MeshData& mesh, MeshOptimizeStats* stats = nullptr);
+
+#endif
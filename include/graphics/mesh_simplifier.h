@@ -0,0 +1,32 @@
+#ifndef MESH_SIMPLIFIER_H
+#define MESH_SIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+struct MeshData;
+
+// Quadric error metric simplification (Garland & Heckbert 1997) with
+// half-edge collapses: vertices are only ever merged onto existing
+// vertices, so every LOD indexes the original vertex buffer and a LOD
+// chain is just extra index ranges.
+//
+// Open borders are kept in place by perpendicular boundary quadrics and
+// may only collapse along themselves. Attribute seams (several vertices at
+// one position) and non-manifold vertices are locked.
+
+// Simplify a triangle list towards target_index_count. Collapses stop once
+// the geometric error would exceed target_error (object space distance).
+// Writes the result to dst (index_count entries are enough) and returns the
+// new index count; result_error receives the largest error introduced.
+size_t simplify_mesh(uint32_t* dst, const uint32_t* indices, size_t index_count, const float* positions,
+                     size_t vertex_count, size_t target_index_count, float target_error,
+                     float* result_error = nullptr);
+
+// Append a LOD chain to a mesh: each level keeps `reduction` of the previous
+// level's triangles, with MeshLod::error set to the object space error.
+// The chain stops early when a level cannot be reduced meaningfully.
+// Returns the number of LODs (including LOD 0). Run before optimize_mesh.
+int generate_lods(MeshData& mesh, int max_lods = 5, float reduction = 0.5f);
+
+#endif
@@ -0,0 +1,135 @@
+#ifndef MULTI_DRAW_H
+#define MULTI_DRAW_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <vector>
+#include "graphics/mesh_cache.h"
+
+class Shader;
+
+// Draws many MeshCache meshes, each with its own per-draw data, in a few
+// GL calls.
+//
+// add() queues a mesh and returns room for its data (texels_per_draw vec4s:
+// a model matrix, a colour, ...). submit() sorts the draws by page and
+// mesh, uploads the data in that order to a texture buffer and merges
+// repeats of a mesh into one instanced command. Then:
+//   - with ARB_multi_draw_indirect (and ARB_base_instance) the commands go
+//     into an indirect buffer and each page is one
+//     glMultiDrawElementsIndirect;
+//   - on a plain 4.1 context each command is one
+//     glDrawElementsInstancedBaseVertex, so a scene costs a call per
+//     distinct mesh rather than one per object.
+//
+// GLSL 4.10 has neither gl_DrawID nor SSBOs. The draw's row in the data
+// buffer comes from the page VAO's per-instance draw index (see
+// MeshCache::DRAW_INDEX_LOCATION), which the base instance offsets on the
+// indirect path and the draw_base uniform offsets on the fallback:
+//
+//   layout(location = 7) in uint draw_index;
+//   uniform samplerBuffer draw_data;
+//   uniform int draw_base;
+//   int row = (draw_base + int(draw_index)) * TEXELS_PER_DRAW;
+//   vec4 first = texelFetch(draw_data, row);
+//
+// add() only touches CPU memory and may run on any one thread at a time;
+// submit() is GL thread only.
+class MultiDrawBatch {
+public:
+    struct Stats {
+        int draws;
+        int commands;           // after merging repeats into instances
+        int calls;              // GL draw calls issued
+        int pages;              // VAO binds
+        bool indirect;
+        size_t data_bytes;
+        double sort_ms;
+        double upload_ms;
+        double submit_ms;
+    };
+
+    // Look for ARB_multi_draw_indirect and load its entry point; glad was
+    // generated for 4.1 without it. Engine::init calls this once the
+    // context is current
+    static bool initMultiDrawIndirect();
+    static bool isMultiDrawIndirectSupported();
+
+    MultiDrawBatch();
+    ~MultiDrawBatch();
+    MultiDrawBatch(const MultiDrawBatch&) = delete;
+    MultiDrawBatch& operator=(const MultiDrawBatch&) = delete;
+
+    // Create the data and indirect buffers
+    bool init(uint32_t texels_per_draw, const char* label);
+
+    // Forget the queued draws (keeps the memory)
+    void reset();
+
+    // Queue one draw of a mesh (LOD 0 / the whole mesh, or lod) and return
+    // texels_per_draw * 4 floats to fill. nullptr once the batch is full
+    // (MeshCache::MAX_DRAW_INDEX draws, or fewer if the texture buffer
+    // limit is lower)
+    float* add(const CachedMesh& mesh, int lod = -1);
+
+    // Draw everything queued with shader, which must be current. The data
+    // texture is bound to data_unit; draw_data and draw_base are set on the
+    // shader's programme, their locations cached until its generation changes
+    void submit(const Shader& shader, int data_unit = 5);
+
+    // Use the 4.1 path even when multi-draw indirect is available
+    void setIndirect(bool enable) { use_indirect = enable; }
+    bool isIndirect() const { return use_indirect && isMultiDrawIndirectSupported(); }
+
+    uint32_t getDrawCount() const { return (uint32_t)draws.size(); }
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Draw {
+        uint32_t page;
+        GLuint vao;
+        uint32_t first_index;
+        int32_t base_vertex;
+        uint32_t index_count;
+        uint32_t source;        // row in staged
+    };
+
+    struct Uniforms {
+        const Shader* shader;
+        unsigned int generation;    // of shader->programme the locations are from
+        GLint draw_data;
+        GLint draw_base;
+        int data_unit;          // last value set on draw_data
+    };
+
+    const Uniforms& lookupUniforms(const Shader& shader, int data_unit);
+
+    // Layout fixed by the GL spec
+    struct IndirectCommand {
+        GLuint count;
+        GLuint instance_count;
+        GLuint first_index;
+        GLint base_vertex;
+        GLuint base_instance;
+    };
+
+    uint32_t texels_per_draw;
+    uint32_t max_draws;
+    bool use_indirect;
+    GLuint data_buffer;
+    GLuint data_texture;
+    GLuint indirect_buffer;
+    size_t data_capacity;       // bytes allocated for each
+    size_t indirect_capacity;
+
+    std::vector<Draw> draws;
+    std::vector<float> staged;              // in add() order
+    std::vector<float> sorted;              // in submit() order
+    std::vector<IndirectCommand> commands;
+    std::vector<uint32_t> page_starts;      // first command of each page, then commands.size()
+    std::vector<GLuint> page_vaos;
+    std::vector<Uniforms> uniforms;         // per shader submitted with
+    Stats stats;
+};
+
+#endif
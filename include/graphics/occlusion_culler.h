@@ -0,0 +1,84 @@
+#ifndef OCCLUSION_CULLER_H
+#define OCCLUSION_CULLER_H
+
+#include "math/mat4.h"
+#include <cstdint>
+#include <vector>
+
+// CPU occlusion culling with a low resolution software depth buffer.
+//
+// Per frame:
+//   beginFrame(proj * view)
+//   addOccluder(...) for every big, solid mesh
+//   finalize()                      - rasterize occluders + build HiZ pyramid
+//   isVisible(box) / testVisibility - query object bounds before drawing
+//
+// Depth is stored as window z in [0, 1] (1 = far plane). The pyramid keeps
+// the farthest (max) and nearest (min) occluder depth per texel, so a box is
+// hidden when its nearest point lies behind the farthest occluder depth of
+// every texel it covers. Needs no GL context.
+class OcclusionCuller {
+public:
+    struct Stats {
+        int occluder_triangles;
+        int objects_tested;
+        int objects_occluded;
+        double raster_ms;
+        double test_ms;
+    };
+
+    // Width is rounded up to a multiple of 4 for the SIMD rasterizer
+    OcclusionCuller(int width = 256, int height = 128);
+
+    // Clear the depth buffer and set the camera for this frame
+    void beginFrame(const mat4& proj_view);
+
+    // Queue occluder triangles. positions are world-space xyz triples;
+    // indices are optional (nullptr = consecutive triangles)
+    void addOccluder(const float* positions, int vertex_count,
+                     const unsigned int* indices = nullptr, int index_count = 0,
+                     const mat4& model = identity_mat4());
+
+    // Rasterize all queued occluders and build the depth pyramid
+    void finalize();
+
+    // Test a world-space box against the pyramid (conservative)
+    bool isVisible(const AABB& box) const;
+
+    // Test many boxes on the job system; visible[i] is set to 0 or 1
+    void testVisibility(const AABB* boxes, uint32_t count, uint8_t* visible);
+
+    const Stats& getStats() const { return stats; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const float* getDepthBuffer() const { return depth.data(); }
+
+private:
+    struct ScreenTri {
+        float x[3];
+        float y[3];
+        float z[3];
+    };
+
+    struct Level {
+        int width;
+        int height;
+        std::vector<float> max_depth;
+        std::vector<float> min_depth;
+    };
+
+    void addClippedTriangle(const float* a, const float* b, const float* c);
+    void emitTriangle(const float* a, const float* b, const float* c);
+    void rasterizeRows(int row_begin, int row_end);
+    void buildPyramid();
+
+    int width;
+    int height;
+    mat4 proj_view;
+    std::vector<float> depth;
+    std::vector<Level> levels;
+    std::vector<ScreenTri> triangles;
+    Stats stats;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef OCCLUSION_QUERIES_H
+#define OCCLUSION_QUERIES_H
+
+#include <glad/glad.h>
+#include <vector>
+#include "core/Memory.h"
+#include "graphics/shader.h"
+#include "math/mat4.h"
+
+// Hardware occlusion culling with GL_ANY_SAMPLES_PASSED queries.
+//
+// Each object's bounding box is rendered (colour and depth writes off)
+// into a query right before the object itself, in front-to-back order.
+// Results are only read once GL reports them available - normally the
+// next frame - so the CPU never waits on the GPU. Queries in flight are
+// kept in a list of records from a Pool, so beginFrame only polls those.
+// The CPU-side decision
+// uses that previous result with hysteresis; optionally the draw is also
+// wrapped in conditional rendering on the current frame's query.
+//
+// Queries are issued in small batches between the draws, so each box is
+// tested against everything drawn before its batch and the box pass is
+// bound once per batch rather than once per object.
+//
+// Per frame:
+//   beginFrame(proj * view)         - collect finished results
+//   for each batch of objects, front to back:
+//     beginQueries()                - bind the box pass
+//     queryObject(id, box) ...      - issue box query if none in flight
+//     endQueries()                  - write masks back on
+//     bind own programme and VAO
+//     for each object in the batch:
+//       if (isVisible(id)) {
+//           beginConditional(id); draw; endConditional(id);
+//       }
+//
+// Boxes that reach the near plane (the camera inside or right next to
+// them) would be clipped and pass no samples, so they are never queried
+// and count as visible.
+class OcclusionQueryManager {
+public:
+    OcclusionQueryManager();
+    ~OcclusionQueryManager();
+
+    // Create queries for object_count objects and load the box shader
+    bool init(int object_count);
+
+    // Read back every available result from earlier frames (never stalls)
+    void beginFrame(const mat4& proj_view);
+
+    // Bind the box programme and VAO and turn colour and depth writes off.
+    // endQueries only turns the writes back on: the caller binds its own
+    // programme and VAO before drawing again
+    void beginQueries();
+    void endQueries();
+
+    // Render the object's box into its query (skipped if one is still
+    // pending), between beginQueries and endQueries
+    void queryObject(int id, const AABB& box);
+
+    // Visibility from the latest result, filtered by hysteresis
+    bool isVisible(int id) const;
+
+    // Let the GPU discard the draw if this frame's query found no samples
+    void beginConditional(int id);
+    void endConditional(int id);
+
+    void setConditionalRender(bool enabled) { conditional_render = enabled; }
+    bool getConditionalRender() const { return conditional_render; }
+
+    // Consecutive occluded results needed before an object is hidden
+    void setHysteresis(int frames) { hide_after_frames = frames; }
+
+    int getObjectCount() const { return (int)objects.size(); }
+
+private:
+    struct QueryObject {
+        GLuint query;
+        bool pending;          // query issued, result not read yet
+        bool visible;          // filtered visibility used for CPU culling
+        int occluded_frames;   // consecutive "no samples" results
+        uint64_t issued_frame; // frame the query was last issued in
+    };
+
+    // One per query in flight, created when issued, destroyed when read
+    struct PendingQuery {
+        int id;
+        PendingQuery* next;
+    };
+
+    bool reachesNearPlane(const AABB& box) const;
+
+    std::vector<QueryObject> objects;
+    Pool<PendingQuery> pending_pool;
+    PendingQuery* pending_list;
+    uint64_t frame;            // starts at 1 so issued_frame 0 means never
+    Shader box_shader;
+    GLuint box_vao;
+    GLuint box_vbo;
+    GLint proj_view_loc;
+    GLint box_min_loc;
+    GLint box_max_loc;
+    bool conditional_render;
+    int hide_after_frames;
+    mat4 proj_view;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef RENDER_STATE_H
+#define RENDER_STATE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+
+// Shadow copy of the GL bindings draws change most often. Each set call
+// compares against the last value it issued and skips the GL call when
+// nothing changes, so sorted command streams only pay for real changes.
+//
+// The cache cannot see GL calls made around it: call invalidate() after
+// code that binds things directly (or at the start of each frame).
+class RenderStateCache {
+public:
+    struct Stats {
+        int programme_binds;
+        int vertex_array_binds;
+        int uniform_range_binds;
+        int redundant;             // calls skipped because the state matched
+    };
+
+    static const int MAX_UNIFORM_BINDINGS = 16;
+
+    RenderStateCache();
+
+    void useProgram(GLuint programme);
+    void bindVertexArray(GLuint vertex_array);
+    void bindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+
+    // Forget everything; the next call of each kind always reaches GL
+    void invalidate();
+
+    void resetStats() { stats = Stats(); }
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct UniformRange {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    };
+
+    GLuint programme;
+    GLuint vertex_array;
+    UniformRange uniform_ranges[MAX_UNIFORM_BINDINGS];
+    bool valid_programme;
+    bool valid_vertex_array;
+    bool valid_ranges[MAX_UNIFORM_BINDINGS];
+    Stats stats;
+};
+
+#endif
@@ -2,20 +2,79 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <cstddef>
 #include <string>
+#include <vector>
+
+// A programme compiled from a Shader's sources but not installed yet
+struct ShaderBuild {
+    GLuint programme = 0;
+    GLuint vertex_shader = 0;
+    GLuint fragment_shader = 0;
+    std::vector<std::string> files;   // every file read, includes too
+    size_t vertex_file_count = 0;     // files[0, n) belong to the vertex stage
+    bool ok = false;
+};
 
 class Shader {
 public:
     GLuint programme;
     
+    // Incremented whenever programme is replaced (reload, hot swap); cached
+    // uniform locations from an older generation must be looked up again
+    unsigned int generation;
+    
     Shader();
     ~Shader();
     
-    // Load and compile shaders from files
+    // Load and compile shaders from files (#include is resolved, see
+    // graphics/shader_preprocessor.h)
     bool loadFromFiles(const std::string& vertex_path, const std::string& fragment_path);
+
+    // Same, with "#define NAME 1" lines injected after #version for each
+    // entry (a "NAME VALUE" entry defines NAME as VALUE)
+    bool loadFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                       const std::vector<std::string>& defines);
+
+    // Insert the defines after the #version line, followed by a #line
+    // directive so compiler messages keep the file's line numbers
+    static std::string injectDefines(const std::string& source, const std::vector<std::string>& defines);
     
-    // Reload shaders (for live editing)
+    // Reload shaders (for live editing). Uniform values are carried over
+    // to the new programme
     bool reload();
+
+    // Compile and link from the stored paths without touching this Shader.
+    // buildFromFiles is safe on any thread whose context shares objects
+    // with the render context
+    bool build(ShaderBuild& out) const;
+    static bool buildFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                               const std::vector<std::string>& defines, ShaderBuild& out);
+
+    // buildFromFiles in two halves. submitFromFiles issues the compile and
+    // link calls without querying any status, so a driver with a threaded
+    // compiler keeps working in the background (false only if a file could
+    // not be read). completeBuild queries the compile and link status,
+    // which waits for that work, and logs any errors
+    static bool submitFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                                const std::vector<std::string>& defines, ShaderBuild& out);
+    static bool completeBuild(ShaderBuild& result);
+
+    // Set the paths and defines reload() and build() use, for Shaders that
+    // are installed from a build instead of loadFromFiles
+    void setSources(const std::string& vertex_path, const std::string& fragment_path,
+                    const std::vector<std::string>& defines);
+
+    // Swap in a successful build (render thread), optionally copying the
+    // current uniform values into it, and delete the old programme
+    void install(ShaderBuild& result, bool keep_uniforms = true);
+
+    // Delete whatever a failed or unwanted build created
+    static void discardBuild(ShaderBuild& result);
+
+    const std::string& getVertexPath() const { return vertex_path; }
+    const std::string& getFragmentPath() const { return fragment_path; }
+    const std::vector<std::string>& getDefines() const { return defines; }
     
     // Use this shader
     void use();
@@ -26,15 +85,16 @@ public:
     // Validate shader (only use during development)
     bool validate();
     
-    // Get uniform location
-    GLint getUniformLocation(const std::string& name);
+    // Get uniform location. Names are plain C strings so per-frame calls
+    // with literals do not build a std::string each time
+    GLint getUniformLocation(const char* name);
     
     // Set uniform values (with automatic use() check)
-    void setUniform(const std::string& name, int value);
-    void setUniform(const std::string& name, float value);
-    void setUniform(const std::string& name, float x, float y);
-    void setUniform(const std::string& name, float x, float y, float z);
-    void setUniform(const std::string& name, float x, float y, float z, float w);
+    void setUniform(const char* name, int value);
+    void setUniform(const char* name, float value);
+    void setUniform(const char* name, float x, float y);
+    void setUniform(const char* name, float x, float y, float z);
+    void setUniform(const char* name, float x, float y, float z, float w);
     
     // Print all shader info
     void printAll();
@@ -46,12 +106,15 @@ private:
     // Store paths for reloading
     std::string vertex_path;
     std::string fragment_path;
+    std::vector<std::string> defines;
     
     // Helper functions
-    bool compileShader(GLuint shader_index, const std::string& source);
-    bool linkProgram();
-    void printShaderInfoLog(GLuint shader_index);
-    void printProgramInfoLog(GLuint programme);
+    static bool checkCompile(GLuint shader_index);
+    static bool checkLink(GLuint programme);
+    static void copyUniforms(GLuint from, GLuint to);
+    static void printShaderInfoLog(GLuint shader_index);
+    static void printSourceFiles(const std::vector<std::string>& files);
+    static void printProgramInfoLog(GLuint programme);
     const char* glTypeToString(GLenum type);
 };
 
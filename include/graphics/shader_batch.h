@@ -0,0 +1,85 @@
+#ifndef SHADER_BATCH_H
+#define SHADER_BATCH_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include "graphics/shader.h"
+
+// Compile many programmes at once.
+//
+// Shader::loadFromFiles queries GL_COMPILE_STATUS right after each compile,
+// which makes the driver finish that shader before the next one is even
+// submitted. A batch submits every programme first (compile + link, no
+// queries) and only then looks at the results:
+//   - with KHR_parallel_shader_compile (or the ARB version) poll() asks
+//     GL_COMPLETION_STATUS_KHR, which never blocks, and installs each
+//     programme into its Shader the moment it is ready;
+//   - without it the status checks are simply deferred until poll() or
+//     finish(), which still lets a driver that compiles on its own
+//     threads overlap the whole batch.
+//
+//   ShaderBatch batch;
+//   batch.add(&sky, "sky.vert", "sky.frag");
+//   batch.add(&terrain, "terrain.vert", "terrain.frag", {"USE_FOG"});
+//   batch.submit();
+//   ... each frame: batch.poll(); draw with shaders whose programme != 0
+//   ... or: batch.finish();
+//
+// Targets must outlive the batch (or the batch must be finished first).
+class ShaderBatch {
+public:
+    struct Stats {
+        int submitted;
+        int installed;
+        int failed;
+        double submit_ms;          // preprocessing + GL calls in submit()
+        double first_ready_ms;     // submit() start to the first installed programme
+        double total_ms;           // submit() start to the last result
+    };
+
+    // Look for the extension and ask for as many compiler threads as the
+    // driver will give. Engine::init calls this once the context is current
+    static bool initParallelCompile();
+    static bool isParallelCompileSupported();
+
+    ShaderBatch();
+    ~ShaderBatch();
+
+    // Queue a programme; its paths are stored in target for reload()
+    void add(Shader* target, const std::string& vertex_path, const std::string& fragment_path,
+             const std::vector<std::string>& defines = std::vector<std::string>());
+
+    // Start compiling everything queued
+    void submit();
+
+    // Install what has finished and return how many are still pending.
+    // Non-blocking with the extension; otherwise it completes the batch
+    int poll();
+
+    // Wait for the rest; true if every programme compiled and linked
+    bool finish();
+
+    bool isDone() const { return queued.empty() && pending.empty(); }
+    int getPendingCount() const { return (int)(queued.size() + pending.size()); }
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Entry {
+        Shader* target;
+        std::string vertex_path;
+        std::string fragment_path;
+        std::vector<std::string> defines;
+        ShaderBuild build;
+    };
+
+    void complete(Entry& entry);
+    double elapsedMs() const;
+
+    std::vector<Entry> queued;
+    std::vector<Entry> pending;
+    std::chrono::high_resolution_clock::time_point start;
+    Stats stats;
+};
+
+#endif
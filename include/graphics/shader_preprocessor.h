@@ -0,0 +1,69 @@
+#ifndef SHADER_PREPROCESSOR_H
+#define SHADER_PREPROCESSOR_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+class Shader;
+
+// GLSL #include resolution.
+//
+//   #include "octahedral.glsl"
+//
+// is looked up relative to the including file, then in SHADER_INCLUDE_DIR.
+// Every file is pasted at most once per shader (an implicit include guard,
+// so shared headers may include each other freely and cycles terminate).
+// "#line <line> <source>" directives are emitted around each inclusion:
+// source 0 is the root file and includes are numbered in order of first
+// appearance, matching ShaderSource::files, so a driver message such as
+// "2:14" means line 14 of files[2].
+#define SHADER_INCLUDE_DIR "shaders/include"
+
+struct ShaderSource {
+    std::string code;
+    std::vector<std::string> files;   // normalised paths, index = GLSL source string number
+};
+
+// Resolve includes starting at path. On failure returns false and sets
+// error to "file:line: message"
+bool preprocess_shader(const std::string& path, ShaderSource& out, std::string* error = nullptr);
+
+// Lexically normalised path ("a/./b/../c.glsl" -> "a/c.glsl")
+std::string normalize_shader_path(const std::string& path);
+
+// Which shader programmes were built from which files. Shaders register
+// themselves on every successful load, so an edited file maps to exactly
+// the programmes that need rebuilding. Every call takes the graph's lock:
+// Shaders are installed and re-registered on the render thread but created
+// and destroyed on the main thread.
+class ShaderDependencyGraph {
+public:
+    static ShaderDependencyGraph& instance();
+
+    void setDependencies(Shader* shader, const std::vector<std::string>& files);
+    void remove(Shader* shader);
+
+    // Shaders that include (directly or not) the given file
+    std::vector<Shader*> dependents(const std::string& file) const;
+    std::vector<std::string> dependencies(Shader* shader) const;
+
+    // Every file any live shader depends on
+    std::vector<std::string> files() const;
+
+private:
+    ShaderDependencyGraph() = default;
+
+    void removeLocked(Shader* shader);
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, std::unordered_set<Shader*>> file_to_shaders;
+    std::unordered_map<Shader*, std::vector<std::string>> shader_to_files;
+};
+
+// Reload only the shaders that depend on file; returns how many were rebuilt
+int reload_shaders_depending_on(const std::string& file);
+
+#endif
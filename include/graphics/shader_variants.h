@@ -0,0 +1,68 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "graphics/shader.h"
+
+// Shader permutations: one vertex/fragment source pair compiled with
+// different #define sets. Bit i of a variant key enables option i, so
+// use-site branches such as "#ifdef USE_BLINN" are resolved by the GLSL
+// compiler instead of a per-fragment uniform test.
+//
+// Variants are compiled on first use and kept for the lifetime of the
+// cache; precompile() front-loads the ones a scene is known to need. A
+// variant that fails to compile stays cached without a programme, so hot
+// reload or reloadAll() can build it again once the source is fixed.
+//
+//   ShaderVariants phong;
+//   phong.init(vs, fs, {"USE_BLINN", "TWO_LIGHTS"});
+//   Shader* shader = phong.get(use_blinn ? 1 : 0);
+class ShaderVariants {
+public:
+    struct Stats {
+        int variants;              // cached with a programme
+        int failed;                // cached without one (compile failed)
+        double total_compile_ms;   // compile + link over all variants
+        double last_compile_ms;
+    };
+
+    static const int MAX_OPTIONS = 32;
+
+    ShaderVariants();
+
+    // Option names, in bit order. An entry may carry a value: "LIGHT_COUNT 4"
+    void init(const std::string& vertex_path, const std::string& fragment_path,
+              const std::vector<std::string>& options);
+
+    // Variant for a key, compiling it on the first request. nullptr while
+    // the variant has no programme; a failed compile is not retried here
+    Shader* get(uint32_t key);
+
+    // Compile every listed variant now, as one ShaderBatch; returns false
+    // if any failed
+    bool precompile(const std::vector<uint32_t>& keys);
+
+    // Recompile every cached variant from disk, including failed ones (a
+    // variant that fails again keeps its old programme)
+    void reloadAll();
+
+    // Define list for a key
+    std::vector<std::string> definesFor(uint32_t key) const;
+
+    int getVariantCount() const;
+    Stats getStats() const;
+
+private:
+    std::string vertex_path;
+    std::string fragment_path;
+    std::vector<std::string> options;
+    std::unordered_map<uint32_t, std::unique_ptr<Shader>> cache;   // programme 0 = failed
+    double total_compile_ms;
+    double last_compile_ms;
+};
+
+#endif
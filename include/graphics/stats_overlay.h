@@ -0,0 +1,112 @@
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include <glad/glad.h>
+#include "core/Memory.h"
+#include "graphics/shader.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// In-viewport frame statistics, drawn on top of the frame by the thread
+// that swaps (the render thread, or the main thread with --serial):
+//   - frame time graph (bars) with GPU frame time (marks), last 240 frames
+//   - mean, p50 / p95 / p99 and jitter of the frame time
+//   - CPU submit and GPU frame time, GPU time per pass (GpuTimers)
+//   - draw calls, triangles and state changes (g_frame_stats)
+//   - GPU memory, heap allocations and frame arena use
+//
+// Text uses the 8x8 KC85/4 font from the vendored sokol_debugtext.h in
+// an R8 atlas; every glyph and rectangle is one instance of a 4-vertex
+// strip, so the whole overlay is one buffer upload and one instanced
+// draw. F4 toggles it; hidden it costs a flag test and a clock read per
+// frame, and it shows its own CPU cost when visible.
+class StatsOverlay {
+public:
+    static const int HISTORY = 240;         // frames in the graph and the percentiles
+    static const int MAX_QUADS = 4096;
+
+    struct Stats {
+        int quads;
+        double cpu_ms;          // last endFrame: build, upload and draw
+        double gpu_ms;          // the overlay's own pass, a few frames late
+    };
+
+    static StatsOverlay& instance();
+
+    // Any thread; applied at the next beginFrame
+    void setVisible(bool visible);
+    bool isVisible() const { return visible.load(std::memory_order_relaxed); }
+    void toggle();
+
+    // Main thread, once per frame after Memory::endFrame (Engine::run)
+    void setMemoryStats(const MemoryStats& memory);
+
+    // Swapping thread, with the context current: beginFrame before the
+    // frame's first draw, endFrame after its last and before the swap
+    void beginFrame();
+    void endFrame();
+
+    const Stats& getStats() const { return stats; }
+
+    // GL objects, on the thread that owns the context
+    void shutdown();
+
+private:
+    struct Quad {
+        int16_t x, y, width, height;
+        uint16_t glyph;
+        uint16_t padding;
+        uint8_t colour[4];
+    };
+
+    typedef std::chrono::high_resolution_clock Clock;
+
+    StatsOverlay();
+    StatsOverlay(const StatsOverlay&) = delete;
+    StatsOverlay& operator=(const StatsOverlay&) = delete;
+
+    bool createResources();
+    void lookupUniforms();
+    void build();
+    void draw();
+
+    void rect(int x, int y, int width, int height, uint32_t colour);
+    int text(int x, int y, uint32_t colour, const char* format, ...);
+
+    std::atomic<bool> visible;
+    bool active;                // visible as of this frame's beginFrame
+    bool created;
+    bool failed;
+
+    // Swapping thread only
+    Clock::time_point frame_start;
+    Clock::time_point last_end;
+    bool has_last_end;
+    float frame_ms[HISTORY];    // end to end
+    float cpu_ms[HISTORY];      // begin to end: the frame's submit
+    float gpu_ms[HISTORY];      // GpuTimers frame time, 0 while hidden
+    int history_index;
+    int history_count;
+
+    std::unique_ptr<Shader> shader;
+    GLuint font_texture;
+    GLuint vertex_buffer;
+    GLuint vertex_array;
+    GLint screen_size_loc;
+    GLint glyph_count_loc;
+    GLint font_loc;
+    unsigned int shader_generation;
+    std::vector<Quad> quads;
+    int scale;
+
+    std::mutex memory_mutex;
+    MemoryStats memory;
+
+    Stats stats;
+};
+
+#endif
@@ -2,14 +2,24 @@
 #define TEXTURE_H
 
 #include <glad/glad.h>
+#include <cstddef>
 #include <string>
 
+// Decoded RGBA8 pixels; decoding touches no GL state, so it can run on any thread
+struct TextureImage {
+    unsigned char* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    int channels = 0;   // in the file; pixels always hold 4
+};
+
 class Texture {
 public:
     GLuint id;
     int width;
     int height;
     int channels;
+    size_t bytes;       // GPU storage (always RGBA8)
     
     Texture();
     ~Texture();
@@ -17,9 +27,21 @@ public:
     bool loadFromFile(const char* filename, bool flip_vertically = true);
     void bind(GLuint texture_unit = 0);
     void unbind();
+
+    // Split load for background reloads: decode anywhere, upload on a
+    // thread with a (shared) current context, replace on the render thread
+    static bool decode(const char* filename, bool flip_vertically, TextureImage& out);
+    static void freeImage(TextureImage& image);
+    static GLuint upload(const TextureImage& image, const char* label);
+    void replace(GLuint new_id, int new_width, int new_height, int new_channels);
+
+    const std::string& getPath() const { return path; }
+    bool getFlipVertically() const { return flip; }
     
 private:
     bool loaded;
+    std::string path;
+    bool flip;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,112 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Declarative interleaved vertex layouts with quantized encodings.
+//
+// A VertexFormat lists (semantic, encoding, location) entries; offsets and
+// the stride are derived from it, pack_vertices() converts float source data
+// into one interleaved buffer and createVAO() sets up every attribute.
+//
+//   float  pos + normal + uv   12 + 12 + 8 = 32 bytes
+//   compact                     8 +  4 + 4 = 16 bytes
+
+#define VERTEX_FORMAT_MAX_ATTRIBS 8
+
+enum VertexSemantic {
+    VERTEX_POSITION,
+    VERTEX_NORMAL,
+    VERTEX_TEXCOORD,
+    VERTEX_COLOR,
+    VERTEX_SEMANTIC_COUNT
+};
+
+enum VertexEncoding {
+    VERTEX_FLOAT2,          //  8 bytes
+    VERTEX_FLOAT3,          // 12 bytes
+    VERTEX_FLOAT4,          // 16 bytes
+    VERTEX_HALF4,           //  8 bytes, xyz half float, w = 1
+    VERTEX_SNORM16X4,       //  8 bytes, xyz in [-1,1] of the mesh bounds, w = 1
+    VERTEX_OCT_2_10_10_10,  //  4 bytes, octahedral unit vector in x/y (GL_INT_2_10_10_10_REV)
+    VERTEX_UNORM16X2,       //  4 bytes, [0,1] of the mesh UV range
+    VERTEX_UNORM8X4         //  4 bytes, colour
+};
+
+struct VertexAttrib {
+    VertexSemantic semantic;
+    VertexEncoding encoding;
+    uint32_t location;
+    uint32_t offset;        // bytes from the start of the vertex
+};
+
+// Quantized positions and UVs are stored relative to the mesh ranges;
+// shaders rebuild them as offset + scale * attribute.
+struct VertexDequant {
+    float pos_offset[3] = {0.0f, 0.0f, 0.0f};
+    float pos_scale[3] = {1.0f, 1.0f, 1.0f};
+    float uv_offset[2] = {0.0f, 0.0f};
+    float uv_scale[2] = {1.0f, 1.0f};
+
+    // Set pos_offset/pos_scale/uv_offset/uv_scale on the bound programme
+    // (uniforms the shader does not declare are skipped)
+    void setUniforms(GLuint programme) const;
+};
+
+// Float source data, one tightly packed array per semantic (nullptr = absent).
+// Missing attributes are filled with defaults (normal +Z, uv 0, colour white).
+struct VertexSource {
+    const float* data[VERTEX_SEMANTIC_COUNT] = {nullptr, nullptr, nullptr, nullptr};
+    int components[VERTEX_SEMANTIC_COUNT] = {3, 3, 2, 3};
+    size_t vertex_count = 0;
+};
+
+class VertexFormat {
+public:
+    VertexFormat();
+
+    // Append an attribute; the offset is the current stride
+    VertexFormat& add(VertexSemantic semantic, VertexEncoding encoding, uint32_t location);
+
+    uint32_t stride() const { return vertex_stride; }
+    int attribCount() const { return count; }
+    const VertexAttrib& attrib(int i) const { return attribs[i]; }
+    const VertexAttrib* find(VertexSemantic semantic) const;
+
+    // glVertexAttribPointer + enable for every attribute, sourcing from the
+    // GL_ARRAY_BUFFER currently bound (base_offset in bytes)
+    void apply(size_t base_offset = 0) const;
+
+    // New VAO over vbo (and ibo if non-zero). Leaves no VAO bound.
+    GLuint createVAO(GLuint vbo, GLuint ibo = 0) const;
+
+    // Layouts used by the engine: all float, and the quantized equivalent.
+    // Locations are 0 position, 1 normal, 2 texcoord, 3 colour.
+    static VertexFormat standard(bool normals, bool texcoords, bool colors = false);
+    static VertexFormat compact(bool normals, bool texcoords, bool colors = false);
+
+private:
+    VertexAttrib attribs[VERTEX_FORMAT_MAX_ATTRIBS];
+    int count;
+    uint32_t vertex_stride;
+};
+
+// Bytes per vertex of an encoding
+uint32_t vertex_encoding_size(VertexEncoding encoding);
+
+// Interleave and quantize source data into out (vertex_count * stride bytes).
+// dequant receives the ranges needed to decode positions and UVs.
+void pack_vertices(const VertexFormat& format, const VertexSource& source, std::vector<uint8_t>& out,
+                   VertexDequant* dequant = nullptr);
+
+// Scalar encoders (exposed for tools and tests of the shader decoders)
+uint16_t float_to_half(float f);
+int16_t quantize_snorm16(float v);
+uint16_t quantize_unorm16(float v);
+uint8_t quantize_unorm8(float v);
+uint32_t encode_oct_normal(float x, float y, float z);
+
+#endif
@@ -68,6 +68,10 @@ vec3 subtract(const vec3& a, const vec3& b);
 vec3 add(const vec3& a, const vec3& b);
 float dot(const vec3& a, const vec3& b);
 
+// Linear interpolation, t = 0 gives a
+float lerp(float a, float b, float t);
+vec3 lerp(const vec3& a, const vec3& b, float t);
+
 // Frustum culling
 struct Plane {
     vec3 normal;
@@ -81,6 +85,15 @@ struct Frustum {
     Plane planes[6]; // left, right, bottom, top, near, far
 };
 
+// Axis-aligned bounding box
+struct AABB {
+    vec3 min;
+    vec3 max;
+    
+    AABB() {}
+    AABB(const vec3& mn, const vec3& mx) : min(mn), max(mx) {}
+};
+
 // Extract frustum planes from projection * view matrix
 Frustum extract_frustum(const mat4& proj_view);
 
@@ -90,4 +103,7 @@ bool point_in_frustum(const Frustum& frustum, const vec3& point);
 // Check if a sphere is inside the frustum
 bool sphere_in_frustum(const Frustum& frustum, const vec3& center, float radius);
 
+// Check if an AABB is inside (or intersects) the frustum
+bool aabb_in_frustum(const Frustum& frustum, const AABB& box);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,22 @@
+#ifndef FRAME_STATS_H
+#define FRAME_STATS_H
+
+#define FRAME_STATS_MAX_LODS 8
+
+// Per-frame rendering counters. Systems add to these while drawing;
+// reset_frame_stats() is called once at the start of every frame.
+struct FrameStats {
+    int draw_calls;
+    int triangles;
+    int occlusion_queries;     // bounding box queries issued this frame
+    int draw_calls_saved;      // draws skipped because the object was occluded
+    int state_changes;         // programme, vertex array and uniform range binds issued
+    int lod_histogram[FRAME_STATS_MAX_LODS];  // draws per selected LOD
+};
+
+extern FrameStats g_frame_stats;
+
+// Clear all counters for the next frame
+void reset_frame_stats();
+
+#endif
@@ -0,0 +1,48 @@
+#ifndef OBJ_LOADER_H
+#define OBJ_LOADER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct MeshData;
+
+// Indexed mesh imported from a Wavefront OBJ file. Vertices are unique
+// position/texcoord/normal tuples; attribute arrays are tightly packed
+// (3 floats position, 3 floats normal, 2 floats texcoord per vertex).
+struct ObjMesh {
+    struct Group {
+        std::string name;        // from "o", "g" or "usemtl"
+        uint32_t index_offset;
+        uint32_t index_count;
+    };
+
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<uint32_t> indices;
+    std::vector<Group> groups;
+    bool has_normals = false;
+    bool has_texcoords = false;
+
+    uint32_t vertexCount() const { return (uint32_t)(positions.size() / 3); }
+};
+
+// Import timings; MB/s covers the whole import (parse + deduplication)
+struct ObjImportStats {
+    double file_mb;
+    double parse_ms;
+    double total_ms;
+    double mb_per_s;
+    int chunks;
+};
+
+// Parse an OBJ file (polygons are triangulated as fans). The file is split
+// into line-aligned chunks parsed in parallel on the job system, then vertex
+// tuples are deduplicated in file order.
+bool load_obj(const char* path, ObjMesh& mesh, ObjImportStats* stats = nullptr);
+
+// Convert to the binary mesh layout: location 0 position, 1 normal, 2 texcoord
+void obj_to_mesh_data(const ObjMesh& obj, MeshData& mesh);
+
+#endif
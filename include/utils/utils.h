@@ -2,16 +2,18 @@
 #define UTILS_H
 
 #include <GLFW/glfw3.h>
+#include <atomic>
 #include <string>
 
 // Forward declaration
 class Shader;
 
-// Global window dimensions
+// Global window dimensions. The framebuffer size is written by the resize
+// callback on the main thread and read by whichever thread owns the context
 extern int g_win_width;
 extern int g_win_height;
-extern int g_fb_width;
-extern int g_fb_height;
+extern std::atomic<int> g_fb_width;
+extern std::atomic<int> g_fb_height;
 
 // Global window title (stored so FPS counter can append to it)
 extern std::string g_window_title;
@@ -25,6 +27,12 @@ void updateInput(GLFWwindow* window);
 // Update input with shader reload (R key) AND screenshot (P key)
 void updateInputWithShaderReload(GLFWwindow* window, Shader* shader1, Shader* shader2 = nullptr);
 
+// GL half of the two above: hot reload swaps, queued reloads and
+// screenshots, the viewport after a resize, periodic error checks. They run it themselves when the
+// calling thread owns the context; otherwise the render thread calls it
+// once per frame (see core/RenderThread.h)
+void updateInputGL();
+
 // Update FPS counter in window title (appends to g_window_title)
 void update_fps_counter(GLFWwindow* window);
 
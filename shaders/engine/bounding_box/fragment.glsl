@@ -0,0 +1,9 @@
+#version 410
+
+out vec4 frag_colour;
+
+// Colour writes are masked off while querying; this only matters when
+// the boxes are drawn for debugging
+void main() {
+    frag_colour = vec4(1.0, 1.0, 0.0, 1.0);
+}
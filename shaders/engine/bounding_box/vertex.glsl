@@ -0,0 +1,12 @@
+#version 410
+
+layout(location = 0) in vec3 vertex_position;  // unit cube corner in [0, 1]
+
+uniform mat4 proj_view;
+uniform vec3 box_min;
+uniform vec3 box_max;
+
+void main() {
+    vec3 world_position = mix(box_min, box_max, vertex_position);
+    gl_Position = proj_view * vec4(world_position, 1.0);
+}
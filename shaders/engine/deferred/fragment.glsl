@@ -0,0 +1,50 @@
+#version 410
+
+// Thin G-buffer (see include/graphics/deferred_renderer.h)
+uniform sampler2D gbuffer_albedo;        // rgb albedo, a = log2(specular exponent) / 10
+uniform sampler2D gbuffer_normal;        // octahedral view space normal
+uniform sampler2D gbuffer_depth;
+uniform vec4 proj_params;                // 1 / proj[0][0], 1 / proj[1][1], proj[2][2], proj[3][2]
+
+#include "clustered_lights.glsl"
+#include "octahedral.glsl"
+
+uniform int show_heatmap;
+uniform vec3 clear_colour;
+
+out vec4 fragment_colour;
+
+const vec3 ambient = vec3(0.03, 0.03, 0.04);
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gbuffer_depth, pixel, 0).r;
+    if (depth == 1.0) {
+        fragment_colour = vec4(clear_colour, 1.0);
+        return;
+    }
+
+    // Reconstruct the view space position from depth
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gbuffer_depth, 0)) * 2.0 - 1.0;
+    float z_eye = -proj_params.w / (depth * 2.0 - 1.0 + proj_params.z);
+    vec3 position_eye = vec3(ndc * proj_params.xy * -z_eye, z_eye);
+
+    vec4 albedo_spec = texelFetch(gbuffer_albedo, pixel, 0);
+    vec3 n = oct_decode(texelFetch(gbuffer_normal, pixel, 0).xy);
+    vec3 v = normalize(-position_eye);
+    float specular_exponent = exp2(albedo_spec.a * 10.0);
+
+    // Same lights and BRDF as the forward path in exercise7/fragment.glsl
+    uvec2 range = cluster_light_range(gl_FragCoord.xy, z_eye);
+    vec3 result = ambient * albedo_spec.rgb;
+    for (uint i = 0u; i < range.y; i++) {
+        result += shade_point_light(cluster_light_index(range, i), position_eye, n, v, albedo_spec.rgb,
+                                    specular_exponent);
+    }
+
+    if (show_heatmap == 1) {
+        result = cluster_heatmap(result, range.y);
+    }
+
+    fragment_colour = vec4(result, 1.0);
+}
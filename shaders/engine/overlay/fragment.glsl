@@ -0,0 +1,13 @@
+#version 410
+
+in vec2 texcoord;
+in vec4 colour;
+
+uniform sampler2D font;
+
+out vec4 frag_colour;
+
+// The atlas is coverage only; filled rectangles use its solid glyph
+void main() {
+    frag_colour = vec4(colour.rgb, colour.a * texture(font, texcoord).r);
+}
@@ -0,0 +1,20 @@
+#version 410
+
+// One instance per quad, corners from gl_VertexID (triangle strip of 4)
+layout(location = 0) in vec4 quad_rect;     // x, y, width, height in pixels, y down
+layout(location = 1) in uint quad_glyph;    // column of the font atlas
+layout(location = 2) in vec4 quad_colour;
+
+uniform vec2 screen_size;
+uniform float glyph_count;
+
+out vec2 texcoord;
+out vec4 colour;
+
+void main() {
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 position = quad_rect.xy + corner * quad_rect.zw;
+    texcoord = vec2((float(quad_glyph) + corner.x) / glyph_count, corner.y);
+    colour = quad_colour;
+    gl_Position = vec4(position.x / screen_size.x * 2.0 - 1.0, 1.0 - position.y / screen_size.y * 2.0, 0.0, 1.0);
+}
@@ -1,13 +1,16 @@
 #version 410
 
-layout(location = 0) in vec3 vertex_position;
-layout(location = 1) in vec3 vertex_colour;
+layout(location = 0) in vec3 vertex_position;  // snorm16, relative to the mesh bounds
+layout(location = 1) in vec3 vertex_colour;    // unorm8
 
 uniform mat4 matrix;  // Our transformation matrix
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
 
 out vec3 colour;
 
 void main() {
     colour = vertex_colour;
-    gl_Position = matrix * vec4(vertex_position, 1.0);
+    vec3 position = pos_offset + pos_scale * vertex_position;
+    gl_Position = matrix * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 layout(location = 0) in vec3 vertex_position;
 layout(location = 1) in vec3 vertex_colour;
 
+uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
 
@@ -10,5 +11,5 @@ out vec3 colour;
 
 void main() {
     colour = vertex_colour;
-    gl_Position = proj * view * vec4(vertex_position, 1.0);
+    gl_Position = proj * view * model * vec4(vertex_position, 1.0);
 }
\ No newline at end of file
@@ -19,41 +19,13 @@ vec3 Ka = vec3(1.0, 1.0, 1.0); // fully reflect ambient light
 
 uniform mat4 view;
 uniform float specular_exponent;
-uniform int use_blinn;
+
+// Variant options (compiled in, see include/graphics/shader_variants.h):
+//   USE_BLINN - half-way vector instead of the reflection vector (phong.glsl)
 
 out vec4 fragment_colour;
 
-// Function to calculate Phong lighting for one light
-vec3 calculate_phong(vec3 light_pos_world, vec3 pos_eye, vec3 norm_eye, bool use_blinn_phong) {
-    // Convert light to eye space
-    vec3 light_position_eye = vec3(view * vec4(light_pos_world, 1.0));
-    vec3 distance_to_light_eye = light_position_eye - pos_eye;
-    vec3 direction_to_light_eye = normalize(distance_to_light_eye);
-    
-    // Diffuse intensity
-    float dot_prod = dot(direction_to_light_eye, norm_eye);
-    dot_prod = max(dot_prod, 0.0);
-    vec3 Id = Ld * Kd * dot_prod;
-    
-    // Specular intensity
-    vec3 surface_to_viewer_eye = normalize(-pos_eye);
-    float dot_prod_specular;
-    
-    if (use_blinn_phong) {
-        // Blinn-Phong
-        vec3 half_way_eye = normalize(surface_to_viewer_eye + direction_to_light_eye);
-        dot_prod_specular = max(dot(half_way_eye, norm_eye), 0.0);
-    } else {
-        // Original Phong
-        vec3 reflection_eye = reflect(-direction_to_light_eye, norm_eye);
-        dot_prod_specular = max(dot(reflection_eye, surface_to_viewer_eye), 0.0);
-    }
-    
-    float specular_factor = pow(dot_prod_specular, specular_exponent);
-    vec3 Is = Ls * Ks * specular_factor;
-    
-    return Id + Is;
-}
+#include "phong.glsl"
 
 void main() {
     // Normalize the normal (it might not be unit length after transformation)
@@ -63,9 +35,10 @@ void main() {
     vec3 Ia = La * Ka;
     
     // Calculate lighting from both lights
-    bool use_blinn_phong = (use_blinn == 1);
-    vec3 light1_contribution = calculate_phong(light1_position_world, position_eye, norm, use_blinn_phong);
-    vec3 light2_contribution = calculate_phong(light2_position_world, position_eye, norm, use_blinn_phong);
+    vec3 light1_position_eye = vec3(view * vec4(light1_position_world, 1.0));
+    vec3 light2_position_eye = vec3(view * vec4(light2_position_world, 1.0));
+    vec3 light1_contribution = calculate_phong(light1_position_eye, position_eye, norm, Ld, Ls, Kd, Ks, specular_exponent);
+    vec3 light2_contribution = calculate_phong(light2_position_eye, position_eye, norm, Ld, Ls, Kd, Ks, specular_exponent);
     
     // Combine: ambient + light1 + light2
     vec3 final_color = Ia + light1_contribution + light2_contribution;
@@ -1,17 +1,23 @@
 #version 410
 
-layout(location = 0) in vec3 vertex_position;
-layout(location = 1) in vec3 vertex_normal;
+layout(location = 0) in vec3 vertex_position;  // snorm16, relative to the mesh bounds
+layout(location = 1) in vec2 vertex_normal;    // octahedral, GL_INT_2_10_10_10_REV
 
 uniform mat4 proj;
 uniform mat4 view;
 uniform mat4 model;
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
 
 out vec3 position_eye;
 out vec3 normal_eye;
 
+#include "octahedral.glsl"
+
 void main() {
-    position_eye = vec3(view * model * vec4(vertex_position, 1.0));
-    normal_eye = vec3(view * model * vec4(vertex_normal, 0.0));
+    vec3 position = pos_offset + pos_scale * vertex_position;
+    vec3 normal = oct_decode(vertex_normal);
+    position_eye = vec3(view * model * vec4(position, 1.0));
+    normal_eye = vec3(view * model * vec4(normal, 0.0));
     gl_Position = proj * vec4(position_eye, 1.0);
 }
\ No newline at end of file
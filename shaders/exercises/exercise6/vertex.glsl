@@ -1,15 +1,20 @@
 #version 410
 
-layout(location = 0) in vec3 vertex_position;
-layout(location = 1) in vec2 vertex_texcoord;
+layout(location = 0) in vec3 vertex_position;  // snorm16, relative to the mesh bounds
+layout(location = 1) in vec2 vertex_texcoord;  // unorm16, relative to the UV range
 
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 proj;
+uniform vec3 pos_offset;
+uniform vec3 pos_scale;
+uniform vec2 uv_offset;
+uniform vec2 uv_scale;
 
 out vec2 texcoord;
 
 void main() {
-    texcoord = vertex_texcoord;
-    gl_Position = proj * view * model * vec4(vertex_position, 1.0);
+    texcoord = uv_offset + uv_scale * vertex_texcoord;
+    vec3 position = pos_offset + pos_scale * vertex_position;
+    gl_Position = proj * view * model * vec4(position, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 410
+
+in vec3 position_eye;
+in vec3 normal_eye;
+
+#include "clustered_lights.glsl"
+
+uniform int use_clusters;                // 0 = loop over every light
+uniform int show_heatmap;                // colour by lights per froxel
+uniform vec3 surface_colour;
+uniform float specular_exponent;
+
+out vec4 fragment_colour;
+
+const vec3 ambient = vec3(0.03, 0.03, 0.04);
+
+void main() {
+    vec3 n = normalize(normal_eye);
+    vec3 v = normalize(-position_eye);
+    vec3 result = ambient * surface_colour;
+
+    if (use_clusters == 1) {
+        uvec2 range = cluster_light_range(gl_FragCoord.xy, position_eye.z);
+        for (uint i = 0u; i < range.y; i++) {
+            result += shade_point_light(cluster_light_index(range, i), position_eye, n, v, surface_colour,
+                                        specular_exponent);
+        }
+
+        if (show_heatmap == 1) {
+            result = cluster_heatmap(result, range.y);
+        }
+    } else {
+        for (int i = 0; i < light_count; i++) {
+            result += shade_point_light(i, position_eye, n, v, surface_colour, specular_exponent);
+        }
+    }
+
+    fragment_colour = vec4(result, 1.0);
+}
\ No newline at end of file
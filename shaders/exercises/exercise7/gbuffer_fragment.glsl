@@ -0,0 +1,17 @@
+#version 410
+
+in vec3 position_eye;
+in vec3 normal_eye;
+
+uniform vec3 surface_colour;
+uniform float specular_exponent;
+
+layout(location = 0) out vec4 gbuffer_albedo;
+layout(location = 1) out vec2 gbuffer_normal;
+
+#include "octahedral.glsl"
+
+void main() {
+    gbuffer_albedo = vec4(surface_colour, log2(specular_exponent) / 10.0);
+    gbuffer_normal = oct_encode(normalize(normal_eye));
+}
\ No newline at end of file
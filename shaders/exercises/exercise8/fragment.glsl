@@ -0,0 +1,21 @@
+#version 410
+
+in vec3 normal_world;
+in vec3 position_object;
+in vec3 object_colour;
+
+// Variant options (compiled in, see include/graphics/shader_variants.h):
+//   STRIPED - horizontal bands; the scene alternates between both
+//             programmes so unsorted submission switches on every draw
+
+out vec4 fragment_colour;
+
+void main() {
+    vec3 n = normalize(normal_world);
+    float diffuse = max(dot(n, normalize(vec3(0.4, 0.8, 0.5))), 0.0);
+    vec3 colour = object_colour;
+#ifdef STRIPED
+    colour *= 0.6 + 0.4 * step(0.5, fract(position_object.y * 4.0));
+#endif
+    fragment_colour = vec4(colour * (0.25 + 0.75 * diffuse), 1.0);
+}
\ No newline at end of file
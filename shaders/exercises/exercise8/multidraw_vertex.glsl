@@ -0,0 +1,30 @@
+#version 410
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 1) in vec3 vertex_normal;
+// Per instance from the mesh cache page VAO, see graphics/multi_draw.h
+layout(location = 7) in uint draw_index;
+
+// Camera -> 0, set once per frame
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+};
+
+// 5 texels per draw: model matrix columns, colour
+uniform samplerBuffer draw_data;
+uniform int draw_base;
+
+out vec3 normal_world;
+out vec3 position_object;
+out vec3 object_colour;
+
+void main() {
+    int row = (draw_base + int(draw_index)) * 5;
+    mat4 model = mat4(texelFetch(draw_data, row), texelFetch(draw_data, row + 1),
+                      texelFetch(draw_data, row + 2), texelFetch(draw_data, row + 3));
+    normal_world = mat3(model) * vertex_normal;
+    position_object = vertex_position;
+    object_colour = texelFetch(draw_data, row + 4).rgb;
+    gl_Position = proj * view * model * vec4(vertex_position, 1.0);
+}
\ No newline at end of file
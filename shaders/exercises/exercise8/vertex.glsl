@@ -0,0 +1,28 @@
+#version 410
+
+layout(location = 0) in vec3 vertex_position;
+layout(location = 1) in vec3 vertex_normal;
+
+// GLSL 4.10 has no layout(binding); the exercise calls glUniformBlockBinding
+// Camera -> 0, set once per frame
+layout(std140) uniform Camera {
+    mat4 view;
+    mat4 proj;
+};
+
+// Object -> 1, a range of the frame's uniform stream per draw
+layout(std140) uniform Object {
+    mat4 model;
+    vec4 colour;
+};
+
+out vec3 normal_world;
+out vec3 position_object;
+out vec3 object_colour;
+
+void main() {
+    normal_world = mat3(model) * vertex_normal;
+    position_object = vertex_position;
+    object_colour = colour.rgb;
+    gl_Position = proj * view * model * vec4(vertex_position, 1.0);
+}
\ No newline at end of file
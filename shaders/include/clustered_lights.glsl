@@ -0,0 +1,49 @@
+// Clustered light lists (see include/graphics/clustered_lighting.h)
+uniform samplerBuffer cluster_lights;    // per light: view pos + radius, colour
+uniform usamplerBuffer cluster_grid;     // per froxel: offset, count
+uniform usamplerBuffer cluster_indices;
+uniform uvec3 cluster_dims;
+uniform vec2 cluster_tile_scale;         // froxels per pixel in x/y
+uniform vec2 cluster_z_params;           // slice = log(depth) * x + y
+uniform int light_count;
+
+// Offset and count of the froxel containing a fragment at view depth z_eye (< 0)
+uvec2 cluster_light_range(vec2 frag_coord, float z_eye) {
+    uvec3 cell;
+    cell.xy = uvec2(frag_coord * cluster_tile_scale);
+    cell.z = uint(max(log(-z_eye) * cluster_z_params.x + cluster_z_params.y, 0.0));
+    cell = min(cell, cluster_dims - 1u);
+    uint cluster = (cell.z * cluster_dims.y + cell.y) * cluster_dims.x + cell.x;
+    return texelFetch(cluster_grid, int(cluster)).xy;
+}
+
+int cluster_light_index(uvec2 range, uint i) {
+    return int(texelFetch(cluster_indices, int(range.x + i)).r);
+}
+
+// Blinn-Phong point light with a windowed inverse square falloff that
+// reaches exactly zero at the light radius
+vec3 shade_point_light(int index, vec3 p, vec3 n, vec3 v, vec3 albedo, float specular_exponent) {
+    vec4 position_radius = texelFetch(cluster_lights, index * 2);
+    vec3 colour = texelFetch(cluster_lights, index * 2 + 1).rgb;
+
+    vec3 to_light = position_radius.xyz - p;
+    float dist2 = dot(to_light, to_light);
+    float radius2 = position_radius.w * position_radius.w;
+    if (dist2 >= radius2) {
+        return vec3(0.0);
+    }
+    float window = clamp(1.0 - (dist2 * dist2) / (radius2 * radius2), 0.0, 1.0);
+    float attenuation = window * window / (dist2 + 1.0);
+
+    vec3 l = to_light * inversesqrt(dist2);
+    float diffuse = max(dot(n, l), 0.0);
+    float specular = diffuse > 0.0 ? pow(max(dot(n, normalize(l + v)), 0.0), specular_exponent) : 0.0;
+    return colour * attenuation * (diffuse * albedo + specular);
+}
+
+// Lights-per-froxel debug colour: blue (none) to red (32+)
+vec3 cluster_heatmap(vec3 colour, uint count) {
+    float heat = clamp(float(count) / 32.0, 0.0, 1.0);
+    return mix(colour, vec3(heat, 1.0 - abs(heat * 2.0 - 1.0), 1.0 - heat), 0.6);
+}
@@ -0,0 +1,31 @@
+// Diffuse + specular from one light, everything in eye space.
+// Phong by default; Blinn-Phong when the USE_BLINN variant option is set.
+vec3 calculate_phong(vec3 light_position_eye, vec3 pos_eye, vec3 norm_eye,
+                     vec3 Ld, vec3 Ls, vec3 Kd, vec3 Ks, float specular_exponent) {
+    vec3 distance_to_light_eye = light_position_eye - pos_eye;
+    vec3 direction_to_light_eye = normalize(distance_to_light_eye);
+
+    // Diffuse intensity
+    float dot_prod = dot(direction_to_light_eye, norm_eye);
+    dot_prod = max(dot_prod, 0.0);
+    vec3 Id = Ld * Kd * dot_prod;
+
+    // Specular intensity
+    vec3 surface_to_viewer_eye = normalize(-pos_eye);
+    float dot_prod_specular;
+
+#ifdef USE_BLINN
+    // Blinn-Phong
+    vec3 half_way_eye = normalize(surface_to_viewer_eye + direction_to_light_eye);
+    dot_prod_specular = max(dot(half_way_eye, norm_eye), 0.0);
+#else
+    // Original Phong
+    vec3 reflection_eye = reflect(-direction_to_light_eye, norm_eye);
+    dot_prod_specular = max(dot(reflection_eye, surface_to_viewer_eye), 0.0);
+#endif
+
+    float specular_factor = pow(dot_prod_specular, specular_exponent);
+    vec3 Is = Ls * Ks * specular_factor;
+
+    return Id + Is;
+}
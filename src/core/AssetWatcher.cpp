@@ -0,0 +1,416 @@
+#include "core/AssetWatcher.h"
+#include "graphics/gpu_resources.h"
+#include "graphics/shader_preprocessor.h"
+#include "utils/log.h"
+#include <chrono>
+#include <iostream>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#define ASSET_WATCHER_INOTIFY 1
+#endif
+
+static double now_seconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Editors write swap and backup files next to the real one
+static bool is_temporary_file(const std::string& name) {
+    return name.empty() || name[0] == '.' || name.back() == '~' ||
+           (name.size() > 4 && name.compare(name.size() - 4, 4, ".swp") == 0);
+}
+
+static bool is_directory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+}
+
+// Calls visit(path, is_dir) for every entry below dir
+template <typename Visit>
+static void walk_directory(const std::string& dir, const Visit& visit) {
+    DIR* handle = opendir(dir.c_str());
+    if (!handle) {
+        return;
+    }
+    while (struct dirent* entry = readdir(handle)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        std::string path = dir + "/" + name;
+        bool dir_entry = is_directory(path);
+        visit(path, dir_entry);
+        if (dir_entry) walk_directory(path, visit);
+    }
+    closedir(handle);
+}
+
+AssetWatcher& AssetWatcher::instance() {
+    static AssetWatcher watcher;
+    return watcher;
+}
+
+AssetWatcher::~AssetWatcher() {
+    // GLFW is gone by now; only the thread can be stopped safely
+    if (running) {
+        running = false;
+        if (thread.joinable()) thread.join();
+    }
+}
+
+bool AssetWatcher::init(GLFWwindow* share_with, const std::vector<std::string>& roots) {
+    if (running) {
+        return true;
+    }
+    this->roots = roots;
+
+    // Hidden 1x1 window whose context shares objects with the main one.
+    // GLFW windows must be created on the main thread; the context is then
+    // made current on the watcher thread
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    context = glfwCreateWindow(1, 1, "asset watcher", nullptr, share_with);
+    glfwWindowHint(GLFW_VISIBLE, GL_TRUE);
+    if (!context) {
+        gl_log_err("Asset watcher: could not create a shared context, hot reload disabled\n");
+        return false;
+    }
+
+    if (!openWatches()) {
+        glfwDestroyWindow(context);
+        context = nullptr;
+        return false;
+    }
+
+    running = true;
+    thread = std::thread(&AssetWatcher::threadLoop, this);
+
+    std::string joined;
+    for (const std::string& root : roots) joined += " " + root;
+    gl_log("Asset watcher: watching%s (%s, %.0f ms debounce)\n", joined.c_str(),
+#ifdef ASSET_WATCHER_INOTIFY
+           "inotify",
+#else
+           "polling",
+#endif
+           debounce_seconds * 1000.0);
+    return true;
+}
+
+void AssetWatcher::shutdown() {
+    if (!running) {
+        return;
+    }
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    closeWatches();
+
+    // Results that were never installed
+    for (ShaderResult& result : shader_results) {
+        Shader::discardBuild(result.build);
+    }
+    for (TextureResult& result : texture_results) {
+        gpu_delete_texture(result.id);
+    }
+    shader_results.clear();
+    texture_results.clear();
+    shader_requests.clear();
+    texture_requests.clear();
+
+    glfwDestroyWindow(context);
+    context = nullptr;
+    gl_log("Asset watcher stopped: %d changes, %d shaders rebuilt, %d textures reloaded, %d failed\n",
+           stats.changes, stats.shaders_rebuilt, stats.textures_reloaded, stats.failed);
+}
+
+bool AssetWatcher::openWatches() {
+#ifdef ASSET_WATCHER_INOTIFY
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        gl_log_err("Asset watcher: inotify_init1 failed, hot reload disabled\n");
+        return false;
+    }
+
+    // inotify is not recursive: one watch per directory
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE;
+    auto add_watch = [this, mask](const std::string& dir) {
+        int wd = inotify_add_watch(inotify_fd, dir.c_str(), mask);
+        if (wd >= 0) watch_dirs[wd] = dir;
+    };
+    for (const std::string& root : roots) {
+        if (!is_directory(root)) continue;
+        add_watch(root);
+        walk_directory(root, [&](const std::string& path, bool dir) {
+            if (dir) add_watch(path);
+        });
+    }
+    if (watch_dirs.empty()) {
+        gl_log_err("Asset watcher: no asset directories found\n");
+    }
+#else
+    // Baseline modification times; only later changes are reported
+    for (const std::string& root : roots) {
+        walk_directory(root, [&](const std::string& path, bool dir) {
+            struct stat info;
+            if (!dir && stat(path.c_str(), &info) == 0) mtimes[path] = (long long)info.st_mtime;
+        });
+    }
+#endif
+    return true;
+}
+
+void AssetWatcher::closeWatches() {
+#ifdef ASSET_WATCHER_INOTIFY
+    if (inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+#endif
+    watch_dirs.clear();
+    mtimes.clear();
+    unsettled.clear();
+}
+
+void AssetWatcher::collectEvents(int timeout_ms) {
+    int events = 0;
+
+#ifdef ASSET_WATCHER_INOTIFY
+    pollfd fd = {inotify_fd, POLLIN, 0};
+    if (poll(&fd, 1, timeout_ms) <= 0) {
+        return;
+    }
+    double now = now_seconds();
+
+    alignas(inotify_event) char buffer[8192];
+    for (;;) {
+        ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+
+        for (char* p = buffer; p < buffer + length;) {
+            const inotify_event* event = (const inotify_event*)p;
+            p += sizeof(inotify_event) + event->len;
+
+            auto dir = watch_dirs.find(event->wd);
+            if (event->len == 0 || dir == watch_dirs.end()) continue;
+            std::string name = event->name;
+            std::string path = dir->second + "/" + name;
+
+            if (event->mask & IN_ISDIR) {
+                // New directory: watch it too
+                int wd = inotify_add_watch(inotify_fd, path.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+                if (wd >= 0) watch_dirs[wd] = path;
+                continue;
+            }
+            if (is_temporary_file(name)) continue;
+
+            unsettled[normalize_shader_path(path)] = now;
+            events++;
+        }
+    }
+#else
+    std::this_thread::sleep_for(std::chrono::milliseconds(timeout_ms * 4));
+    double now = now_seconds();
+    for (const std::string& root : roots) {
+        walk_directory(root, [&](const std::string& path, bool dir) {
+            struct stat info;
+            if (dir || stat(path.c_str(), &info) != 0) return;
+            long long& mtime = mtimes[path];
+            if (mtime != (long long)info.st_mtime) {
+                mtime = (long long)info.st_mtime;
+                unsettled[normalize_shader_path(path)] = now;
+                events++;
+            }
+        });
+    }
+#endif
+
+    if (events) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.file_events += events;
+    }
+}
+
+void AssetWatcher::settleChanges() {
+    double now = now_seconds();
+    std::vector<std::string> ready;
+    for (auto it = unsettled.begin(); it != unsettled.end();) {
+        if (now - it->second >= debounce_seconds) {
+            ready.push_back(it->first);
+            it = unsettled.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if (ready.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    settled.insert(settled.end(), ready.begin(), ready.end());
+    stats.changes += (int)ready.size();
+}
+
+void AssetWatcher::runBuilds() {
+    std::vector<ShaderRequest> shaders;
+    std::vector<TextureRequest> texture_list;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shaders.swap(shader_requests);
+        texture_list.swap(texture_requests);
+    }
+    if (shaders.empty() && texture_list.empty()) {
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<ShaderResult> built_shaders;
+    std::vector<TextureResult> built_textures;
+
+    // An edited include can rebuild many programmes: submit them all before
+    // asking for any status so the driver can compile them concurrently
+    for (const ShaderRequest& request : shaders) {
+        ShaderResult result;
+        result.target = request.target;
+        result.vertex_path = request.vertex_path;
+        Shader::submitFromFiles(request.vertex_path, request.fragment_path, request.defines, result.build);
+        built_shaders.push_back(std::move(result));
+    }
+    for (ShaderResult& result : built_shaders) {
+        Shader::completeBuild(result.build);
+    }
+
+    int failed = 0;
+    for (const TextureRequest& request : texture_list) {
+        TextureImage image;
+        if (!Texture::decode(request.path.c_str(), request.flip, image)) {
+            gl_log_err("Asset watcher: could not decode %s\n", request.path.c_str());
+            failed++;
+            continue;
+        }
+        TextureResult result = {request.target, request.path, Texture::upload(image, request.path.c_str()),
+                                image.width, image.height, image.channels};
+        Texture::freeImage(image);
+        built_textures.push_back(result);
+    }
+
+    // Objects must be complete before another context uses them
+    glFinish();
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (ShaderResult& result : built_shaders) {
+        shader_results.push_back(std::move(result));
+    }
+    texture_results.insert(texture_results.end(), built_textures.begin(), built_textures.end());
+    stats.failed += failed;
+    stats.last_build_ms = ms;
+}
+
+void AssetWatcher::threadLoop() {
+    glfwMakeContextCurrent(context);
+    while (running) {
+        collectEvents(50);
+        settleChanges();
+        runBuilds();
+    }
+    glfwMakeContextCurrent(nullptr);
+}
+
+void AssetWatcher::applyPending() {
+    if (!running) {
+        return;
+    }
+
+    std::vector<std::string> changed;
+    std::vector<ShaderResult> shaders;
+    std::vector<TextureResult> texture_list;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        changed.swap(settled);
+        shaders.swap(shader_results);
+        texture_list.swap(texture_results);
+    }
+
+    // Install finished work. Targets destroyed meanwhile are no longer in
+    // the dependency graph / texture set, and their results are dropped
+    ShaderDependencyGraph& graph = ShaderDependencyGraph::instance();
+    int shaders_installed = 0, textures_installed = 0, failed = 0;
+    for (ShaderResult& result : shaders) {
+        bool alive = !graph.dependencies(result.target).empty() &&
+                     result.target->getVertexPath() == result.vertex_path;
+        if (alive && !result.build.files.empty()) {
+            graph.setDependencies(result.target, result.build.files);
+        }
+        if (alive && result.build.ok) {
+            result.target->install(result.build, true);
+            shaders_installed++;
+        } else {
+            if (alive) failed++;
+            Shader::discardBuild(result.build);
+        }
+    }
+    for (TextureResult& result : texture_list) {
+        if (textures.count(result.target) && result.target->getPath() == result.path) {
+            result.target->replace(result.id, result.width, result.height, result.channels);
+            textures_installed++;
+        } else {
+            gpu_delete_texture(result.id);
+        }
+    }
+    if (!shaders.empty() || !texture_list.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.shaders_rebuilt += shaders_installed;
+        stats.textures_reloaded += textures_installed;
+        stats.failed += failed;
+        std::cout << "Hot reload: " << shaders_installed << " shaders, " << textures_installed << " textures swapped, "
+                  << failed << " failed (built in " << stats.last_build_ms << " ms off the render thread)" << std::endl;
+    }
+
+    if (changed.empty()) {
+        return;
+    }
+
+    // Map settled paths to the resources built from them
+    std::vector<ShaderRequest> new_shaders;
+    std::vector<TextureRequest> new_textures;
+    std::unordered_set<Shader*> queued;
+    for (const std::string& path : changed) {
+        for (Shader* shader : graph.dependents(path)) {
+            if (!queued.insert(shader).second) continue;
+            new_shaders.push_back({shader, shader->getVertexPath(), shader->getFragmentPath(), shader->getDefines()});
+        }
+        for (Texture* texture : textures) {
+            if (normalize_shader_path(texture->getPath()) == path) {
+                new_textures.push_back({texture, texture->getPath(), texture->getFlipVertically()});
+            }
+        }
+        gl_log("Asset changed: %s\n", path.c_str());
+    }
+    if (new_shaders.empty() && new_textures.empty()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    shader_requests.insert(shader_requests.end(), new_shaders.begin(), new_shaders.end());
+    texture_requests.insert(texture_requests.end(), new_textures.begin(), new_textures.end());
+}
+
+void AssetWatcher::watchTexture(Texture* texture) {
+    textures.insert(texture);
+}
+
+void AssetWatcher::unwatchTexture(Texture* texture) {
+    textures.erase(texture);
+}
+
+AssetWatcher::Stats AssetWatcher::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
@@ -1,7 +1,21 @@
 #include "core/Engine.h"
+#include "core/JobSystem.h"
+#include "core/Memory.h"
+#include "core/AssetWatcher.h"
+#include "core/FramePacer.h"
+#include "core/Input.h"
+#include "core/RenderThread.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/gpu_resources.h"
+#include "graphics/multi_draw.h"
+#include "graphics/shader_batch.h"
+#include "graphics/gpu_timer.h"
+#include "graphics/stats_overlay.h"
 #include "utils/log.h"
 #include "utils/utils.h"
 #include "utils/gl_debug.h" 
+#include <chrono>
+#include <cmath>
 #include <iostream>
 
 // GLFW error callback
@@ -9,6 +23,9 @@ static void glfw_error_callback(int error, const char* description) {
     gl_log_err("GLFW ERROR: code %i msg: %s\n", error, description);
 }
 
+RenderPath g_render_path = RENDER_PATH_FORWARD;
+bool g_render_thread = true;
+
 Engine::Engine() : window(nullptr), initialized(false) {}
 
 Engine::~Engine() {
@@ -100,18 +117,41 @@ bool Engine::init(int width, int height, bool fullscreen, const char* title) {
     // Initialize OpenGL debug output (if available)
     init_gl_debug_output();
     
+    // Let the driver compile batched shaders on its own threads
+    bool parallel_compile = ShaderBatch::initParallelCompile();
+    std::cout << "Parallel shader compile: " << (parallel_compile ? "ENABLED" : "not supported") << std::endl;
+
+    // One GL call per mesh cache page for MultiDrawBatch where available
+    bool multi_draw_indirect = MultiDrawBatch::initMultiDrawIndirect();
+    std::cout << "Multi-draw indirect: " << (multi_draw_indirect ? "ENABLED" : "not supported") << std::endl;
+    
     // Enable sRGB gamma correction globally
     glEnable(GL_FRAMEBUFFER_SRGB);
     gl_log("sRGB gamma correction: ENABLED\n");
     std::cout << "sRGB gamma correction: ENABLED" << std::endl;
     
     // Get framebuffer dimensions
-    glfwGetFramebufferSize(window, &g_fb_width, &g_fb_height);
-    gl_log("Initial framebuffer size: %dx%d\n", g_fb_width, g_fb_height);
+    int fb_width = 0, fb_height = 0;
+    glfwGetFramebufferSize(window, &fb_width, &fb_height);
+    g_fb_width = fb_width;
+    g_fb_height = fb_height;
+    gl_log("Initial framebuffer size: %dx%d\n", fb_width, fb_height);
     
     // Register window callbacks
     glfwSetWindowSizeCallback(window, glfw_window_size_callback);
     glfwSetFramebufferSizeCallback(window, glfw_framebuffer_resize_callback);
+
+    // Keyboard and mouse arrive as queued events (see core/Input.h)
+    Input::instance().attach(window);
+    
+    // Start worker threads for parallel engine work (culling, asset loading...)
+    JobSystem::instance().init();
+    std::cout << "Job system workers: " << JobSystem::instance().getWorkerCount() << std::endl;
+    
+    // Background hot reload of shaders and textures (optional: failure only disables it)
+    if (AssetWatcher::instance().init(window)) {
+        std::cout << "Hot reload: watching shaders/ and assets/" << std::endl;
+    }
     
     initialized = true;
     gl_log("Engine initialized successfully\n");
@@ -119,12 +159,164 @@ bool Engine::init(int width, int height, bool fullscreen, const char* title) {
     return true;
 }
 
+void Engine::setRenderPath(RenderPath path) {
+    g_render_path = path;
+    gl_log("Render path: %s\n", path == RENDER_PATH_DEFERRED ? "deferred" : "forward");
+}
+
+void Engine::setRenderThread(bool enabled) {
+    g_render_thread = enabled;
+    gl_log("Render thread: %s\n", enabled ? "enabled" : "disabled");
+}
+
+void Engine::setFramePacing(const FramePacing& pacing) {
+    FramePacer::instance().setPacing(pacing);
+}
+
+static LoopStats s_loop_stats = {};
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void Engine::run(GLFWwindow* window, const LoopCallbacks& callbacks, const LoopSettings& settings) {
+    s_loop_stats = LoopStats();
+    double accumulator = 0.0;
+    double previous = glfwGetTime();
+
+    bool packets = callbacks.build && callbacks.submit;
+    RenderThread render_thread;
+    RenderPacket serial_packet;
+    if (packets && g_render_thread) {
+        s_loop_stats.render_thread = render_thread.start(window, callbacks.submit);
+    }
+    gl_log("Main loop: fixed step %.2f ms, at most %d steps per frame%s\n", settings.fixed_dt * 1000.0,
+           settings.max_steps_per_frame,
+           s_loop_stats.render_thread ? ", render thread" : (packets ? ", serial packets" : ""));
+
+    uint64_t render_thread_allocs = 0;
+    while (!glfwWindowShouldClose(window)) {
+        Memory::beginFrame();
+        double now = glfwGetTime();
+        double frame_time = now - previous;
+        previous = now;
+        if (frame_time > settings.max_frame_time) {
+            frame_time = settings.max_frame_time;
+        }
+        accumulator += frame_time;
+
+        update_fps_counter(window);
+        Input::instance().beginFrame();
+        if (callbacks.frame) {
+            callbacks.frame(frame_time);
+        }
+
+        int steps = 0;
+        while (accumulator >= settings.fixed_dt && steps < settings.max_steps_per_frame) {
+            if (callbacks.update) {
+                callbacks.update(settings.fixed_dt);
+            }
+            accumulator -= settings.fixed_dt;
+            s_loop_stats.sim_time += settings.fixed_dt;
+            steps++;
+        }
+        if (accumulator >= settings.fixed_dt) {
+            // Too far behind to catch up: keep the fraction for alpha, drop the rest
+            accumulator = fmod(accumulator, settings.fixed_dt);
+            s_loop_stats.clamped_frames++;
+        }
+
+        double alpha = accumulator / settings.fixed_dt;
+        uint64_t render_thread_frame_allocs = 0;
+        if (s_loop_stats.render_thread) {
+            // Waits only if the GL thread is still on the frame before last
+            auto acquire_start = std::chrono::high_resolution_clock::now();
+            RenderPacket& packet = render_thread.acquire();
+            s_loop_stats.acquire_wait_ms = ms_since(acquire_start);
+            packet.alpha = alpha;
+
+            auto build_start = std::chrono::high_resolution_clock::now();
+            callbacks.build(packet, alpha);
+            s_loop_stats.build_ms = ms_since(build_start);
+            render_thread.publish();
+
+            RenderThread::Stats thread_stats = render_thread.getStats();
+            s_loop_stats.submit_ms = thread_stats.submit_ms;
+            s_loop_stats.swap_ms = thread_stats.swap_ms;
+            render_thread_frame_allocs = thread_stats.heap_allocs - render_thread_allocs;
+            render_thread_allocs = thread_stats.heap_allocs;
+        } else if (packets) {
+            StatsOverlay::instance().beginFrame();
+            serial_packet.clear();
+            serial_packet.frame = (uint64_t)s_loop_stats.frames;
+            serial_packet.alpha = alpha;
+
+            auto build_start = std::chrono::high_resolution_clock::now();
+            callbacks.build(serial_packet, alpha);
+            s_loop_stats.build_ms = ms_since(build_start);
+
+            auto submit_start = std::chrono::high_resolution_clock::now();
+            callbacks.submit(serial_packet);
+            s_loop_stats.submit_ms = ms_since(submit_start);
+        } else if (callbacks.render) {
+            StatsOverlay::instance().beginFrame();
+            callbacks.render(alpha);
+        }
+
+        s_loop_stats.frames++;
+        s_loop_stats.updates += steps;
+        s_loop_stats.last_steps = steps;
+        s_loop_stats.alpha = alpha;
+
+        if (!s_loop_stats.render_thread) {
+            StatsOverlay::instance().endFrame();
+            FramePacer::instance().beforeSwap();
+            auto swap_start = std::chrono::high_resolution_clock::now();
+            glfwSwapBuffers(window);
+            s_loop_stats.swap_ms = ms_since(swap_start);
+            FramePacer::instance().afterSwap();
+            GpuHandles::instance().endFrame();
+        }
+        glfwPollEvents();
+
+        // Heap check and frame arena reset
+        Memory::endFrame(render_thread_frame_allocs);
+        StatsOverlay::instance().setMemoryStats(Memory::getStats());
+    }
+
+    // Draws what is still in flight and hands the context back for cleanup
+    render_thread.stop();
+
+    gl_log("Main loop: %lld frames, %lld updates, %lld clamped frames\n", s_loop_stats.frames,
+           s_loop_stats.updates, s_loop_stats.clamped_frames);
+    MemoryStats memory = Memory::getStats();
+    gl_log("Memory: %llu heap allocations (%llu frames allocated after warm-up), frame arena peak %zu / %zu bytes\n",
+           (unsigned long long)memory.heap_allocs, (unsigned long long)memory.steady_heap_frames,
+           memory.frame_arena_peak, memory.frame_arena_capacity);
+}
+
+const LoopStats& Engine::getLoopStats() {
+    return s_loop_stats;
+}
+
 void Engine::shutdown() {
     if (!initialized) {
         return;
     }
     
     gl_log("Shutting down engine\n");
+    AssetWatcher::instance().shutdown();
+    JobSystem::instance().shutdown();
+
+    // The exercise has released its objects by now; whatever is left leaked
+    StatsOverlay::instance().shutdown();
+    GpuTimers::instance().shutdown();
+    GpuHandles::instance().flush();
+    GpuResources::instance().logReport();
+    GpuResources::instance().checkLeaks();
+    Input::instance().logStats();
+    FramePacer::instance().logReport();
+    FramePacer::instance().shutdown();
     glfwTerminate();
     initialized = false;
 }
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "core/FramePacer.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// Sleep until this long before the deadline, spin the rest; covers the
+// scheduler's wake-up error on common desktop kernels
+static const double LIMITER_SPIN_MS = 1.5;
+
+// Wait at most this long for a fence before giving up on it
+static const GLuint64 FENCE_TIMEOUT_NS = 100000000ull;
+
+static double ms_between(std::chrono::steady_clock::time_point a, std::chrono::steady_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+FramePacer& FramePacer::instance() {
+    static FramePacer pacer;
+    return pacer;
+}
+
+FramePacer::FramePacer()
+    : dirty(true), has_last_swap(false), fence_count(0), interval_sum(0.0),
+      interval_sq_sum(0.0) {
+    memset(fences, 0, sizeof(fences));
+    resetStats();
+}
+
+const char* FramePacer::vsyncName(VsyncMode mode) {
+    switch (mode) {
+    case VSYNC_OFF: return "off";
+    case VSYNC_ON: return "on";
+    case VSYNC_ADAPTIVE: return "adaptive";
+    default: return "?";
+    }
+}
+
+void FramePacer::setPacing(const FramePacing& new_pacing) {
+    std::lock_guard<std::mutex> lock(mutex);
+    pacing = new_pacing;
+    pacing.max_frames_ahead = std::max(0, std::min(pacing.max_frames_ahead, (int)MAX_FRAMES_AHEAD));
+    if (pacing.max_fps < 0.0) pacing.max_fps = 0.0;
+    dirty = true;
+}
+
+FramePacing FramePacer::getPacing() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return pacing;
+}
+
+void FramePacer::beforeSwap() {
+    FramePacing current;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        current = pacing;
+        changed = dirty;
+        dirty = false;
+    }
+
+    if (changed) {
+        int interval = current.vsync == VSYNC_OFF ? 0 : 1;
+        if (current.vsync == VSYNC_ADAPTIVE) {
+            if (glfwExtensionSupported("GLX_EXT_swap_control_tear") ||
+                glfwExtensionSupported("WGL_EXT_swap_control_tear")) {
+                interval = -1;
+            } else {
+                gl_log("Frame pacing: adaptive vsync not supported, using vsync on\n");
+            }
+        }
+        glfwSwapInterval(interval);
+        if (current.max_frames_ahead == 0 || current.finish) {
+            deleteFences();
+        }
+        deadline = Clock::now();
+        gl_log("Frame pacing: swap interval %d, limit %.1f fps, %d frames ahead%s\n", interval, current.max_fps,
+               current.max_frames_ahead, current.finish ? ", glFinish" : "");
+    }
+
+    double limiter_ms = 0.0, spin_ms = 0.0;
+    if (current.max_fps > 0.0) {
+        Clock::time_point start = Clock::now();
+        if (start < deadline) {
+            double remaining_ms = ms_between(start, deadline);
+            if (remaining_ms > LIMITER_SPIN_MS) {
+                std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(remaining_ms - LIMITER_SPIN_MS));
+            }
+            Clock::time_point spin_start = Clock::now();
+            while (Clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+            spin_ms = ms_between(spin_start, Clock::now());
+        }
+        Clock::time_point now = Clock::now();
+        limiter_ms = ms_between(start, now);
+
+        // The next deadline follows this one, so a late frame does not make
+        // the next ones early; one that is more than a frame late restarts
+        // the schedule
+        auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / current.max_fps));
+        deadline += period;
+        if (deadline < now) {
+            deadline = now + period;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.limiter_ms = limiter_ms;
+    stats.spin_ms = spin_ms;
+}
+
+void FramePacer::afterSwap() {
+    Clock::time_point now = Clock::now();
+    FramePacing current = getPacing();
+
+    auto wait_start = Clock::now();
+    if (current.finish) {
+        glFinish();
+    } else if (current.max_frames_ahead > 0) {
+        // Fence this frame; wait for the one max_frames_ahead frames back
+        fences[fence_count++] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        while (fence_count > current.max_frames_ahead) {
+            GLenum result = glClientWaitSync(fences[0], GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS);
+            if (result == GL_WAIT_FAILED) {
+                gl_log_err("Frame pacing: fence wait failed\n");
+            }
+            glDeleteSync(fences[0]);
+            memmove(fences, fences + 1, sizeof(GLsync) * (size_t)(fence_count - 1));
+            fence_count--;
+        }
+    }
+    double latency_wait_ms = ms_between(wait_start, Clock::now());
+
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.latency_wait_ms = latency_wait_ms;
+    if (has_last_swap) {
+        double interval = ms_between(last_swap, now);
+        stats.frames++;
+        stats.last_interval_ms = interval;
+        stats.min_interval_ms = stats.frames == 1 ? interval : std::min(stats.min_interval_ms, interval);
+        stats.max_interval_ms = std::max(stats.max_interval_ms, interval);
+        interval_sum += interval;
+        interval_sq_sum += interval * interval;
+        stats.mean_interval_ms = interval_sum / (double)stats.frames;
+        double variance = interval_sq_sum / (double)stats.frames - stats.mean_interval_ms * stats.mean_interval_ms;
+        stats.jitter_ms = sqrt(std::max(variance, 0.0));
+        int bucket = std::min((int)(interval * 2.0), HISTOGRAM_BUCKETS - 1);
+        stats.histogram[bucket]++;
+    }
+    last_swap = now;
+    has_last_swap = true;
+}
+
+void FramePacer::resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    memset(&stats, 0, sizeof(stats));
+    interval_sum = 0.0;
+    interval_sq_sum = 0.0;
+}
+
+FramePacer::Stats FramePacer::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void FramePacer::logReport() {
+    Stats s = getStats();
+    FramePacing current = getPacing();
+    gl_log("=== Frame pacing: vsync %s, limit %.1f fps, %d frames ahead%s ===\n", vsyncName(current.vsync),
+           current.max_fps, current.max_frames_ahead, current.finish ? ", glFinish" : "");
+    gl_log("%llu frames: swap to swap mean %.3f ms (%.1f fps), jitter %.3f ms, min %.3f, max %.3f\n",
+           (unsigned long long)s.frames, s.mean_interval_ms, s.mean_interval_ms > 0.0 ? 1000.0 / s.mean_interval_ms : 0.0,
+           s.jitter_ms, s.min_interval_ms, s.max_interval_ms);
+    gl_log("last frame: limiter %.3f ms (spin %.3f), latency wait %.3f ms\n", s.limiter_ms, s.spin_ms,
+           s.latency_wait_ms);
+    std::cout << "Frame pacing: vsync " << vsyncName(current.vsync) << ", mean " << s.mean_interval_ms
+              << " ms, jitter " << s.jitter_ms << " ms over " << s.frames << " frames" << std::endl;
+
+    // Non-empty buckets, bars scaled to the fullest
+    uint32_t peak = 0;
+    for (int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        peak = std::max(peak, s.histogram[i]);
+    }
+    for (int i = 0; i < HISTOGRAM_BUCKETS && peak > 0; i++) {
+        if (!s.histogram[i]) continue;
+        char bar[41];
+        int length = (int)((uint64_t)s.histogram[i] * 40 / peak);
+        memset(bar, '#', (size_t)length);
+        bar[length] = '\0';
+        gl_log("  %5.1f%s ms %8u %s\n", i * 0.5, i == HISTOGRAM_BUCKETS - 1 ? "+" : " ", s.histogram[i], bar);
+    }
+}
+
+void FramePacer::deleteFences() {
+    for (int i = 0; i < fence_count; i++) {
+        glDeleteSync(fences[i]);
+    }
+    fence_count = 0;
+}
+
+void FramePacer::shutdown() {
+    deleteFences();
+    has_last_swap = false;
+}
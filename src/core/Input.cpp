@@ -0,0 +1,257 @@
+#include "core/Input.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+Input& Input::instance() {
+    static Input input;
+    return input;
+}
+
+Input::Input()
+    : write_index(0), read_index(0), dropped(0), cursor_x(0.0), cursor_y(0.0), cursor_dx(0.0), cursor_dy(0.0),
+      scroll_x(0.0), scroll_y(0.0), has_cursor(false), presses(0), latency_total_ms(0.0), stats() {
+    memset(key_state, 0, sizeof(key_state));
+    memset(button_state, 0, sizeof(button_state));
+}
+
+void Input::attach(GLFWwindow* window) {
+    glfwSetKeyCallback(window, keyCallback);
+    glfwSetMouseButtonCallback(window, buttonCallback);
+    glfwSetCursorPosCallback(window, cursorCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+
+    // Deltas start from here rather than from the first movement
+    glfwGetCursorPos(window, &cursor_x, &cursor_y);
+    has_cursor = true;
+    gl_log("Input: callbacks installed, %u event queue\n", QUEUE_SIZE);
+}
+
+void Input::keyCallback(GLFWwindow*, int key, int, int action, int) {
+    if (key < 0 || key >= KEY_COUNT || action == GLFW_REPEAT) {
+        return;
+    }
+    Event event = {glfwGetTime(), 0.0, 0.0, key, EVENT_KEY, (uint8_t)action};
+    instance().push(event);
+}
+
+void Input::buttonCallback(GLFWwindow*, int button, int action, int) {
+    if (button < 0 || button >= BUTTON_COUNT) {
+        return;
+    }
+    Event event = {glfwGetTime(), 0.0, 0.0, button, EVENT_BUTTON, (uint8_t)action};
+    instance().push(event);
+}
+
+void Input::cursorCallback(GLFWwindow*, double x, double y) {
+    Event event = {glfwGetTime(), x, y, 0, EVENT_CURSOR, 0};
+    instance().push(event);
+}
+
+void Input::scrollCallback(GLFWwindow*, double x, double y) {
+    Event event = {glfwGetTime(), x, y, 0, EVENT_SCROLL, 0};
+    instance().push(event);
+}
+
+void Input::push(const Event& event) {
+    uint32_t write = write_index.load(std::memory_order_relaxed);
+    if (write - read_index.load(std::memory_order_acquire) >= QUEUE_SIZE) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    queue[write % QUEUE_SIZE] = event;
+    write_index.store(write + 1, std::memory_order_release);
+}
+
+void Input::apply(uint8_t* state, uint8_t action) {
+    if (action == GLFW_PRESS) {
+        if (!(*state & STATE_HELD)) *state |= STATE_PRESSED;
+        *state |= STATE_HELD;
+    } else if (action == GLFW_RELEASE) {
+        if (*state & STATE_HELD) *state |= STATE_RELEASED;
+        *state &= (uint8_t)~STATE_HELD;
+    }
+}
+
+void Input::beginFrame() {
+    for (int i = 0; i < KEY_COUNT; i++) {
+        key_state[i] &= STATE_HELD;
+    }
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        button_state[i] &= STATE_HELD;
+    }
+    cursor_dx = cursor_dy = 0.0;
+    scroll_x = scroll_y = 0.0;
+
+    double now = glfwGetTime();
+    double frame_latency_ms = 0.0;
+    int frame_presses = 0;
+    uint32_t read = read_index.load(std::memory_order_relaxed);
+    uint32_t write = write_index.load(std::memory_order_acquire);
+    for (; read != write; read++) {
+        const Event& event = queue[read % QUEUE_SIZE];
+        switch (event.type) {
+        case EVENT_KEY:
+            apply(&key_state[event.code], event.action);
+            break;
+        case EVENT_BUTTON:
+            apply(&button_state[event.code], event.action);
+            break;
+        case EVENT_CURSOR:
+            if (has_cursor) {
+                cursor_dx += event.x - cursor_x;
+                cursor_dy += event.y - cursor_y;
+            }
+            cursor_x = event.x;
+            cursor_y = event.y;
+            has_cursor = true;
+            break;
+        case EVENT_SCROLL:
+            scroll_x += event.x;
+            scroll_y += event.y;
+            break;
+        }
+        if ((event.type == EVENT_KEY || event.type == EVENT_BUTTON) && event.action == GLFW_PRESS) {
+            double age_ms = (now - event.time) * 1000.0;
+            frame_latency_ms += age_ms;
+            frame_presses++;
+            stats.max_latency_ms = std::max(stats.max_latency_ms, age_ms);
+        }
+    }
+    stats.frame_events = (int)(write - read_index.load(std::memory_order_relaxed));
+    read_index.store(read, std::memory_order_release);
+
+    stats.events += (uint64_t)stats.frame_events;
+    stats.dropped = dropped.load(std::memory_order_relaxed);
+    stats.frame_presses = frame_presses;
+    if (frame_presses > 0) {
+        stats.latency_ms = frame_latency_ms / frame_presses;
+        presses += (uint64_t)frame_presses;
+        latency_total_ms += frame_latency_ms;
+        stats.mean_latency_ms = latency_total_ms / (double)presses;
+    }
+}
+
+bool Input::isKeyHeld(int key) const {
+    return key >= 0 && key < KEY_COUNT && (key_state[key] & STATE_HELD);
+}
+
+bool Input::wasKeyPressed(int key) const {
+    return key >= 0 && key < KEY_COUNT && (key_state[key] & STATE_PRESSED);
+}
+
+bool Input::wasKeyReleased(int key) const {
+    return key >= 0 && key < KEY_COUNT && (key_state[key] & STATE_RELEASED);
+}
+
+bool Input::isButtonHeld(int button) const {
+    return button >= 0 && button < BUTTON_COUNT && (button_state[button] & STATE_HELD);
+}
+
+bool Input::wasButtonPressed(int button) const {
+    return button >= 0 && button < BUTTON_COUNT && (button_state[button] & STATE_PRESSED);
+}
+
+bool Input::wasButtonReleased(int button) const {
+    return button >= 0 && button < BUTTON_COUNT && (button_state[button] & STATE_RELEASED);
+}
+
+int Input::addAction(const char* name, int key) {
+    int action = findAction(name);
+    if (action < 0) {
+        action = (int)actions.size();
+        actions.push_back(Action());
+        actions.back().name = name;
+    }
+    if (key >= 0) {
+        bindKey(action, key);
+    }
+    return action;
+}
+
+int Input::findAction(const char* name) const {
+    for (size_t i = 0; i < actions.size(); i++) {
+        if (actions[i].name == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+void Input::bindKey(int action, int key) {
+    if (action < 0 || action >= (int)actions.size() || key < 0 || key >= KEY_COUNT) {
+        return;
+    }
+    std::vector<int>& keys = actions[action].keys;
+    if (std::find(keys.begin(), keys.end(), key) == keys.end()) {
+        keys.push_back(key);
+    }
+}
+
+void Input::bindButton(int action, int button) {
+    if (action < 0 || action >= (int)actions.size() || button < 0 || button >= BUTTON_COUNT) {
+        return;
+    }
+    std::vector<int>& buttons = actions[action].buttons;
+    if (std::find(buttons.begin(), buttons.end(), button) == buttons.end()) {
+        buttons.push_back(button);
+    }
+}
+
+void Input::clearBindings(int action) {
+    if (action >= 0 && action < (int)actions.size()) {
+        actions[action].keys.clear();
+        actions[action].buttons.clear();
+    }
+}
+
+bool Input::isHeld(int action) const {
+    if (action < 0 || action >= (int)actions.size()) {
+        return false;
+    }
+    const Action& a = actions[action];
+    for (int key : a.keys) {
+        if (key_state[key] & STATE_HELD) return true;
+    }
+    for (int button : a.buttons) {
+        if (button_state[button] & STATE_HELD) return true;
+    }
+    return false;
+}
+
+bool Input::wasPressed(int action) const {
+    if (action < 0 || action >= (int)actions.size()) {
+        return false;
+    }
+    const Action& a = actions[action];
+    for (int key : a.keys) {
+        if (key_state[key] & STATE_PRESSED) return true;
+    }
+    for (int button : a.buttons) {
+        if (button_state[button] & STATE_PRESSED) return true;
+    }
+    return false;
+}
+
+bool Input::wasReleased(int action) const {
+    if (action < 0 || action >= (int)actions.size()) {
+        return false;
+    }
+    const Action& a = actions[action];
+    for (int key : a.keys) {
+        if (key_state[key] & STATE_RELEASED) return true;
+    }
+    for (int button : a.buttons) {
+        if (button_state[button] & STATE_RELEASED) return true;
+    }
+    return false;
+}
+
+void Input::logStats() const {
+    gl_log("Input: %llu events (%llu dropped), %llu presses, latency mean %.2f ms, max %.2f ms\n",
+           (unsigned long long)stats.events, (unsigned long long)stats.dropped, (unsigned long long)presses,
+           stats.mean_latency_ms, stats.max_latency_ms);
+    std::cout << "Input latency: mean " << stats.mean_latency_ms << " ms, max " << stats.max_latency_ms
+              << " ms over " << presses << " presses" << std::endl;
+}
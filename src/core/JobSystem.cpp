@@ -0,0 +1,120 @@
+#include "core/JobSystem.h"
+#include "utils/log.h"
+
+JobSystem& JobSystem::instance() {
+    static JobSystem job_system;
+    return job_system;
+}
+
+JobSystem::~JobSystem() {
+    shutdown();
+}
+
+void JobSystem::init(unsigned int num_workers) {
+    if (running) {
+        return;
+    }
+
+    if (num_workers == 0) {
+        unsigned int hw = std::thread::hardware_concurrency();
+        num_workers = hw > 1 ? hw - 1 : 0;
+    }
+
+    running = true;
+    workers.reserve(num_workers);
+    for (unsigned int i = 0; i < num_workers; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this);
+    }
+
+    gl_log("Job system started with %u worker threads\n", num_workers);
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (!running) {
+            return;
+        }
+        running = false;
+    }
+    queue_cv.notify_all();
+
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // Drain anything left so counters never hang
+    Job job;
+    while (tryPop(job)) {
+        execute(job);
+    }
+
+    gl_log("Job system stopped\n");
+}
+
+void JobSystem::submit(void (*func)(void*), void* data, JobCounter* counter) {
+    if (counter) {
+        counter->pending.fetch_add(1);
+    }
+
+    Job job = {func, data, counter};
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        if (running && queue_count < QUEUE_CAPACITY) {
+            queue[(queue_head + queue_count) % QUEUE_CAPACITY] = job;
+            queue_count++;
+            queue_cv.notify_one();
+            return;
+        }
+    }
+
+    // No workers or the queue is full - run it right here
+    execute(job);
+}
+
+void JobSystem::wait(JobCounter& counter) {
+    while (counter.pending.load() > 0) {
+        Job job;
+        if (tryPop(job)) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+}
+
+bool JobSystem::tryPop(Job& job) {
+    std::lock_guard<std::mutex> lock(queue_mutex);
+    if (queue_count == 0) {
+        return false;
+    }
+    job = queue[queue_head];
+    queue_head = (queue_head + 1) % QUEUE_CAPACITY;
+    queue_count--;
+    return true;
+}
+
+void JobSystem::execute(const Job& job) {
+    job.func(job.data);
+    if (job.counter) {
+        job.counter->pending.fetch_sub(1);
+    }
+}
+
+void JobSystem::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return queue_count > 0 || !running; });
+            if (queue_count == 0) {
+                return;  // Shutting down and nothing left to do
+            }
+            job = queue[queue_head];
+            queue_head = (queue_head + 1) % QUEUE_CAPACITY;
+            queue_count--;
+        }
+        execute(job);
+    }
+}
@@ -0,0 +1,212 @@
+#include "core/Memory.h"
+#include "utils/log.h"
+#include <atomic>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+
+// Heap counters, bumped by the global operator new below
+static std::atomic<uint64_t> s_heap_allocs{0};
+static std::atomic<uint64_t> s_heap_frees{0};
+static std::atomic<uint64_t> s_heap_bytes{0};
+static thread_local uint64_t t_heap_allocs = 0;
+
+#ifndef MEMORY_NO_TRACKING
+
+static void* tracked_alloc(size_t size) {
+    s_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+    s_heap_bytes.fetch_add(size, std::memory_order_relaxed);
+    t_heap_allocs++;
+    return std::malloc(size ? size : 1);
+}
+
+static void tracked_free(void* ptr) {
+    if (ptr) {
+        s_heap_frees.fetch_add(1, std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+
+void* operator new(size_t size) {
+    void* ptr = tracked_alloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new[](size_t size) {
+    void* ptr = tracked_alloc(size);
+    if (!ptr) throw std::bad_alloc();
+    return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return tracked_alloc(size); }
+void operator delete(void* ptr) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { tracked_free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { tracked_free(ptr); }
+
+#endif
+
+static const size_t MIN_ARENA_BLOCK = 64 * 1024;
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+LinearArena::LinearArena(size_t capacity)
+    : block(nullptr), capacity(capacity), used(0), cycle_peak(0), peak(0), overflow_used(0), overflow_count(0) {
+    if (capacity) {
+        block = (uint8_t*)::operator new(capacity);
+    }
+}
+
+LinearArena::~LinearArena() {
+    for (void* ptr : overflow) {
+        ::operator delete(ptr);
+    }
+    ::operator delete(block);
+}
+
+void* LinearArena::alloc(size_t size, size_t align) {
+    // Offsets are aligned relative to the block, which operator new aligns
+    // to max_align_t; larger alignments are not supported
+    if (align > alignof(std::max_align_t)) align = alignof(std::max_align_t);
+    size_t offset = align_up(used, align);
+    if (block && offset + size <= capacity) {
+        used = offset + size;
+        if (used + overflow_used > cycle_peak) cycle_peak = used + overflow_used;
+        return block + offset;
+    }
+
+    // Out of space: heap until the next reset() grows the block
+    void* ptr = ::operator new(size ? size : 1);
+    overflow.push_back(ptr);
+    overflow_used += size;
+    overflow_count++;
+    if (used + overflow_used > cycle_peak) cycle_peak = used + overflow_used;
+    return ptr;
+}
+
+void LinearArena::rewind(size_t marker) {
+    if (marker < used) {
+        used = marker;
+    }
+}
+
+void LinearArena::reset() {
+    if (cycle_peak > peak) {
+        peak = cycle_peak;
+    }
+    if (!overflow.empty()) {
+        for (void* ptr : overflow) {
+            ::operator delete(ptr);
+        }
+        overflow.clear();
+
+        // Room for the whole cycle plus alignment slack
+        size_t grown = capacity ? capacity : MIN_ARENA_BLOCK;
+        while (grown < cycle_peak + cycle_peak / 8) {
+            grown *= 2;
+        }
+        ::operator delete(block);
+        block = (uint8_t*)::operator new(grown);
+        capacity = grown;
+    }
+    used = 0;
+    overflow_used = 0;
+    cycle_peak = 0;
+}
+
+// Open ScratchScopes on this thread. The marker cannot tell the outermost
+// scope: heap fallbacks do not advance it, so it is still 0 in a scope
+// nested inside one whose allocations all overflowed
+static thread_local int t_scratch_depth = 0;
+
+ScratchScope::ScratchScope() : scratch(Memory::scratch()), marker(scratch.getMarker()) {
+    t_scratch_depth++;
+}
+
+ScratchScope::~ScratchScope() {
+    // The outermost scope also releases heap fallbacks and grows the arena
+    if (--t_scratch_depth == 0) {
+        scratch.reset();
+    } else {
+        scratch.rewind(marker);
+    }
+}
+
+static bool s_heap_check = false;
+static int s_heap_check_warmup = 120;
+static uint64_t s_frame_start_allocs = 0;
+static MemoryStats s_stats = {};
+
+LinearArena& Memory::frameArena() {
+    static LinearArena arena(MIN_ARENA_BLOCK * 16);
+    return arena;
+}
+
+LinearArena& Memory::scratch() {
+    static thread_local LinearArena arena;
+    return arena;
+}
+
+uint64_t Memory::threadAllocations() {
+    return t_heap_allocs;
+}
+
+void Memory::setHeapCheck(bool enabled, int warmup_frames) {
+    s_heap_check = enabled;
+    s_heap_check_warmup = warmup_frames;
+#ifdef MEMORY_NO_TRACKING
+    if (enabled) {
+        gl_log_err("WARNING: heap check requested but built with MEMORY_NO_TRACKING\n");
+    }
+#endif
+    gl_log("Heap check: %s (after %d frames)\n", enabled ? "enabled" : "disabled", warmup_frames);
+}
+
+bool Memory::getHeapCheck() {
+    return s_heap_check;
+}
+
+void Memory::beginFrame() {
+    s_frame_start_allocs = t_heap_allocs;
+}
+
+void Memory::endFrame(uint64_t other_thread_allocs) {
+    uint64_t allocs = t_heap_allocs - s_frame_start_allocs + other_thread_allocs;
+    s_stats.frame_heap_allocs = allocs;
+    s_stats.frames++;
+
+    LinearArena& arena = frameArena();
+    s_stats.frame_arena_used = arena.getUsed();
+
+    if (allocs > 0 && s_stats.frames > (uint64_t)s_heap_check_warmup) {
+        s_stats.steady_heap_frames++;
+        if (s_heap_check) {
+            gl_log_err("ERROR: frame %llu made %llu heap allocations after warm-up\n",
+                       (unsigned long long)s_stats.frames, (unsigned long long)allocs);
+            std::cerr << "Heap check: frame " << s_stats.frames << " made " << allocs << " heap allocations"
+                      << std::endl;
+            assert(allocs == 0 && "steady-state frame allocated from the heap");
+        }
+    }
+
+    // Growing the arena is itself a heap allocation; it belongs to the
+    // frame that overflowed, not the next one
+    arena.reset();
+    s_stats.frame_arena_peak = arena.getPeak();
+    s_stats.frame_arena_capacity = arena.getCapacity();
+    s_frame_start_allocs = t_heap_allocs;
+}
+
+MemoryStats Memory::getStats() {
+    MemoryStats stats = s_stats;
+    stats.heap_allocs = s_heap_allocs.load(std::memory_order_relaxed);
+    stats.heap_frees = s_heap_frees.load(std::memory_order_relaxed);
+    stats.heap_bytes = s_heap_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,144 @@
+#include <glad/glad.h>
+#include "core/RenderThread.h"
+#include "core/FramePacer.h"
+#include "core/Memory.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/stats_overlay.h"
+#include "utils/log.h"
+#include "utils/utils.h"
+#include <chrono>
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+RenderThread::RenderThread()
+    : window(nullptr), running(false), write_index(0), read_index(0), frame(0), stopping(false), stats() {
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        in_flight[i] = false;
+    }
+}
+
+RenderThread::~RenderThread() {
+    stop();
+}
+
+bool RenderThread::start(GLFWwindow* window, const SubmitFunc& submit) {
+    if (running) {
+        return true;
+    }
+    if (glfwGetCurrentContext() != window) {
+        gl_log_err("ERROR: RenderThread::start needs the window's context current on the calling thread\n");
+        return false;
+    }
+
+    this->window = window;
+    this->submit = submit;
+    for (int i = 0; i < PACKET_COUNT; i++) {
+        in_flight[i] = false;
+    }
+    write_index = 0;
+    read_index = 0;
+    frame = 0;
+    stopping = false;
+    stats = Stats();
+
+    // A context can only be current on one thread at a time
+    glfwMakeContextCurrent(nullptr);
+    running = true;
+    thread = std::thread(&RenderThread::threadLoop, this);
+    gl_log("Render thread started (%d packets in flight)\n", PACKET_COUNT);
+    return true;
+}
+
+void RenderThread::stop() {
+    if (!running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+    running = false;
+
+    glfwMakeContextCurrent(window);
+    gl_log("Render thread stopped after %llu packets\n", (unsigned long long)stats.packets);
+}
+
+RenderPacket& RenderThread::acquire() {
+    auto start = std::chrono::high_resolution_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return !in_flight[write_index]; });
+    stats.acquire_wait_ms = ms_since(start);
+
+    RenderPacket& packet = packets[write_index];
+    packet.clear();
+    packet.frame = frame;
+    return packet;
+}
+
+void RenderThread::publish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        in_flight[write_index] = true;
+        write_index = (write_index + 1) % PACKET_COUNT;
+        frame++;
+    }
+    cv.notify_all();
+}
+
+RenderThread::Stats RenderThread::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void RenderThread::threadLoop() {
+    glfwMakeContextCurrent(window);
+
+    while (true) {
+        auto wait_start = std::chrono::high_resolution_clock::now();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return in_flight[read_index] || stopping; });
+            // Published packets are still drawn after stop()
+            if (!in_flight[read_index]) {
+                break;
+            }
+        }
+        double packet_wait_ms = ms_since(wait_start);
+
+        // The main thread does not touch this packet until in_flight is cleared
+        const RenderPacket& packet = packets[read_index];
+        uint64_t allocs_before = Memory::threadAllocations();
+        updateInputGL();
+
+        StatsOverlay::instance().beginFrame();
+        auto submit_start = std::chrono::high_resolution_clock::now();
+        submit(packet);
+        double submit_ms = ms_since(submit_start);
+        StatsOverlay::instance().endFrame();
+
+        FramePacer::instance().beforeSwap();
+        auto swap_start = std::chrono::high_resolution_clock::now();
+        glfwSwapBuffers(window);
+        double swap_ms = ms_since(swap_start);
+        FramePacer::instance().afterSwap();
+        GpuHandles::instance().endFrame();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            in_flight[read_index] = false;
+            read_index = (read_index + 1) % PACKET_COUNT;
+            stats.packets++;
+            stats.packet_wait_ms = packet_wait_ms;
+            stats.submit_ms = submit_ms;
+            stats.swap_ms = swap_ms;
+            stats.heap_allocs += Memory::threadAllocations() - allocs_before;
+        }
+        cv.notify_all();
+    }
+
+    glfwMakeContextCurrent(nullptr);
+}
@@ -1,8 +1,12 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <iostream>
+#include <vector>
 #include "exercises/exercise1.h"
+#include "graphics/gpu_handles.h"
+#include "core/Engine.h"
 #include "graphics/shader.h"
+#include "graphics/mesh_optimizer.h"
 #include "utils/log.h"
 #include "utils/utils.h"
 #include "exercises/ExerciseRegistry.h"
@@ -23,7 +27,7 @@ void runExercise1(GLFWwindow* window) {
 
     // Set initial viewport based on framebuffer size
     glViewport(0, 0, g_fb_width, g_fb_height);
-    gl_log("Initial viewport set to %dx%d\n", g_fb_width, g_fb_height);
+    gl_log("Initial viewport set to %dx%d\n", g_fb_width.load(), g_fb_height.load());
 
     // get version info
     const GLubyte* renderer = glGetString(GL_RENDERER);
@@ -65,36 +69,52 @@ void runExercise1(GLFWwindow* window) {
         0.5f, -0.5f,  0.0f
     };
 
+    // Index the square: its two triangles share 2 of their 6 vertices
+    std::vector<uint32_t> remap;
+    VertexStream square_stream = {points, 3};
+    size_t square_vertex_count = generate_vertex_remap(remap, &square_stream, 1, 6);
+    GLfloat square_points[6 * 3];
+    remap_vertex_buffer(square_points, points, 6, 3, remap);
+    GLuint square_indices[6];
+    for (int i = 0; i < 6; i++) {
+        square_indices[i] = remap[i];
+    }
+    gl_log("Square indexed: 6 -> %zu vertices\n", square_vertex_count);
+
+    GLuint triangle_indices[] = {0, 1, 2};
+
     gl_log("Creating VBOs and VAOs\n");
     
     //Build VBO
-    GLuint vbo = 0;
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+    GpuBuffer vbo(RESOURCE_VERTEX_BUFFER, "exercise 1 vbo");
+    gpu_buffer_data(vbo.get(), GL_ARRAY_BUFFER, square_vertex_count * 3 * sizeof(GLfloat), square_points, GL_STATIC_DRAW);
 
     //Build VAO
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    GpuVertexArray vao("exercise 1 vao");
+    glBindVertexArray(vao.get());
     glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo.get());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+    //Build IBO (element buffer binding is stored in the VAO)
+    GpuBuffer ibo(RESOURCE_INDEX_BUFFER, "exercise 1 ibo");
+    gpu_buffer_data(ibo.get(), GL_ELEMENT_ARRAY_BUFFER, sizeof(square_indices), square_indices, GL_STATIC_DRAW);
+
     //Build second VBO
-    GLuint vbo2 = 0;
-    glGenBuffers(1, &vbo2);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo2);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points2), points2, GL_STATIC_DRAW);
+    GpuBuffer vbo2(RESOURCE_VERTEX_BUFFER, "exercise 1 vbo2");
+    gpu_buffer_data(vbo2.get(), GL_ARRAY_BUFFER, sizeof(points2), points2, GL_STATIC_DRAW);
 
     //Build second VAO
-    GLuint vao2 = 0;
-    glGenVertexArrays(1, &vao2);
-    glBindVertexArray(vao2);
+    GpuVertexArray vao2("exercise 1 vao2");
+    glBindVertexArray(vao2.get());
     glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo2);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo2.get());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
 
+    //Build second IBO
+    GpuBuffer ibo2(RESOURCE_INDEX_BUFFER, "exercise 1 ibo2");
+    gpu_buffer_data(ibo2.get(), GL_ELEMENT_ARRAY_BUFFER, sizeof(triangle_indices), triangle_indices, GL_STATIC_DRAW);
+
     // Load shaders using Shader class
     Shader shader1;
     if (!shader1.loadFromFiles("shaders/exercises/exercise1/test.vert", 
@@ -129,40 +149,32 @@ void runExercise1(GLFWwindow* window) {
 
     gl_log("Entering render loop\n");
     
-    //Draw Loop
-    while (!glfwWindowShouldClose(window)) {
-        // Update FPS counter
-        update_fps_counter(window);
-        
+    //Draw Loop (no simulation, so only frame and render callbacks)
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
         // Update input with shader reload (R key) - pass both shaders
         updateInputWithShaderReload(window, &shader1, &shader2);
-        
+    };
+    loop.render = [&](double) {
         // Clear and set viewport
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, g_fb_width, g_fb_height);
         
         // Draw first shape (purple square)
         shader1.use();
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(vao.get());
+        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
         
         // Draw second shape (orange triangle)
         shader2.use();
-        glBindVertexArray(vao2);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        glBindVertexArray(vao2.get());
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+    };
+    Engine::run(window, loop);
 
     gl_log("Exiting render loop, cleaning up\n");
 
-    // Cleanup
-    glDeleteVertexArrays(1, &vao);
-    glDeleteVertexArrays(1, &vao2);
-    glDeleteBuffers(1, &vbo);
-    glDeleteBuffers(1, &vbo2);
-    // Shaders are automatically cleaned up by Shader destructor
+    // Buffers, VAOs and shaders are released by their destructors
 
     gl_log("Exercise 1 completed\n");
 }
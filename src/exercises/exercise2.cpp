@@ -2,6 +2,8 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "exercises/exercise2.h"
+#include "graphics/gpu_handles.h"
+#include "core/Engine.h"
 #include "graphics/shader.h"
 #include "utils/log.h"
 #include "utils/utils.h"
@@ -23,7 +25,7 @@ void runExercise2(GLFWwindow* window) {
 
     // Set initial viewport
     glViewport(0, 0, g_fb_width, g_fb_height);
-    gl_log("Initial viewport set to %dx%d\n", g_fb_width, g_fb_height);
+    gl_log("Initial viewport set to %dx%d\n", g_fb_width.load(), g_fb_height.load());
 
     // Get version info
     const GLubyte* renderer = glGetString(GL_RENDERER);
@@ -61,32 +63,32 @@ void runExercise2(GLFWwindow* window) {
     gl_log("Creating VBOs and VAO\n");
     
     // Create VBO for points
-    GLuint points_vbo = 0;
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+    GpuBuffer points_vbo(RESOURCE_VERTEX_BUFFER, "exercise 2 points_vbo");
+    gpu_buffer_data(points_vbo.get(), GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
 
     // Create VBO for colors
-    GLuint colours_vbo = 0;
-    glGenBuffers(1, &colours_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(colours), colours, GL_STATIC_DRAW);
+    GpuBuffer colours_vbo(RESOURCE_VERTEX_BUFFER, "exercise 2 colours_vbo");
+    gpu_buffer_data(colours_vbo.get(), GL_ARRAY_BUFFER, sizeof(colours), colours, GL_STATIC_DRAW);
 
     // Create VAO and configure vertex attributes
-    GLuint vao = 0;
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    GpuVertexArray vao("exercise 2 vao");
+    glBindVertexArray(vao.get());
     
     // Bind points VBO and set attribute pointer for position (location 0)
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, points_vbo.get());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
     glEnableVertexAttribArray(0);
     
     // Bind colors VBO and set attribute pointer for color (location 1)
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo.get());
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
     glEnableVertexAttribArray(1);
 
+    // Index buffer (element buffer binding is stored in the VAO)
+    GLuint indices[] = {0, 1, 2};
+    GpuBuffer ibo(RESOURCE_INDEX_BUFFER, "exercise 2 ibo");
+    gpu_buffer_data(ibo.get(), GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
     // Load shaders
     Shader shader;
     if (!shader.loadFromFiles("shaders/exercises/exercise2/vertex.glsl", 
@@ -103,34 +105,26 @@ void runExercise2(GLFWwindow* window) {
 
     gl_log("Entering render loop\n");
     
-    // Draw Loop
-    while (!glfwWindowShouldClose(window)) {
-        // Update FPS counter
-        update_fps_counter(window);
-        
+    // Draw Loop (no simulation, so only frame and render callbacks)
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
         // Update input with shader reload
         updateInputWithShaderReload(window, &shader, nullptr);
-        
+    };
+    loop.render = [&](double) {
         // Clear and set viewport
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, g_fb_width, g_fb_height);
         
         // Draw triangle
         shader.use();
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        glBindVertexArray(vao.get());
+        glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+    };
+    Engine::run(window, loop);
 
     gl_log("Exiting render loop, cleaning up\n");
 
-    // Cleanup
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &points_vbo);
-    glDeleteBuffers(1, &colours_vbo);
-
     gl_log("Exercise 2 completed\n");
 }
 
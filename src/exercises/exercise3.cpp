@@ -3,7 +3,10 @@
 #include <iostream>
 #include <cmath>
 #include "exercises/exercise3.h"
+#include "graphics/mesh_cache.h"
+#include "core/Engine.h"
 #include "graphics/shader.h"
+#include "graphics/vertex_format.h"
 #include "math/mat4.h"
 #include "utils/log.h"
 #include "utils/utils.h"
@@ -47,29 +50,26 @@ void runExercise3(GLFWwindow* window) {
         0.0f, 0.0f, 1.0f   // Blue
     };
 
-    gl_log("Creating VBOs and VAO\n");
+    gl_log("Creating interleaved VBO and VAO\n");
 
-    // Create VBOs and VAO
-    GLuint points_vbo, colours_vbo, vao;
-    
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+    // Interleaved snorm16 position + unorm8 colour: 12 bytes per vertex
+    // instead of 24 in two float buffers
+    VertexFormat format;
+    format.add(VERTEX_POSITION, VERTEX_SNORM16X4, 0)
+          .add(VERTEX_COLOR, VERTEX_UNORM8X4, 1);
 
-    glGenBuffers(1, &colours_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(colours), colours, GL_STATIC_DRAW);
+    VertexSource source;
+    source.data[VERTEX_POSITION] = points;
+    source.data[VERTEX_COLOR] = colours;
+    source.vertex_count = 3;
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(1);
+    // Packed and suballocated by the mesh cache, drawn from its shared VAO
+    GLuint indices[] = {0, 1, 2};
+    MeshCache& mesh_cache = MeshCache::instance();
+    MeshHandle triangle = mesh_cache.add(source, indices, 3, format, "exercise 3 triangle");
+    VertexDequant dequant = mesh_cache.get(triangle)->dequant;
+    gl_log("Vertex format: %u bytes/vertex (float layout: %u)\n", format.stride(),
+           (unsigned)(sizeof(points) + sizeof(colours)) / 3);
 
     // Load shaders
     gl_log("Loading shaders\n");
@@ -78,6 +78,7 @@ void runExercise3(GLFWwindow* window) {
                                "shaders/exercises/exercise3/fragment.glsl")) {
         gl_log_err("Failed to load shader\n");
         std::cerr << "Failed to load shader" << std::endl;
+        mesh_cache.release(triangle);
         return;
     }
 
@@ -85,6 +86,7 @@ void runExercise3(GLFWwindow* window) {
     shader.validate();
 
     shader.use();
+    dequant.setUniforms(shader.programme);
     int matrix_location = glGetUniformLocation(shader.programme, "matrix");
     
     if (matrix_location == -1) {
@@ -104,18 +106,24 @@ void runExercise3(GLFWwindow* window) {
 
     gl_log("Entering render loop\n");
 
-    // Animation variables
+    // Animation variables, advanced in fixed steps; the previous step is
+    // kept so frames in between can be interpolated
     float speed = 1.0f;
     float last_position = 0.0f;
     float rotation_angle = 0.0f;
     float scale_time = 0.0f;
+    float prev_position = 0.0f;
+    float prev_rotation_angle = 0.0f;
+    float prev_scale_time = 0.0f;
 
-    while (!glfwWindowShouldClose(window)) {
-        // Timer for animation
-        static double previous_seconds = glfwGetTime();
-        double current_seconds = glfwGetTime();
-        double elapsed_seconds = current_seconds - previous_seconds;
-        previous_seconds = current_seconds;
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
+        updateInput(window);  // Handles ESC and P key (screenshot)
+    };
+    loop.update = [&](double elapsed_seconds) {
+        prev_position = last_position;
+        prev_rotation_angle = rotation_angle;
+        prev_scale_time = scale_time;
 
         // Update translation (bounce back and forth)
         if (fabs(last_position) > 1.0f) {
@@ -127,23 +135,27 @@ void runExercise3(GLFWwindow* window) {
         rotation_angle += elapsed_seconds * 50.0f;  // 50 degrees per second
         if (rotation_angle > 360.0f) {
             rotation_angle -= 360.0f;
+            prev_rotation_angle -= 360.0f;
         }
 
-        // Update scale (pulse between 0.5 and 1.0)
+        // Update scale time
         scale_time += elapsed_seconds;
-        float scale_factor = 0.5f + 0.25f * (1.0f + sinf(scale_time * 2.0f));  // Oscillates 0.5 to 1.0
+    };
+    loop.render = [&](double alpha) {
+        float t = (float)alpha;
+        float position = lerp(prev_position, last_position, t);
+        float angle = lerp(prev_rotation_angle, rotation_angle, t);
+
+        // Pulse between 0.5 and 1.0
+        float scale_factor = 0.5f + 0.25f * (1.0f + sinf(lerp(prev_scale_time, scale_time, t) * 2.0f));
 
         // Build transformation matrix: Translate * Rotate * Scale
-        mat4 translation = translate(last_position, 0.0f, 0.0f);
-        mat4 rotation = rotate_z(rotation_angle);
+        mat4 translation = translate(position, 0.0f, 0.0f);
+        mat4 rotation = rotate_z(angle);
         mat4 scaling = scale(scale_factor, scale_factor, 1.0f);  // Animated scale!
         
         // Combine transformations (order matters!)
         mat4 model = translation * rotation * scaling;
-
-        update_fps_counter(window);
-        
-        updateInput(window);  // Handles ESC and P key (screenshot)
         
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, g_fb_width, g_fb_height);
@@ -151,18 +163,13 @@ void runExercise3(GLFWwindow* window) {
         shader.use();
         glUniformMatrix4fv(matrix_location, 1, GL_FALSE, model.m);
         
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-        
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        mesh_cache.draw(triangle);
+    };
+    Engine::run(window, loop);
 
     gl_log("Exiting render loop, cleaning up\n");
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &points_vbo);
-    glDeleteBuffers(1, &colours_vbo);
+    mesh_cache.release(triangle);
 
     gl_log("Exercise 3 completed\n");
 }
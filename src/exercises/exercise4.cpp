@@ -2,18 +2,78 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include "exercises/exercise4.h"
+#include "graphics/gpu_handles.h"
+#include "core/Engine.h"
+#include "core/Input.h"
+#include "core/Memory.h"
+#include "core/RenderThread.h"
 #include "graphics/shader.h"
+#include "graphics/lod_selector.h"
+#include "graphics/mesh.h"
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_simplifier.h"
+#include "graphics/occlusion_culler.h"
+#include "graphics/occlusion_queries.h"
 #include "math/mat4.h"
 #include "utils/log.h"
 #include "utils/utils.h"
+#include "utils/frame_stats.h"
 #include "exercises/ExerciseRegistry.h"
 
+// Draws whose GPU occlusion queries are issued together, ahead of them
+static const size_t QUERY_BATCH = 16;
+
 struct Triangle {
     vec3 position;  // Center position
     vec3 color;
 };
 
+// Unit UV sphere with a colour stream (location 1) shaded from the normal
+static void make_sphere(MeshData& mesh, int rings, int segments) {
+    std::vector<float> positions;
+    std::vector<float> colours;
+    for (int r = 0; r <= rings; r++) {
+        float theta = (float)M_PI * r / rings;
+        // Poles are a single vertex so the mesh is closed for the simplifier
+        int count = (r == 0 || r == rings) ? 1 : segments;
+        for (int s = 0; s < count; s++) {
+            float phi = 2.0f * (float)M_PI * s / segments;
+            vec3 n(sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi));
+            float light = 0.35f + 0.65f * fmaxf(dot(n, normalize(vec3(0.4f, 0.8f, 0.6f))), 0.0f);
+            positions.insert(positions.end(), {n.v[0], n.v[1], n.v[2]});
+            colours.insert(colours.end(), {light, light * 0.8f, light * 0.6f});
+        }
+    }
+
+    auto ring_vertex = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + s % segments); };
+    uint32_t south = (uint32_t)(positions.size() / 3 - 1);
+    for (int s = 0; s < segments; s++) {
+        mesh.indices.insert(mesh.indices.end(), {0u, ring_vertex(1, s + 1), ring_vertex(1, s)});
+        mesh.indices.insert(mesh.indices.end(), {south, ring_vertex(rings - 1, s), ring_vertex(rings - 1, s + 1)});
+    }
+    for (int r = 1; r < rings - 1; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = ring_vertex(r, s), b = ring_vertex(r, s + 1);
+            uint32_t c = ring_vertex(r + 1, s), d = ring_vertex(r + 1, s + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, b, d, c});
+        }
+    }
+
+    mesh.vertex_count = (uint32_t)(positions.size() / 3);
+    const uint8_t* p = (const uint8_t*)positions.data();
+    const uint8_t* c = (const uint8_t*)colours.data();
+    mesh.streams.push_back({0, 3, MESH_TYPE_FLOAT, false,
+                            std::vector<uint8_t>(p, p + positions.size() * sizeof(float))});
+    mesh.streams.push_back({1, 3, MESH_TYPE_FLOAT, false,
+                            std::vector<uint8_t>(c, c + colours.size() * sizeof(float))});
+    for (int i = 0; i < 3; i++) {
+        mesh.bounds_min[i] = -1.0f;
+        mesh.bounds_max[i] = 1.0f;
+    }
+}
+
 void runExercise4(GLFWwindow* window) {
     gl_log("Running Exercise 4 - Virtual Camera with Frustum Culling\n");
     
@@ -62,27 +122,29 @@ void runExercise4(GLFWwindow* window) {
     std::cout << "Created " << triangles.size() << " triangles in the scene" << std::endl;
 
     // Create VBOs with base triangle
-    GLuint points_vbo, colours_vbo, vao;
     
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(base_points), base_points, GL_DYNAMIC_DRAW);
+    GpuBuffer points_vbo(RESOURCE_VERTEX_BUFFER, "exercise 4 points_vbo");
+    gpu_buffer_data(points_vbo.get(), GL_ARRAY_BUFFER, sizeof(base_points), base_points, GL_DYNAMIC_DRAW);
 
-    glGenBuffers(1, &colours_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(base_colours), base_colours, GL_DYNAMIC_DRAW);
+    GpuBuffer colours_vbo(RESOURCE_VERTEX_BUFFER, "exercise 4 colours_vbo");
+    gpu_buffer_data(colours_vbo.get(), GL_ARRAY_BUFFER, sizeof(base_colours), base_colours, GL_DYNAMIC_DRAW);
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
+    GpuVertexArray vao("exercise 4 vao");
+    glBindVertexArray(vao.get());
     
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, points_vbo.get());
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
     glEnableVertexAttribArray(0);
     
-    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, colours_vbo.get());
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
     glEnableVertexAttribArray(1);
 
+    // Index buffer (element buffer binding is stored in the VAO)
+    GLuint indices[] = {0, 1, 2};
+    GpuBuffer ibo(RESOURCE_INDEX_BUFFER, "exercise 4 ibo");
+    gpu_buffer_data(ibo.get(), GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
     Shader shader;
     if (!shader.loadFromFiles("shaders/exercises/exercise4/vertex.glsl", 
                                "shaders/exercises/exercise4/fragment.glsl")) {
@@ -93,6 +155,9 @@ void runExercise4(GLFWwindow* window) {
     shader.use();
     int view_loc = glGetUniformLocation(shader.programme, "view");
     int proj_loc = glGetUniformLocation(shader.programme, "proj");
+    int model_loc = glGetUniformLocation(shader.programme, "model");
+    mat4 identity = identity_mat4();
+    glUniformMatrix4fv(model_loc, 1, GL_FALSE, identity.m);
     
     std::cout << "view_loc: " << view_loc << ", proj_loc: " << proj_loc << std::endl;
 
@@ -104,13 +169,51 @@ void runExercise4(GLFWwindow* window) {
     float cam_pitch = 0.0f;
 
     // Mouse variables
-    double prev_mouse_x = 0.0, prev_mouse_y = 0.0;
-    bool first_mouse = true;
     float mouse_sensitivity = 0.2f;
 
     // Frustum culling toggle
     bool culling_enabled = false;
 
+    // Occlusion culling: the big red triangle in front occludes the grid
+    bool occlusion_enabled = false;
+    OcclusionCuller occlusion_culler(256, 128);
+    std::vector<AABB> bounds(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const vec3& p = triangles[i].position;
+        bounds[i] = AABB(vec3(p.v[0] - 1.0f, p.v[1] - 1.0f, p.v[2]),
+                         vec3(p.v[0] + 1.0f, p.v[1] + 1.0f, p.v[2]));
+    }
+
+    // LOD spheres: a dense sphere at every grid position, drawn with the
+    // LOD picked from its projected error
+    bool lod_spheres = false;
+    MeshData sphere_data;
+    make_sphere(sphere_data, 64, 128);
+    int lod_count = generate_lods(sphere_data);
+    optimize_mesh(sphere_data);
+    Mesh sphere;
+    sphere.loadFromData(sphere_data, "lod sphere");
+    for (const MeshLod& lod : sphere.lods) {
+        std::cout << "  LOD: " << lod.index_count / 3 << " triangles, error " << lod.error << std::endl;
+    }
+
+    LodSelector lod_selector;
+    lod_selector.setProjection(67.0f, (float)g_fb_height);
+    std::vector<int> lod_state(triangles.size(), -1);
+    std::vector<AABB> sphere_bounds(triangles.size());
+    for (size_t i = 0; i < triangles.size(); i++) {
+        const vec3& p = triangles[i].position;
+        sphere_bounds[i] = AABB(subtract(p, vec3(1.0f, 1.0f, 1.0f)), add(p, vec3(1.0f, 1.0f, 1.0f)));
+    }
+
+    // GPU occlusion queries (results are used one frame late, never stalls)
+    bool gpu_queries_enabled = false;
+    OcclusionQueryManager occlusion_queries;
+    if (!occlusion_queries.init((int)triangles.size())) {
+        std::cerr << "Failed to initialise occlusion queries" << std::endl;
+        return;
+    }
+
     // Matrices
     mat4 proj_mat = perspective(67.0f, (float)g_fb_width / (float)g_fb_height, 0.1f, 100.0f);
     mat4 view_mat = rotate_x(-cam_pitch) * rotate_y(-cam_yaw) * translate(vec3(-cam_pos.v[0], -cam_pos.v[1], -cam_pos.v[2]));
@@ -125,45 +228,74 @@ void runExercise4(GLFWwindow* window) {
     std::cout << "RIGHT CLICK + Q/E - Up/Down" << std::endl;
     std::cout << "MIDDLE CLICK + DRAG - Pan" << std::endl;
     std::cout << "C - Toggle frustum culling (starts OFF)" << std::endl;
+    std::cout << "O - Toggle occlusion culling (starts OFF)" << std::endl;
+    std::cout << "G - Toggle GPU occlusion queries (starts OFF)" << std::endl;
+    std::cout << "V - Toggle conditional rendering for GPU queries" << std::endl;
+    std::cout << "L - Toggle LOD spheres (" << lod_count << " LODs)" << std::endl;
+    std::cout << "[ / ] - LOD error threshold in pixels" << std::endl;
     std::cout << "ESC - Exit" << std::endl;
 
     float cam_speed = 5.0f;
 
-    while (!glfwWindowShouldClose(window)) {
-        static double prev_time = glfwGetTime();
-        double curr_time = glfwGetTime();
-        double dt = curr_time - prev_time;
-        prev_time = curr_time;
-
-        update_fps_counter(window);
-
+    // Toggles the render thread applies (frame() must not touch GL objects)
+    bool conditional_render = occlusion_queries.getConditionalRender();
+    const uint32_t PACKET_GPU_QUERIES = 1u << 0;
+    const uint32_t PACKET_CONDITIONAL = 1u << 1;
+    const uint32_t PACKET_LOD_SPHERES = 1u << 2;
+    const uint32_t MESH_TRIANGLE = 0, MESH_SPHERE = 1;
+
+    // Nothing here is simulated: the camera follows input once per frame.
+    // Culling and LOD selection build a render packet on the main thread;
+    // the GL thread draws it (see core/RenderThread.h, --serial to compare)
+    LoopCallbacks loop;
+    loop.frame = [&](double dt) {
+        Input& input = Input::instance();
         bool moved = false;
 
         // Toggle culling with C key
-        static bool c_was_pressed = false;
-        bool c_is_pressed = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
-        if (c_is_pressed && !c_was_pressed) {
+        if (input.wasKeyPressed(GLFW_KEY_C)) {
             culling_enabled = !culling_enabled;
             std::cout << "\nFrustum culling: " << (culling_enabled ? "ON" : "OFF") << std::endl;
         }
-        c_was_pressed = c_is_pressed;
 
-        bool right_mouse = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT) == GLFW_PRESS;
-        bool middle_mouse = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_MIDDLE) == GLFW_PRESS;
+        // Toggle occlusion culling with O key
+        if (input.wasKeyPressed(GLFW_KEY_O)) {
+            occlusion_enabled = !occlusion_enabled;
+            std::cout << "\nOcclusion culling: " << (occlusion_enabled ? "ON" : "OFF") << std::endl;
+        }
 
-        double mouse_x, mouse_y;
-        glfwGetCursorPos(window, &mouse_x, &mouse_y);
-        
-        if (first_mouse) {
-            prev_mouse_x = mouse_x;
-            prev_mouse_y = mouse_y;
-            first_mouse = false;
+        // Toggle GPU occlusion queries with G key
+        if (input.wasKeyPressed(GLFW_KEY_G)) {
+            gpu_queries_enabled = !gpu_queries_enabled;
+            std::cout << "\nGPU occlusion queries: " << (gpu_queries_enabled ? "ON" : "OFF") << std::endl;
+        }
+
+        // Toggle conditional rendering with V key
+        if (input.wasKeyPressed(GLFW_KEY_V)) {
+            conditional_render = !conditional_render;
+            std::cout << "\nConditional rendering: " << (conditional_render ? "ON" : "OFF") << std::endl;
+        }
+
+        // Toggle LOD spheres with L key, threshold with [ and ]
+        if (input.wasKeyPressed(GLFW_KEY_L)) {
+            lod_spheres = !lod_spheres;
+            std::cout << "\nLOD spheres: " << (lod_spheres ? "ON" : "OFF") << std::endl;
+        }
+
+        bool bracket_down = input.wasKeyPressed(GLFW_KEY_LEFT_BRACKET);
+        bool bracket_up = input.wasKeyPressed(GLFW_KEY_RIGHT_BRACKET);
+        if (bracket_down || bracket_up) {
+            float pixels = lod_selector.getThreshold() * (bracket_up ? 2.0f : 0.5f);
+            lod_selector.setThreshold(pixels);
+            std::cout << "\nLOD threshold: " << pixels << " px" << std::endl;
         }
-        
-        double mouse_dx = prev_mouse_x - mouse_x;
-        double mouse_dy = prev_mouse_y - mouse_y;
-        prev_mouse_x = mouse_x;
-        prev_mouse_y = mouse_y;
+
+        bool right_mouse = input.isButtonHeld(GLFW_MOUSE_BUTTON_RIGHT);
+        bool middle_mouse = input.isButtonHeld(GLFW_MOUSE_BUTTON_MIDDLE);
+
+        // Every cursor event since the last frame, summed
+        double mouse_dx = -input.getCursorDeltaX();
+        double mouse_dy = -input.getCursorDeltaY();
 
         if (right_mouse && (mouse_dx != 0.0 || mouse_dy != 0.0)) {
             cam_yaw += mouse_dx * mouse_sensitivity;
@@ -188,31 +320,31 @@ void runExercise4(GLFWwindow* window) {
             vec3 forward(sinf(yaw_rad), 0.0f, -cosf(yaw_rad));
             vec3 right(cosf(yaw_rad), 0.0f, sinf(yaw_rad));
             
-            if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_W)) {
                 cam_pos.v[0] += forward.v[0] * cam_speed * dt;
                 cam_pos.v[2] += forward.v[2] * cam_speed * dt;
                 moved = true;
             }
-            if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_S)) {
                 cam_pos.v[0] -= forward.v[0] * cam_speed * dt;
                 cam_pos.v[2] -= forward.v[2] * cam_speed * dt;
                 moved = true;
             }
-            if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_A)) {
                 cam_pos.v[0] -= right.v[0] * cam_speed * dt;
                 cam_pos.v[2] -= right.v[2] * cam_speed * dt;
                 moved = true;
             }
-            if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_D)) {
                 cam_pos.v[0] += right.v[0] * cam_speed * dt;
                 cam_pos.v[2] += right.v[2] * cam_speed * dt;
                 moved = true;
             }
-            if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_Q)) {
                 cam_pos.v[1] -= cam_speed * dt;
                 moved = true;
             }
-            if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+            if (input.isKeyHeld(GLFW_KEY_E)) {
                 cam_pos.v[1] += cam_speed * dt;
                 moved = true;
             }
@@ -222,25 +354,68 @@ void runExercise4(GLFWwindow* window) {
         
         if (moved) {
             view_mat = rotate_x(-cam_pitch) * rotate_y(-cam_yaw) * translate(vec3(-cam_pos.v[0], -cam_pos.v[1], -cam_pos.v[2]));
-            glUniformMatrix4fv(view_loc, 1, GL_FALSE, view_mat.m);
+        }
+    };
+    loop.build = [&](RenderPacket& packet, double) {
+        double curr_time = glfwGetTime();
+
+        packet.view = view_mat;
+        packet.proj = proj_mat;
+        packet.camera_position = cam_pos;
+        if (gpu_queries_enabled) packet.flags |= PACKET_GPU_QUERIES;
+        if (conditional_render) packet.flags |= PACKET_CONDITIONAL;
+        if (lod_spheres) packet.flags |= PACKET_LOD_SPHERES;
+
+        // Per-frame lists live in the frame arena, which Engine::run resets
+        // after the frame
+        LinearArena& arena = Memory::frameArena();
+        uint32_t object_count = (uint32_t)triangles.size();
+        int* draw_order = arena.allocArray<int>(object_count);
+        uint8_t* visible = arena.allocArray<uint8_t>(object_count);
+        for (uint32_t i = 0; i < object_count; i++) {
+            draw_order[i] = (int)i;
+            visible[i] = 1;
         }
 
         // Extract frustum for culling
         mat4 proj_view = proj_mat * view_mat;
+        const std::vector<AABB>& object_bounds = lod_spheres ? sphere_bounds : bounds;
         Frustum frustum = extract_frustum(proj_view);
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, g_fb_width, g_fb_height);
+        // Rasterize the occluder on the CPU and test every other triangle
+        if (occlusion_enabled) {
+            GLfloat occluder[9];
+            for (int i = 0; i < 9; i++) {
+                occluder[i] = base_points[i] + triangles[0].position.v[i % 3];
+            }
+            occlusion_culler.beginFrame(proj_view);
+            occlusion_culler.addOccluder(occluder, 3);
+            occlusion_culler.finalize();
+            occlusion_culler.testVisibility(object_bounds.data() + 1, (uint32_t)object_bounds.size() - 1,
+                                            visible + 1);
+        }
 
-        shader.use();
-        glBindVertexArray(vao);
+        // Queries need front-to-back order so nearer triangles occlude later ones
+        if (gpu_queries_enabled) {
+            float* distance = arena.allocArray<float>(object_count);
+            for (uint32_t i = 0; i < object_count; i++) {
+                vec3 d = subtract(triangles[i].position, cam_pos);
+                distance[i] = dot(d, d);
+            }
+            std::sort(draw_order, draw_order + object_count,
+                      [distance](int a, int b) { return distance[a] < distance[b]; });
+        }
 
-        int triangles_drawn = 0;
-        GLfloat points[9];
-        GLfloat colours[9];
+        // Draw list: every triangle that survives frustum and occlusion culling
+        for (uint32_t d = 0; d < object_count; d++) {
+            int t = draw_order[d];
+            const Triangle& tri = triangles[t];
+
+            // Occlusion check (the occluder itself is never culled)
+            if (occlusion_enabled && !visible[t]) {
+                continue;
+            }
 
-        // Draw all triangles with optional frustum culling
-        for (const auto& tri : triangles) {
             // Frustum culling check
             if (culling_enabled) {
                 float bounding_radius = 2.0f;  // Approximate radius of triangle
@@ -249,42 +424,143 @@ void runExercise4(GLFWwindow* window) {
                 }
             }
 
-            triangles_drawn++;
+            DrawItem item;
+            item.object = (uint32_t)t;
+            item.mesh = lod_spheres ? MESH_SPHERE : MESH_TRIANGLE;
+            item.lod = -1;
+            item.model = translate(tri.position);
+            item.colour = tri.color;
+            if (lod_spheres) {
+                item.lod = lod_selector.select(sphere.lods.data(), (int)sphere.lods.size(),
+                                               lod_distance(cam_pos, object_bounds[t]), lod_state[t]);
+                lod_state[t] = item.lod;
+            }
+            packet.draws.push_back(item);
+        }
+
+        // Display CPU side stats every second
+        static double last_print = 0.0;
+        if (curr_time - last_print > 1.0) {
+            int drawn = (int)packet.draws.size();
+            int percent = triangles.size() > 0 ? (drawn * 100 / triangles.size()) : 0;
+            std::cout << "Drawing " << drawn << " / " << triangles.size() 
+                      << " (" << percent << "%) - Culling: " 
+                      << (culling_enabled ? "ON" : "OFF") << std::endl;
+            if (lod_spheres) {
+                std::cout << "  LOD threshold " << lod_selector.getThreshold() << " px" << std::endl;
+            }
+            if (occlusion_enabled) {
+                const OcclusionCuller::Stats& occ = occlusion_culler.getStats();
+                std::cout << "  Occluded " << occ.objects_occluded << " / " << occ.objects_tested
+                          << " - raster: " << occ.raster_ms << " ms, test: " << occ.test_ms << " ms" << std::endl;
+            }
+            const LoopStats& loop_stats = Engine::getLoopStats();
+            std::cout << "  Main thread: build " << loop_stats.build_ms << " ms, waited "
+                      << loop_stats.acquire_wait_ms << " ms - GL: submit " << loop_stats.submit_ms << " ms, swap "
+                      << loop_stats.swap_ms << " ms (" << (loop_stats.render_thread ? "render thread" : "serial")
+                      << ")" << std::endl;
+            last_print = curr_time;
+        }
+    };
+    loop.submit = [&](const RenderPacket& packet) {
+        bool gpu_queries = (packet.flags & PACKET_GPU_QUERIES) != 0;
+        mat4 proj_view = packet.proj * packet.view;
+
+        reset_frame_stats();
+        occlusion_queries.setConditionalRender((packet.flags & PACKET_CONDITIONAL) != 0);
+        if (gpu_queries) {
+            occlusion_queries.beginFrame(proj_view);
+        }
+
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glViewport(0, 0, g_fb_width, g_fb_height);
 
-            // Update triangle position and color
+        shader.use();
+        glUniformMatrix4fv(view_loc, 1, GL_FALSE, packet.view.m);
+        glBindVertexArray(vao.get());
+
+        GLfloat points[9];
+        GLfloat colours[9];
+
+        for (size_t d = 0; d < packet.draws.size(); d++) {
+            const DrawItem& item = packet.draws[d];
+            int t = (int)item.object;
+
+            // GPU queries for the next batch of draws: each box is tested
+            // against everything drawn before the batch
+            if (gpu_queries && d % QUERY_BATCH == 0) {
+                size_t batch_end = std::min(d + QUERY_BATCH, packet.draws.size());
+                occlusion_queries.beginQueries();
+                for (size_t q = d; q < batch_end; q++) {
+                    const DrawItem& queried = packet.draws[q];
+                    int id = (int)queried.object;
+                    occlusion_queries.queryObject(id, queried.mesh == MESH_SPHERE ? sphere_bounds[id] : bounds[id]);
+                }
+                occlusion_queries.endQueries();
+                shader.use();
+                glBindVertexArray(vao.get());
+            }
+            if (gpu_queries && !occlusion_queries.isVisible(t)) {
+                g_frame_stats.draw_calls_saved++;
+                continue;
+            }
+
+            if (item.mesh == MESH_SPHERE) {
+                int lod = item.lod;
+                glUniformMatrix4fv(model_loc, 1, GL_FALSE, item.model.m);
+                if (gpu_queries) occlusion_queries.beginConditional(t);
+                sphere.drawLod(lod);
+                if (gpu_queries) occlusion_queries.endConditional(t);
+                g_frame_stats.draw_calls++;
+                g_frame_stats.triangles += sphere.lods[lod].index_count / 3;
+                g_frame_stats.lod_histogram[lod < FRAME_STATS_MAX_LODS ? lod : FRAME_STATS_MAX_LODS - 1]++;
+                continue;
+            }
+
+            // Update triangle position and color (translation is the model matrix's last column)
             for (int i = 0; i < 3; i++) {
-                points[i*3+0] = base_points[i*3+0] + tri.position.v[0];
-                points[i*3+1] = base_points[i*3+1] + tri.position.v[1];
-                points[i*3+2] = base_points[i*3+2] + tri.position.v[2];
-                colours[i*3+0] = tri.color.v[0];
-                colours[i*3+1] = tri.color.v[1];
-                colours[i*3+2] = tri.color.v[2];
+                points[i*3+0] = base_points[i*3+0] + item.model.m[12];
+                points[i*3+1] = base_points[i*3+1] + item.model.m[13];
+                points[i*3+2] = base_points[i*3+2] + item.model.m[14];
+                colours[i*3+0] = item.colour.v[0];
+                colours[i*3+1] = item.colour.v[1];
+                colours[i*3+2] = item.colour.v[2];
             }
             
-            glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
+            glUniformMatrix4fv(model_loc, 1, GL_FALSE, identity.m);
+            glBindVertexArray(vao.get());
+            glBindBuffer(GL_ARRAY_BUFFER, points_vbo.get());
             glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(points), points);
-            glBindBuffer(GL_ARRAY_BUFFER, colours_vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, colours_vbo.get());
             glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(colours), colours);
-            glDrawArrays(GL_TRIANGLES, 0, 3);
+            if (gpu_queries) occlusion_queries.beginConditional(t);
+            glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+            if (gpu_queries) occlusion_queries.endConditional(t);
+            g_frame_stats.draw_calls++;
+            g_frame_stats.triangles++;
         }
 
-        // Display stats every second
+        // Display GL side stats every second
         static double last_print = 0.0;
+        double curr_time = glfwGetTime();
         if (curr_time - last_print > 1.0) {
-            int percent = triangles.size() > 0 ? (triangles_drawn * 100 / triangles.size()) : 0;
-            std::cout << "Drawing " << triangles_drawn << " / " << triangles.size() 
-                      << " (" << percent << "%) - Culling: " 
-                      << (culling_enabled ? "ON" : "OFF") << std::endl;
+            std::cout << "  Triangles submitted: " << g_frame_stats.triangles
+                      << " in " << g_frame_stats.draw_calls << " draw calls" << std::endl;
+            if (packet.flags & PACKET_LOD_SPHERES) {
+                std::cout << "  LODs:";
+                for (int i = 0; i < lod_count && i < FRAME_STATS_MAX_LODS; i++) {
+                    std::cout << " " << g_frame_stats.lod_histogram[i];
+                }
+                std::cout << std::endl;
+            }
+            if (gpu_queries) {
+                std::cout << "  GPU queries: " << g_frame_stats.occlusion_queries
+                          << " issued, draw calls saved: " << g_frame_stats.draw_calls_saved << std::endl;
+            }
             last_print = curr_time;
         }
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
-
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &points_vbo);
-    glDeleteBuffers(1, &colours_vbo);
+    };
+    Engine::run(window, loop);
 
     gl_log("Exercise 4 completed\n");
 }
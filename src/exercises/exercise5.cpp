@@ -1,13 +1,73 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include "exercises/exercise5.h"
-#include "graphics/shader.h"
+#include "graphics/mesh_cache.h"
+#include "core/Engine.h"
+#include "core/Input.h"
+#include "graphics/shader_batch.h"
+#include "graphics/shader_variants.h"
+#include "graphics/vertex_format.h"
 #include "math/mat4.h"
 #include "utils/log.h"
 #include "utils/utils.h"
 #include "exercises/ExerciseRegistry.h"
 
+// Startup cost of many programmes: the same BENCH_PROGRAMMES programmes are
+// built one by one with loadFromFiles (status checked after every compile)
+// and then as one ShaderBatch. Every programme gets a unique define so
+// neither the driver's in-memory nor its on-disk shader cache can answer
+static void runCompileBenchmark() {
+    const int BENCH_PROGRAMMES = 64;
+    const char* vs = "shaders/exercises/exercise5/vertex.glsl";
+    const char* fs = "shaders/exercises/exercise5/fragment.glsl";
+    static int run = 0;
+    int salt = (int)(glfwGetTime() * 1000.0) * 4 + (run++ % 4);
+
+    auto definesFor = [&](int pass, int i) {
+        std::vector<std::string> defines = {"BENCH_SALT " + std::to_string(salt) + std::to_string(pass),
+                                            "BENCH_PROGRAMME " + std::to_string(i)};
+        if (i & 1) defines.push_back("USE_BLINN");
+        return defines;
+    };
+
+    std::cout << "\nCompiling " << BENCH_PROGRAMMES << " programmes twice ("
+              << (ShaderBatch::isParallelCompileSupported() ? "parallel compile" : "no parallel compile extension")
+              << ")..." << std::endl;
+
+    std::vector<std::unique_ptr<Shader>> sequential;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < BENCH_PROGRAMMES; i++) {
+        sequential.emplace_back(new Shader());
+        sequential.back()->loadFromFiles(vs, fs, definesFor(0, i));
+    }
+    double sequential_ms =
+        std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    std::vector<std::unique_ptr<Shader>> batched;
+    ShaderBatch batch;
+    for (int i = 0; i < BENCH_PROGRAMMES; i++) {
+        batched.emplace_back(new Shader());
+        batch.add(batched.back().get(), vs, fs, definesFor(1, i));
+    }
+    batch.submit();
+    while (batch.poll() > 0) {
+        // A real frame would draw with whatever is installed so far
+    }
+    batch.finish();
+    const ShaderBatch::Stats& stats = batch.getStats();
+
+    std::cout << "  Sequential: " << sequential_ms << " ms" << std::endl;
+    std::cout << "  Batched:    " << stats.total_ms << " ms (submit " << stats.submit_ms << " ms, first ready "
+              << stats.first_ready_ms << " ms, " << stats.failed << " failed)" << std::endl;
+    std::cout << "  Speed-up:   " << (stats.total_ms > 0.0 ? sequential_ms / stats.total_ms : 0.0) << "x"
+              << std::endl;
+    gl_log("Compile benchmark (%d programmes): sequential %.2f ms, batched %.2f ms (first ready %.2f ms)\n",
+           BENCH_PROGRAMMES, sequential_ms, stats.total_ms, stats.first_ready_ms);
+}
+
 void runExercise5(GLFWwindow* window) {
     gl_log("Running Exercise 5 - Phong vs Blinn-Phong (Double-Sided)\n");
     
@@ -53,48 +113,37 @@ void runExercise5(GLFWwindow* window) {
         0.0f, 0.0f, -1.0f
     };
 
-    GLuint points_vbo, normals_vbo, vao;
-    
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+    // Interleaved snorm16 position + octahedral 10:10 normal: 12 bytes per
+    // vertex instead of 24 in two float buffers
+    VertexFormat format = VertexFormat::compact(true, false);
 
-    glGenBuffers(1, &normals_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, normals_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(normals), normals, GL_STATIC_DRAW);
+    VertexSource source;
+    source.data[VERTEX_POSITION] = points;
+    source.data[VERTEX_NORMAL] = normals;
+    source.vertex_count = 6;
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, normals_vbo);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(1);
+    // Packed and suballocated by the mesh cache, drawn from its shared VAO
+    GLuint indices[] = {0, 1, 2, 3, 4, 5};
+    MeshCache& mesh_cache = MeshCache::instance();
+    MeshHandle triangle = mesh_cache.add(source, indices, 6, format, "exercise 5 triangle");
+    VertexDequant dequant = mesh_cache.get(triangle)->dequant;
 
-    Shader shader;
-    if (!shader.loadFromFiles("shaders/exercises/exercise5/vertex.glsl", 
-                               "shaders/exercises/exercise5/fragment.glsl")) {
+    // Phong / Blinn-Phong is a compile-time option: each variant is its own
+    // programme with no per-fragment branch
+    const uint32_t VARIANT_BLINN = 1u << 0;
+    ShaderVariants phong;
+    phong.init("shaders/exercises/exercise5/vertex.glsl",
+               "shaders/exercises/exercise5/fragment.glsl", {"USE_BLINN"});
+    if (!phong.precompile({0, VARIANT_BLINN}) && !phong.get(0)) {
         std::cerr << "Failed to load shader" << std::endl;
+        mesh_cache.release(triangle);
         return;
     }
+    std::cout << "Phong variants compiled in " << phong.getStats().last_compile_ms << " ms" << std::endl;
 
-    shader.use();
-    
-    int model_loc = glGetUniformLocation(shader.programme, "model");
-    int view_loc = glGetUniformLocation(shader.programme, "view");
-    int proj_loc = glGetUniformLocation(shader.programme, "proj");
-    int spec_exp_loc = glGetUniformLocation(shader.programme, "specular_exponent");
-    int use_blinn_loc = glGetUniformLocation(shader.programme, "use_blinn");
-    
-    std::cout << "Uniform locations:" << std::endl;
-    std::cout << "  model: " << model_loc << std::endl;
-    std::cout << "  view: " << view_loc << std::endl;
-    std::cout << "  proj: " << proj_loc << std::endl;
-    std::cout << "  specular_exponent: " << spec_exp_loc << std::endl;
-    std::cout << "  use_blinn: " << use_blinn_loc << std::endl;
+    Shader* shader = nullptr;
+    unsigned int shader_generation = 0;
+    int model_loc = -1, view_loc = -1, proj_loc = -1, spec_exp_loc = -1;
 
     glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
 
@@ -105,10 +154,6 @@ void runExercise5(GLFWwindow* window) {
     float aspect = (float)g_fb_width / (float)g_fb_height;
     mat4 proj_mat = perspective(67.0f, aspect, 0.1f, 100.0f);
 
-    // Send view and projection once
-    glUniformMatrix4fv(view_loc, 1, GL_FALSE, view_mat.m);
-    glUniformMatrix4fv(proj_loc, 1, GL_FALSE, proj_mat.m);
-
     std::cout << "\n=== Exercise 5 - Double-Sided Phong Lighting ===" << std::endl;
     std::cout << "Triangle has geometry on BOTH sides with proper normals!" << std::endl;
     std::cout << "Both sides will be lit correctly when rotating" << std::endl;
@@ -116,9 +161,11 @@ void runExercise5(GLFWwindow* window) {
     std::cout << "  B - Toggle Blinn-Phong / Phong" << std::endl;
     std::cout << "  SPACE - Toggle rotation" << std::endl;
     std::cout << "  UP/DOWN - Adjust specular exponent" << std::endl;
+    std::cout << "  C - Shader compile benchmark (sequential vs batched)" << std::endl;
     std::cout << "  ESC - Exit" << std::endl;
 
     float rotation_angle = 0.0f;
+    float prev_rotation_angle = 0.0f;
     bool rotate = true;
     float specular_exp = 100.0f;
     bool use_blinn = false;
@@ -126,18 +173,13 @@ void runExercise5(GLFWwindow* window) {
     std::cout << "\nCurrent mode: PHONG (classic)" << std::endl;
     std::cout << "Specular exponent: " << specular_exp << std::endl;
 
-    while (!glfwWindowShouldClose(window)) {
-        static double prev_time = glfwGetTime();
+    LoopCallbacks loop;
+    loop.frame = [&](double elapsed) {
+        Input& input = Input::instance();
         double curr_time = glfwGetTime();
-        double elapsed = curr_time - prev_time;
-        prev_time = curr_time;
-
-        update_fps_counter(window);
 
         // Toggle Blinn-Phong
-        static bool b_was_pressed = false;
-        bool b_is_pressed = glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS;
-        if (b_is_pressed && !b_was_pressed) {
+        if (input.wasKeyPressed(GLFW_KEY_B)) {
             use_blinn = !use_blinn;
             std::cout << "\n=== Switched to " << (use_blinn ? "BLINN-PHONG" : "PHONG") << " ===" << std::endl;
             if (use_blinn) {
@@ -147,25 +189,26 @@ void runExercise5(GLFWwindow* window) {
                 std::cout << "Using reflection vector (classic Phong)" << std::endl;
             }
         }
-        b_was_pressed = b_is_pressed;
 
         // Toggle rotation
-        static bool space_was_pressed = false;
-        bool space_is_pressed = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
-        if (space_is_pressed && !space_was_pressed) {
+        if (input.wasKeyPressed(GLFW_KEY_SPACE)) {
             rotate = !rotate;
             std::cout << "Rotation: " << (rotate ? "ON" : "OFF") << std::endl;
         }
-        space_was_pressed = space_is_pressed;
+
+        // Compile benchmark
+        if (input.wasKeyPressed(GLFW_KEY_C)) {
+            runCompileBenchmark();
+        }
 
         // Adjust specular exponent
         bool exp_changed = false;
-        if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
+        if (input.isKeyHeld(GLFW_KEY_UP)) {
             specular_exp += 100.0f * elapsed;
             if (specular_exp > 1000.0f) specular_exp = 1000.0f;
             exp_changed = true;
         }
-        if (glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS) {
+        if (input.isKeyHeld(GLFW_KEY_DOWN)) {
             specular_exp -= 100.0f * elapsed;
             if (specular_exp < 1.0f) specular_exp = 1.0f;
             exp_changed = true;
@@ -178,36 +221,62 @@ void runExercise5(GLFWwindow* window) {
         }
 
         updateInput(window);  // Handles ESC and P key (screenshot)
-
-        // Update rotation
+    };
+    loop.update = [&](double dt) {
+        prev_rotation_angle = rotation_angle;
         if (rotate) {
-            rotation_angle += 30.0f * elapsed;
-            if (rotation_angle > 360.0f) rotation_angle -= 360.0f;
+            rotation_angle += 30.0f * dt;
+            if (rotation_angle > 360.0f) {
+                rotation_angle -= 360.0f;
+                prev_rotation_angle -= 360.0f;
+            }
+        }
+    };
+    loop.render = [&](double alpha) {
+        // Select the variant; the first request for one compiles it
+        int variants_before = phong.getVariantCount();
+        Shader* variant = phong.get(use_blinn ? VARIANT_BLINN : 0);
+        if (!variant) {
+            variant = phong.get(0);
+        }
+        if (phong.getVariantCount() != variants_before) {
+            std::cout << "Compiled variant in " << phong.getStats().last_compile_ms << " ms ("
+                      << phong.getVariantCount() << " variants, " << phong.getStats().total_compile_ms
+                      << " ms total)" << std::endl;
+        }
+
+        // Locations and constant uniforms are refreshed when the variant
+        // changes or a hot reload replaced its programme
+        if (variant != shader || variant->generation != shader_generation) {
+            shader = variant;
+            shader_generation = shader->generation;
+            shader->use();
+            model_loc = glGetUniformLocation(shader->programme, "model");
+            view_loc = glGetUniformLocation(shader->programme, "view");
+            proj_loc = glGetUniformLocation(shader->programme, "proj");
+            spec_exp_loc = glGetUniformLocation(shader->programme, "specular_exponent");
+            glUniformMatrix4fv(view_loc, 1, GL_FALSE, view_mat.m);
+            glUniformMatrix4fv(proj_loc, 1, GL_FALSE, proj_mat.m);
+            dequant.setUniforms(shader->programme);
         }
 
         // Model matrix
         mat4 T = translate(vec3(0.0f, 0.0f, -5.0f));
-        mat4 R = rotate_y(rotation_angle);
+        mat4 R = rotate_y(lerp(prev_rotation_angle, rotation_angle, (float)alpha));
         mat4 model_mat = T * R;
         
+        shader->use();
         glUniformMatrix4fv(model_loc, 1, GL_FALSE, model_mat.m);
         glUniform1f(spec_exp_loc, specular_exp);
-        glUniform1i(use_blinn_loc, use_blinn ? 1 : 0);
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glViewport(0, 0, g_fb_width, g_fb_height);
 
-        shader.use();
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 6);  // Draw 6 vertices (2 triangles)
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        mesh_cache.draw(triangle);
+    };
+    Engine::run(window, loop);
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &points_vbo);
-    glDeleteBuffers(1, &normals_vbo);
+    mesh_cache.release(triangle);
 
     gl_log("Exercise 5 completed\n");
 }
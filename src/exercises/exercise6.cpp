@@ -2,8 +2,12 @@
 #include <GLFW/glfw3.h>
 #include <iostream>
 #include "exercises/exercise6.h"
+#include "graphics/mesh_cache.h"
+#include "core/Engine.h"
+#include "core/Input.h"
 #include "graphics/shader.h"
 #include "graphics/texture.h"
+#include "graphics/vertex_format.h"
 #include "math/mat4.h"
 #include "utils/log.h"
 #include "utils/utils.h"
@@ -46,35 +50,32 @@ void runExercise6(GLFWwindow* window) {
     std::cout << "  Point 2: (" << points[6] << ", " << points[7] << ", " << points[8] 
               << ") -> TexCoord: (" << texcoords[4] << ", " << texcoords[5] << ")" << std::endl;
 
-    GLuint points_vbo, texcoords_vbo, vao;
-    
-    glGenBuffers(1, &points_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(points), points, GL_STATIC_DRAW);
+    // Interleaved snorm16 position + unorm16 UV: 12 bytes per vertex instead
+    // of 20 in two float buffers
+    VertexFormat format;
+    format.add(VERTEX_POSITION, VERTEX_SNORM16X4, 0)
+          .add(VERTEX_TEXCOORD, VERTEX_UNORM16X2, 1);
 
-    glGenBuffers(1, &texcoords_vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, texcoords_vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(texcoords), texcoords, GL_STATIC_DRAW);
+    VertexSource source;
+    source.data[VERTEX_POSITION] = points;
+    source.data[VERTEX_TEXCOORD] = texcoords;
+    source.vertex_count = 3;
 
-    glGenVertexArrays(1, &vao);
-    glBindVertexArray(vao);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, points_vbo);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(0);
-    
-    glBindBuffer(GL_ARRAY_BUFFER, texcoords_vbo);
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
-    glEnableVertexAttribArray(1);
+    // Packed and suballocated by the mesh cache, drawn from its shared VAO
+    GLuint indices[] = {0, 1, 2};
+    MeshCache& mesh_cache = MeshCache::instance();
+    MeshHandle triangle = mesh_cache.add(source, indices, 3, format, "exercise 6 triangle");
+    VertexDequant dequant = mesh_cache.get(triangle)->dequant;
 
-    std::cout << "\nVAO setup:" << std::endl;
-    std::cout << "  Attribute 0 (position): 3 floats per vertex" << std::endl;
-    std::cout << "  Attribute 1 (texcoord): 2 floats per vertex" << std::endl;
+    std::cout << "\nVAO setup (" << format.stride() << " bytes/vertex, interleaved):" << std::endl;
+    std::cout << "  Attribute 0 (position): 4 x snorm16" << std::endl;
+    std::cout << "  Attribute 1 (texcoord): 2 x unorm16" << std::endl;
 
     Texture texture;
     if (!texture.loadFromFile("assets/textures/test_texture.png")) {
         std::cerr << "\nERROR: Failed to load texture!" << std::endl;
         std::cerr << "Make sure 'assets/textures/test_texture.png' exists!" << std::endl;
+        mesh_cache.release(triangle);
         return;
     }
 
@@ -82,10 +83,12 @@ void runExercise6(GLFWwindow* window) {
     if (!shader.loadFromFiles("shaders/exercises/exercise6/vertex.glsl", 
                                "shaders/exercises/exercise6/fragment.glsl")) {
         std::cerr << "Failed to load shader" << std::endl;
+        mesh_cache.release(triangle);
         return;
     }
 
     shader.use();
+    dequant.setUniforms(shader.programme);
     
     int model_loc = glGetUniformLocation(shader.programme, "model");
     int view_loc = glGetUniformLocation(shader.programme, "view");
@@ -100,6 +103,7 @@ void runExercise6(GLFWwindow* window) {
 
     if (model_loc == -1 || view_loc == -1 || proj_loc == -1 || tex_loc == -1) {
         std::cerr << "ERROR: One or more uniforms not found in shader!" << std::endl;
+        mesh_cache.release(triangle);
         return;
     }
 
@@ -120,34 +124,35 @@ void runExercise6(GLFWwindow* window) {
     std::cout << "  P - Take screenshot (global)" << std::endl;
     std::cout << "  ESC - Exit" << std::endl;
 
+    // Simulation state: rendered between the previous and current step
     float rotation_angle = 0.0f;
+    float prev_rotation_angle = 0.0f;
     bool rotate = true;
 
-    while (!glfwWindowShouldClose(window)) {
-        static double prev_time = glfwGetTime();
-        double curr_time = glfwGetTime();
-        double elapsed = curr_time - prev_time;
-        prev_time = curr_time;
-
-        update_fps_counter(window);
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
+        Input& input = Input::instance();
         updateInput(window);  // Handles ESC and P key globally!
 
         // Toggle rotation
-        static bool space_was_pressed = false;
-        bool space_is_pressed = glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS;
-        if (space_is_pressed && !space_was_pressed) {
+        if (input.wasKeyPressed(GLFW_KEY_SPACE)) {
             rotate = !rotate;
             std::cout << "Rotation: " << (rotate ? "ON" : "OFF") << std::endl;
         }
-        space_was_pressed = space_is_pressed;
-
+    };
+    loop.update = [&](double dt) {
+        prev_rotation_angle = rotation_angle;
         if (rotate) {
-            rotation_angle += 30.0f * elapsed;
-            if (rotation_angle > 360.0f) rotation_angle -= 360.0f;
+            rotation_angle += 30.0f * dt;
+            if (rotation_angle > 360.0f) {
+                rotation_angle -= 360.0f;
+                prev_rotation_angle -= 360.0f;
+            }
         }
-
+    };
+    loop.render = [&](double alpha) {
         mat4 T = translate(vec3(0.0f, 0.0f, -5.0f));
-        mat4 R = rotate_y(rotation_angle);
+        mat4 R = rotate_y(lerp(prev_rotation_angle, rotation_angle, (float)alpha));
         mat4 model_mat = T * R;
         
         glUniformMatrix4fv(model_loc, 1, GL_FALSE, model_mat.m);
@@ -157,16 +162,11 @@ void runExercise6(GLFWwindow* window) {
 
         shader.use();
         texture.bind(0);
-        glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
-
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        mesh_cache.draw(triangle);
+    };
+    Engine::run(window, loop);
 
-    glDeleteVertexArrays(1, &vao);
-    glDeleteBuffers(1, &points_vbo);
-    glDeleteBuffers(1, &texcoords_vbo);
+    mesh_cache.release(triangle);
 
     gl_log("Exercise 6 completed\n");
 }
@@ -0,0 +1,395 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include "exercises/exercise7.h"
+#include "core/Engine.h"
+#include "core/Input.h"
+#include "graphics/deferred_renderer.h"
+#include "graphics/clustered_lighting.h"
+#include "graphics/mesh.h"
+#include "graphics/shader.h"
+#include "graphics/vertex_format.h"
+#include "math/mat4.h"
+#include "utils/log.h"
+#include "utils/utils.h"
+#include "utils/frame_stats.h"
+#include "exercises/ExerciseRegistry.h"
+
+static float random_float(float lo, float hi) {
+    return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+// Fully saturated colour from a hue in [0, 1)
+static vec3 hue_colour(float h) {
+    float r = fabsf(h * 6.0f - 3.0f) - 1.0f;
+    float g = 2.0f - fabsf(h * 6.0f - 2.0f);
+    float b = 2.0f - fabsf(h * 6.0f - 4.0f);
+    auto sat = [](float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); };
+    return vec3(sat(r), sat(g), sat(b));
+}
+
+void runExercise7(GLFWwindow* window) {
+    gl_log("Running Exercise 7 - Clustered Forward / Deferred Lighting\n");
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        gl_log_err("Failed to initialize GLAD\n");
+        return;
+    }
+
+    glViewport(0, 0, g_fb_width, g_fb_height);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glEnable(GL_CULL_FACE);
+
+    std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
+
+    // Scene: a floor and a grid of pillars, in the compact vertex format
+    VertexFormat format = VertexFormat::compact(true, false);
+    MeshData floor_data, pillar_data;
+    make_box_mesh(floor_data, 20.0f, 0.05f, 20.0f);
+    make_box_mesh(pillar_data, 0.5f, 1.5f, 0.5f);
+    Mesh floor_mesh, pillar_mesh;
+    floor_mesh.loadFromData(floor_data, "floor", &format);
+    pillar_mesh.loadFromData(pillar_data, "pillar", &format);
+
+    // Sparse: 81 pillars. Dense: 729 pillars at a third of the spacing, so
+    // most pixels are covered several times (front to back order is not kept)
+    std::vector<vec3> sparse_pillars, dense_pillars;
+    for (int x = -16; x <= 16; x += 4) {
+        for (int z = -16; z <= 16; z += 4) {
+            sparse_pillars.push_back(vec3((float)x, 1.5f, (float)z));
+        }
+    }
+    for (int x = 13; x >= -13; x--) {
+        for (int z = 13; z >= -13; z--) {
+            dense_pillars.push_back(vec3(x * 1.33f, 1.5f, z * 1.33f));
+        }
+    }
+
+    // Lights wander on circles above the floor
+    const int MAX_LIGHTS = 1024;
+    struct LightPath {
+        vec3 centre;
+        float orbit;
+        float speed;
+        float phase;
+    };
+    std::vector<PointLight> lights(MAX_LIGHTS);
+    std::vector<LightPath> paths(MAX_LIGHTS);
+    srand(7);
+    for (int i = 0; i < MAX_LIGHTS; i++) {
+        paths[i] = {vec3(random_float(-18.0f, 18.0f), random_float(0.4f, 3.0f), random_float(-18.0f, 18.0f)),
+                    random_float(0.5f, 2.5f), random_float(0.3f, 1.2f), random_float(0.0f, 6.283f)};
+        lights[i].radius = random_float(2.0f, 4.0f);
+        lights[i].color = hue_colour(random_float(0.0f, 1.0f));
+        lights[i].intensity = 3.0f;
+    }
+    int light_count = 2;
+
+    ClusteredLighting clusters(16, 9, 24);
+    if (!clusters.init(MAX_LIGHTS)) {
+        std::cerr << "Failed to initialise clustered lighting" << std::endl;
+        return;
+    }
+
+    DeferredRenderer deferred;
+    if (!deferred.init(g_fb_width, g_fb_height)) {
+        std::cerr << "Failed to initialise deferred renderer" << std::endl;
+        return;
+    }
+
+    // Forward shader shades while drawing; the G-buffer shader shares its
+    // vertex stage and only writes surface attributes
+    Shader shader, gbuffer_shader;
+    if (!shader.loadFromFiles("shaders/exercises/exercise7/vertex.glsl",
+                              "shaders/exercises/exercise7/fragment.glsl") ||
+        !gbuffer_shader.loadFromFiles("shaders/exercises/exercise7/vertex.glsl",
+                                      "shaders/exercises/exercise7/gbuffer_fragment.glsl")) {
+        std::cerr << "Failed to load shader" << std::endl;
+        return;
+    }
+
+    struct SceneUniforms {
+        GLuint programme;
+        int model, view, proj, colour, specular;
+    };
+    auto scene_uniforms = [](GLuint programme) {
+        SceneUniforms u;
+        u.programme = programme;
+        u.model = glGetUniformLocation(programme, "model");
+        u.view = glGetUniformLocation(programme, "view");
+        u.proj = glGetUniformLocation(programme, "proj");
+        u.colour = glGetUniformLocation(programme, "surface_colour");
+        u.specular = glGetUniformLocation(programme, "specular_exponent");
+        return u;
+    };
+    SceneUniforms forward_uniforms = scene_uniforms(shader.programme);
+    SceneUniforms gbuffer_uniforms = scene_uniforms(gbuffer_shader.programme);
+    int use_clusters_loc = glGetUniformLocation(shader.programme, "use_clusters");
+    int heatmap_loc = glGetUniformLocation(shader.programme, "show_heatmap");
+    unsigned int forward_generation = shader.generation, gbuffer_generation = gbuffer_shader.generation;
+
+    float fovy = 67.0f, near = 0.1f, far = 100.0f;
+    float aspect = (float)g_fb_width / (float)g_fb_height;
+    mat4 proj_mat = perspective(fovy, aspect, near, far);
+    clusters.setProjection(fovy, aspect, near, far);
+    shader.use();
+    glUniformMatrix4fv(forward_uniforms.proj, 1, GL_FALSE, proj_mat.m);
+    glUniform1f(forward_uniforms.specular, 64.0f);
+    gbuffer_shader.use();
+    glUniformMatrix4fv(gbuffer_uniforms.proj, 1, GL_FALSE, proj_mat.m);
+    glUniform1f(gbuffer_uniforms.specular, 64.0f);
+
+    // GPU frame time from timer queries, read a few frames late
+    const int QUERY_FRAMES = 4;
+    GLuint timer_queries[QUERY_FRAMES];
+    glGenQueries(QUERY_FRAMES, timer_queries);
+    int query_frame = 0;
+    double gpu_ms = 0.0;
+
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    deferred.setClearColour(0.0f, 0.0f, 0.0f);
+
+    enum ShadingMode { SHADING_CLUSTERED, SHADING_BRUTE_FORCE, SHADING_DEFERRED, SHADING_MODE_COUNT };
+    static const char* mode_names[SHADING_MODE_COUNT] = {"clustered forward", "brute force", "deferred"};
+    ShadingMode shading = g_render_path == RENDER_PATH_DEFERRED ? SHADING_DEFERRED : SHADING_CLUSTERED;
+
+    std::cout << "\n=== Exercise 7 - Clustered Lighting ===" << std::endl;
+    std::cout << "Shading: " << mode_names[shading] << " (--forward / --deferred)" << std::endl;
+    std::cout << "\nControls:" << std::endl;
+    std::cout << "  UP/DOWN - Double / halve the light count (2 - " << MAX_LIGHTS << ")" << std::endl;
+    std::cout << "  C - Toggle clustered / brute force forward shading" << std::endl;
+    std::cout << "  D - Toggle deferred / forward shading" << std::endl;
+    std::cout << "  G - Toggle sparse / dense geometry" << std::endl;
+    std::cout << "  H - Toggle lights-per-froxel heatmap" << std::endl;
+    std::cout << "  B - Run the benchmark sweep" << std::endl;
+    std::cout << "  SPACE - Toggle camera orbit" << std::endl;
+    std::cout << "  ESC - Exit" << std::endl;
+
+    bool dense = false;
+    bool heatmap = false;
+    bool orbit = true;
+
+    // Simulation state (fixed step). Lights follow closed paths, so only
+    // their clock is simulated and positions are evaluated at render time
+    float camera_angle = 0.0f, prev_camera_angle = 0.0f;
+    double light_time = 0.0, prev_light_time = 0.0;
+
+    // Benchmark: every scene x shading mode x light count for BENCH_FRAMES frames
+    const int bench_counts[] = {8, 64, 256, 1024};
+    const int BENCH_COUNTS = sizeof(bench_counts) / sizeof(bench_counts[0]);
+    const int BENCH_STEPS = 2 * SHADING_MODE_COUNT * BENCH_COUNTS;
+    const int BENCH_FRAMES = 60;
+    const int BENCH_WARMUP = 10;
+    int bench_step = -1;
+    int bench_frame = 0;
+    double bench_gpu = 0.0, bench_assign = 0.0;
+    double bench_results[2][SHADING_MODE_COUNT][BENCH_COUNTS] = {};
+    double bench_assign_results[2][BENCH_COUNTS] = {};
+
+    auto draw_scene = [&](const SceneUniforms& u, const std::vector<vec3>& pillars) {
+        mat4 identity = identity_mat4();
+        glUniformMatrix4fv(u.model, 1, GL_FALSE, identity.m);
+        glUniform3f(u.colour, 0.6f, 0.6f, 0.6f);
+        floor_mesh.dequant.setUniforms(u.programme);
+        floor_mesh.draw();
+        g_frame_stats.draw_calls++;
+        g_frame_stats.triangles += floor_mesh.index_count / 3;
+
+        glUniform3f(u.colour, 0.8f, 0.75f, 0.7f);
+        pillar_mesh.dequant.setUniforms(u.programme);
+        for (const vec3& p : pillars) {
+            mat4 model_mat = translate(p);
+            glUniformMatrix4fv(u.model, 1, GL_FALSE, model_mat.m);
+            pillar_mesh.draw();
+            g_frame_stats.draw_calls++;
+            g_frame_stats.triangles += pillar_mesh.index_count / 3;
+        }
+    };
+
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
+        Input& input = Input::instance();
+        updateInput(window);
+
+        if (bench_step < 0 && input.wasKeyPressed(GLFW_KEY_UP)) {
+            light_count = std::min(light_count * 2, MAX_LIGHTS);
+            std::cout << "Lights: " << light_count << std::endl;
+        }
+        if (bench_step < 0 && input.wasKeyPressed(GLFW_KEY_DOWN)) {
+            light_count = std::max(light_count / 2, 2);
+            std::cout << "Lights: " << light_count << std::endl;
+        }
+
+        if (bench_step < 0 && input.wasKeyPressed(GLFW_KEY_C)) {
+            shading = shading == SHADING_CLUSTERED ? SHADING_BRUTE_FORCE : SHADING_CLUSTERED;
+            std::cout << "Shading: " << mode_names[shading] << std::endl;
+        }
+
+        if (bench_step < 0 && input.wasKeyPressed(GLFW_KEY_D)) {
+            shading = shading == SHADING_DEFERRED ? SHADING_CLUSTERED : SHADING_DEFERRED;
+            std::cout << "Shading: " << mode_names[shading] << std::endl;
+        }
+
+        if (bench_step < 0 && input.wasKeyPressed(GLFW_KEY_G)) {
+            dense = !dense;
+            std::cout << "Geometry: " << (dense ? "DENSE" : "SPARSE") << std::endl;
+        }
+
+        if (input.wasKeyPressed(GLFW_KEY_H)) heatmap = !heatmap;
+
+        if (input.wasKeyPressed(GLFW_KEY_SPACE)) orbit = !orbit;
+
+        if (input.wasKeyPressed(GLFW_KEY_B) && bench_step < 0) {
+            std::cout << "\nRunning benchmark sweep..." << std::endl;
+            bench_step = 0;
+            bench_frame = 0;
+            bench_gpu = 0.0;
+            bench_assign = 0.0;
+            heatmap = false;
+        }
+
+        if (bench_step >= 0) {
+            dense = bench_step / (SHADING_MODE_COUNT * BENCH_COUNTS) == 1;
+            shading = (ShadingMode)(bench_step / BENCH_COUNTS % SHADING_MODE_COUNT);
+            light_count = bench_counts[bench_step % BENCH_COUNTS];
+        }
+    };
+    loop.update = [&](double dt) {
+        prev_camera_angle = camera_angle;
+        prev_light_time = light_time;
+        if (orbit) camera_angle += 10.0f * (float)dt;
+        light_time += dt;
+    };
+    loop.render = [&](double alpha) {
+        double curr_time = glfwGetTime();
+
+        // Interpolate between the last two simulation steps
+        float a = lerp(prev_camera_angle, camera_angle, (float)alpha) * ONE_DEG_IN_RAD;
+        double time = prev_light_time + (light_time - prev_light_time) * alpha;
+        vec3 cam_pos(sinf(a) * 24.0f, 12.0f, cosf(a) * 24.0f);
+        mat4 view_mat = look_at(cam_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+        for (int i = 0; i < light_count; i++) {
+            const LightPath& path = paths[i];
+            float t = (float)time * path.speed + path.phase;
+            lights[i].position = vec3(path.centre.v[0] + cosf(t) * path.orbit, path.centre.v[1],
+                                      path.centre.v[2] + sinf(t) * path.orbit);
+        }
+
+        // Hot reload keeps uniform values but may move their locations
+        if (shader.generation != forward_generation) {
+            forward_uniforms = scene_uniforms(shader.programme);
+            use_clusters_loc = glGetUniformLocation(shader.programme, "use_clusters");
+            heatmap_loc = glGetUniformLocation(shader.programme, "show_heatmap");
+            forward_generation = shader.generation;
+        }
+        if (gbuffer_shader.generation != gbuffer_generation) {
+            gbuffer_uniforms = scene_uniforms(gbuffer_shader.programme);
+            gbuffer_generation = gbuffer_shader.generation;
+        }
+
+        reset_frame_stats();
+        clusters.update(view_mat, lights.data(), light_count);
+        const std::vector<vec3>& pillars = dense ? dense_pillars : sparse_pillars;
+
+        glBeginQuery(GL_TIME_ELAPSED, timer_queries[query_frame % QUERY_FRAMES]);
+
+        if (shading == SHADING_DEFERRED) {
+            deferred.resize(g_fb_width, g_fb_height);
+            deferred.beginGeometryPass();
+            gbuffer_shader.use();
+            glUniformMatrix4fv(gbuffer_uniforms.view, 1, GL_FALSE, view_mat.m);
+            draw_scene(gbuffer_uniforms, pillars);
+            deferred.endGeometryPass();
+
+            deferred.setShowHeatmap(heatmap);
+            deferred.lightingPass(proj_mat, clusters);
+        } else {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glViewport(0, 0, g_fb_width, g_fb_height);
+
+            shader.use();
+            clusters.bind(shader.programme);
+            glUniformMatrix4fv(forward_uniforms.view, 1, GL_FALSE, view_mat.m);
+            glUniform1i(use_clusters_loc, shading == SHADING_CLUSTERED ? 1 : 0);
+            glUniform1i(heatmap_loc, heatmap ? 1 : 0);
+            draw_scene(forward_uniforms, pillars);
+        }
+
+        glEndQuery(GL_TIME_ELAPSED);
+        query_frame++;
+
+        // Oldest query in the ring: finished unless the GPU is >3 frames behind
+        if (query_frame >= QUERY_FRAMES) {
+            GLuint oldest = timer_queries[query_frame % QUERY_FRAMES];
+            GLint available = 0;
+            glGetQueryObjectiv(oldest, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(oldest, GL_QUERY_RESULT, &ns);
+                gpu_ms = ns / 1.0e6;
+            }
+        }
+
+        const ClusteredLighting::Stats& cs = clusters.getStats();
+        if (bench_step >= 0) {
+            if (bench_frame >= BENCH_WARMUP) {
+                bench_gpu += gpu_ms;
+                bench_assign += cs.assign_ms;
+            }
+            if (++bench_frame == BENCH_FRAMES) {
+                int samples = BENCH_FRAMES - BENCH_WARMUP;
+                int scene = bench_step / (SHADING_MODE_COUNT * BENCH_COUNTS);
+                int count = bench_step % BENCH_COUNTS;
+                bench_results[scene][shading][count] = bench_gpu / samples;
+                if (shading == SHADING_CLUSTERED) bench_assign_results[scene][count] = bench_assign / samples;
+                bench_step++;
+                bench_frame = 0;
+                bench_gpu = 0.0;
+                bench_assign = 0.0;
+                if (bench_step == BENCH_STEPS) {
+                    for (int sc = 0; sc < 2; sc++) {
+                        printf("\n%s scene (%zu pillars), GPU ms\n", sc ? "Dense" : "Sparse",
+                               sc ? dense_pillars.size() : sparse_pillars.size());
+                        printf("  lights | clustered forward |  brute force |  deferred | assign CPU ms\n");
+                        for (int i = 0; i < BENCH_COUNTS; i++) {
+                            printf("  %6d | %17.3f | %12.3f | %9.3f | %13.3f\n", bench_counts[i],
+                                   bench_results[sc][SHADING_CLUSTERED][i], bench_results[sc][SHADING_BRUTE_FORCE][i],
+                                   bench_results[sc][SHADING_DEFERRED][i], bench_assign_results[sc][i]);
+                        }
+                        gl_log("Lighting benchmark (%s, %d lights): forward %.3f ms, deferred %.3f ms\n",
+                               sc ? "dense" : "sparse", bench_counts[BENCH_COUNTS - 1],
+                               bench_results[sc][SHADING_CLUSTERED][BENCH_COUNTS - 1],
+                               bench_results[sc][SHADING_DEFERRED][BENCH_COUNTS - 1]);
+                    }
+                    bench_step = -1;
+                    shading = g_render_path == RENDER_PATH_DEFERRED ? SHADING_DEFERRED : SHADING_CLUSTERED;
+                    dense = false;
+                }
+            }
+        }
+
+        static double last_print = 0.0;
+        if (bench_step < 0 && curr_time - last_print > 1.0) {
+            printf("Lights %4d (%s, %s): GPU %.3f ms, %d draws, assign %.3f ms, upload %.3f ms, "
+                   "max %d per froxel%s\n",
+                   cs.lights, mode_names[shading], dense ? "dense" : "sparse", gpu_ms, g_frame_stats.draw_calls,
+                   cs.assign_ms, cs.upload_ms, cs.max_lights_per_cluster, cs.overflowed_clusters ? " (overflow)" : "");
+            last_print = curr_time;
+        }
+    };
+    Engine::run(window, loop);
+
+    glDeleteQueries(QUERY_FRAMES, timer_queries);
+
+    gl_log("Exercise 7 completed\n");
+}
+
+REGISTER_EXERCISE("7. Clustered Lighting", runExercise7)
@@ -0,0 +1,478 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include "exercises/exercise8.h"
+#include "graphics/gpu_handles.h"
+#include "core/Engine.h"
+#include "core/Input.h"
+#include "core/JobSystem.h"
+#include "core/RenderThread.h"
+#include "graphics/command_buffer.h"
+#include "graphics/command_replay.h"
+#include "graphics/gpu_timer.h"
+#include "graphics/mesh_cache.h"
+#include "graphics/mesh_format.h"
+#include "graphics/multi_draw.h"
+#include "graphics/render_state.h"
+#include "graphics/shader_variants.h"
+#include "math/mat4.h"
+#include "utils/log.h"
+#include "utils/utils.h"
+#include "utils/frame_stats.h"
+#include "exercises/ExerciseRegistry.h"
+
+// std140 layouts of the Camera and Object blocks in exercise8/vertex.glsl
+struct CameraBlock {
+    float view[16];
+    float proj[16];
+};
+
+struct ObjectBlock {
+    float model[16];
+    float colour[4];
+};
+
+struct SceneObject {
+    vec3 position;
+    vec3 colour;
+    uint32_t mesh;
+    uint32_t variant;      // programme: plain or striped
+    float spin_speed;      // degrees per second
+    float phase;
+};
+
+void runExercise8(GLFWwindow* window) {
+    gl_log("Running Exercise 8 - Command Buffers\n");
+
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+        gl_log_err("Failed to initialize GLAD\n");
+        return;
+    }
+
+    glViewport(0, 0, g_fb_width, g_fb_height);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glEnable(GL_CULL_FACE);
+
+    std::cout << "OpenGL version: " << glGetString(GL_VERSION) << std::endl;
+
+    // Sixteen box shapes
+    const int MESH_COUNT = 16;
+    // All of them share one page of the mesh cache, so one VAO for the scene
+    MeshCache& mesh_cache = MeshCache::instance();
+    MeshHandle mesh_handles[MESH_COUNT];
+    for (int i = 0; i < MESH_COUNT; i++) {
+        MeshData data;
+        make_box_mesh(data, 0.2f + 0.1f * (i % 4), 0.2f + 0.15f * (i / 4), 0.25f + 0.05f * ((i * 3) % 5));
+        mesh_handles[i] = mesh_cache.add(data, VertexFormat::standard(true, false), "command buffer box");
+    }
+    const CachedMesh* meshes[MESH_COUNT];
+    for (int i = 0; i < MESH_COUNT; i++) {
+        meshes[i] = mesh_cache.get(mesh_handles[i]);
+    }
+
+    // Plain and striped programmes. Neighbouring objects alternate between
+    // them, so drawing in scene order switches programme on every draw
+    ShaderVariants variants;
+    variants.init("shaders/exercises/exercise8/vertex.glsl",
+                  "shaders/exercises/exercise8/fragment.glsl", {"STRIPED"});
+    variants.precompile({0, 1});
+    // The same pair for multi-draw, reading the object from a texture buffer
+    ShaderVariants multi_variants;
+    multi_variants.init("shaders/exercises/exercise8/multidraw_vertex.glsl",
+                        "shaders/exercises/exercise8/fragment.glsl", {"STRIPED"});
+    multi_variants.precompile({0, 1});
+    Shader* shaders[4] = {variants.get(0), variants.get(1), multi_variants.get(0), multi_variants.get(1)};
+    if (!shaders[0] || !shaders[1] || !shaders[2] || !shaders[3]) {
+        std::cerr << "Failed to load shader" << std::endl;
+        return;
+    }
+
+    // GLSL 4.10 has no layout(binding) for blocks; redone after hot reloads
+    const GLuint CAMERA_BINDING = 0, OBJECT_BINDING = 1;
+    auto bind_blocks = [&](GLuint programme) {
+        GLuint camera_index = glGetUniformBlockIndex(programme, "Camera");
+        GLuint object_index = glGetUniformBlockIndex(programme, "Object");
+        if (camera_index != GL_INVALID_INDEX) glUniformBlockBinding(programme, camera_index, CAMERA_BINDING);
+        if (object_index != GL_INVALID_INDEX) glUniformBlockBinding(programme, object_index, OBJECT_BINDING);
+    };
+    unsigned int shader_generations[4];
+    // Written by the GL thread after a reload, read by build on the main thread
+    std::atomic<GLuint> programmes[4];
+    for (int v = 0; v < 4; v++) {
+        bind_blocks(shaders[v]->programme);
+        shader_generations[v] = shaders[v]->generation;
+        programmes[v] = shaders[v]->programme;
+    }
+
+    // 80 x 80 grid of spinning boxes
+    const int GRID = 80;
+    const float SPACING = 1.6f;
+    std::vector<SceneObject> objects;
+    objects.reserve(GRID * GRID);
+    for (int x = 0; x < GRID; x++) {
+        for (int z = 0; z < GRID; z++) {
+            uint32_t i = (uint32_t)objects.size();
+            SceneObject obj;
+            obj.position = vec3((x - GRID / 2) * SPACING, 0.0f, (z - GRID / 2) * SPACING);
+            obj.colour = vec3(0.3f + 0.7f * x / GRID, 0.5f, 0.3f + 0.7f * z / GRID);
+            obj.mesh = i % MESH_COUNT;
+            obj.variant = i % 2;
+            obj.spin_speed = 20.0f + (float)(i % 7) * 15.0f;
+            obj.phase = (float)(i * 37 % 360);
+            objects.push_back(obj);
+        }
+    }
+    const float OBJECT_RADIUS = 0.8f;
+    std::cout << "Created " << objects.size() << " objects" << std::endl;
+
+    CommandReplay replay;
+    if (!replay.init()) {
+        std::cerr << "Failed to initialise command replay" << std::endl;
+        return;
+    }
+    uint32_t uniform_alignment = replay.getUniformAlignment();
+    RenderStateCache state;
+
+    // Recording buffers per packet slot: 0 holds the camera, the rest one
+    // per recording batch. A slot is only reused once its packet is drawn
+    const uint32_t RECORD_BATCH = 256;
+    const int RECORDER_COUNT = 1 + (int)((objects.size() + RECORD_BATCH - 1) / RECORD_BATCH);
+    std::vector<CommandBuffer> recorders[RenderThread::PACKET_COUNT];
+    int recorder_used[RenderThread::PACKET_COUNT] = {};
+    GLuint recorded_programmes[RenderThread::PACKET_COUNT][2] = {};
+    for (int s = 0; s < RenderThread::PACKET_COUNT; s++) {
+        recorders[s].resize(RECORDER_COUNT);
+    }
+    std::vector<const CommandBuffer*> replay_list;
+
+    // Multi-draw: one batch per programme and packet slot, filled by build
+    const uint32_t TEXELS_PER_DRAW = 5;     // model matrix, colour
+    MultiDrawBatch multi_batches[RenderThread::PACKET_COUNT][2];
+    for (int s = 0; s < RenderThread::PACKET_COUNT; s++) {
+        for (int v = 0; v < 2; v++) {
+            if (!multi_batches[s][v].init(TEXELS_PER_DRAW, "exercise 8 multi-draw")) {
+                std::cerr << "Failed to initialise multi-draw batches" << std::endl;
+                return;
+            }
+        }
+    }
+    bool indirect = MultiDrawBatch::isMultiDrawIndirectSupported();
+
+    // Direct path: one uniform stream in scene order, bound per draw
+    GpuBuffer direct_ubo(RESOURCE_UNIFORM_BUFFER, "exercise 8 direct uniforms");
+    std::vector<uint8_t> direct_uniforms;
+
+    float fovy = 67.0f, near = 0.1f, far = 150.0f;
+    mat4 proj_mat = perspective(fovy, (float)g_fb_width / (float)g_fb_height, near, far);
+
+    glClearColor(0.15f, 0.15f, 0.18f, 1.0f);
+
+    // Direct: the GL thread walks the draw list and issues every bind itself.
+    // Recorded: build records one command buffer; replay sorts and filters it.
+    // Parallel: JobSystem workers record one command buffer per batch.
+    // Multi-draw: per-object data in a texture buffer, a few calls in total
+    enum SubmitMode { SUBMIT_DIRECT, SUBMIT_RECORDED, SUBMIT_PARALLEL, SUBMIT_MULTI_DRAW, SUBMIT_MODE_COUNT };
+    static const char* mode_names[SUBMIT_MODE_COUNT] = {"direct", "recorded", "parallel recorded", "multi-draw"};
+    const uint32_t FLAG_INDIRECT = 0x100;  // packet.flags: mode in the low byte
+    SubmitMode mode = SUBMIT_PARALLEL;
+
+    std::cout << "\n=== Exercise 8 - Command Buffers ===" << std::endl;
+    std::cout << "Submission: " << mode_names[mode] << std::endl;
+    std::cout << "\nControls:" << std::endl;
+    std::cout << "  M - Cycle direct / recorded / parallel recorded / multi-draw submission" << std::endl;
+    std::cout << "  I - Toggle multi-draw indirect / instanced fallback" << std::endl;
+    std::cout << "  SPACE - Toggle camera orbit" << std::endl;
+    std::cout << "  ESC - Exit" << std::endl;
+
+    bool orbit = true;
+
+    // Simulation state (fixed step): objects spin at fixed rates, so only
+    // the clock and the camera angle are simulated
+    float camera_angle = 0.0f, prev_camera_angle = 0.0f;
+    double sim_time = 0.0, prev_sim_time = 0.0;
+
+    auto object_block = [&](const SceneObject& obj, float time, ObjectBlock& block) {
+        mat4 model = translate(obj.position) * rotate_y(obj.spin_speed * time + obj.phase);
+        memcpy(block.model, model.m, sizeof(block.model));
+        block.colour[0] = obj.colour.v[0];
+        block.colour[1] = obj.colour.v[1];
+        block.colour[2] = obj.colour.v[2];
+        block.colour[3] = 1.0f;
+    };
+
+    // Any thread: record objects [begin, end) that survive culling
+    auto record_objects = [&](CommandBuffer& cmd, uint32_t begin, uint32_t end, const Frustum& frustum,
+                              const vec3& cam_pos, float time, const GLuint* programme_ids) {
+        for (uint32_t i = begin; i < end; i++) {
+            const SceneObject& obj = objects[i];
+            if (!sphere_in_frustum(frustum, obj.position, OBJECT_RADIUS)) {
+                continue;
+            }
+            vec3 d = subtract(obj.position, cam_pos);
+            const CachedMesh& mesh = *meshes[obj.mesh];
+
+            ObjectBlock block;
+            object_block(obj, time, block);
+            cmd.begin(sort_key(obj.variant, obj.mesh, sqrtf(dot(d, d)) / far));
+            cmd.bindProgram(programme_ids[obj.variant]);
+            cmd.bindVertexArray(mesh.vao);
+            cmd.uniformBlock(OBJECT_BINDING, &block, sizeof(block));
+            cmd.draw(mesh.index_count, INDEX_TYPE_U32, mesh.first_index, mesh.base_vertex);
+        }
+    };
+
+    LoopCallbacks loop;
+    loop.frame = [&](double) {
+        Input& input = Input::instance();
+        updateInput(window);
+
+        if (input.wasKeyPressed(GLFW_KEY_M)) {
+            mode = (SubmitMode)((mode + 1) % SUBMIT_MODE_COUNT);
+            std::cout << "Submission: " << mode_names[mode] << std::endl;
+        }
+
+        if (input.wasKeyPressed(GLFW_KEY_I)) {
+            if (MultiDrawBatch::isMultiDrawIndirectSupported()) {
+                indirect = !indirect;
+                std::cout << "Multi-draw: " << (indirect ? "indirect" : "instanced fallback") << std::endl;
+            } else {
+                std::cout << "Multi-draw indirect not supported" << std::endl;
+            }
+        }
+
+        if (input.wasKeyPressed(GLFW_KEY_SPACE)) orbit = !orbit;
+    };
+    loop.update = [&](double dt) {
+        prev_camera_angle = camera_angle;
+        prev_sim_time = sim_time;
+        if (orbit) camera_angle += 6.0f * (float)dt;
+        sim_time += dt;
+    };
+    loop.build = [&](RenderPacket& packet, double alpha) {
+        double curr_time = glfwGetTime();
+
+        float a = lerp(prev_camera_angle, camera_angle, (float)alpha) * ONE_DEG_IN_RAD;
+        float time = (float)(prev_sim_time + (sim_time - prev_sim_time) * alpha);
+        vec3 cam_pos(sinf(a) * 30.0f, 14.0f, cosf(a) * 30.0f);
+        packet.view = look_at(cam_pos, vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 1.0f, 0.0f));
+        packet.proj = proj_mat;
+        packet.camera_position = cam_pos;
+        packet.flags = (uint32_t)mode | (indirect ? FLAG_INDIRECT : 0);
+        Frustum frustum = extract_frustum(proj_mat * packet.view);
+
+        auto record_start = std::chrono::high_resolution_clock::now();
+        int slot = (int)(packet.frame % RenderThread::PACKET_COUNT);
+        int visible = 0;
+        if (mode == SUBMIT_DIRECT) {
+            for (uint32_t i = 0; i < (uint32_t)objects.size(); i++) {
+                const SceneObject& obj = objects[i];
+                if (!sphere_in_frustum(frustum, obj.position, OBJECT_RADIUS)) {
+                    continue;
+                }
+                DrawItem item;
+                item.object = i;
+                item.mesh = obj.mesh;
+                item.lod = -1;
+                item.model = translate(obj.position) * rotate_y(obj.spin_speed * time + obj.phase);
+                item.colour = obj.colour;
+                packet.draws.push_back(item);
+            }
+            visible = (int)packet.draws.size();
+        } else if (mode == SUBMIT_MULTI_DRAW) {
+            // Only CPU memory; the GL thread uploads and draws the batches
+            for (int v = 0; v < 2; v++) {
+                multi_batches[slot][v].reset();
+            }
+            for (uint32_t i = 0; i < (uint32_t)objects.size(); i++) {
+                const SceneObject& obj = objects[i];
+                if (!sphere_in_frustum(frustum, obj.position, OBJECT_RADIUS)) {
+                    continue;
+                }
+                float* data = multi_batches[slot][obj.variant].add(*meshes[obj.mesh]);
+                if (!data) {
+                    continue;
+                }
+                ObjectBlock block;
+                object_block(obj, time, block);
+                memcpy(data, &block, sizeof(block));
+                visible++;
+            }
+        } else {
+            // Programme names as of this build; submit skips the packet if a
+            // hot reload replaced one in between
+            GLuint programme_ids[2] = {programmes[0], programmes[1]};
+            recorded_programmes[slot][0] = programme_ids[0];
+            recorded_programmes[slot][1] = programme_ids[1];
+
+            std::vector<CommandBuffer>& cmds = recorders[slot];
+            CameraBlock camera;
+            memcpy(camera.view, packet.view.m, sizeof(camera.view));
+            memcpy(camera.proj, packet.proj.m, sizeof(camera.proj));
+            cmds[0].reset(uniform_alignment);
+            cmds[0].uniformBlock(CAMERA_BINDING, &camera, sizeof(camera));
+
+            if (mode == SUBMIT_RECORDED) {
+                cmds[1].reset(uniform_alignment);
+                record_objects(cmds[1], 0, (uint32_t)objects.size(), frustum, cam_pos, time, programme_ids);
+                recorder_used[slot] = 2;
+            } else {
+                JobSystem::instance().parallelFor((uint32_t)objects.size(), RECORD_BATCH,
+                                                  [&](uint32_t begin, uint32_t end) {
+                    CommandBuffer& cmd = cmds[1 + begin / RECORD_BATCH];
+                    cmd.reset(uniform_alignment);
+                    record_objects(cmd, begin, end, frustum, cam_pos, time, programme_ids);
+                });
+                recorder_used[slot] = RECORDER_COUNT;
+            }
+            for (int i = 1; i < recorder_used[slot]; i++) {
+                visible += (int)cmds[i].getDrawCount();
+            }
+        }
+        double record_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - record_start).count();
+
+        static double last_print = 0.0;
+        if (curr_time - last_print > 1.0) {
+            printf("%s: %d / %zu objects, %s %.3f ms on the main thread\n", mode_names[mode], visible,
+                   objects.size(), mode == SUBMIT_RECORDED || mode == SUBMIT_PARALLEL ? "record" : "draw list",
+                   record_ms);
+            last_print = curr_time;
+        }
+    };
+    loop.submit = [&](const RenderPacket& packet) {
+        for (int v = 0; v < 4; v++) {
+            if (shaders[v]->generation != shader_generations[v]) {
+                bind_blocks(shaders[v]->programme);
+                shader_generations[v] = shaders[v]->generation;
+                programmes[v] = shaders[v]->programme;
+            }
+        }
+
+        reset_frame_stats();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glViewport(0, 0, g_fb_width, g_fb_height);
+
+        auto submit_start = std::chrono::high_resolution_clock::now();
+        GpuTimers::instance().beginPass("scene");
+        SubmitMode packet_mode = (SubmitMode)(packet.flags & 0xFF);
+        if (packet_mode == SUBMIT_DIRECT) {
+            // Camera block then one object block per draw, uploaded in one go
+            size_t align = uniform_alignment;
+            size_t stride = (sizeof(ObjectBlock) + align - 1) / align * align;
+            size_t objects_base = (sizeof(CameraBlock) + align - 1) / align * align;
+            direct_uniforms.resize(objects_base + stride * packet.draws.size());
+            CameraBlock* camera = (CameraBlock*)direct_uniforms.data();
+            memcpy(camera->view, packet.view.m, sizeof(camera->view));
+            memcpy(camera->proj, packet.proj.m, sizeof(camera->proj));
+            for (size_t i = 0; i < packet.draws.size(); i++) {
+                const DrawItem& item = packet.draws[i];
+                ObjectBlock* block = (ObjectBlock*)(direct_uniforms.data() + objects_base + stride * i);
+                memcpy(block->model, item.model.m, sizeof(block->model));
+                block->colour[0] = item.colour.v[0];
+                block->colour[1] = item.colour.v[1];
+                block->colour[2] = item.colour.v[2];
+                block->colour[3] = 1.0f;
+            }
+            gpu_buffer_data(direct_ubo.get(), GL_UNIFORM_BUFFER, direct_uniforms.size(), nullptr, GL_STREAM_DRAW);
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, direct_uniforms.size(), direct_uniforms.data());
+            glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, direct_ubo.get(), 0, sizeof(CameraBlock));
+
+            // Scene order, every bind issued
+            for (size_t i = 0; i < packet.draws.size(); i++) {
+                const DrawItem& item = packet.draws[i];
+                const CachedMesh& mesh = *meshes[item.mesh];
+                glUseProgram(shaders[objects[item.object].variant]->programme);
+                glBindVertexArray(mesh.vao);
+                glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_BINDING, direct_ubo.get(), objects_base + stride * i,
+                                  sizeof(ObjectBlock));
+                glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)mesh.index_count, GL_UNSIGNED_INT,
+                                         (const void*)(mesh.first_index * sizeof(uint32_t)), mesh.base_vertex);
+                g_frame_stats.draw_calls++;
+                g_frame_stats.triangles += mesh.index_count / 3;
+                g_frame_stats.state_changes += 3;
+            }
+        } else if (packet_mode == SUBMIT_MULTI_DRAW) {
+            CameraBlock camera;
+            memcpy(camera.view, packet.view.m, sizeof(camera.view));
+            memcpy(camera.proj, packet.proj.m, sizeof(camera.proj));
+            gpu_buffer_data(direct_ubo.get(), GL_UNIFORM_BUFFER, sizeof(camera), &camera, GL_STREAM_DRAW);
+            glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, direct_ubo.get(), 0, sizeof(CameraBlock));
+
+            int slot = (int)(packet.frame % RenderThread::PACKET_COUNT);
+            for (int v = 0; v < 2; v++) {
+                MultiDrawBatch& batch = multi_batches[slot][v];
+                batch.setIndirect((packet.flags & FLAG_INDIRECT) != 0);
+                glUseProgram(shaders[2 + v]->programme);
+                batch.submit(*shaders[2 + v]);
+                g_frame_stats.draw_calls += batch.getStats().calls;
+                g_frame_stats.state_changes += 1 + batch.getStats().pages;   // programme, then a VAO per page
+            }
+        } else {
+            int slot = (int)(packet.frame % RenderThread::PACKET_COUNT);
+            if (recorded_programmes[slot][0] != programmes[0] || recorded_programmes[slot][1] != programmes[1]) {
+                return;     // recorded against a programme a reload has replaced
+            }
+            replay_list.clear();
+            for (int i = 0; i < recorder_used[slot]; i++) {
+                replay_list.push_back(&recorders[slot][i]);
+            }
+            state.invalidate();
+            state.resetStats();
+            replay.submit(replay_list.data(), (int)replay_list.size(), state);
+            g_frame_stats.draw_calls = replay.getStats().draws;
+        }
+        glBindVertexArray(0);
+        GpuTimers::instance().endPass();
+        double submit_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - submit_start).count();
+
+        static double last_print = 0.0;
+        double curr_time = glfwGetTime();
+        if (curr_time - last_print > 1.0) {
+            int draws = g_frame_stats.draw_calls;
+            printf("  GL thread: %d draws in %.3f ms (%.0f ns per draw)\n", draws, submit_ms,
+                   draws ? submit_ms * 1.0e6 / draws : 0.0);
+            if (packet_mode == SUBMIT_MULTI_DRAW) {
+                int slot = (int)(packet.frame % RenderThread::PACKET_COUNT);
+                for (int v = 0; v < 2; v++) {
+                    const MultiDrawBatch::Stats& ms = multi_batches[slot][v].getStats();
+                    printf("  multi-draw %d: %d draws, %d commands on %d pages, %d calls (%s), %zu KB data - "
+                           "sort %.3f ms, upload %.3f ms\n",
+                           v, ms.draws, ms.commands, ms.pages, ms.calls, ms.indirect ? "indirect" : "instanced",
+                           ms.data_bytes / 1024, ms.sort_ms, ms.upload_ms);
+                }
+            } else if (packet_mode != SUBMIT_DIRECT) {
+                const CommandReplay::Stats& rs = replay.getStats();
+                const RenderStateCache::Stats& cs = state.getStats();
+                printf("  replay: %d buffers, %d segments, %zu KB commands, %zu KB uniforms - upload %.3f ms, "
+                       "sort %.3f ms, replay %.3f ms\n",
+                       rs.buffers, rs.segments, rs.command_bytes / 1024, rs.uniform_bytes / 1024, rs.upload_ms,
+                       rs.sort_ms, rs.replay_ms);
+                printf("  binds: %d programme, %d vertex array, %d uniform range, %d redundant skipped\n",
+                       cs.programme_binds, cs.vertex_array_binds, cs.uniform_range_binds, cs.redundant);
+            }
+            last_print = curr_time;
+        }
+    };
+    Engine::run(window, loop);
+
+    MeshCache::Stats mesh_stats = mesh_cache.getStats();
+    gl_log("Mesh cache: %d meshes on %d pages, %zu / %zu vertex bytes\n", mesh_stats.meshes, mesh_stats.pages,
+           mesh_stats.vertex_bytes, mesh_stats.vertex_capacity);
+    for (int i = 0; i < MESH_COUNT; i++) {
+        mesh_cache.release(mesh_handles[i]);
+    }
+
+    gl_log("Exercise 8 completed\n");
+}
+
+REGISTER_EXERCISE("8. Command Buffers", runExercise8)
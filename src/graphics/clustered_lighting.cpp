@@ -0,0 +1,290 @@
+#include "graphics/clustered_lighting.h"
+#include "core/JobSystem.h"
+#include "graphics/gpu_handles.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CLUSTER_USE_SSE 1
+#endif
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+ClusteredLighting::ClusteredLighting(int grid_x, int grid_y, int grid_z)
+    : grid_x(grid_x), grid_y(grid_y), grid_z(grid_z), max_lights(0),
+      near_plane(0.1f), far_plane(100.0f), z_scale(1.0f), z_bias(0.0f),
+      light_buffer(0), light_texture(0), grid_buffer(0), grid_texture(0),
+      index_buffer(0), index_texture(0), stats() {
+    tiles_per_slice = (grid_x * grid_y + 3) & ~3;
+    size_t padded = (size_t)tiles_per_slice * grid_z;
+    bounds.min_x.assign(padded, 0.0f);
+    bounds.min_y.assign(padded, 0.0f);
+    bounds.min_z.assign(padded, 0.0f);
+    bounds.max_x.assign(padded, 0.0f);
+    bounds.max_y.assign(padded, 0.0f);
+    bounds.max_z.assign(padded, 0.0f);
+    slice_lists.resize(padded * MAX_LIGHTS_PER_CLUSTER);
+    slice_counts.assign(padded, 0);
+    grid.assign((size_t)grid_x * grid_y * grid_z * 2, 0);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    gpu_release_texture(light_texture);
+    gpu_release_texture(grid_texture);
+    gpu_release_texture(index_texture);
+    gpu_release_buffer(light_buffer);
+    gpu_release_buffer(grid_buffer);
+    gpu_release_buffer(index_buffer);
+}
+
+bool ClusteredLighting::init(int max_lights_) {
+    max_lights = max_lights_;
+    // Light indices are stored as 16 bit
+    if (max_lights > 65535) max_lights = 65535;
+    view_lights.reserve(max_lights);
+    light_data.reserve((size_t)max_lights * 8);
+
+    // Texture buffer textures are views; the memory is in the buffers
+    light_buffer = gpu_create_buffer(RESOURCE_DATA_BUFFER, "cluster lights");
+    grid_buffer = gpu_create_buffer(RESOURCE_DATA_BUFFER, "cluster grid");
+    index_buffer = gpu_create_buffer(RESOURCE_DATA_BUFFER, "cluster light indices");
+    light_texture = gpu_create_texture(RESOURCE_TEXTURE, "cluster lights");
+    grid_texture = gpu_create_texture(RESOURCE_TEXTURE, "cluster grid");
+    index_texture = gpu_create_texture(RESOURCE_TEXTURE, "cluster light indices");
+
+    gpu_buffer_data(light_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)max_lights * 8 * sizeof(float), nullptr,
+                    GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, light_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, light_buffer);
+
+    gpu_buffer_data(grid_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)(grid.size() * sizeof(uint32_t)), nullptr,
+                    GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, grid_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RG32UI, grid_buffer);
+
+    // Resized by every update()
+    gpu_buffer_data(index_buffer, GL_TEXTURE_BUFFER, 4096 * sizeof(uint16_t), nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, index_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_R16UI, index_buffer);
+
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    gl_log("Clustered lighting: %dx%dx%d froxels, %d lights max\n", grid_x, grid_y, grid_z, max_lights);
+    return true;
+}
+
+void ClusteredLighting::setProjection(float fovy, float aspect, float near, float far) {
+    near_plane = near;
+    far_plane = far;
+    float log_ratio = logf(far / near);
+    z_scale = (float)grid_z / log_ratio;
+    z_bias = -(float)grid_z * logf(near) / log_ratio;
+
+    float tan_y = tanf(fovy * ONE_DEG_IN_RAD * 0.5f);
+    float tan_x = tan_y * aspect;
+
+    for (int z = 0; z < grid_z; z++) {
+        // Exponential slices: equal ratio far/near per slice
+        float d0 = near * powf(far / near, (float)z / grid_z);
+        float d1 = near * powf(far / near, (float)(z + 1) / grid_z);
+        for (int t = 0; t < tiles_per_slice; t++) {
+            size_t i = (size_t)z * tiles_per_slice + t;
+            if (t >= grid_x * grid_y) {
+                // Padding lanes can never contain a light
+                bounds.min_x[i] = bounds.min_y[i] = bounds.min_z[i] = 1e30f;
+                bounds.max_x[i] = bounds.max_y[i] = bounds.max_z[i] = 1e30f;
+                continue;
+            }
+            int x = t % grid_x, y = t / grid_x;
+            float nx0 = -1.0f + 2.0f * x / grid_x, nx1 = -1.0f + 2.0f * (x + 1) / grid_x;
+            float ny0 = -1.0f + 2.0f * y / grid_y, ny1 = -1.0f + 2.0f * (y + 1) / grid_y;
+
+            // The froxel is a frustum slab; its corners at d0 and d1 bound it
+            float min_x = std::min(std::min(nx0 * tan_x * d0, nx0 * tan_x * d1), std::min(nx1 * tan_x * d0, nx1 * tan_x * d1));
+            float max_x = std::max(std::max(nx0 * tan_x * d0, nx0 * tan_x * d1), std::max(nx1 * tan_x * d0, nx1 * tan_x * d1));
+            float min_y = std::min(std::min(ny0 * tan_y * d0, ny0 * tan_y * d1), std::min(ny1 * tan_y * d0, ny1 * tan_y * d1));
+            float max_y = std::max(std::max(ny0 * tan_y * d0, ny0 * tan_y * d1), std::max(ny1 * tan_y * d0, ny1 * tan_y * d1));
+            bounds.min_x[i] = min_x;
+            bounds.max_x[i] = max_x;
+            bounds.min_y[i] = min_y;
+            bounds.max_y[i] = max_y;
+            // View space looks down -z
+            bounds.min_z[i] = -d1;
+            bounds.max_z[i] = -d0;
+        }
+    }
+}
+
+void ClusteredLighting::assignSlice(int slice) {
+    size_t base = (size_t)slice * tiles_per_slice;
+    uint32_t* counts = &slice_counts[base];
+    uint16_t* lists = &slice_lists[base * MAX_LIGHTS_PER_CLUSTER];
+    std::fill(counts, counts + tiles_per_slice, 0u);
+
+    const float* min_x = &bounds.min_x[base];
+    const float* min_y = &bounds.min_y[base];
+    const float* min_z = &bounds.min_z[base];
+    const float* max_x = &bounds.max_x[base];
+    const float* max_y = &bounds.max_y[base];
+    const float* max_z = &bounds.max_z[base];
+
+    for (size_t l = 0; l < view_lights.size(); l++) {
+        const ViewLight& light = view_lights[l];
+        if (slice < light.slice_begin || slice > light.slice_end) {
+            continue;
+        }
+        float r2 = light.radius * light.radius;
+
+#ifdef CLUSTER_USE_SSE
+        // Sphere vs 4 AABBs: squared distance from the centre to each box
+        __m128 cx = _mm_set1_ps(light.x), cy = _mm_set1_ps(light.y), cz = _mm_set1_ps(light.z);
+        __m128 radius2 = _mm_set1_ps(r2);
+        __m128 zero = _mm_setzero_ps();
+        for (int t = 0; t < tiles_per_slice; t += 4) {
+            __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(min_x + t), cx),
+                                              _mm_sub_ps(cx, _mm_loadu_ps(max_x + t))), zero);
+            __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(min_y + t), cy),
+                                              _mm_sub_ps(cy, _mm_loadu_ps(max_y + t))), zero);
+            __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(min_z + t), cz),
+                                              _mm_sub_ps(cz, _mm_loadu_ps(max_z + t))), zero);
+            __m128 d2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(d2, radius2));
+            for (int lane = 0; mask && lane < 4; lane++) {
+                if (!(mask & (1 << lane))) continue;
+                int tile = t + lane;
+                if (counts[tile] < (uint32_t)MAX_LIGHTS_PER_CLUSTER) {
+                    lists[tile * MAX_LIGHTS_PER_CLUSTER + counts[tile]] = (uint16_t)l;
+                }
+                counts[tile]++;
+            }
+        }
+#else
+        for (int t = 0; t < tiles_per_slice; t++) {
+            float dx = std::max(std::max(min_x[t] - light.x, light.x - max_x[t]), 0.0f);
+            float dy = std::max(std::max(min_y[t] - light.y, light.y - max_y[t]), 0.0f);
+            float dz = std::max(std::max(min_z[t] - light.z, light.z - max_z[t]), 0.0f);
+            if (dx * dx + dy * dy + dz * dz <= r2) {
+                if (counts[t] < (uint32_t)MAX_LIGHTS_PER_CLUSTER) {
+                    lists[t * MAX_LIGHTS_PER_CLUSTER + counts[t]] = (uint16_t)l;
+                }
+                counts[t]++;
+            }
+        }
+#endif
+    }
+}
+
+void ClusteredLighting::update(const mat4& view, const PointLight* lights, int count) {
+    auto start = std::chrono::high_resolution_clock::now();
+    if (count > max_lights) count = max_lights;
+
+    // View space lights and the depth slices each one can touch
+    const float* m = view.m;
+    view_lights.clear();
+    light_data.resize((size_t)count * 8);
+    for (int i = 0; i < count; i++) {
+        const PointLight& light = lights[i];
+        float x = m[0] * light.position.v[0] + m[4] * light.position.v[1] + m[8] * light.position.v[2] + m[12];
+        float y = m[1] * light.position.v[0] + m[5] * light.position.v[1] + m[9] * light.position.v[2] + m[13];
+        float z = m[2] * light.position.v[0] + m[6] * light.position.v[1] + m[10] * light.position.v[2] + m[14];
+
+        ViewLight vl = {x, y, z, light.radius, 1, 0};
+        float depth_near = -z - light.radius;
+        float depth_far = -z + light.radius;
+        if (depth_far > near_plane && depth_near < far_plane) {
+            float dn = std::max(depth_near, near_plane);
+            float df = std::min(depth_far, far_plane);
+            vl.slice_begin = std::max(0, (int)floorf(logf(dn) * z_scale + z_bias));
+            vl.slice_end = std::min(grid_z - 1, (int)floorf(logf(df) * z_scale + z_bias));
+        }
+        view_lights.push_back(vl);
+
+        float* data = &light_data[(size_t)i * 8];
+        data[0] = x;
+        data[1] = y;
+        data[2] = z;
+        data[3] = light.radius;
+        data[4] = light.color.v[0] * light.intensity;
+        data[5] = light.color.v[1] * light.intensity;
+        data[6] = light.color.v[2] * light.intensity;
+        data[7] = 0.0f;
+    }
+
+    // One depth slice per job: slices own disjoint froxels
+    JobSystem::instance().parallelFor((uint32_t)grid_z, 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t z = begin; z < end; z++) assignSlice((int)z);
+    });
+
+    // Compact the fixed-size per-froxel lists into one index list
+    stats.lights = count;
+    stats.max_lights_per_cluster = 0;
+    stats.overflowed_clusters = 0;
+    indices.clear();
+    for (int z = 0; z < grid_z; z++) {
+        for (int t = 0; t < grid_x * grid_y; t++) {
+            size_t cluster = (size_t)z * tiles_per_slice + t;
+            uint32_t n = slice_counts[cluster];
+            stats.max_lights_per_cluster = std::max(stats.max_lights_per_cluster, (int)n);
+            if (n > (uint32_t)MAX_LIGHTS_PER_CLUSTER) {
+                n = MAX_LIGHTS_PER_CLUSTER;
+                stats.overflowed_clusters++;
+            }
+            size_t out = ((size_t)z * grid_x * grid_y + t) * 2;
+            grid[out] = (uint32_t)indices.size();
+            grid[out + 1] = n;
+            const uint16_t* list = &slice_lists[cluster * MAX_LIGHTS_PER_CLUSTER];
+            indices.insert(indices.end(), list, list + n);
+        }
+    }
+    stats.light_indices = (int)indices.size();
+    stats.assign_ms = ms_since(start);
+
+    // Orphan and refill so the driver never waits on last frame's buffers
+    auto upload_start = std::chrono::high_resolution_clock::now();
+    gpu_buffer_data(light_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)max_lights * 8 * sizeof(float), nullptr,
+                    GL_STREAM_DRAW);
+    if (count > 0) {
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)(light_data.size() * sizeof(float)), light_data.data());
+    }
+
+    gpu_buffer_data(grid_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)(grid.size() * sizeof(uint32_t)), grid.data(),
+                    GL_STREAM_DRAW);
+
+    // A zero sized texture buffer is not allowed, keep at least one entry
+    if (indices.empty()) indices.push_back(0);
+    gpu_buffer_data(index_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)(indices.size() * sizeof(uint16_t)),
+                    indices.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    stats.upload_ms = ms_since(upload_start);
+}
+
+void ClusteredLighting::bind(GLuint programme, int first_unit) {
+    GLuint textures[3] = {light_texture, grid_texture, index_texture};
+    const char* names[3] = {"cluster_lights", "cluster_grid", "cluster_indices"};
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + first_unit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        GLint loc = glGetUniformLocation(programme, names[i]);
+        if (loc != -1) glUniform1i(loc, first_unit + i);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    GLint loc = glGetUniformLocation(programme, "cluster_dims");
+    if (loc != -1) glUniform3ui(loc, (GLuint)grid_x, (GLuint)grid_y, (GLuint)grid_z);
+    loc = glGetUniformLocation(programme, "cluster_z_params");
+    if (loc != -1) glUniform2f(loc, z_scale, z_bias);
+    loc = glGetUniformLocation(programme, "cluster_tile_scale");
+    if (loc != -1) {
+        GLint viewport[4];
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glUniform2f(loc, (float)grid_x / (float)viewport[2], (float)grid_y / (float)viewport[3]);
+    }
+    loc = glGetUniformLocation(programme, "light_count");
+    if (loc != -1) glUniform1i(loc, stats.lights);
+}
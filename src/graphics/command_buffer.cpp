@@ -0,0 +1,91 @@
+#include "graphics/command_buffer.h"
+#include <cstring>
+
+CommandBuffer::CommandBuffer() : command_size(0), uniform_size(0), uniform_alignment(256), draw_count(0) {}
+
+void CommandBuffer::reset(uint32_t uniform_alignment) {
+    this->uniform_alignment = uniform_alignment ? uniform_alignment : 1;
+    segments.clear();
+    command_size = 0;
+    uniform_size = 0;
+    draw_count = 0;
+    begin(0);
+}
+
+void* CommandBuffer::push(size_t bytes) {
+    if (command_size + bytes > commands.size()) {
+        commands.resize(commands.empty() ? 4096 : (command_size + bytes) * 2);
+    }
+    void* cmd = commands.data() + command_size;
+    command_size += bytes;
+    return cmd;
+}
+
+void CommandBuffer::closeSegment() {
+    if (!segments.empty()) {
+        segments.back().end = (uint32_t)command_size;
+    }
+}
+
+void CommandBuffer::begin(uint64_t key) {
+    closeSegment();
+    segments.push_back({key, (uint32_t)command_size, (uint32_t)command_size});
+}
+
+void CommandBuffer::bindProgram(uint32_t programme) {
+    CmdBindProgram* cmd = (CmdBindProgram*)push(sizeof(CmdBindProgram));
+    cmd->type = CMD_BIND_PROGRAM;
+    cmd->programme = programme;
+    closeSegment();
+}
+
+void CommandBuffer::bindVertexArray(uint32_t vertex_array) {
+    CmdBindVertexArray* cmd = (CmdBindVertexArray*)push(sizeof(CmdBindVertexArray));
+    cmd->type = CMD_BIND_VERTEX_ARRAY;
+    cmd->vertex_array = vertex_array;
+    closeSegment();
+}
+
+void CommandBuffer::uniformBlockRange(uint32_t binding, uint32_t buffer, uint32_t offset, uint32_t size) {
+    CmdUniformBlockRange* cmd = (CmdUniformBlockRange*)push(sizeof(CmdUniformBlockRange));
+    cmd->type = CMD_UNIFORM_BLOCK_RANGE;
+    cmd->binding = binding;
+    cmd->buffer = buffer;
+    cmd->offset = offset;
+    cmd->size = size;
+    closeSegment();
+}
+
+void CommandBuffer::draw(uint32_t index_count, IndexType index_type, uint32_t first_index, int32_t base_vertex) {
+    CmdDraw* cmd = (CmdDraw*)push(sizeof(CmdDraw));
+    cmd->type = CMD_DRAW;
+    cmd->index_type = index_type;
+    cmd->index_count = index_count;
+    cmd->first_index = first_index;
+    cmd->base_vertex = base_vertex;
+    draw_count++;
+    closeSegment();
+}
+
+void CommandBuffer::drawInstanced(uint32_t index_count, IndexType index_type, uint32_t instance_count,
+                                  uint32_t first_index, int32_t base_vertex) {
+    CmdDrawInstanced* cmd = (CmdDrawInstanced*)push(sizeof(CmdDrawInstanced));
+    cmd->type = CMD_DRAW_INSTANCED;
+    cmd->index_type = index_type;
+    cmd->index_count = index_count;
+    cmd->first_index = first_index;
+    cmd->base_vertex = base_vertex;
+    cmd->instance_count = instance_count;
+    draw_count++;
+    closeSegment();
+}
+
+void CommandBuffer::uniformBlock(uint32_t binding, const void* data, uint32_t size) {
+    size_t offset = (uniform_size + uniform_alignment - 1) / uniform_alignment * uniform_alignment;
+    if (offset + size > uniforms.size()) {
+        uniforms.resize(uniforms.empty() ? 16384 : (offset + size) * 2);
+    }
+    memcpy(uniforms.data() + offset, data, size);
+    uniform_size = offset + size;
+    uniformBlockRange(binding, 0, (uint32_t)offset, size);
+}
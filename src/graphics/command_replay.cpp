@@ -0,0 +1,146 @@
+#include "graphics/command_replay.h"
+#include "graphics/gpu_handles.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <chrono>
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+CommandReplay::CommandReplay() : uniform_buffer(0), uniform_capacity(0), alignment(256), stats() {}
+
+CommandReplay::~CommandReplay() {
+    gpu_release_buffer(uniform_buffer);
+}
+
+bool CommandReplay::init() {
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment <= 0) {
+        alignment = 256;
+    }
+    uniform_buffer = gpu_create_buffer(RESOURCE_UNIFORM_BUFFER, "command replay uniforms");
+    gl_log("Command replay: uniform offset alignment %d\n", alignment);
+    return uniform_buffer != 0;
+}
+
+void CommandReplay::upload(const CommandBuffer* const* buffers, int count) {
+    // Every buffer's data starts on an aligned offset, so its recorded
+    // (already aligned) offsets stay valid after adding the base
+    uniform_bases.resize(count);
+    size_t total = 0;
+    for (int i = 0; i < count; i++) {
+        total = (total + alignment - 1) / alignment * alignment;
+        uniform_bases[i] = (GLintptr)total;
+        total += buffers[i]->getUniformSize();
+    }
+    stats.uniform_bytes = total;
+    if (total == 0) {
+        return;
+    }
+
+    if (total > uniform_capacity) {
+        uniform_capacity = total + total / 2;
+    }
+    // Orphan last frame's storage instead of waiting for the GPU to finish with it
+    gpu_buffer_data(uniform_buffer, GL_UNIFORM_BUFFER, (GLsizeiptr)uniform_capacity, nullptr, GL_STREAM_DRAW);
+    for (int i = 0; i < count; i++) {
+        size_t size = buffers[i]->getUniformSize();
+        if (size) {
+            glBufferSubData(GL_UNIFORM_BUFFER, uniform_bases[i], (GLsizeiptr)size, buffers[i]->getUniformData());
+        }
+    }
+}
+
+void CommandReplay::submit(const CommandBuffer* const* buffers, int count, RenderStateCache& state) {
+    stats = Stats();
+    stats.buffers = count;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    upload(buffers, count);
+    stats.upload_ms = ms_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    entries.clear();
+    for (int i = 0; i < count; i++) {
+        for (const CommandBuffer::Segment& segment : buffers[i]->getSegments()) {
+            if (segment.end > segment.begin) {
+                entries.push_back({segment.key, (uint32_t)i, segment.begin, segment.end});
+            }
+        }
+        stats.draws += (int)buffers[i]->getDrawCount();
+        stats.command_bytes += buffers[i]->getCommandBytes();
+    }
+    std::sort(entries.begin(), entries.end(), [](const SortEntry& a, const SortEntry& b) {
+        if (a.key != b.key) return a.key < b.key;
+        if (a.buffer != b.buffer) return a.buffer < b.buffer;
+        return a.begin < b.begin;
+    });
+    stats.segments = (int)entries.size();
+    stats.sort_ms = ms_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (const SortEntry& entry : entries) {
+        replay(*buffers[entry.buffer], entry.begin, entry.end, uniform_bases[entry.buffer], state);
+    }
+    stats.replay_ms = ms_since(start);
+}
+
+void CommandReplay::replay(const CommandBuffer& buffer, uint32_t begin, uint32_t end, GLintptr uniform_base,
+                           RenderStateCache& state) {
+    const uint8_t* cmd = buffer.getCommands() + begin;
+    const uint8_t* cmd_end = buffer.getCommands() + end;
+    while (cmd < cmd_end) {
+        switch (*(const uint32_t*)cmd) {
+            case CMD_BIND_PROGRAM: {
+                const CmdBindProgram* c = (const CmdBindProgram*)cmd;
+                state.useProgram(c->programme);
+                cmd += sizeof(CmdBindProgram);
+                break;
+            }
+            case CMD_BIND_VERTEX_ARRAY: {
+                const CmdBindVertexArray* c = (const CmdBindVertexArray*)cmd;
+                state.bindVertexArray(c->vertex_array);
+                cmd += sizeof(CmdBindVertexArray);
+                break;
+            }
+            case CMD_UNIFORM_BLOCK_RANGE: {
+                const CmdUniformBlockRange* c = (const CmdUniformBlockRange*)cmd;
+                if (c->buffer == 0) {
+                    state.bindUniformRange(c->binding, uniform_buffer, uniform_base + c->offset, c->size);
+                } else {
+                    state.bindUniformRange(c->binding, c->buffer, c->offset, c->size);
+                }
+                cmd += sizeof(CmdUniformBlockRange);
+                break;
+            }
+            case CMD_DRAW: {
+                const CmdDraw* c = (const CmdDraw*)cmd;
+                GLenum type = c->index_type == INDEX_TYPE_U16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+                size_t index_size = c->index_type == INDEX_TYPE_U16 ? 2 : 4;
+                const void* offset = (const void*)(c->first_index * index_size);
+                if (c->base_vertex) {
+                    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)c->index_count, type, (void*)offset,
+                                             c->base_vertex);
+                } else {
+                    glDrawElements(GL_TRIANGLES, (GLsizei)c->index_count, type, offset);
+                }
+                cmd += sizeof(CmdDraw);
+                break;
+            }
+            case CMD_DRAW_INSTANCED: {
+                const CmdDrawInstanced* c = (const CmdDrawInstanced*)cmd;
+                GLenum type = c->index_type == INDEX_TYPE_U16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+                size_t index_size = c->index_type == INDEX_TYPE_U16 ? 2 : 4;
+                const void* offset = (const void*)(c->first_index * index_size);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)c->index_count, type, (void*)offset,
+                                                  (GLsizei)c->instance_count, c->base_vertex);
+                cmd += sizeof(CmdDrawInstanced);
+                break;
+            }
+            default:
+                gl_log_err("ERROR: unknown command %u in command buffer\n", *(const uint32_t*)cmd);
+                return;
+        }
+    }
+}
@@ -0,0 +1,159 @@
+#include "graphics/deferred_renderer.h"
+#include "graphics/clustered_lighting.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/gpu_timer.h"
+#include "utils/log.h"
+
+DeferredRenderer::DeferredRenderer()
+    : fbo(0), albedo_texture(0), normal_texture(0), depth_texture(0), fullscreen_vao(0),
+      proj_params_loc(-1), heatmap_loc(-1), clear_colour_loc(-1), shader_generation(0),
+      show_heatmap(false), clear_colour(0.0f, 0.0f, 0.0f), stats() {}
+
+DeferredRenderer::~DeferredRenderer() {
+    destroyTargets();
+    gpu_release_vertex_array(fullscreen_vao);
+}
+
+bool DeferredRenderer::init(int width, int height) {
+    if (!lighting_shader.loadFromFiles("shaders/engine/deferred/vertex.glsl",
+                                       "shaders/engine/deferred/fragment.glsl")) {
+        gl_log_err("ERROR: could not load deferred lighting shader\n");
+        return false;
+    }
+    lookupUniforms();
+
+    // The fullscreen triangle is generated from gl_VertexID
+    fullscreen_vao = gpu_create_vertex_array("deferred fullscreen triangle");
+
+    stats.width = width;
+    stats.height = height;
+    createTargets();
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        gl_log_err("ERROR: G-buffer incomplete (status 0x%x)\n", status);
+        return false;
+    }
+
+    gl_log("Deferred renderer: %dx%d G-buffer, %d bytes per pixel\n", width, height, BYTES_PER_PIXEL);
+    return true;
+}
+
+void DeferredRenderer::lookupUniforms() {
+    lighting_shader.use();
+    glUniform1i(glGetUniformLocation(lighting_shader.programme, "gbuffer_albedo"), 0);
+    glUniform1i(glGetUniformLocation(lighting_shader.programme, "gbuffer_normal"), 1);
+    glUniform1i(glGetUniformLocation(lighting_shader.programme, "gbuffer_depth"), 2);
+    proj_params_loc = glGetUniformLocation(lighting_shader.programme, "proj_params");
+    heatmap_loc = glGetUniformLocation(lighting_shader.programme, "show_heatmap");
+    clear_colour_loc = glGetUniformLocation(lighting_shader.programme, "clear_colour");
+    shader_generation = lighting_shader.generation;
+}
+
+void DeferredRenderer::createTargets() {
+    int w = stats.width, h = stats.height;
+
+    albedo_texture = gpu_create_texture(RESOURCE_RENDER_TARGET, "G-buffer albedo");
+    glBindTexture(GL_TEXTURE_2D, albedo_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gpu_texture_size(albedo_texture, gpu_texture_bytes(GL_RGBA8, w, h));
+
+    normal_texture = gpu_create_texture(RESOURCE_RENDER_TARGET, "G-buffer normal");
+    glBindTexture(GL_TEXTURE_2D, normal_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, w, h, 0, GL_RG, GL_HALF_FLOAT, nullptr);
+    gpu_texture_size(normal_texture, gpu_texture_bytes(GL_RG16F, w, h));
+
+    depth_texture = gpu_create_texture(RESOURCE_RENDER_TARGET, "G-buffer depth");
+    glBindTexture(GL_TEXTURE_2D, depth_texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, w, h, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, nullptr);
+    gpu_texture_size(depth_texture, gpu_texture_bytes(GL_DEPTH_COMPONENT24, w, h));
+
+    // Only read with texelFetch, which still needs complete (non-mipmapped) textures
+    GLuint textures[3] = {albedo_texture, normal_texture, depth_texture};
+    for (GLuint texture : textures) {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedo_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normal_texture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth_texture, 0);
+    GLenum draw_buffers[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
+    glDrawBuffers(2, draw_buffers);
+
+    stats.gbuffer_bytes = (size_t)w * h * BYTES_PER_PIXEL;
+}
+
+void DeferredRenderer::destroyTargets() {
+    if (fbo) glDeleteFramebuffers(1, &fbo);
+    gpu_release_texture(albedo_texture);
+    gpu_release_texture(normal_texture);
+    gpu_release_texture(depth_texture);
+    fbo = 0;
+}
+
+void DeferredRenderer::resize(int width, int height) {
+    if (width == stats.width && height == stats.height) {
+        return;
+    }
+    destroyTargets();
+    stats.width = width;
+    stats.height = height;
+    createTargets();
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gl_log("G-buffer resized to %dx%d\n", width, height);
+}
+
+void DeferredRenderer::beginGeometryPass() {
+    GpuTimers::instance().beginPass("gbuffer");
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glViewport(0, 0, stats.width, stats.height);
+    // RGBA8 is not an sRGB format, so albedo is stored as written
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+}
+
+void DeferredRenderer::endGeometryPass() {
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GpuTimers::instance().endPass();
+}
+
+void DeferredRenderer::lightingPass(const mat4& proj, ClusteredLighting& clusters) {
+    GpuTimers::instance().beginPass("lighting");
+    glViewport(0, 0, stats.width, stats.height);
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    glDisable(GL_DEPTH_TEST);
+    glDepthMask(GL_FALSE);
+
+    if (lighting_shader.generation != shader_generation) {
+        lookupUniforms();   // hot reloaded
+    }
+    lighting_shader.use();
+    clusters.bind(lighting_shader.programme);
+
+    // View position from depth: z_eye = -B / (z_ndc + A), xy_eye = ndc * -z_eye / (m0, m5)
+    glUniform4f(proj_params_loc, 1.0f / proj.m[0], 1.0f / proj.m[5], proj.m[10], proj.m[14]);
+    glUniform1i(heatmap_loc, show_heatmap ? 1 : 0);
+    glUniform3f(clear_colour_loc, clear_colour.v[0], clear_colour.v[1], clear_colour.v[2]);
+
+    GLuint textures[3] = {albedo_texture, normal_texture, depth_texture};
+    for (int i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(fullscreen_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glDepthMask(GL_TRUE);
+    if (depth_test) glEnable(GL_DEPTH_TEST);
+    GpuTimers::instance().endPass();
+}
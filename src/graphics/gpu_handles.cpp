@@ -0,0 +1,184 @@
+#include "graphics/gpu_handles.h"
+#include "utils/log.h"
+
+static void release_name(GpuObjectType type, GLuint& name) {
+    if (name) {
+        GpuHandles::instance().release(type, name);
+        name = 0;
+    }
+}
+
+void gpu_release_buffer(GLuint& buffer) {
+    release_name(GPU_OBJECT_BUFFER, buffer);
+}
+
+void gpu_release_texture(GLuint& texture) {
+    release_name(GPU_OBJECT_TEXTURE, texture);
+}
+
+void gpu_release_vertex_array(GLuint& vertex_array) {
+    release_name(GPU_OBJECT_VERTEX_ARRAY, vertex_array);
+}
+
+void gpu_release_program(GLuint& programme) {
+    release_name(GPU_OBJECT_PROGRAM, programme);
+}
+
+GpuHandles& GpuHandles::instance() {
+    static GpuHandles handles;
+    return handles;
+}
+
+GpuHandles::GpuHandles() : deleted(0) {
+    entries.reserve(1024);
+}
+
+// Vertex arrays and programmes have a category of their own; the argument
+// only matters for buffers and textures
+uint32_t GpuHandles::create(GpuObjectType type, ResourceCategory category, const char* label) {
+    Entry entry;
+    entry.type = type;
+    switch (type) {
+        case GPU_OBJECT_BUFFER: entry.name = gpu_create_buffer(category, label); break;
+        case GPU_OBJECT_TEXTURE: entry.name = gpu_create_texture(category, label); break;
+        case GPU_OBJECT_VERTEX_ARRAY: entry.name = gpu_create_vertex_array(label); break;
+        case GPU_OBJECT_PROGRAM: entry.name = gpu_create_program(label); break;
+    }
+    if (!entry.name) {
+        return 0;
+    }
+
+    uint32_t id;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        id = entries.insert(entry);
+    }
+    if (!id) {
+        gl_log_err("ERROR: out of GPU handles, \"%s\" not created\n", label ? label : "");
+        GLuint name = entry.name;
+        switch (type) {
+            case GPU_OBJECT_BUFFER: gpu_delete_buffer(name); break;
+            case GPU_OBJECT_TEXTURE: gpu_delete_texture(name); break;
+            case GPU_OBJECT_VERTEX_ARRAY: gpu_delete_vertex_array(name); break;
+            case GPU_OBJECT_PROGRAM: gpu_delete_program(name); break;
+        }
+    }
+    return id;
+}
+
+GLuint GpuHandles::lookup(GpuObjectType type, uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Entry* entry = entries.get(id);
+    return entry && entry->type == type ? entry->name : 0;
+}
+
+void GpuHandles::destroy(GpuObjectType type, uint32_t id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry* entry = entries.get(id);
+    if (!entry || entry->type != type) {
+        return;
+    }
+    Pending pending = {entry->type, entry->name};
+    entries.remove(id);
+    released.push_back(pending);
+}
+
+void GpuHandles::release(GpuObjectType type, GLuint name) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Pending pending = {type, name};
+    released.push_back(pending);
+}
+
+void GpuHandles::endFrame() {
+    std::vector<Pending> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        // With the render thread, something released on the main thread
+        // can still be in the packet the GL thread draws next, so objects
+        // wait one more frame before they are fenced. Packets are double
+        // buffered (RenderThread), so one frame is enough
+        if (!previous.empty()) {
+            Batch batch;
+            batch.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            batch.objects.swap(previous);
+            if (!spare.empty()) {
+                previous.swap(spare.back());
+                spare.pop_back();
+            }
+            batches.push_back(std::move(batch));
+        }
+        previous.swap(released);
+
+        // Fences signal in order, so stop at the first that has not
+        while (!batches.empty()) {
+            GLenum status = glClientWaitSync(batches.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            glDeleteSync(batches.front().fence);
+            if (ready.empty()) {
+                ready.swap(batches.front().objects);
+            } else {
+                ready.insert(ready.end(), batches.front().objects.begin(), batches.front().objects.end());
+            }
+            batches.pop_front();
+        }
+    }
+
+    if (!ready.empty()) {
+        deleteObjects(ready);
+        std::lock_guard<std::mutex> lock(mutex);
+        spare.push_back(std::move(ready));
+    }
+}
+
+void GpuHandles::flush() {
+    std::vector<Pending> objects;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (released.empty() && previous.empty() && batches.empty()) {
+            return;
+        }
+        glFinish();
+        for (Batch& batch : batches) {
+            glDeleteSync(batch.fence);
+            objects.insert(objects.end(), batch.objects.begin(), batch.objects.end());
+        }
+        batches.clear();
+        objects.insert(objects.end(), previous.begin(), previous.end());
+        objects.insert(objects.end(), released.begin(), released.end());
+        previous.clear();
+        released.clear();
+    }
+    size_t count = objects.size();
+    deleteObjects(objects);
+    gl_log("GPU handles: flushed %zu released objects\n", count);
+}
+
+void GpuHandles::deleteObjects(std::vector<Pending>& objects) {
+    for (Pending& object : objects) {
+        switch (object.type) {
+            case GPU_OBJECT_BUFFER: gpu_delete_buffer(object.name); break;
+            case GPU_OBJECT_TEXTURE: gpu_delete_texture(object.name); break;
+            case GPU_OBJECT_VERTEX_ARRAY: gpu_delete_vertex_array(object.name); break;
+            case GPU_OBJECT_PROGRAM: gpu_delete_program(object.name); break;
+        }
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    deleted += objects.size();
+    objects.clear();
+}
+
+GpuHandles::Stats GpuHandles::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Stats stats;
+    stats.live_handles = entries.size();
+    stats.pending = released.size() + previous.size();
+    stats.fences = batches.size();
+    for (const Batch& batch : batches) {
+        stats.pending += batch.objects.size();
+    }
+    stats.deleted = deleted;
+    return stats;
+}
@@ -0,0 +1,258 @@
+#include "graphics/gpu_resources.h"
+#include "core/Memory.h"
+#include "utils/log.h"
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static const char* category_names[RESOURCE_CATEGORY_COUNT] = {
+    "vertex buffers", "index buffers", "uniform buffers", "data buffers",
+    "textures", "render targets", "vertex arrays", "programmes"
+};
+
+const char* resource_category_name(ResourceCategory category) {
+    return category >= 0 && category < RESOURCE_CATEGORY_COUNT ? category_names[category] : "unknown";
+}
+
+static double to_mb(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+GLuint gpu_create_buffer(ResourceCategory category, const char* label) {
+    GLuint buffer = 0;
+    glGenBuffers(1, &buffer);
+    GpuResources::instance().add(GPU_OBJECT_BUFFER, buffer, category, label);
+    return buffer;
+}
+
+void gpu_buffer_data(GLuint buffer, GLenum target, GLsizeiptr size, const void* data, GLenum usage) {
+    glBindBuffer(target, buffer);
+    glBufferData(target, size, data, usage);
+    GpuResources::instance().resize(GPU_OBJECT_BUFFER, buffer, (size_t)size);
+}
+
+void gpu_delete_buffer(GLuint& buffer) {
+    if (buffer) {
+        GpuResources::instance().remove(GPU_OBJECT_BUFFER, buffer);
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+}
+
+GLuint gpu_create_texture(ResourceCategory category, const char* label) {
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    GpuResources::instance().add(GPU_OBJECT_TEXTURE, texture, category, label);
+    return texture;
+}
+
+void gpu_texture_size(GLuint texture, size_t bytes) {
+    GpuResources::instance().resize(GPU_OBJECT_TEXTURE, texture, bytes);
+}
+
+void gpu_delete_texture(GLuint& texture) {
+    if (texture) {
+        GpuResources::instance().remove(GPU_OBJECT_TEXTURE, texture);
+        glDeleteTextures(1, &texture);
+        texture = 0;
+    }
+}
+
+size_t gpu_texture_bytes(GLenum internal_format, int width, int height, bool mipmaps) {
+    size_t texel = 4;
+    switch (internal_format) {
+        case GL_R8: texel = 1; break;
+        case GL_R16: case GL_R16F: case GL_R16UI: case GL_RG8: case GL_DEPTH_COMPONENT16: texel = 2; break;
+        case GL_RGBA16F: case GL_RG32F: case GL_RGBA16: texel = 8; break;
+        case GL_RGBA32F: texel = 16; break;
+        // RGB8, RGBA8, sRGB, RG16F, R32F, depth 24 / 24+8: drivers keep 24-bit
+        // formats in 32-bit texels
+        default: texel = 4; break;
+    }
+    size_t bytes = (size_t)width * height * texel;
+    if (mipmaps) {
+        bytes += bytes / 3;
+    }
+    return bytes;
+}
+
+GLuint gpu_create_vertex_array(const char* label) {
+    GLuint vertex_array = 0;
+    glGenVertexArrays(1, &vertex_array);
+    GpuResources::instance().add(GPU_OBJECT_VERTEX_ARRAY, vertex_array, RESOURCE_VERTEX_ARRAY, label);
+    return vertex_array;
+}
+
+void gpu_delete_vertex_array(GLuint& vertex_array) {
+    if (vertex_array) {
+        GpuResources::instance().remove(GPU_OBJECT_VERTEX_ARRAY, vertex_array);
+        glDeleteVertexArrays(1, &vertex_array);
+        vertex_array = 0;
+    }
+}
+
+GLuint gpu_create_program(const char* label) {
+    GLuint programme = glCreateProgram();
+    GpuResources::instance().add(GPU_OBJECT_PROGRAM, programme, RESOURCE_PROGRAM, label);
+    return programme;
+}
+
+void gpu_delete_program(GLuint& programme) {
+    if (programme) {
+        GpuResources::instance().remove(GPU_OBJECT_PROGRAM, programme);
+        glDeleteProgram(programme);
+        programme = 0;
+    }
+}
+
+GpuResources& GpuResources::instance() {
+    static GpuResources resources;
+    return resources;
+}
+
+GpuResources::GpuResources()
+    : categories(), over_budget(), total_bytes(0), total_peak(0), total_budget(0), over_total_budget(false) {}
+
+void GpuResources::add(GpuObjectType type, GLuint id, ResourceCategory category, const char* label) {
+    if (!id) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    Entry& entry = entries[key(type, id)];
+    entry.category = category;
+    entry.bytes = 0;
+    snprintf(entry.label, sizeof(entry.label), "%s", label ? label : "");
+    categories[category].count++;
+}
+
+void GpuResources::resize(GpuObjectType type, GLuint id, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key(type, id));
+    if (it == entries.end()) {
+        return;     // not created through gpu_create_*
+    }
+    Entry& entry = it->second;
+    CategoryStats& stats = categories[entry.category];
+    stats.bytes = stats.bytes - entry.bytes + bytes;
+    total_bytes = total_bytes - entry.bytes + bytes;
+    entry.bytes = bytes;
+    if (stats.bytes > stats.peak_bytes) stats.peak_bytes = stats.bytes;
+    if (total_bytes > total_peak) total_peak = total_bytes;
+    checkBudget(entry.category);
+}
+
+void GpuResources::remove(GpuObjectType type, GLuint id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key(type, id));
+    if (it == entries.end()) {
+        return;
+    }
+    CategoryStats& stats = categories[it->second.category];
+    stats.count--;
+    stats.bytes -= it->second.bytes;
+    total_bytes -= it->second.bytes;
+    ResourceCategory category = it->second.category;
+    entries.erase(it);
+    checkBudget(category);
+}
+
+void GpuResources::setBudget(ResourceCategory category, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    categories[category].budget = bytes;
+    checkBudget(category);
+}
+
+void GpuResources::setTotalBudget(size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    total_budget = bytes;
+    over_total_budget = false;
+    checkBudget(RESOURCE_VERTEX_BUFFER);
+}
+
+// Called with the mutex held
+void GpuResources::checkBudget(ResourceCategory category) {
+    const CategoryStats& stats = categories[category];
+    bool over = stats.budget && stats.bytes > stats.budget;
+    if (over && !over_budget[category]) {
+        gl_log_err("WARNING: %s use %.2f MB exceeds the %.2f MB budget\n", category_names[category],
+                   to_mb(stats.bytes), to_mb(stats.budget));
+    }
+    over_budget[category] = over;
+
+    bool total_over = total_budget && total_bytes > total_budget;
+    if (total_over && !over_total_budget) {
+        gl_log_err("WARNING: GPU memory use %.2f MB exceeds the %.2f MB budget\n", to_mb(total_bytes),
+                   to_mb(total_budget));
+    }
+    over_total_budget = total_over;
+}
+
+GpuResources::Report GpuResources::getReport() {
+    std::lock_guard<std::mutex> lock(mutex);
+    Report report;
+    report.count = 0;
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+        report.categories[i] = categories[i];
+        report.count += categories[i].count;
+    }
+    report.bytes = total_bytes;
+    report.peak_bytes = total_peak;
+    report.budget = total_budget;
+    return report;
+}
+
+size_t GpuResources::getTotalBytes() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return total_bytes;
+}
+
+void GpuResources::logReport() {
+    Report report = getReport();
+    MemoryStats memory = Memory::getStats();
+
+    char line[160];
+    std::cout << "\n=== Resource report ===" << std::endl;
+    gl_log("=== Resource report ===\n");
+    snprintf(line, sizeof(line), "  %-16s %6s %11s %11s %11s", "category", "count", "MB", "peak MB", "budget MB");
+    std::cout << line << std::endl;
+    gl_log("%s\n", line);
+    for (int i = 0; i < RESOURCE_CATEGORY_COUNT; i++) {
+        const CategoryStats& c = report.categories[i];
+        char budget[16] = "-";
+        if (c.budget) snprintf(budget, sizeof(budget), "%.2f", to_mb(c.budget));
+        snprintf(line, sizeof(line), "  %-16s %6d %11.2f %11.2f %11s%s", category_names[i], c.count, to_mb(c.bytes),
+                 to_mb(c.peak_bytes), budget, c.budget && c.bytes > c.budget ? "  OVER" : "");
+        std::cout << line << std::endl;
+        gl_log("%s\n", line);
+    }
+    char budget[16] = "-";
+    if (report.budget) snprintf(budget, sizeof(budget), "%.2f", to_mb(report.budget));
+    snprintf(line, sizeof(line), "  %-16s %6d %11.2f %11.2f %11s", "GPU total", report.count, to_mb(report.bytes),
+             to_mb(report.peak_bytes), budget);
+    std::cout << line << std::endl;
+    gl_log("%s\n", line);
+
+    snprintf(line, sizeof(line), "  CPU heap: %llu live allocations, %.2f MB requested in total; frame arena %.2f MB",
+             (unsigned long long)(memory.heap_allocs - memory.heap_frees), to_mb(memory.heap_bytes),
+             to_mb(memory.frame_arena_capacity));
+    std::cout << line << std::endl;
+    gl_log("%s\n", line);
+}
+
+int GpuResources::checkLeaks() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.empty()) {
+        gl_log("GPU resources: no leaks\n");
+        return 0;
+    }
+
+    static const char* type_names[] = {"buffer", "texture", "vertex array", "programme"};
+    gl_log_err("WARNING: %zu GPU resources still alive at shutdown (%.2f MB)\n", entries.size(), to_mb(total_bytes));
+    std::cerr << "WARNING: " << entries.size() << " GPU resources leaked, see gl.log" << std::endl;
+    for (const auto& pair : entries) {
+        const Entry& entry = pair.second;
+        gl_log_err("  %s %u (%s) \"%s\" %zu bytes\n", type_names[pair.first >> 32], (unsigned)(pair.first & 0xFFFFFFFF),
+                   category_names[entry.category], entry.label, entry.bytes);
+    }
+    return (int)entries.size();
+}
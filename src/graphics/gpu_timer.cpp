@@ -0,0 +1,136 @@
+#include "graphics/gpu_timer.h"
+#include "utils/log.h"
+#include <cstring>
+
+static const int QUERIES_PER_SLOT = 2 + GpuTimers::MAX_PASSES * 2;
+
+GpuTimers& GpuTimers::instance() {
+    static GpuTimers timers;
+    return timers;
+}
+
+GpuTimers::GpuTimers()
+    : enabled(false), created(false), in_frame(false), frame_index(0), open_count(0), dropped(0), frame_ms(0.0),
+      result_count(0) {
+    memset(slots, 0, sizeof(slots));
+    memset(results, 0, sizeof(results));
+}
+
+void GpuTimers::setEnabled(bool enable) {
+    if (enable == enabled) {
+        return;
+    }
+    enabled = enable;
+    in_frame = false;
+    // Whatever was queued before is stale by the time timing resumes
+    for (int i = 0; i < FRAME_LATENCY; i++) {
+        slots[i].issued = false;
+    }
+    frame_ms = 0.0;
+    result_count = 0;
+}
+
+void GpuTimers::beginFrame() {
+    if (!enabled) {
+        return;
+    }
+    if (!created) {
+        for (int i = 0; i < FRAME_LATENCY; i++) {
+            glGenQueries(QUERIES_PER_SLOT, slots[i].queries);
+        }
+        created = true;
+        gl_log("GPU timers: %d timestamp queries per frame, read %d frames late\n", QUERIES_PER_SLOT, FRAME_LATENCY);
+    }
+
+    frame_index = (frame_index + 1) % FRAME_LATENCY;
+    Slot& slot = slots[frame_index];
+    if (slot.issued) {
+        resolve(slot);
+    }
+    slot.pass_count = 0;
+    slot.issued = false;
+    open_count = 0;
+    dropped = 0;
+    glQueryCounter(slot.queries[0], GL_TIMESTAMP);
+    in_frame = true;
+}
+
+void GpuTimers::endFrame() {
+    if (!enabled || !in_frame) {
+        return;
+    }
+    while (open_count > 0) {
+        endPass();
+    }
+    Slot& slot = slots[frame_index];
+    glQueryCounter(slot.queries[1], GL_TIMESTAMP);
+    slot.issued = true;
+    in_frame = false;
+}
+
+void GpuTimers::beginPass(const char* name) {
+    if (!enabled || !in_frame) {
+        return;
+    }
+    Slot& slot = slots[frame_index];
+    // Once a begin is dropped everything nested in it is too, so the
+    // matching ends are simply the next `dropped` ones
+    if (dropped > 0 || slot.pass_count >= MAX_PASSES || open_count >= MAX_DEPTH) {
+        dropped++;
+        return;
+    }
+    int index = slot.pass_count++;
+    slot.names[index] = name;
+    slot.depths[index] = open_count;
+    glQueryCounter(slot.queries[2 + index * 2], GL_TIMESTAMP);
+    open[open_count++] = index;
+}
+
+void GpuTimers::endPass() {
+    if (!enabled || !in_frame) {
+        return;
+    }
+    if (dropped > 0) {
+        dropped--;
+        return;
+    }
+    if (open_count == 0) {
+        return;
+    }
+    int index = open[--open_count];
+    glQueryCounter(slots[frame_index].queries[3 + index * 2], GL_TIMESTAMP);
+}
+
+void GpuTimers::resolve(Slot& slot) {
+    // The frame end is the last timestamp written, so it being available
+    // means the others are too
+    GLint available = 0;
+    glGetQueryObjectiv(slot.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        return;
+    }
+
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(slot.queries[0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(slot.queries[1], GL_QUERY_RESULT, &end);
+    frame_ms = (double)(end - begin) * 1.0e-6;
+
+    for (int i = 0; i < slot.pass_count; i++) {
+        glGetQueryObjectui64v(slot.queries[2 + i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(slot.queries[3 + i * 2], GL_QUERY_RESULT, &end);
+        results[i].name = slot.names[i];
+        results[i].depth = slot.depths[i];
+        results[i].ms = (double)(end - begin) * 1.0e-6;
+    }
+    result_count = slot.pass_count;
+}
+
+void GpuTimers::shutdown() {
+    setEnabled(false);
+    if (created) {
+        for (int i = 0; i < FRAME_LATENCY; i++) {
+            glDeleteQueries(QUERIES_PER_SLOT, slots[i].queries);
+        }
+        created = false;
+    }
+}
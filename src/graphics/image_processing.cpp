@@ -0,0 +1,631 @@
+#include "graphics/image_processing.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define IMAGE_SIMD_SSE2 1
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#define IMAGE_SIMD_NEON 1
+#endif
+
+// Rows per job system batch are chosen to cover about this many pixels
+static const uint32_t PIXELS_PER_BATCH = 16384;
+
+// Linear -> sRGB table size; see the header for its accuracy
+static const int SRGB_ENCODE_SIZE = 4096;
+
+namespace {
+
+// The operations the kernels need, on one RGBA pixel (F) or four packed
+// RGBA8 pixels (U). ScalarOps is the reference and the fallback; the
+// vector backends must match it.
+//
+// max/min return the second operand when the first is NaN, so clamping
+// with max first maps NaN to the lower bound
+struct ScalarOps {
+    struct F {
+        float v[4];
+    };
+    struct U {
+        uint32_t v[4];
+    };
+
+    static F load(const float* p) { F r; memcpy(r.v, p, sizeof(r.v)); return r; }
+    static void store(float* p, const F& a) { memcpy(p, a.v, sizeof(a.v)); }
+    static F set(float x, float y, float z, float w) { F r = {{x, y, z, w}}; return r; }
+    static F splat(float s) { return set(s, s, s, s); }
+    static F splatW(const F& a) { return splat(a.v[3]); }
+    static F add(const F& a, const F& b) { F r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] + b.v[i]; return r; }
+    static F mul(const F& a, const F& b) { F r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] * b.v[i]; return r; }
+    static F div(const F& a, const F& b) { F r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] / b.v[i]; return r; }
+    static F madd(const F& a, const F& b, const F& c) { return add(mul(a, b), c); }
+    static F max(const F& a, const F& b) { F r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+    static F min(const F& a, const F& b) { F r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+    static F sqrt(const F& a) { F r; for (int i = 0; i < 4; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+
+    // a < b ? x : y per lane
+    static F selectLess(const F& a, const F& b, const F& x, const F& y) {
+        F r;
+        for (int i = 0; i < 4; i++) r.v[i] = a.v[i] < b.v[i] ? x.v[i] : y.v[i];
+        return r;
+    }
+
+    static void transpose(F& a, F& b, F& c, F& d) {
+        F rows[4] = {a, b, c, d};
+        for (int i = 0; i < 4; i++) {
+            a.v[i] = rows[i].v[0];
+            b.v[i] = rows[i].v[1];
+            c.v[i] = rows[i].v[2];
+            d.v[i] = rows[i].v[3];
+        }
+    }
+
+    // One RGBA8 pixel to 0..255 and back; the store truncates values
+    // already clamped to [0, 255.5)
+    static F fromUnorm8(const uint8_t* p) { return set(p[0], p[1], p[2], p[3]); }
+    static void toUnorm8(const F& a, uint8_t* p) { for (int i = 0; i < 4; i++) p[i] = (uint8_t)a.v[i]; }
+    static void toInt(const F& a, int32_t* out) { for (int i = 0; i < 4; i++) out[i] = (int32_t)a.v[i]; }
+
+    static U loadU(const uint8_t* p) { U r; memcpy(r.v, p, sizeof(r.v)); return r; }
+    static void storeU(uint8_t* p, const U& a) { memcpy(p, a.v, sizeof(a.v)); }
+    static U splatU(uint32_t s) { U r = {{s, s, s, s}}; return r; }
+    static U srl(const U& a, int n) { U r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] >> n; return r; }
+    static U sll(const U& a, int n) { U r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] << n; return r; }
+    static U andU(const U& a, const U& b) { U r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] & b.v[i]; return r; }
+    static U orU(const U& a, const U& b) { U r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] | b.v[i]; return r; }
+};
+
+#if defined(IMAGE_SIMD_SSE2)
+struct SimdOps {
+    typedef __m128 F;
+    typedef __m128i U;
+
+    static F load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, F a) { _mm_storeu_ps(p, a); }
+    static F set(float x, float y, float z, float w) { return _mm_setr_ps(x, y, z, w); }
+    static F splat(float s) { return _mm_set1_ps(s); }
+    static F splatW(F a) { return _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)); }
+    static F add(F a, F b) { return _mm_add_ps(a, b); }
+    static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+    static F div(F a, F b) { return _mm_div_ps(a, b); }
+    static F madd(F a, F b, F c) { return _mm_add_ps(_mm_mul_ps(a, b), c); }
+    static F max(F a, F b) { return _mm_max_ps(a, b); }
+    static F min(F a, F b) { return _mm_min_ps(a, b); }
+    static F sqrt(F a) { return _mm_sqrt_ps(a); }
+
+    static F selectLess(F a, F b, F x, F y) {
+        F mask = _mm_cmplt_ps(a, b);
+        return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y));
+    }
+
+    static void transpose(F& a, F& b, F& c, F& d) { _MM_TRANSPOSE4_PS(a, b, c, d); }
+
+    static F fromUnorm8(const uint8_t* p) {
+        int32_t bits;
+        memcpy(&bits, p, sizeof(bits));
+        __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bits), zero);
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    }
+    static void toUnorm8(F a, uint8_t* p) {
+        __m128i v = _mm_cvttps_epi32(a);
+        v = _mm_packs_epi32(v, v);
+        v = _mm_packus_epi16(v, v);
+        int32_t bits = _mm_cvtsi128_si32(v);
+        memcpy(p, &bits, sizeof(bits));
+    }
+    static void toInt(F a, int32_t* out) { _mm_storeu_si128((__m128i*)out, _mm_cvttps_epi32(a)); }
+
+    static U loadU(const uint8_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static void storeU(uint8_t* p, U a) { _mm_storeu_si128((__m128i*)p, a); }
+    static U splatU(uint32_t s) { return _mm_set1_epi32((int)s); }
+    static U srl(U a, int n) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(n)); }
+    static U sll(U a, int n) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(n)); }
+    static U andU(U a, U b) { return _mm_and_si128(a, b); }
+    static U orU(U a, U b) { return _mm_or_si128(a, b); }
+};
+static const bool SIMD_AVAILABLE = true;
+static const char* SIMD_NAME = "SSE2";
+#elif defined(IMAGE_SIMD_NEON)
+struct SimdOps {
+    typedef float32x4_t F;
+    typedef uint32x4_t U;
+
+    static F load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, F a) { vst1q_f32(p, a); }
+    static F set(float x, float y, float z, float w) {
+        const float v[4] = {x, y, z, w};
+        return vld1q_f32(v);
+    }
+    static F splat(float s) { return vdupq_n_f32(s); }
+    static F splatW(F a) { return vdupq_laneq_f32(a, 3); }
+    static F add(F a, F b) { return vaddq_f32(a, b); }
+    static F mul(F a, F b) { return vmulq_f32(a, b); }
+    static F div(F a, F b) { return vdivq_f32(a, b); }
+    static F madd(F a, F b, F c) { return vmlaq_f32(c, a, b); }
+    // The "nm" forms return the number when one operand is NaN
+    static F max(F a, F b) { return vmaxnmq_f32(a, b); }
+    static F min(F a, F b) { return vminnmq_f32(a, b); }
+    static F sqrt(F a) { return vsqrtq_f32(a); }
+
+    static F selectLess(F a, F b, F x, F y) { return vbslq_f32(vcltq_f32(a, b), x, y); }
+
+    static void transpose(F& a, F& b, F& c, F& d) {
+        float32x4x2_t ab = vtrnq_f32(a, b);
+        float32x4x2_t cd = vtrnq_f32(c, d);
+        a = vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0]));
+        b = vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1]));
+        c = vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0]));
+        d = vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1]));
+    }
+
+    static F fromUnorm8(const uint8_t* p) {
+        uint32_t bits;
+        memcpy(&bits, p, sizeof(bits));
+        uint16x8_t v = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(bits)));
+        return vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+    }
+    static void toUnorm8(F a, uint8_t* p) {
+        uint16x4_t half = vmovn_u32(vcvtq_u32_f32(a));
+        uint8x8_t bytes = vmovn_u16(vcombine_u16(half, half));
+        uint32_t bits = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+        memcpy(p, &bits, sizeof(bits));
+    }
+    static void toInt(F a, int32_t* out) { vst1q_s32(out, vcvtq_s32_f32(a)); }
+
+    static U loadU(const uint8_t* p) { return vreinterpretq_u32_u8(vld1q_u8(p)); }
+    static void storeU(uint8_t* p, U a) { vst1q_u8(p, vreinterpretq_u8_u32(a)); }
+    static U splatU(uint32_t s) { return vdupq_n_u32(s); }
+    static U srl(U a, int n) { return vshlq_u32(a, vdupq_n_s32(-n)); }
+    static U sll(U a, int n) { return vshlq_u32(a, vdupq_n_s32(n)); }
+    static U andU(U a, U b) { return vandq_u32(a, b); }
+    static U orU(U a, U b) { return vorrq_u32(a, b); }
+};
+static const bool SIMD_AVAILABLE = true;
+static const char* SIMD_NAME = "NEON";
+#else
+typedef ScalarOps SimdOps;
+static const bool SIMD_AVAILABLE = false;
+static const char* SIMD_NAME = "scalar";
+#endif
+
+struct SrgbTables {
+    float to_linear[256];
+    uint8_t to_srgb[SRGB_ENCODE_SIZE];
+
+    SrgbTables() {
+        for (int i = 0; i < 256; i++) {
+            double s = i / 255.0;
+            to_linear[i] = (float)(s <= 0.04045 ? s / 12.92 : pow((s + 0.055) / 1.055, 2.4));
+        }
+        for (int i = 0; i < SRGB_ENCODE_SIZE; i++) {
+            double l = (double)i / (SRGB_ENCODE_SIZE - 1);
+            double s = l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+            to_srgb[i] = (uint8_t)std::min(255.0, floor(s * 255.0 + 0.5));
+        }
+    }
+};
+
+// Either axis of a resample: output pixel o reads input pixels
+// indices[o * max_taps + t] with weights[o * max_taps + t]
+struct FilterTaps {
+    int max_taps;
+    std::vector<int> indices;
+    std::vector<float> weights;
+};
+
+} // namespace
+
+static bool s_simd = SIMD_AVAILABLE;
+
+static const SrgbTables& srgb_tables() {
+    static const SrgbTables tables;
+    return tables;
+}
+
+// Rows [0, rows) in batches on the job system
+template <typename Func>
+static void for_rows(int rows, int row_pixels, const Func& func) {
+    uint32_t batch = std::max(1u, PIXELS_PER_BATCH / (uint32_t)std::max(row_pixels, 1));
+    JobSystem::instance().parallelFor((uint32_t)rows, batch, func);
+}
+
+// Decode / encode
+
+template <typename Ops>
+static void decode_rows(const Image8& in, ImageEncoding encoding, ImageF& out, uint32_t begin, uint32_t end) {
+    typedef typename Ops::F F;
+    const uint8_t* src = in.pixels.data();
+    float* dst = out.pixels.data();
+    size_t first = (size_t)begin * in.width, last = (size_t)end * in.width;
+
+    if (encoding == IMAGE_SRGB) {
+        // Table lookups; nothing for the vector unit to do
+        const float* to_linear = srgb_tables().to_linear;
+        for (size_t p = first; p < last; p++) {
+            dst[p * 4 + 0] = to_linear[src[p * 4 + 0]];
+            dst[p * 4 + 1] = to_linear[src[p * 4 + 1]];
+            dst[p * 4 + 2] = to_linear[src[p * 4 + 2]];
+            dst[p * 4 + 3] = src[p * 4 + 3] * (1.0f / 255.0f);
+        }
+        return;
+    }
+
+    bool normal = encoding == IMAGE_NORMAL;
+    float rgb_scale = normal ? 2.0f / 255.0f : 1.0f / 255.0f;
+    F scale = Ops::set(rgb_scale, rgb_scale, rgb_scale, 1.0f / 255.0f);
+    F bias = normal ? Ops::set(-1.0f, -1.0f, -1.0f, 0.0f) : Ops::splat(0.0f);
+    for (size_t p = first; p < last; p++) {
+        Ops::store(dst + p * 4, Ops::madd(Ops::fromUnorm8(src + p * 4), scale, bias));
+    }
+}
+
+template <typename Ops>
+static void encode_rows(const ImageF& in, ImageEncoding encoding, Image8& out, uint32_t begin, uint32_t end) {
+    typedef typename Ops::F F;
+    const float* src = in.pixels.data();
+    uint8_t* dst = out.pixels.data();
+    size_t first = (size_t)begin * in.width, last = (size_t)end * in.width;
+
+    bool normal = encoding == IMAGE_NORMAL;
+    F scale = normal ? Ops::set(0.5f, 0.5f, 0.5f, 1.0f) : Ops::splat(1.0f);
+    F bias = normal ? Ops::set(0.5f, 0.5f, 0.5f, 0.0f) : Ops::splat(0.0f);
+    F zero = Ops::splat(0.0f), one = Ops::splat(1.0f), half = Ops::splat(0.5f);
+    F unorm = Ops::splat(255.0f), table = Ops::splat((float)(SRGB_ENCODE_SIZE - 1));
+    const uint8_t* to_srgb = srgb_tables().to_srgb;
+    for (size_t p = first; p < last; p++) {
+        F v = Ops::min(Ops::max(Ops::madd(Ops::load(src + p * 4), scale, bias), zero), one);
+        Ops::toUnorm8(Ops::madd(v, unorm, half), dst + p * 4);
+        if (encoding == IMAGE_SRGB) {
+            int32_t index[4];
+            Ops::toInt(Ops::madd(v, table, half), index);
+            dst[p * 4 + 0] = to_srgb[index[0]];
+            dst[p * 4 + 1] = to_srgb[index[1]];
+            dst[p * 4 + 2] = to_srgb[index[2]];
+        }
+    }
+}
+
+void image_decode(const Image8& in, ImageEncoding encoding, ImageF& out) {
+    out.width = in.width;
+    out.height = in.height;
+    out.pixels.resize((size_t)in.width * in.height * 4);
+    for_rows(in.height, in.width, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) decode_rows<SimdOps>(in, encoding, out, begin, end);
+        else decode_rows<ScalarOps>(in, encoding, out, begin, end);
+    });
+}
+
+void image_encode(const ImageF& in, ImageEncoding encoding, Image8& out) {
+    out.width = in.width;
+    out.height = in.height;
+    out.pixels.resize((size_t)in.width * in.height * 4);
+    for_rows(in.height, in.width, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) encode_rows<SimdOps>(in, encoding, out, begin, end);
+        else encode_rows<ScalarOps>(in, encoding, out, begin, end);
+    });
+}
+
+// Premultiply
+
+template <typename Ops>
+static void premultiply_rows(ImageF& image, uint32_t begin, uint32_t end) {
+    typedef typename Ops::F F;
+    float* pixels = image.pixels.data();
+    size_t first = (size_t)begin * image.width, last = (size_t)end * image.width;
+    // (a, a, a, 1): alpha scales the colour and keeps itself
+    F rgb = Ops::set(1.0f, 1.0f, 1.0f, 0.0f), w = Ops::set(0.0f, 0.0f, 0.0f, 1.0f);
+    for (size_t p = first; p < last; p++) {
+        F v = Ops::load(pixels + p * 4);
+        Ops::store(pixels + p * 4, Ops::mul(v, Ops::madd(Ops::splatW(v), rgb, w)));
+    }
+}
+
+void image_premultiply(ImageF& image) {
+    for_rows(image.height, image.width, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) premultiply_rows<SimdOps>(image, begin, end);
+        else premultiply_rows<ScalarOps>(image, begin, end);
+    });
+}
+
+// Box downscale
+
+template <typename Ops>
+static void box_rows(const ImageF& in, ImageF& out, uint32_t begin, uint32_t end) {
+    typedef typename Ops::F F;
+    F quarter = Ops::splat(0.25f);
+    for (uint32_t y = begin; y < end; y++) {
+        const float* row0 = in.pixels.data() + (size_t)std::min(2 * (int)y, in.height - 1) * in.width * 4;
+        const float* row1 = in.pixels.data() + (size_t)std::min(2 * (int)y + 1, in.height - 1) * in.width * 4;
+        float* dst = out.pixels.data() + (size_t)y * out.width * 4;
+        for (int x = 0; x < out.width; x++) {
+            int x0 = std::min(2 * x, in.width - 1) * 4;
+            int x1 = std::min(2 * x + 1, in.width - 1) * 4;
+            F sum = Ops::add(Ops::add(Ops::load(row0 + x0), Ops::load(row0 + x1)),
+                             Ops::add(Ops::load(row1 + x0), Ops::load(row1 + x1)));
+            Ops::store(dst + x * 4, Ops::mul(sum, quarter));
+        }
+    }
+}
+
+void image_downscale_box(const ImageF& in, ImageF& out) {
+    out.width = std::max(in.width / 2, 1);
+    out.height = std::max(in.height / 2, 1);
+    out.pixels.resize((size_t)out.width * out.height * 4);
+    for_rows(out.height, out.width * 4, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) box_rows<SimdOps>(in, out, begin, end);
+        else box_rows<ScalarOps>(in, out, begin, end);
+    });
+}
+
+// Kaiser downscale
+
+// Modified Bessel function of the first kind, order 0 (power series)
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    double q = x * x * 0.25;
+    for (int k = 1; k < 64 && term > sum * 1e-12; k++) {
+        term *= q / ((double)k * k);
+        sum += term;
+    }
+    return sum;
+}
+
+// Kaiser-windowed sinc at x output pixels from the centre, without the
+// window's 1 / I0(alpha) (the taps are normalised anyway)
+static double kaiser(double x, double radius, double alpha) {
+    if (fabs(x) >= radius) {
+        return 0.0;
+    }
+    double sinc = x == 0.0 ? 1.0 : sin(M_PI * x) / (M_PI * x);
+    double t = x / radius;
+    return sinc * bessel_i0(alpha * sqrt(1.0 - t * t));
+}
+
+static void build_taps(int in_size, int out_size, float radius, float alpha, FilterTaps& taps) {
+    double scale = std::max((double)in_size / out_size, 1.0);
+    double support = radius * scale;        // in input pixels
+    taps.max_taps = (int)ceil(support * 2.0) + 1;
+    taps.indices.assign((size_t)out_size * taps.max_taps, 0);
+    taps.weights.assign((size_t)out_size * taps.max_taps, 0.0f);
+
+    // Weights depend only on where the centre falls between input pixels,
+    // which repeats every output pixel or few for the usual ratios
+    std::vector<double> weights;
+    double sum = 0.0, last_phase = -1.0;
+    int last_count = -1;
+    for (int o = 0; o < out_size; o++) {
+        double centre = (o + 0.5) * ((double)in_size / out_size);
+        int first = (int)ceil(centre - support - 0.5);
+        int count = std::min((int)floor(centre + support - 0.5) - first + 1, taps.max_taps);
+        double phase = first + 0.5 - centre;
+        if (count != last_count || fabs(phase - last_phase) > 1e-9) {
+            weights.resize((size_t)std::max(count, 0));
+            sum = 0.0;
+            for (int t = 0; t < count; t++) {
+                weights[t] = kaiser((phase + t) / scale, radius, alpha);
+                sum += weights[t];
+            }
+            last_phase = phase;
+            last_count = count;
+        }
+        for (int t = 0; t < count; t++) {
+            // Past the edge the edge pixel repeats
+            taps.indices[(size_t)o * taps.max_taps + t] = std::min(std::max(first + t, 0), in_size - 1);
+            taps.weights[(size_t)o * taps.max_taps + t] = (float)(sum != 0.0 ? weights[t] / sum : 0.0);
+        }
+    }
+}
+
+// Each output row: the vertical taps into one full-width line, then the
+// horizontal taps from that line. The tap rows overlap from one output row
+// to the next, so they stay in cache, and there is no intermediate image
+template <typename Ops>
+static void kaiser_rows(const ImageF& in, const FilterTaps& horizontal, const FilterTaps& vertical, ImageF& out,
+                        uint32_t begin, uint32_t end) {
+    typedef typename Ops::F F;
+    int floats = in.width * 4;
+    std::vector<float> line((size_t)floats);
+    std::vector<const float*> rows((size_t)vertical.max_taps);
+    for (uint32_t y = begin; y < end; y++) {
+        const int* index = &vertical.indices[(size_t)y * vertical.max_taps];
+        const float* weight = &vertical.weights[(size_t)y * vertical.max_taps];
+        for (int t = 0; t < vertical.max_taps; t++) {
+            rows[t] = in.pixels.data() + (size_t)index[t] * floats;
+        }
+        // Four pixels at a time: four independent chains of adds
+        int x = 0;
+        for (; x + 16 <= floats; x += 16) {
+            F w = Ops::splat(weight[0]);
+            F sum0 = Ops::mul(Ops::load(rows[0] + x), w), sum1 = Ops::mul(Ops::load(rows[0] + x + 4), w);
+            F sum2 = Ops::mul(Ops::load(rows[0] + x + 8), w), sum3 = Ops::mul(Ops::load(rows[0] + x + 12), w);
+            for (int t = 1; t < vertical.max_taps; t++) {
+                w = Ops::splat(weight[t]);
+                sum0 = Ops::madd(Ops::load(rows[t] + x), w, sum0);
+                sum1 = Ops::madd(Ops::load(rows[t] + x + 4), w, sum1);
+                sum2 = Ops::madd(Ops::load(rows[t] + x + 8), w, sum2);
+                sum3 = Ops::madd(Ops::load(rows[t] + x + 12), w, sum3);
+            }
+            Ops::store(&line[x], sum0);
+            Ops::store(&line[x + 4], sum1);
+            Ops::store(&line[x + 8], sum2);
+            Ops::store(&line[x + 12], sum3);
+        }
+        for (; x < floats; x += 4) {
+            F sum = Ops::mul(Ops::load(rows[0] + x), Ops::splat(weight[0]));
+            for (int t = 1; t < vertical.max_taps; t++) {
+                sum = Ops::madd(Ops::load(rows[t] + x), Ops::splat(weight[t]), sum);
+            }
+            Ops::store(&line[x], sum);
+        }
+
+        // Likewise four output pixels at a time, each with its own taps
+        float* dst = out.pixels.data() + (size_t)y * out.width * 4;
+        int taps = horizontal.max_taps;
+        for (x = 0; x + 4 <= out.width; x += 4) {
+            index = &horizontal.indices[(size_t)x * taps];
+            weight = &horizontal.weights[(size_t)x * taps];
+            F sum0 = Ops::splat(0.0f), sum1 = sum0, sum2 = sum0, sum3 = sum0;
+            for (int t = 0; t < taps; t++) {
+                sum0 = Ops::madd(Ops::load(&line[index[t] * 4]), Ops::splat(weight[t]), sum0);
+                sum1 = Ops::madd(Ops::load(&line[index[taps + t] * 4]), Ops::splat(weight[taps + t]), sum1);
+                sum2 = Ops::madd(Ops::load(&line[index[2 * taps + t] * 4]), Ops::splat(weight[2 * taps + t]), sum2);
+                sum3 = Ops::madd(Ops::load(&line[index[3 * taps + t] * 4]), Ops::splat(weight[3 * taps + t]), sum3);
+            }
+            Ops::store(dst + x * 4, sum0);
+            Ops::store(dst + x * 4 + 4, sum1);
+            Ops::store(dst + x * 4 + 8, sum2);
+            Ops::store(dst + x * 4 + 12, sum3);
+        }
+        for (; x < out.width; x++) {
+            index = &horizontal.indices[(size_t)x * taps];
+            weight = &horizontal.weights[(size_t)x * taps];
+            F sum = Ops::splat(0.0f);
+            for (int t = 0; t < taps; t++) {
+                sum = Ops::madd(Ops::load(&line[index[t] * 4]), Ops::splat(weight[t]), sum);
+            }
+            Ops::store(dst + x * 4, sum);
+        }
+    }
+}
+
+void image_downscale_kaiser(const ImageF& in, int width, int height, ImageF& out, float radius, float alpha) {
+    width = std::min(std::max(width, 1), std::max(in.width, 1));
+    height = std::min(std::max(height, 1), std::max(in.height, 1));
+    FilterTaps horizontal, vertical;
+    build_taps(in.width, width, radius, alpha, horizontal);
+    build_taps(in.height, height, radius, alpha, vertical);
+
+    out.width = width;
+    out.height = height;
+    out.pixels.resize((size_t)width * height * 4);
+    for_rows(height, in.width * vertical.max_taps, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) kaiser_rows<SimdOps>(in, horizontal, vertical, out, begin, end);
+        else kaiser_rows<ScalarOps>(in, horizontal, vertical, out, begin, end);
+    });
+}
+
+// Normal renormalisation
+
+// Four pixels as x, y, z, w vectors (structure of arrays)
+template <typename Ops>
+static void renormalize4(float* p) {
+    typedef typename Ops::F F;
+    F x = Ops::load(p), y = Ops::load(p + 4), z = Ops::load(p + 8), w = Ops::load(p + 12);
+    Ops::transpose(x, y, z, w);
+
+    F zero = Ops::splat(0.0f), one = Ops::splat(1.0f), epsilon = Ops::splat(1e-12f);
+    F length2 = Ops::madd(x, x, Ops::madd(y, y, Ops::mul(z, z)));
+    x = Ops::selectLess(length2, epsilon, zero, x);
+    y = Ops::selectLess(length2, epsilon, zero, y);
+    z = Ops::selectLess(length2, epsilon, one, z);
+    length2 = Ops::selectLess(length2, epsilon, one, length2);
+    F scale = Ops::div(one, Ops::sqrt(length2));
+    x = Ops::mul(x, scale);
+    y = Ops::mul(y, scale);
+    z = Ops::mul(z, scale);
+
+    Ops::transpose(x, y, z, w);
+    Ops::store(p, x);
+    Ops::store(p + 4, y);
+    Ops::store(p + 8, z);
+    Ops::store(p + 12, w);
+}
+
+template <typename Ops>
+static void renormalize_rows(ImageF& image, uint32_t begin, uint32_t end) {
+    size_t first = (size_t)begin * image.width, last = (size_t)end * image.width;
+    float* pixels = image.pixels.data();
+    size_t p = first;
+    for (; p + 4 <= last; p += 4) {
+        renormalize4<Ops>(pixels + p * 4);
+    }
+    for (; p < last; p++) {
+        float* n = pixels + p * 4;
+        float length2 = n[0] * n[0] + n[1] * n[1] + n[2] * n[2];
+        if (!(length2 >= 1e-12f)) {
+            n[0] = n[1] = 0.0f;
+            n[2] = 1.0f;
+            continue;
+        }
+        float scale = 1.0f / std::sqrt(length2);
+        n[0] *= scale;
+        n[1] *= scale;
+        n[2] *= scale;
+    }
+}
+
+void image_renormalize(ImageF& image) {
+    for_rows(image.height, image.width, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) renormalize_rows<SimdOps>(image, begin, end);
+        else renormalize_rows<ScalarOps>(image, begin, end);
+    });
+}
+
+// Channel packing
+
+// Pixels are little-endian RGBA: channel c is bits [8c, 8c + 8)
+template <typename Ops>
+static void pack_rows(const ChannelSource* sources, int width, Image8& out, uint32_t begin, uint32_t end) {
+    typedef typename Ops::U U;
+    size_t first = (size_t)begin * width, last = (size_t)end * width;
+    uint8_t* dst = out.pixels.data();
+    U mask = Ops::splatU(0xff);
+    uint32_t constants = 0;
+    for (int c = 0; c < 4; c++) {
+        if (!sources[c].image) constants |= (uint32_t)sources[c].value << (8 * c);
+    }
+
+    size_t p = first;
+    for (; p + 4 <= last; p += 4) {
+        U packed = Ops::splatU(constants);
+        for (int c = 0; c < 4; c++) {
+            if (!sources[c].image) continue;
+            U v = Ops::loadU(sources[c].image->pixels.data() + p * 4);
+            v = Ops::andU(Ops::srl(v, 8 * sources[c].channel), mask);
+            packed = Ops::orU(packed, Ops::sll(v, 8 * c));
+        }
+        Ops::storeU(dst + p * 4, packed);
+    }
+    for (; p < last; p++) {
+        for (int c = 0; c < 4; c++) {
+            const ChannelSource& source = sources[c];
+            dst[p * 4 + c] = source.image ? source.image->pixels[p * 4 + source.channel] : source.value;
+        }
+    }
+}
+
+bool image_pack_channels(const ChannelSource sources[4], int width, int height, Image8& out) {
+    ChannelSource checked[4];
+    for (int c = 0; c < 4; c++) {
+        checked[c] = sources[c];
+        if (checked[c].image && (checked[c].image->width != width || checked[c].image->height != height)) {
+            return false;
+        }
+        checked[c].channel = std::min(std::max(checked[c].channel, 0), 3);
+    }
+    out.width = width;
+    out.height = height;
+    out.pixels.resize((size_t)width * height * 4);
+    for_rows(height, width, [&](uint32_t begin, uint32_t end) {
+        if (s_simd) pack_rows<SimdOps>(checked, width, out, begin, end);
+        else pack_rows<ScalarOps>(checked, width, out, begin, end);
+    });
+    return true;
+}
+
+void image_set_simd(bool enabled) {
+    s_simd = enabled && SIMD_AVAILABLE;
+}
+
+bool image_get_simd() {
+    return s_simd;
+}
+
+const char* image_simd_name() {
+    return s_simd ? SIMD_NAME : "scalar";
+}
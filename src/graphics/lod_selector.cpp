@@ -0,0 +1,47 @@
+#include "graphics/lod_selector.h"
+#include <cmath>
+
+LodSelector::LodSelector() : pixels_per_unit(1.0f), threshold(1.0f), hysteresis(0.25f) {
+    setProjection(67.0f, 480.0f);
+}
+
+void LodSelector::setProjection(float fovy_degrees, float viewport_height) {
+    pixels_per_unit = viewport_height / (2.0f * tanf(fovy_degrees * ONE_DEG_IN_RAD * 0.5f));
+}
+
+float LodSelector::screenError(float object_error, float distance) const {
+    return object_error * pixels_per_unit / distance;
+}
+
+int LodSelector::coarsestWithin(const MeshLod* lods, int lod_count, float distance, float pixels) const {
+    int best = 0;
+    for (int i = 1; i < lod_count; i++) {
+        if (screenError(lods[i].error, distance) > pixels) break;
+        best = i;
+    }
+    return best;
+}
+
+int LodSelector::select(const MeshLod* lods, int lod_count, float distance, int current) const {
+    if (lod_count <= 1) {
+        return 0;
+    }
+    int allowed = coarsestWithin(lods, lod_count, distance, threshold);
+    if (current < 0 || current >= lod_count || allowed < current) {
+        return allowed;
+    }
+    int coarser = coarsestWithin(lods, lod_count, distance, threshold * (1.0f - hysteresis));
+    return coarser > current ? coarser : current;
+}
+
+float lod_distance(const vec3& eye, const AABB& box) {
+    float sq = 0.0f;
+    for (int i = 0; i < 3; i++) {
+        float d = 0.0f;
+        if (eye.v[i] < box.min.v[i]) d = box.min.v[i] - eye.v[i];
+        else if (eye.v[i] > box.max.v[i]) d = eye.v[i] - box.max.v[i];
+        sq += d * d;
+    }
+    float distance = sqrtf(sq);
+    return distance > 1e-3f ? distance : 1e-3f;
+}
@@ -0,0 +1,219 @@
+#include "graphics/mesh.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_simplifier.h"
+#include "utils/log.h"
+#include "utils/obj_loader.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+static void log_optimize_stats(const char* name, const MeshOptimizeStats& stats) {
+    gl_log("Optimised %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %u -> %u vertices, %d clusters\n",
+           name, stats.before.acmr, stats.after.acmr, stats.before.atvr, stats.after.atvr,
+           stats.vertices_before, stats.vertices_after, stats.clusters);
+}
+
+Mesh::Mesh()
+    : vao(0), ibo(0), vertex_count(0), index_count(0), index_type(GL_UNSIGNED_INT), vertex_bytes(0),
+      loaded(false) {}
+
+Mesh::~Mesh() {
+    release();
+}
+
+void Mesh::release() {
+    if (!loaded) {
+        return;
+    }
+    for (GLuint& vbo : vbos) {
+        gpu_release_buffer(vbo);
+    }
+    gpu_release_buffer(ibo);
+    gpu_release_vertex_array(vao);
+    vbos.clear();
+    loaded = false;
+}
+
+void Mesh::beginUpload(uint32_t stream_count, const char* label) {
+    release();
+    vao = gpu_create_vertex_array(label);
+    glBindVertexArray(vao);
+    vertex_bytes = 0;
+    dequant = VertexDequant();
+    vbos.resize(stream_count);
+    for (GLuint& vbo : vbos) {
+        vbo = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, label);
+    }
+    ibo = gpu_create_buffer(RESOURCE_INDEX_BUFFER, label);
+}
+
+void Mesh::uploadStream(uint32_t i, uint32_t location, uint32_t components, uint32_t type, bool normalized,
+                        size_t size, const void* data) {
+    gpu_buffer_data(vbos[i], GL_ARRAY_BUFFER, (GLsizeiptr)size, data, GL_STATIC_DRAW);
+    glVertexAttribPointer(location, (GLint)components, (GLenum)type, normalized ? GL_TRUE : GL_FALSE,
+                          (GLsizei)(components * mesh_type_size(type)), nullptr);
+    glEnableVertexAttribArray(location);
+    vertex_bytes += size;
+}
+
+void Mesh::endUpload(size_t index_bytes, const void* indices) {
+    // The VAO is still bound, so it records the index buffer
+    gpu_buffer_data(ibo, GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)index_bytes, indices, GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    loaded = true;
+}
+
+bool Mesh::loadFromFile(const char* filename) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    MeshFileView file;
+    if (!file.open(filename)) {
+        std::cerr << "ERROR: Could not load mesh: " << filename << std::endl;
+        return false;
+    }
+
+    const MeshFileHeader* header = file.header();
+
+    // Not optimised offline: copy out, optimise, upload from memory
+    if (!(header->flags & MESH_FLAG_OPTIMIZED)) {
+        MeshData data;
+        data.vertex_count = header->vertex_count;
+        data.flags = header->flags;
+        memcpy(data.bounds_min, header->bounds_min, sizeof(data.bounds_min));
+        memcpy(data.bounds_max, header->bounds_max, sizeof(data.bounds_max));
+        for (uint32_t i = 0; i < header->stream_count; i++) {
+            const MeshStreamDesc& desc = file.streams()[i];
+            const uint8_t* bytes = (const uint8_t*)file.streamData(i);
+            data.streams.push_back({desc.location, desc.components, desc.type, desc.normalized != 0,
+                                    std::vector<uint8_t>(bytes, bytes + desc.size)});
+        }
+        data.indices.resize(header->index_count);
+        if (header->index_type == MESH_TYPE_UNSIGNED_SHORT) {
+            const uint16_t* narrow = (const uint16_t*)file.indexData();
+            for (uint32_t i = 0; i < header->index_count; i++) data.indices[i] = narrow[i];
+        } else {
+            memcpy(data.indices.data(), file.indexData(), file.indexDataSize());
+        }
+        data.submeshes.assign(file.submeshes(), file.submeshes() + header->submesh_count);
+        data.lods.assign(file.lods(), file.lods() + header->lod_count);
+
+        generate_lods(data);
+        MeshOptimizeStats stats;
+        optimize_mesh(data, &stats);
+        log_optimize_stats(filename, stats);
+        return loadFromData(data, filename);
+    }
+
+    vertex_count = (GLsizei)header->vertex_count;
+    index_count = (GLsizei)header->index_count;
+    index_type = header->index_type == MESH_TYPE_UNSIGNED_SHORT ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    bounds = AABB(vec3(header->bounds_min[0], header->bounds_min[1], header->bounds_min[2]),
+                  vec3(header->bounds_max[0], header->bounds_max[1], header->bounds_max[2]));
+    submeshes.assign(file.submeshes(), file.submeshes() + header->submesh_count);
+    lods.assign(file.lods(), file.lods() + header->lod_count);
+
+    // One VBO per stream, filled straight from the mapped pages
+    beginUpload(header->stream_count, filename);
+    for (uint32_t i = 0; i < header->stream_count; i++) {
+        const MeshStreamDesc& stream = file.streams()[i];
+        uploadStream(i, stream.location, stream.components, stream.type, stream.normalized != 0,
+                     (size_t)stream.size, file.streamData(i));
+    }
+    endUpload(file.indexDataSize(), file.indexData());
+
+    double ms = ms_since(start);
+    gl_log("Loaded mesh %s: %d vertices, %d indices, %u streams in %.3f ms\n",
+           filename, vertex_count, index_count, header->stream_count, ms);
+    std::cout << "Loaded mesh: " << filename << " (" << vertex_count << " vertices, "
+              << index_count / 3 << " triangles) in " << ms << " ms" << std::endl;
+    return true;
+}
+
+bool Mesh::loadFromObj(const char* filename, bool optimize, const VertexFormat* format) {
+    ObjMesh obj;
+    if (!load_obj(filename, obj)) {
+        std::cerr << "ERROR: Could not load mesh: " << filename << std::endl;
+        return false;
+    }
+
+    MeshData data;
+    obj_to_mesh_data(obj, data);
+    if (optimize) {
+        generate_lods(data);
+        MeshOptimizeStats stats;
+        optimize_mesh(data, &stats);
+        log_optimize_stats(filename, stats);
+    }
+    return loadFromData(data, filename, format);
+}
+
+bool Mesh::loadFromData(const MeshData& data, const char* name, const VertexFormat* format) {
+    vertex_count = (GLsizei)data.vertex_count;
+    index_count = (GLsizei)data.indices.size();
+    index_type = GL_UNSIGNED_INT;
+    bounds = AABB(vec3(data.bounds_min[0], data.bounds_min[1], data.bounds_min[2]),
+                  vec3(data.bounds_max[0], data.bounds_max[1], data.bounds_max[2]));
+    submeshes = data.submeshes;
+    lods = data.lods;
+
+    if (format) {
+        // Interleave the float streams into one quantized VBO
+        VertexSource source;
+        size_t float_bytes = 0;
+        source.vertex_count = data.vertex_count;
+        for (const MeshData::Stream& stream : data.streams) {
+            if (stream.type != MESH_TYPE_FLOAT || stream.location >= VERTEX_SEMANTIC_COUNT) continue;
+            source.data[stream.location] = (const float*)stream.data.data();
+            source.components[stream.location] = (int)stream.components;
+            if (format->find((VertexSemantic)stream.location)) float_bytes += stream.data.size();
+        }
+
+        std::vector<uint8_t> packed;
+        VertexDequant packed_dequant;
+        pack_vertices(*format, source, packed, &packed_dequant);
+
+        beginUpload(1, name);
+        dequant = packed_dequant;
+        gpu_buffer_data(vbos[0], GL_ARRAY_BUFFER, (GLsizeiptr)packed.size(), packed.data(), GL_STATIC_DRAW);
+        format->apply();
+        vertex_bytes = packed.size();
+        gl_log("Packed mesh %s: %u bytes/vertex, %zu -> %zu vertex bytes\n", name, format->stride(),
+               float_bytes, vertex_bytes);
+    } else {
+        beginUpload((uint32_t)data.streams.size(), name);
+        for (uint32_t i = 0; i < data.streams.size(); i++) {
+            const MeshData::Stream& stream = data.streams[i];
+            uploadStream(i, stream.location, stream.components, stream.type, stream.normalized,
+                         stream.data.size(), stream.data.data());
+        }
+    }
+    endUpload(data.indices.size() * sizeof(uint32_t), data.indices.data());
+
+    gl_log("Loaded mesh %s: %d vertices, %d indices\n", name, vertex_count, index_count);
+    std::cout << "Loaded mesh: " << name << " (" << vertex_count << " vertices, "
+              << index_count / 3 << " triangles)" << std::endl;
+    return true;
+}
+
+void Mesh::drawRange(uint32_t index_offset, uint32_t count) {
+    size_t index_size = index_type == GL_UNSIGNED_SHORT ? 2 : 4;
+    glBindVertexArray(vao);
+    glDrawElements(GL_TRIANGLES, (GLsizei)count, index_type, (const void*)(index_offset * index_size));
+}
+
+void Mesh::draw() {
+    drawRange(0, lods.empty() ? (uint32_t)index_count : lods[0].index_count);
+}
+
+void Mesh::drawSubmesh(int submesh) {
+    drawRange(submeshes[submesh].index_offset, submeshes[submesh].index_count);
+}
+
+void Mesh::drawLod(int lod) {
+    drawRange(lods[lod].index_offset, lods[lod].index_count);
+}
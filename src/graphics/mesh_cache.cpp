@@ -0,0 +1,454 @@
+#include "graphics/mesh_cache.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_simplifier.h"
+#include "utils/log.h"
+#include "utils/obj_loader.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// First-fit allocator over [0, capacity) in elements, free ranges kept
+// sorted and merged on free
+class RangeAllocator {
+public:
+    explicit RangeAllocator(uint32_t capacity = 0) : capacity(capacity), used(0) {
+        if (capacity) free_ranges.push_back({0, capacity});
+    }
+
+    bool alloc(uint32_t count, uint32_t& offset) {
+        for (size_t i = 0; i < free_ranges.size(); i++) {
+            Range& range = free_ranges[i];
+            if (range.count >= count) {
+                offset = range.offset;
+                range.offset += count;
+                range.count -= count;
+                if (range.count == 0) free_ranges.erase(free_ranges.begin() + i);
+                used += count;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void free(uint32_t offset, uint32_t count) {
+        auto it = std::lower_bound(free_ranges.begin(), free_ranges.end(), offset,
+                                   [](const Range& r, uint32_t value) { return r.offset < value; });
+        it = free_ranges.insert(it, {offset, count});
+        used -= count;
+        // Merge with the next range, then with the previous one
+        auto next = it + 1;
+        if (next != free_ranges.end() && it->offset + it->count == next->offset) {
+            it->count += next->count;
+            free_ranges.erase(next);
+        }
+        if (it != free_ranges.begin()) {
+            auto prev = it - 1;
+            if (prev->offset + prev->count == it->offset) {
+                prev->count += it->count;
+                free_ranges.erase(it);
+            }
+        }
+    }
+
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getUsed() const { return used; }
+
+private:
+    struct Range {
+        uint32_t offset;
+        uint32_t count;
+    };
+
+    std::vector<Range> free_ranges;
+    uint32_t capacity;
+    uint32_t used;
+};
+
+struct MeshCache::Page {
+    VertexFormat format;
+    uint64_t format_key;
+    GLuint vbo;
+    GLuint ibo;
+    GLuint vao;
+    RangeAllocator vertices;
+    RangeAllocator indices;
+    int meshes;
+};
+
+// FNV-1a, 64 bit
+static uint64_t hash_bytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Second, unrelated hash (64-bit words, multiply and xor-shift) so two
+// meshes are only shared when both agree
+static uint64_t hash_words(const void* data, size_t size, uint64_t hash = 0x9E3779B97F4A7C15ull) {
+    const uint8_t* bytes = (const uint8_t*)data;
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, std::min<size_t>(8, size - i));
+        hash = (hash ^ word) * 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 31;
+    }
+    return (hash ^ size) * 0x94D049BB133111EBull;
+}
+
+static uint64_t format_key(const VertexFormat& format) {
+    uint64_t hash = hash_bytes(nullptr, 0);
+    for (int i = 0; i < format.attribCount(); i++) {
+        const VertexAttrib& a = format.attrib(i);
+        uint32_t fields[3] = {(uint32_t)a.semantic, (uint32_t)a.encoding, a.location};
+        hash = hash_bytes(fields, sizeof(fields), hash);
+    }
+    return hash;
+}
+
+MeshCache& MeshCache::instance() {
+    static MeshCache cache;
+    return cache;
+}
+
+MeshCache::MeshCache() : draw_index_buffer(0), references(0), hits(0), uploads(0) {}
+
+MeshCache::~MeshCache() {}
+
+MeshHandle MeshCache::load(const char* path, const VertexFormat& format) {
+    char key[32];
+    snprintf(key, sizeof(key), "#%016llx", (unsigned long long)format_key(format));
+    std::string path_key = std::string(path) + key;
+    auto found = by_path.find(path_key);
+    if (found != by_path.end()) {
+        return acquire(MeshHandle(found->second));
+    }
+
+    MeshHandle handle;
+    size_t length = strlen(path);
+    if (length > 6 && strcmp(path + length - 6, ".amesh") == 0) {
+        // Float streams straight from the mapping; 16-bit indices are widened
+        MeshFileView file;
+        if (!file.open(path)) {
+            std::cerr << "ERROR: Could not load mesh: " << path << std::endl;
+            return MeshHandle();
+        }
+        const MeshFileHeader* header = file.header();
+        VertexSource source;
+        source.vertex_count = header->vertex_count;
+        for (uint32_t i = 0; i < header->stream_count; i++) {
+            const MeshStreamDesc& stream = file.streams()[i];
+            if (stream.type != MESH_TYPE_FLOAT || stream.location >= VERTEX_SEMANTIC_COUNT) continue;
+            source.data[stream.location] = (const float*)file.streamData(i);
+            source.components[stream.location] = (int)stream.components;
+        }
+        std::vector<uint32_t> indices(header->index_count);
+        if (header->index_type == MESH_TYPE_UNSIGNED_SHORT) {
+            const uint16_t* narrow = (const uint16_t*)file.indexData();
+            for (uint32_t i = 0; i < header->index_count; i++) indices[i] = narrow[i];
+        } else {
+            memcpy(indices.data(), file.indexData(), file.indexDataSize());
+        }
+        std::vector<MeshSubmesh> submeshes(file.submeshes(), file.submeshes() + header->submesh_count);
+        std::vector<MeshLod> lods(file.lods(), file.lods() + header->lod_count);
+        handle = insert(source, indices.data(), header->index_count, format, path, submeshes, lods);
+    } else {
+        ObjMesh obj;
+        if (!load_obj(path, obj)) {
+            std::cerr << "ERROR: Could not load mesh: " << path << std::endl;
+            return MeshHandle();
+        }
+        MeshData data;
+        obj_to_mesh_data(obj, data);
+        generate_lods(data);
+        optimize_mesh(data);
+        handle = add(data, format, path);
+    }
+
+    // A different path with the same content shares the entry; the first
+    // path stays its key
+    Entry* entry = entries.get(handle.id);
+    if (entry && entry->path.empty()) {
+        entry->path = path_key;
+        by_path[path_key] = handle.id;
+    }
+    return handle;
+}
+
+MeshHandle MeshCache::add(const MeshData& data, const VertexFormat& format, const char* name) {
+    VertexSource source;
+    source.vertex_count = data.vertex_count;
+    for (const MeshData::Stream& stream : data.streams) {
+        if (stream.type != MESH_TYPE_FLOAT || stream.location >= VERTEX_SEMANTIC_COUNT) continue;
+        source.data[stream.location] = (const float*)stream.data.data();
+        source.components[stream.location] = (int)stream.components;
+    }
+    return insert(source, data.indices.data(), (uint32_t)data.indices.size(), format, name, data.submeshes,
+                  data.lods);
+}
+
+MeshHandle MeshCache::add(const VertexSource& source, const uint32_t* indices, uint32_t index_count,
+                          const VertexFormat& format, const char* name) {
+    return insert(source, indices, index_count, format, name, std::vector<MeshSubmesh>(), std::vector<MeshLod>());
+}
+
+MeshHandle MeshCache::insert(const VertexSource& source, const uint32_t* indices, uint32_t index_count,
+                             const VertexFormat& format, const char* name, const std::vector<MeshSubmesh>& submeshes,
+                             const std::vector<MeshLod>& lods) {
+    std::vector<uint8_t> packed;
+    VertexDequant dequant;
+    pack_vertices(format, source, packed, &dequant);
+
+    // The format and LOD table are part of the key: the same positions
+    // packed differently, or split differently, are different meshes
+    uint64_t fkey = format_key(format);
+    uint64_t key = hash_bytes(&fkey, sizeof(fkey));
+    key = hash_bytes(packed.data(), packed.size(), key);
+    key = hash_bytes(indices, index_count * sizeof(uint32_t), key);
+    if (!lods.empty()) key = hash_bytes(lods.data(), lods.size() * sizeof(MeshLod), key);
+    if (!submeshes.empty()) key = hash_bytes(submeshes.data(), submeshes.size() * sizeof(MeshSubmesh), key);
+    uint64_t check = hash_words(packed.data(), packed.size());
+    check = hash_words(indices, index_count * sizeof(uint32_t), check);
+    if (!lods.empty()) check = hash_words(lods.data(), lods.size() * sizeof(MeshLod), check);
+    if (!submeshes.empty()) check = hash_words(submeshes.data(), submeshes.size() * sizeof(MeshSubmesh), check);
+
+    // Share only when the sizes and the second hash agree too; on a
+    // collision the new mesh gets its own copy and stays out of by_key
+    auto found = by_key.find(key);
+    bool collision = false;
+    if (found != by_key.end()) {
+        const Entry* existing = entries.get(found->second);
+        if (existing->format == fkey && existing->check == check &&
+            existing->mesh.vertex_count == (uint32_t)source.vertex_count && existing->index_total == index_count &&
+            existing->mesh.lods.size() == lods.size() && existing->mesh.submeshes.size() == submeshes.size()) {
+            return acquire(MeshHandle(found->second));
+        }
+        collision = true;
+        gl_log_err("WARNING: mesh cache key collision for %s, uploading a separate copy\n", name);
+    }
+
+    uint32_t vertex_count = (uint32_t)source.vertex_count;
+    uint32_t vertex_offset = 0, index_offset = 0;
+    uint32_t page_index = findPage(format, vertex_count, index_count, vertex_offset, index_offset);
+    Page& page = *pages[page_index];
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.vbo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)vertex_offset * format.stride(), (GLsizeiptr)packed.size(),
+                    packed.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, page.ibo);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)index_offset * sizeof(uint32_t),
+                    (GLsizeiptr)index_count * sizeof(uint32_t), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    Entry entry;
+    CachedMesh& mesh = entry.mesh;
+    mesh.vao = page.vao;
+    mesh.page = page_index;
+    mesh.first_index = index_offset;
+    mesh.base_vertex = (int32_t)vertex_offset;
+    mesh.index_count = lods.empty() ? index_count : lods[0].index_count;
+    mesh.vertex_count = vertex_count;
+    mesh.dequant = dequant;
+    mesh.submeshes = submeshes;
+    mesh.lods = lods;
+
+    vec3 lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    const float* positions = source.data[VERTEX_POSITION];
+    int components = source.components[VERTEX_POSITION];
+    for (uint32_t i = 0; positions && i < vertex_count; i++) {
+        const float* p = positions + (size_t)i * components;
+        for (int c = 0; c < 3 && c < components; c++) {
+            lo.v[c] = std::min(lo.v[c], p[c]);
+            hi.v[c] = std::max(hi.v[c], p[c]);
+        }
+    }
+    mesh.bounds = positions && vertex_count ? AABB(lo, hi) : AABB(vec3(0.0f, 0.0f, 0.0f), vec3(0.0f, 0.0f, 0.0f));
+
+    entry.key = key;
+    entry.check = check;
+    entry.format = fkey;
+    entry.index_total = index_count;
+    entry.refs = 1;
+    uint32_t id = entries.insert(entry);
+    if (!collision) {
+        by_key[key] = id;
+    }
+    page.meshes++;
+    references++;
+    uploads++;
+
+    gl_log("Mesh cache: %s on page %u, %u vertices at %u, %u indices at %u\n", name, page_index, vertex_count,
+           vertex_offset, index_count, index_offset);
+    return MeshHandle(id);
+}
+
+uint32_t MeshCache::findPage(const VertexFormat& format, uint32_t vertex_count, uint32_t index_count,
+                             uint32_t& vertex_offset, uint32_t& index_offset) {
+    uint64_t key = format_key(format);
+    int free_slot = -1;
+    for (size_t i = 0; i < pages.size(); i++) {
+        Page* page = pages[i].get();
+        if (!page) {
+            if (free_slot < 0) free_slot = (int)i;
+            continue;
+        }
+        if (page->format_key != key || !page->vertices.alloc(vertex_count, vertex_offset)) {
+            continue;
+        }
+        if (page->indices.alloc(index_count, index_offset)) {
+            return (uint32_t)i;
+        }
+        page->vertices.free(vertex_offset, vertex_count);
+    }
+
+    // New page, large enough for this mesh
+    std::unique_ptr<Page> page(new Page());
+    page->format = format;
+    page->format_key = key;
+    uint32_t vertex_capacity = std::max(VERTEX_PAGE_BYTES / std::max(format.stride(), 1u), vertex_count);
+    uint32_t index_capacity = std::max(INDEX_PAGE_COUNT, index_count);
+    page->vertices = RangeAllocator(vertex_capacity);
+    page->indices = RangeAllocator(index_capacity);
+    page->meshes = 0;
+
+    page->vbo = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, "mesh cache vertices");
+    gpu_buffer_data(page->vbo, GL_COPY_WRITE_BUFFER, (GLsizeiptr)vertex_capacity * format.stride(), nullptr,
+                    GL_STATIC_DRAW);
+    page->ibo = gpu_create_buffer(RESOURCE_INDEX_BUFFER, "mesh cache indices");
+    gpu_buffer_data(page->ibo, GL_COPY_WRITE_BUFFER, (GLsizeiptr)index_capacity * sizeof(uint32_t), nullptr,
+                    GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    page->vao = format.createVAO(page->vbo, page->ibo);
+
+    // Per-instance draw index 0, 1, 2, ... shared by every page
+    if (!draw_index_buffer) {
+        std::vector<uint32_t> draw_indices(MAX_DRAW_INDEX);
+        for (uint32_t i = 0; i < MAX_DRAW_INDEX; i++) draw_indices[i] = i;
+        draw_index_buffer = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, "mesh cache draw indices");
+        gpu_buffer_data(draw_index_buffer, GL_ARRAY_BUFFER, (GLsizeiptr)(draw_indices.size() * sizeof(uint32_t)),
+                        draw_indices.data(), GL_STATIC_DRAW);
+    }
+    glBindVertexArray(page->vao);
+    glBindBuffer(GL_ARRAY_BUFFER, draw_index_buffer);
+    glVertexAttribIPointer(DRAW_INDEX_LOCATION, 1, GL_UNSIGNED_INT, 0, nullptr);
+    glVertexAttribDivisor(DRAW_INDEX_LOCATION, 1);
+    glEnableVertexAttribArray(DRAW_INDEX_LOCATION);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    page->vertices.alloc(vertex_count, vertex_offset);
+    page->indices.alloc(index_count, index_offset);
+
+    uint32_t index;
+    if (free_slot >= 0) {
+        index = (uint32_t)free_slot;
+        pages[index] = std::move(page);
+    } else {
+        index = (uint32_t)pages.size();
+        pages.push_back(std::move(page));
+    }
+    gl_log("Mesh cache: page %u, %u bytes/vertex, %u vertices, %u indices\n", index, format.stride(),
+           vertex_capacity, index_capacity);
+    return index;
+}
+
+MeshHandle MeshCache::acquire(MeshHandle handle) {
+    Entry* entry = entries.get(handle.id);
+    if (!entry) {
+        return MeshHandle();
+    }
+    entry->refs++;
+    references++;
+    hits++;
+    return handle;
+}
+
+void MeshCache::release(MeshHandle& handle) {
+    uint32_t id = handle.id;
+    handle = MeshHandle();
+    Entry* entry = entries.get(id);
+    if (!entry) {
+        return;
+    }
+    references--;
+    if (--entry->refs > 0) {
+        return;
+    }
+
+    // Last reference: give the ranges back. Frames still in flight only
+    // read them, and GL orders a later glBufferSubData after those draws
+    const CachedMesh& mesh = entry->mesh;
+    uint32_t page_index = mesh.page;
+    Page& page = *pages[page_index];
+    page.vertices.free((uint32_t)mesh.base_vertex, mesh.vertex_count);
+    page.indices.free(mesh.first_index, entry->index_total);
+    page.meshes--;
+
+    auto keyed = by_key.find(entry->key);
+    if (keyed != by_key.end() && keyed->second == id) {
+        by_key.erase(keyed);
+    }
+    if (!entry->path.empty()) {
+        by_path.erase(entry->path);
+    }
+    entries.remove(id);
+
+    if (page.meshes == 0) {
+        gpu_release_vertex_array(page.vao);
+        gpu_release_buffer(page.vbo);
+        gpu_release_buffer(page.ibo);
+        pages[page_index].reset();
+        gl_log("Mesh cache: page %u released\n", page_index);
+
+        bool any_page = false;
+        for (const std::unique_ptr<Page>& p : pages) {
+            any_page = any_page || p != nullptr;
+        }
+        if (!any_page) {
+            gpu_release_buffer(draw_index_buffer);
+        }
+    }
+}
+
+const CachedMesh* MeshCache::get(MeshHandle handle) const {
+    const Entry* entry = entries.get(handle.id);
+    return entry ? &entry->mesh : nullptr;
+}
+
+void MeshCache::draw(MeshHandle handle, int lod) {
+    const Entry* entry = entries.get(handle.id);
+    if (!entry) {
+        return;
+    }
+    const CachedMesh& mesh = entry->mesh;
+    uint32_t first = mesh.first_index, count = mesh.index_count;
+    if (lod >= 0 && lod < (int)mesh.lods.size()) {
+        first += mesh.lods[lod].index_offset;
+        count = mesh.lods[lod].index_count;
+    }
+    glBindVertexArray(mesh.vao);
+    glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)count, GL_UNSIGNED_INT,
+                             (const void*)((size_t)first * sizeof(uint32_t)), mesh.base_vertex);
+}
+
+MeshCache::Stats MeshCache::getStats() const {
+    Stats stats = {};
+    stats.meshes = (int)entries.size();
+    stats.references = references;
+    stats.hits = hits;
+    stats.uploads = uploads;
+    for (const auto& page : pages) {
+        if (!page) continue;
+        stats.pages++;
+        stats.vertex_bytes += (size_t)page->vertices.getUsed() * page->format.stride();
+        stats.vertex_capacity += (size_t)page->vertices.getCapacity() * page->format.stride();
+        stats.index_bytes += (size_t)page->indices.getUsed() * sizeof(uint32_t);
+        stats.index_capacity += (size_t)page->indices.getCapacity() * sizeof(uint32_t);
+    }
+    return stats;
+}
@@ -0,0 +1,280 @@
+#include "graphics/mesh_format.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static uint64_t align_up(uint64_t value) {
+    return (value + MESH_FILE_ALIGNMENT - 1) & ~(uint64_t)(MESH_FILE_ALIGNMENT - 1);
+}
+
+bool write_mesh_file(const char* path, const MeshData& mesh) {
+    bool short_indices = mesh.vertex_count <= 0xFFFF;
+    uint32_t index_size = short_indices ? 2 : 4;
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_FILE_MAGIC;
+    header.version = MESH_FILE_VERSION;
+    header.header_size = sizeof(MeshFileHeader);
+    header.flags = mesh.flags;
+    header.vertex_count = mesh.vertex_count;
+    header.index_count = (uint32_t)mesh.indices.size();
+    header.index_type = short_indices ? MESH_TYPE_UNSIGNED_SHORT : MESH_TYPE_UNSIGNED_INT;
+    header.stream_count = (uint32_t)mesh.streams.size();
+    header.submesh_count = (uint32_t)mesh.submeshes.size();
+    header.lod_count = (uint32_t)mesh.lods.size();
+    memcpy(header.bounds_min, mesh.bounds_min, sizeof(header.bounds_min));
+    memcpy(header.bounds_max, mesh.bounds_max, sizeof(header.bounds_max));
+
+    // Lay out the tables, then each blob on its own aligned offset
+    uint64_t offset = sizeof(MeshFileHeader)
+                    + header.stream_count * sizeof(MeshStreamDesc)
+                    + header.submesh_count * sizeof(MeshSubmesh)
+                    + header.lod_count * sizeof(MeshLod);
+
+    std::vector<MeshStreamDesc> descs(mesh.streams.size());
+    for (size_t i = 0; i < mesh.streams.size(); i++) {
+        const MeshData::Stream& s = mesh.streams[i];
+        MeshStreamDesc& d = descs[i];
+        memset(&d, 0, sizeof(d));
+        d.location = s.location;
+        d.components = s.components;
+        d.type = s.type;
+        d.normalized = s.normalized ? 1 : 0;
+        d.stride = s.components * mesh_type_size(s.type);
+        d.size = s.data.size();
+        offset = align_up(offset);
+        d.offset = offset;
+        offset += d.size;
+    }
+    offset = align_up(offset);
+    header.index_offset = offset;
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        gl_log_err("ERROR: could not open mesh file %s for writing\n", path);
+        return false;
+    }
+
+    static const uint8_t padding[MESH_FILE_ALIGNMENT] = {0};
+    auto pad_to = [&](uint64_t target) {
+        long pos = ftell(file);
+        if ((uint64_t)pos < target) fwrite(padding, 1, (size_t)(target - pos), file);
+    };
+
+    fwrite(&header, sizeof(header), 1, file);
+    if (!descs.empty()) fwrite(descs.data(), sizeof(MeshStreamDesc), descs.size(), file);
+    if (!mesh.submeshes.empty()) fwrite(mesh.submeshes.data(), sizeof(MeshSubmesh), mesh.submeshes.size(), file);
+    if (!mesh.lods.empty()) fwrite(mesh.lods.data(), sizeof(MeshLod), mesh.lods.size(), file);
+
+    for (size_t i = 0; i < mesh.streams.size(); i++) {
+        pad_to(descs[i].offset);
+        fwrite(mesh.streams[i].data.data(), 1, mesh.streams[i].data.size(), file);
+    }
+
+    pad_to(header.index_offset);
+    if (short_indices) {
+        std::vector<uint16_t> narrow(mesh.indices.begin(), mesh.indices.end());
+        fwrite(narrow.data(), index_size, narrow.size(), file);
+    } else {
+        fwrite(mesh.indices.data(), index_size, mesh.indices.size(), file);
+    }
+
+    bool ok = ferror(file) == 0;
+    fclose(file);
+    if (!ok) {
+        gl_log_err("ERROR: failed writing mesh file %s\n", path);
+    }
+    return ok;
+}
+
+MeshFileView::MeshFileView() : data(nullptr), size(0) {}
+
+MeshFileView::~MeshFileView() {
+    close();
+}
+
+bool MeshFileView::open(const char* path) {
+    close();
+
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0) {
+        gl_log_err("ERROR: could not open mesh file %s\n", path);
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(MeshFileHeader)) {
+        gl_log_err("ERROR: mesh file %s is too small\n", path);
+        ::close(fd);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        gl_log_err("ERROR: could not mmap mesh file %s\n", path);
+        return false;
+    }
+
+    data = (const uint8_t*)mapping;
+    size = (size_t)st.st_size;
+
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MeshFileView::close() {
+    if (data) {
+        munmap((void*)data, size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+bool MeshFileView::validate(const char* path) const {
+    const MeshFileHeader* h = header();
+    if (h->magic != MESH_FILE_MAGIC) {
+        gl_log_err("ERROR: %s is not an AceEngine mesh file\n", path);
+        return false;
+    }
+    if (h->version != MESH_FILE_VERSION || h->header_size != sizeof(MeshFileHeader)) {
+        gl_log_err("ERROR: %s has unsupported mesh version %u\n", path, h->version);
+        return false;
+    }
+
+    uint64_t tables = sizeof(MeshFileHeader)
+                    + (uint64_t)h->stream_count * sizeof(MeshStreamDesc)
+                    + (uint64_t)h->submesh_count * sizeof(MeshSubmesh)
+                    + (uint64_t)h->lod_count * sizeof(MeshLod);
+    if (tables > size) {
+        gl_log_err("ERROR: %s is truncated\n", path);
+        return false;
+    }
+
+    // Sizes are compared as "offset > size || count > size - offset" so a
+    // crafted offset cannot wrap around
+    for (uint32_t i = 0; i < h->stream_count; i++) {
+        const MeshStreamDesc& s = streams()[i];
+        bool known_type = s.type == MESH_TYPE_FLOAT || s.type == MESH_TYPE_UNSIGNED_SHORT ||
+                          s.type == MESH_TYPE_UNSIGNED_INT;
+        if (!known_type || s.components < 1 || s.components > 4 ||
+            s.stride != s.components * mesh_type_size(s.type)) {
+            gl_log_err("ERROR: %s has an unsupported vertex stream %u\n", path, i);
+            return false;
+        }
+        if (s.offset > size || s.size > size - s.offset || s.offset % MESH_FILE_ALIGNMENT != 0 ||
+            s.size < (uint64_t)h->vertex_count * s.stride) {
+            gl_log_err("ERROR: %s has a bad vertex stream %u\n", path, i);
+            return false;
+        }
+    }
+
+    if (h->index_type != MESH_TYPE_UNSIGNED_SHORT && h->index_type != MESH_TYPE_UNSIGNED_INT) {
+        gl_log_err("ERROR: %s has unsupported index type 0x%x\n", path, h->index_type);
+        return false;
+    }
+    if (h->index_offset > size || indexDataSize() > size - h->index_offset ||
+        h->index_offset % MESH_FILE_ALIGNMENT != 0) {
+        gl_log_err("ERROR: %s has truncated index data\n", path);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < h->submesh_count; i++) {
+        const MeshSubmesh& submesh = submeshes()[i];
+        if ((uint64_t)submesh.index_offset + submesh.index_count > h->index_count) {
+            gl_log_err("ERROR: %s has submesh %u outside the index data\n", path, i);
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < h->lod_count; i++) {
+        const MeshLod& lod = lods()[i];
+        if ((uint64_t)lod.index_offset + lod.index_count > h->index_count) {
+            gl_log_err("ERROR: %s has LOD %u outside the index data\n", path, i);
+            return false;
+        }
+    }
+
+    // The optimiser and the mesh cache index the streams on the CPU
+    uint32_t max_index = 0;
+    if (h->index_type == MESH_TYPE_UNSIGNED_SHORT) {
+        const uint16_t* indices = (const uint16_t*)indexData();
+        for (uint32_t i = 0; i < h->index_count; i++) max_index = std::max(max_index, (uint32_t)indices[i]);
+    } else {
+        const uint32_t* indices = (const uint32_t*)indexData();
+        for (uint32_t i = 0; i < h->index_count; i++) max_index = std::max(max_index, indices[i]);
+    }
+    if (h->index_count > 0 && max_index >= h->vertex_count) {
+        gl_log_err("ERROR: %s has index %u past its %u vertices\n", path, max_index, h->vertex_count);
+        return false;
+    }
+    return true;
+}
+
+const MeshStreamDesc* MeshFileView::streams() const {
+    return (const MeshStreamDesc*)(data + sizeof(MeshFileHeader));
+}
+
+const MeshSubmesh* MeshFileView::submeshes() const {
+    return (const MeshSubmesh*)(streams() + header()->stream_count);
+}
+
+const MeshLod* MeshFileView::lods() const {
+    return (const MeshLod*)(submeshes() + header()->submesh_count);
+}
+
+const void* MeshFileView::streamData(uint32_t i) const {
+    return data + streams()[i].offset;
+}
+
+const void* MeshFileView::indexData() const {
+    return data + header()->index_offset;
+}
+
+size_t MeshFileView::indexDataSize() const {
+    size_t index_size = header()->index_type == MESH_TYPE_UNSIGNED_SHORT ? 2 : 4;
+    return (size_t)header()->index_count * index_size;
+}
+
+void make_box_mesh(MeshData& mesh, float half_x, float half_y, float half_z) {
+    const float half[3] = {half_x, half_y, half_z};
+    static const float faces[6][4][3] = {
+        {{ 1, -1, -1}, { 1,  1, -1}, { 1,  1,  1}, { 1, -1,  1}},   // +x
+        {{-1, -1,  1}, {-1,  1,  1}, {-1,  1, -1}, {-1, -1, -1}},   // -x
+        {{-1,  1, -1}, {-1,  1,  1}, { 1,  1,  1}, { 1,  1, -1}},   // +y
+        {{-1, -1,  1}, {-1, -1, -1}, { 1, -1, -1}, { 1, -1,  1}},   // -y
+        {{ 1, -1,  1}, { 1,  1,  1}, {-1,  1,  1}, {-1, -1,  1}},   // +z
+        {{-1, -1, -1}, {-1,  1, -1}, { 1,  1, -1}, { 1, -1, -1}}    // -z
+    };
+    static const float normals[6][3] = {{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1}};
+
+    std::vector<float> positions, face_normals;
+    for (int f = 0; f < 6; f++) {
+        uint32_t base = (uint32_t)(positions.size() / 3);
+        for (int v = 0; v < 4; v++) {
+            for (int c = 0; c < 3; c++) {
+                positions.push_back(faces[f][v][c] * half[c]);
+                face_normals.push_back(normals[f][c]);
+            }
+        }
+        mesh.indices.insert(mesh.indices.end(), {base, base + 2, base + 1, base, base + 3, base + 2});
+    }
+
+    mesh.vertex_count = (uint32_t)(positions.size() / 3);
+    const uint8_t* p = (const uint8_t*)positions.data();
+    const uint8_t* n = (const uint8_t*)face_normals.data();
+    mesh.streams.push_back({0, 3, MESH_TYPE_FLOAT, false, std::vector<uint8_t>(p, p + positions.size() * 4)});
+    mesh.streams.push_back({1, 3, MESH_TYPE_FLOAT, false, std::vector<uint8_t>(n, n + face_normals.size() * 4)});
+    for (int c = 0; c < 3; c++) {
+        mesh.bounds_min[c] = -half[c];
+        mesh.bounds_max[c] = half[c];
+    }
+}
@@ -0,0 +1,329 @@
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_format.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+struct VertexHasher {
+    const VertexStream* streams;
+    int stream_count;
+
+    size_t operator()(uint32_t v) const {
+        uint32_t h = 2166136261u;
+        for (int s = 0; s < stream_count; s++) {
+            const float* f = streams[s].data + (size_t)v * streams[s].components;
+            for (int c = 0; c < streams[s].components; c++) {
+                uint32_t bits;
+                memcpy(&bits, &f[c], sizeof(bits));
+                h = (h ^ bits) * 16777619u;
+            }
+        }
+        return h;
+    }
+
+    bool operator()(uint32_t a, uint32_t b) const {
+        for (int s = 0; s < stream_count; s++) {
+            const float* fa = streams[s].data + (size_t)a * streams[s].components;
+            const float* fb = streams[s].data + (size_t)b * streams[s].components;
+            if (memcmp(fa, fb, sizeof(float) * streams[s].components) != 0) return false;
+        }
+        return true;
+    }
+};
+
+// Vertex -> triangle adjacency in CSR form
+struct Adjacency {
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> triangles;
+
+    Adjacency(const uint32_t* indices, size_t index_count, size_t vertex_count) {
+        offsets.assign(vertex_count + 1, 0);
+        for (size_t i = 0; i < index_count; i++) offsets[indices[i] + 1]++;
+        for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+        triangles.resize(index_count);
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < index_count; i++) triangles[fill[indices[i]]++] = (uint32_t)(i / 3);
+    }
+};
+
+}  // namespace
+
+size_t generate_vertex_remap(std::vector<uint32_t>& remap, const VertexStream* streams, int stream_count,
+                             size_t vertex_count) {
+    VertexHasher hasher = {streams, stream_count};
+    std::unordered_map<uint32_t, uint32_t, VertexHasher, VertexHasher> unique(vertex_count, hasher, hasher);
+
+    remap.resize(vertex_count);
+    uint32_t next = 0;
+    for (uint32_t v = 0; v < (uint32_t)vertex_count; v++) {
+        auto result = unique.emplace(v, next);
+        remap[v] = result.first->second;
+        if (result.second) next++;
+    }
+    return next;
+}
+
+void remap_vertex_buffer(float* dst, const float* src, size_t vertex_count, int components,
+                         const std::vector<uint32_t>& remap) {
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (remap[v] == UINT32_MAX) continue;
+        memcpy(dst + (size_t)remap[v] * components, src + v * components, sizeof(float) * components);
+    }
+}
+
+VertexCacheStats analyze_vertex_cache(const uint32_t* indices, size_t index_count, size_t vertex_count,
+                                      int cache_size) {
+    // FIFO: a vertex is in the cache if it entered within the last cache_size misses
+    std::vector<int64_t> entered(vertex_count, -(int64_t)cache_size - 1);
+    std::vector<bool> referenced(vertex_count, false);
+    int64_t misses = 0;
+    size_t unique = 0;
+
+    for (size_t i = 0; i < index_count; i++) {
+        uint32_t v = indices[i];
+        if (misses - entered[v] > cache_size) {
+            entered[v] = misses;
+            misses++;
+        }
+        if (!referenced[v]) {
+            referenced[v] = true;
+            unique++;
+        }
+    }
+
+    VertexCacheStats stats;
+    stats.acmr = index_count ? (float)misses / (float)(index_count / 3) : 0.0f;
+    stats.atvr = unique ? (float)misses / (float)unique : 0.0f;
+    return stats;
+}
+
+void optimize_vertex_cache(uint32_t* indices, size_t index_count, size_t vertex_count, int cache_size,
+                           std::vector<uint32_t>* clusters) {
+    size_t triangle_count = index_count / 3;
+    if (triangle_count == 0) {
+        return;
+    }
+
+    Adjacency adjacency(indices, index_count, vertex_count);
+    std::vector<uint32_t> live(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) live[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    std::vector<int> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> dead_end;
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(index_count);
+
+    int timestamp = cache_size + 1;
+    size_t cursor = 0;
+    int fanning = (int)indices[0];
+    if (clusters) clusters->assign(1, 0);
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        // Emit every remaining triangle around the fanning vertex
+        for (uint32_t a = adjacency.offsets[fanning]; a < adjacency.offsets[fanning + 1]; a++) {
+            uint32_t t = adjacency.triangles[a];
+            if (emitted[t]) continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                output.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (timestamp - cache_time[v] > cache_size) {
+                    cache_time[v] = timestamp++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Next fanning vertex: the oldest candidate still in cache after its fan
+        int best = -1;
+        int best_priority = -1;
+        for (uint32_t v : candidates) {
+            if (live[v] == 0) continue;
+            int priority = 0;
+            if (timestamp - cache_time[v] + 2 * (int)live[v] <= cache_size) {
+                priority = timestamp - cache_time[v];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                best = (int)v;
+            }
+        }
+
+        if (best < 0) {
+            // Dead end: recently used vertices first, then scan in input order
+            while (!dead_end.empty() && best < 0) {
+                uint32_t v = dead_end.back();
+                dead_end.pop_back();
+                if (live[v] > 0) best = (int)v;
+            }
+            while (best < 0 && cursor < vertex_count) {
+                if (live[cursor] > 0) best = (int)cursor;
+                cursor++;
+            }
+            if (best >= 0 && clusters) {
+                clusters->push_back((uint32_t)(output.size() / 3));
+            }
+        }
+        fanning = best;
+    }
+
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+void optimize_overdraw(uint32_t* indices, size_t index_count, const float* positions, size_t /*vertex_count*/,
+                       const std::vector<uint32_t>& clusters) {
+    size_t triangle_count = index_count / 3;
+    size_t cluster_count = clusters.size();
+    if (cluster_count < 2) {
+        return;
+    }
+
+    // Area-weighted centroid and normal per cluster
+    struct Cluster {
+        uint32_t first;
+        uint32_t count;
+        float centroid[3];
+        float normal[3];
+        float area;
+        float sort_key;
+    };
+    std::vector<Cluster> info(cluster_count);
+    float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+    float mesh_area = 0.0f;
+
+    for (size_t c = 0; c < cluster_count; c++) {
+        Cluster& cl = info[c];
+        cl.first = clusters[c];
+        cl.count = (uint32_t)((c + 1 < cluster_count ? clusters[c + 1] : triangle_count) - cl.first);
+        memset(cl.centroid, 0, sizeof(cl.centroid));
+        memset(cl.normal, 0, sizeof(cl.normal));
+        cl.area = 0.0f;
+
+        for (uint32_t t = cl.first; t < cl.first + cl.count; t++) {
+            const float* a = positions + indices[t * 3 + 0] * 3;
+            const float* b = positions + indices[t * 3 + 1] * 3;
+            const float* d = positions + indices[t * 3 + 2] * 3;
+            float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            float e2[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+            float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5f;
+            for (int k = 0; k < 3; k++) {
+                cl.normal[k] += n[k];
+                cl.centroid[k] += (a[k] + b[k] + d[k]) / 3.0f * area;
+            }
+            cl.area += area;
+        }
+
+        for (int k = 0; k < 3; k++) mesh_centroid[k] += cl.centroid[k];
+        mesh_area += cl.area;
+        if (cl.area > 0.0f) {
+            for (int k = 0; k < 3; k++) cl.centroid[k] /= cl.area;
+        }
+    }
+    if (mesh_area > 0.0f) {
+        for (int k = 0; k < 3; k++) mesh_centroid[k] /= mesh_area;
+    }
+
+    for (Cluster& cl : info) {
+        float len = sqrtf(cl.normal[0] * cl.normal[0] + cl.normal[1] * cl.normal[1] + cl.normal[2] * cl.normal[2]);
+        float d[3] = {cl.centroid[0] - mesh_centroid[0], cl.centroid[1] - mesh_centroid[1], cl.centroid[2] - mesh_centroid[2]};
+        cl.sort_key = len > 0.0f ? (d[0] * cl.normal[0] + d[1] * cl.normal[1] + d[2] * cl.normal[2]) / len : 0.0f;
+    }
+
+    // Outward facing, far from the centre first: these occlude the others
+    std::stable_sort(info.begin(), info.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sort_key > b.sort_key;
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(index_count);
+    for (const Cluster& cl : info) {
+        output.insert(output.end(), indices + cl.first * 3, indices + (cl.first + cl.count) * 3);
+    }
+    memcpy(indices, output.data(), output.size() * sizeof(uint32_t));
+}
+
+size_t optimize_vertex_fetch_remap(std::vector<uint32_t>& remap, uint32_t* indices, size_t index_count,
+                                   size_t vertex_count) {
+    remap.assign(vertex_count, UINT32_MAX);
+    uint32_t next = 0;
+    for (size_t i = 0; i < index_count; i++) {
+        uint32_t& r = remap[indices[i]];
+        if (r == UINT32_MAX) r = next++;
+        indices[i] = r;
+    }
+    return next;
+}
+
+void optimize_mesh(MeshData& mesh, MeshOptimizeStats* stats) {
+    const MeshData::Stream* position_stream = nullptr;
+    for (const auto& stream : mesh.streams) {
+        if (stream.location == 0 && stream.type == MESH_TYPE_FLOAT && stream.components == 3) {
+            position_stream = &stream;
+        }
+    }
+
+    if (stats) {
+        stats->before = analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+        stats->vertices_before = mesh.vertex_count;
+        stats->clusters = 0;
+    }
+
+    // Index ranges to optimise independently: each submesh, plus any LOD
+    // stored after the submeshes (LOD 0 is the submeshes themselves).
+    // Without submeshes LOD 0 is the base range, so triangles never move
+    // between levels
+    std::vector<std::pair<uint32_t, uint32_t>> ranges;
+    uint32_t covered = 0;
+    for (const auto& submesh : mesh.submeshes) {
+        ranges.push_back({submesh.index_offset, submesh.index_count});
+        covered = std::max(covered, submesh.index_offset + submesh.index_count);
+    }
+    if (ranges.empty()) {
+        covered = mesh.lods.empty() ? (uint32_t)mesh.indices.size() : mesh.lods[0].index_count;
+        ranges.push_back({0, covered});
+    }
+    for (const auto& lod : mesh.lods) {
+        if (lod.index_offset >= covered) ranges.push_back({lod.index_offset, lod.index_count});
+    }
+
+    for (const auto& range : ranges) {
+        uint32_t* indices = mesh.indices.data() + range.first;
+        std::vector<uint32_t> clusters;
+        optimize_vertex_cache(indices, range.second, mesh.vertex_count, VERTEX_CACHE_SIZE, &clusters);
+        if (position_stream) {
+            optimize_overdraw(indices, range.second, (const float*)position_stream->data.data(),
+                              mesh.vertex_count, clusters);
+        }
+        if (stats) stats->clusters += (int)clusters.size();
+    }
+
+    // Vertex fetch: renumber in first-use order and drop unused vertices
+    std::vector<uint32_t> remap;
+    size_t used = optimize_vertex_fetch_remap(remap, mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+    for (auto& stream : mesh.streams) {
+        size_t stride = stream.components * mesh_type_size(stream.type);
+        std::vector<uint8_t> reordered(used * stride);
+        for (size_t v = 0; v < mesh.vertex_count; v++) {
+            if (remap[v] == UINT32_MAX) continue;
+            memcpy(&reordered[remap[v] * stride], &stream.data[v * stride], stride);
+        }
+        stream.data.swap(reordered);
+    }
+    mesh.vertex_count = (uint32_t)used;
+    mesh.flags |= MESH_FLAG_OPTIMIZED;
+
+    if (stats) {
+        stats->after = analyze_vertex_cache(mesh.indices.data(), mesh.indices.size(), mesh.vertex_count);
+        stats->vertices_after = mesh.vertex_count;
+    }
+}
@@ -0,0 +1,332 @@
+#include "graphics/mesh_simplifier.h"
+#include "graphics/mesh_format.h"
+#include "graphics/mesh_optimizer.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+enum VertexKind : uint8_t {
+    KIND_MANIFOLD,   // interior vertex, may collapse onto any neighbour
+    KIND_BORDER,     // on an open edge, may only slide along it
+    KIND_LOCKED      // seam or non-manifold, never moves
+};
+
+// Boundary quadrics are weighted up so open edges keep their silhouette
+const double BORDER_WEIGHT = 10.0;
+
+// Symmetric 4x4 error quadric plus the accumulated area weight, so the
+// error of a position is a weighted mean squared distance to the planes
+struct Quadric {
+    double a00, a11, a22, a01, a02, a12;
+    double b0, b1, b2;
+    double c;
+    double w;
+};
+
+void quadric_add(Quadric& q, const Quadric& r) {
+    q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+    q.a01 += r.a01; q.a02 += r.a02; q.a12 += r.a12;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+    q.w += r.w;
+}
+
+// Plane a*x + b*y + c*z + d = 0 with unit normal
+void quadric_add_plane(Quadric& q, double a, double b, double c, double d, double w) {
+    q.a00 += a * a * w; q.a11 += b * b * w; q.a22 += c * c * w;
+    q.a01 += a * b * w; q.a02 += a * c * w; q.a12 += b * c * w;
+    q.b0 += a * d * w; q.b1 += b * d * w; q.b2 += c * d * w;
+    q.c += d * d * w;
+    q.w += w;
+}
+
+double quadric_error(const Quadric& q, const float* p) {
+    double x = p[0], y = p[1], z = p[2];
+    double r = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+             + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+             + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z)
+             + q.c;
+    return fabs(r) / (q.w > 0.0 ? q.w : 1.0);
+}
+
+void triangle_normal(const float* a, const float* b, const float* c, double n[3]) {
+    double e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    double e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+uint64_t edge_key(uint32_t a, uint32_t b) {
+    return ((uint64_t)a << 32) | b;
+}
+
+struct Collapse {
+    uint32_t v;      // vertex that disappears
+    uint32_t t;      // vertex it is merged onto
+    double error;
+};
+
+// Simplification state kept across calls, so a LOD chain is produced by
+// one continuous run: every level starts from the previous one and the
+// quadrics (and so the errors) stay relative to LOD 0
+class Simplifier {
+public:
+    Simplifier(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count);
+
+    // Collapse until result has at most target_index_count indices or the
+    // next collapse would exceed target_error
+    void run(size_t target_index_count, float target_error);
+
+    std::vector<uint32_t> result;
+    double max_error;          // squared
+
+private:
+    void buildDirected();
+    size_t edgeCount(uint32_t a, uint32_t b) const;
+    bool canCollapse(uint32_t v, uint32_t t) const;
+    bool flips(uint32_t v, uint32_t t) const;
+
+    const float* positions;
+    size_t vertex_count;
+    std::vector<uint32_t> pos_id;
+    std::vector<uint8_t> kind;
+    std::vector<Quadric> quadrics;
+
+    // Per pass scratch
+    std::vector<uint64_t> directed;
+    std::vector<uint64_t> edges;
+    std::vector<Collapse> collapses;
+    std::vector<uint32_t> adj_offsets;
+    std::vector<uint32_t> adj_triangles;
+    std::vector<uint32_t> remap;
+    std::vector<uint8_t> touched;
+};
+
+Simplifier::Simplifier(const uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count)
+    : result(indices, indices + index_count), max_error(0.0), positions(positions), vertex_count(vertex_count) {
+    // Position ids: vertices that only differ in attributes share one
+    VertexStream position_stream = {positions, 3};
+    size_t position_count = generate_vertex_remap(pos_id, &position_stream, 1, vertex_count);
+    std::vector<uint32_t> pos_users(position_count, 0);
+    for (size_t v = 0; v < vertex_count; v++) pos_users[pos_id[v]]++;
+
+    buildDirected();
+    kind.assign(vertex_count, KIND_MANIFOLD);
+    quadrics.assign(vertex_count, Quadric{});
+
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const uint32_t tri[3] = {result[i], result[i + 1], result[i + 2]};
+        const float* p[3] = {positions + tri[0] * 3, positions + tri[1] * 3, positions + tri[2] * 3};
+        double n[3];
+        triangle_normal(p[0], p[1], p[2], n);
+        double area2 = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (area2 <= 0.0) continue;
+        n[0] /= area2; n[1] /= area2; n[2] /= area2;
+        double d = -(n[0] * p[0][0] + n[1] * p[0][1] + n[2] * p[0][2]);
+        for (int k = 0; k < 3; k++) quadric_add_plane(quadrics[tri[k]], n[0], n[1], n[2], d, area2 * 0.5);
+
+        for (int e = 0; e < 3; e++) {
+            uint32_t va = tri[e], vb = tri[(e + 1) % 3];
+            uint32_t a = pos_id[va], b = pos_id[vb];
+            if (edgeCount(a, b) > 1 || edgeCount(b, a) > 1) {
+                kind[va] = KIND_LOCKED;
+                kind[vb] = KIND_LOCKED;
+            } else if (edgeCount(b, a) == 0) {
+                if (kind[va] == KIND_MANIFOLD) kind[va] = KIND_BORDER;
+                if (kind[vb] == KIND_MANIFOLD) kind[vb] = KIND_BORDER;
+
+                // Plane through the open edge, perpendicular to the triangle
+                const float* pa = positions + va * 3;
+                const float* pb = positions + vb * 3;
+                double ed[3] = {pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2]};
+                double m[3] = {ed[1] * n[2] - ed[2] * n[1], ed[2] * n[0] - ed[0] * n[2], ed[0] * n[1] - ed[1] * n[0]};
+                double len = sqrt(m[0] * m[0] + m[1] * m[1] + m[2] * m[2]);
+                if (len <= 0.0) continue;
+                m[0] /= len; m[1] /= len; m[2] /= len;
+                double md = -(m[0] * pa[0] + m[1] * pa[1] + m[2] * pa[2]);
+                double weight = (ed[0] * ed[0] + ed[1] * ed[1] + ed[2] * ed[2]) * BORDER_WEIGHT;
+                quadric_add_plane(quadrics[va], m[0], m[1], m[2], md, weight);
+                quadric_add_plane(quadrics[vb], m[0], m[1], m[2], md, weight);
+            }
+        }
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (pos_users[pos_id[v]] > 1) kind[v] = KIND_LOCKED;
+    }
+
+    remap.resize(vertex_count);
+    touched.resize(vertex_count);
+}
+
+// Directed edges in position space: an edge without its reverse is open,
+// an edge seen twice in the same direction is non-manifold
+void Simplifier::buildDirected() {
+    directed.clear();
+    for (size_t i = 0; i < result.size(); i += 3) {
+        for (int e = 0; e < 3; e++) {
+            directed.push_back(edge_key(pos_id[result[i + e]], pos_id[result[i + (e + 1) % 3]]));
+        }
+    }
+    std::sort(directed.begin(), directed.end());
+}
+
+size_t Simplifier::edgeCount(uint32_t a, uint32_t b) const {
+    auto range = std::equal_range(directed.begin(), directed.end(), edge_key(a, b));
+    return (size_t)(range.second - range.first);
+}
+
+bool Simplifier::canCollapse(uint32_t v, uint32_t t) const {
+    if (kind[v] == KIND_LOCKED) return false;
+    if (kind[v] == KIND_BORDER) {
+        // Only along an open edge, so the border does not fold inwards
+        uint32_t a = pos_id[v], b = pos_id[t];
+        return edgeCount(a, b) + edgeCount(b, a) == 1;
+    }
+    return true;
+}
+
+// Rejects collapses that would turn a surviving triangle over
+bool Simplifier::flips(uint32_t v, uint32_t t) const {
+    for (uint32_t k = adj_offsets[v]; k < adj_offsets[v + 1]; k++) {
+        uint32_t tri = adj_triangles[k];
+        uint32_t i0 = remap[result[tri * 3]], i1 = remap[result[tri * 3 + 1]], i2 = remap[result[tri * 3 + 2]];
+        if (i0 == t || i1 == t || i2 == t) continue;
+        double before[3], after[3];
+        triangle_normal(positions + i0 * 3, positions + i1 * 3, positions + i2 * 3, before);
+        uint32_t j0 = i0 == v ? t : i0, j1 = i1 == v ? t : i1, j2 = i2 == v ? t : i2;
+        triangle_normal(positions + j0 * 3, positions + j1 * 3, positions + j2 * 3, after);
+        if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0.0) return true;
+    }
+    return false;
+}
+
+void Simplifier::run(size_t target_index_count, float target_error) {
+    double error_limit = (double)target_error * (double)target_error;
+
+    // Each pass collapses the cheapest independent edges, then compacts
+    while (result.size() > target_index_count) {
+        buildDirected();
+
+        edges.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                uint32_t a = result[i + e], b = result[i + (e + 1) % 3];
+                edges.push_back(a < b ? edge_key(a, b) : edge_key(b, a));
+            }
+        }
+        std::sort(edges.begin(), edges.end());
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t key : edges) {
+            uint32_t a = (uint32_t)(key >> 32), b = (uint32_t)key;
+            Quadric q = quadrics[a];
+            quadric_add(q, quadrics[b]);
+            double ab = canCollapse(a, b) ? quadric_error(q, positions + b * 3) : DBL_MAX;
+            double ba = canCollapse(b, a) ? quadric_error(q, positions + a * 3) : DBL_MAX;
+            if (ab == DBL_MAX && ba == DBL_MAX) continue;
+            if (ab <= ba) collapses.push_back({a, b, ab});
+            else collapses.push_back({b, a, ba});
+        }
+        std::sort(collapses.begin(), collapses.end(),
+                  [](const Collapse& x, const Collapse& y) { return x.error < y.error; });
+
+        // Vertex -> triangle adjacency of the current index buffer
+        adj_offsets.assign(vertex_count + 1, 0);
+        for (uint32_t v : result) adj_offsets[v + 1]++;
+        for (size_t v = 0; v < vertex_count; v++) adj_offsets[v + 1] += adj_offsets[v];
+        adj_triangles.resize(result.size());
+        {
+            std::vector<uint32_t> fill(adj_offsets.begin(), adj_offsets.end() - 1);
+            for (size_t i = 0; i < result.size(); i++) adj_triangles[fill[result[i]]++] = (uint32_t)(i / 3);
+        }
+
+        for (size_t v = 0; v < vertex_count; v++) remap[v] = (uint32_t)v;
+        std::fill(touched.begin(), touched.end(), 0);
+
+        size_t triangles_needed = (result.size() - target_index_count + 2) / 3;
+        size_t triangles_removed = 0;
+        size_t applied = 0;
+        for (const Collapse& c : collapses) {
+            if (c.error > error_limit || triangles_removed >= triangles_needed) break;
+            if (touched[c.v] || touched[c.t]) continue;
+            if (flips(c.v, c.t)) continue;
+
+            remap[c.v] = c.t;
+            touched[c.v] = 1;
+            touched[c.t] = 1;
+            quadric_add(quadrics[c.t], quadrics[c.v]);
+            max_error = std::max(max_error, c.error);
+            triangles_removed += kind[c.v] == KIND_BORDER ? 1 : 2;
+            applied++;
+        }
+        if (applied == 0) {
+            break;
+        }
+
+        // Apply the collapses and drop triangles that became degenerate
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = remap[result[i]], b = remap[result[i + 1]], c = remap[result[i + 2]];
+            if (pos_id[a] == pos_id[b] || pos_id[b] == pos_id[c] || pos_id[a] == pos_id[c]) continue;
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+}
+
+}  // namespace
+
+size_t simplify_mesh(uint32_t* dst, const uint32_t* indices, size_t index_count, const float* positions,
+                     size_t vertex_count, size_t target_index_count, float target_error, float* result_error) {
+    Simplifier simplifier(indices, index_count, positions, vertex_count);
+    simplifier.run(target_index_count, target_error);
+
+    std::copy(simplifier.result.begin(), simplifier.result.end(), dst);
+    if (result_error) *result_error = (float)sqrt(simplifier.max_error);
+    return simplifier.result.size();
+}
+
+int generate_lods(MeshData& mesh, int max_lods, float reduction) {
+    const MeshData::Stream* position_stream = nullptr;
+    for (const auto& stream : mesh.streams) {
+        if (stream.location == 0 && stream.type == MESH_TYPE_FLOAT && stream.components == 3) {
+            position_stream = &stream;
+        }
+    }
+    if (mesh.lods.empty()) {
+        mesh.lods.push_back({0, (uint32_t)mesh.indices.size(), 0.0f, 0});
+    }
+    if (!position_stream || mesh.lods.size() > 1) {
+        return (int)mesh.lods.size();
+    }
+
+    float extent = 0.0f;
+    for (int c = 0; c < 3; c++) extent = std::max(extent, mesh.bounds_max[c] - mesh.bounds_min[c]);
+
+    // One run from LOD 0, snapshotting each level. Past a quarter of the
+    // mesh size the shape is gone anyway.
+    Simplifier simplifier(mesh.indices.data() + mesh.lods[0].index_offset, mesh.lods[0].index_count,
+                          (const float*)position_stream->data.data(), mesh.vertex_count);
+    size_t previous = mesh.lods[0].index_count;
+
+    while ((int)mesh.lods.size() < max_lods) {
+        simplifier.run((size_t)(previous / 3 * reduction) * 3, extent * 0.25f);
+        size_t count = simplifier.result.size();
+        // Stop once a level no longer removes at least 10% of the previous one
+        if (count == 0 || count > previous * 9 / 10) {
+            break;
+        }
+
+        mesh.lods.push_back({(uint32_t)mesh.indices.size(), (uint32_t)count, (float)sqrt(simplifier.max_error), 0});
+        mesh.indices.insert(mesh.indices.end(), simplifier.result.begin(), simplifier.result.end());
+        previous = count;
+    }
+    return (int)mesh.lods.size();
+}
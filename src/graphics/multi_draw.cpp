@@ -0,0 +1,241 @@
+#include "graphics/multi_draw.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/shader.h"
+#include "utils/log.h"
+#include <GLFW/glfw3.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// ARB_multi_draw_indirect is core in 4.3; glad was generated for 4.1
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect,
+                                                        GLsizei draw_count, GLsizei stride);
+
+static MultiDrawElementsIndirectProc s_multi_draw_elements_indirect = nullptr;
+
+static double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+bool MultiDrawBatch::initMultiDrawIndirect() {
+    s_multi_draw_elements_indirect = nullptr;
+    // A non-zero base instance also needs ARB_base_instance (core in 4.2)
+    if (glfwExtensionSupported("GL_ARB_multi_draw_indirect") && glfwExtensionSupported("GL_ARB_base_instance")) {
+        s_multi_draw_elements_indirect =
+            (MultiDrawElementsIndirectProc)glfwGetProcAddress("glMultiDrawElementsIndirect");
+    }
+    gl_log("Multi-draw indirect: %s\n", s_multi_draw_elements_indirect ? "supported" : "not supported");
+    return s_multi_draw_elements_indirect != nullptr;
+}
+
+bool MultiDrawBatch::isMultiDrawIndirectSupported() {
+    return s_multi_draw_elements_indirect != nullptr;
+}
+
+MultiDrawBatch::MultiDrawBatch()
+    : texels_per_draw(0), max_draws(0), use_indirect(true), data_buffer(0), data_texture(0), indirect_buffer(0),
+      data_capacity(0), indirect_capacity(0), stats() {}
+
+MultiDrawBatch::~MultiDrawBatch() {
+    gpu_release_texture(data_texture);
+    gpu_release_buffer(data_buffer);
+    gpu_release_buffer(indirect_buffer);
+}
+
+bool MultiDrawBatch::init(uint32_t texels_per_draw_, const char* label) {
+    texels_per_draw = std::max(texels_per_draw_, 1u);
+
+    // 4.1 only guarantees 65536 texels per texture buffer
+    GLint max_texels = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &max_texels);
+    max_draws = std::min(MeshCache::MAX_DRAW_INDEX, (uint32_t)max_texels / texels_per_draw);
+    if (max_draws == 0) {
+        gl_log_err("Multi-draw batch %s: %u texels per draw exceed the texture buffer limit\n", label,
+                   texels_per_draw);
+        return false;
+    }
+
+    data_buffer = gpu_create_buffer(RESOURCE_DATA_BUFFER, label);
+    data_texture = gpu_create_texture(RESOURCE_TEXTURE, label);
+    indirect_buffer = gpu_create_buffer(RESOURCE_DATA_BUFFER, label);
+
+    // Grown by submit()
+    data_capacity = 1024 * texels_per_draw * 4 * sizeof(float);
+    gpu_buffer_data(data_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)data_capacity, nullptr, GL_STREAM_DRAW);
+    glBindTexture(GL_TEXTURE_BUFFER, data_texture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, data_buffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    indirect_capacity = 256 * sizeof(IndirectCommand);
+    gpu_buffer_data(indirect_buffer, GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)indirect_capacity, nullptr,
+                    GL_STREAM_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    gl_log("Multi-draw batch %s: %u texels per draw, %u draws max, %s\n", label, texels_per_draw, max_draws,
+           isMultiDrawIndirectSupported() ? "indirect" : "instanced fallback");
+    return true;
+}
+
+void MultiDrawBatch::reset() {
+    draws.clear();
+    staged.clear();
+}
+
+float* MultiDrawBatch::add(const CachedMesh& mesh, int lod) {
+    if (draws.size() >= max_draws) {
+        return nullptr;
+    }
+    Draw draw;
+    draw.page = mesh.page;
+    draw.vao = mesh.vao;
+    draw.first_index = mesh.first_index;
+    draw.base_vertex = mesh.base_vertex;
+    draw.index_count = mesh.index_count;
+    if (lod >= 0 && lod < (int)mesh.lods.size()) {
+        draw.first_index += mesh.lods[lod].index_offset;
+        draw.index_count = mesh.lods[lod].index_count;
+    }
+    draw.source = (uint32_t)draws.size();
+    draws.push_back(draw);
+
+    size_t floats = (size_t)texels_per_draw * 4;
+    staged.resize(staged.size() + floats);
+    return &staged[staged.size() - floats];
+}
+
+const MultiDrawBatch::Uniforms& MultiDrawBatch::lookupUniforms(const Shader& shader, int data_unit) {
+    Uniforms* cached = nullptr;
+    for (Uniforms& u : uniforms) {
+        if (u.shader == &shader) {
+            cached = &u;
+            break;
+        }
+    }
+    if (!cached) {
+        uniforms.push_back({&shader, shader.generation - 1, -1, -1, -1});
+        cached = &uniforms.back();
+    }
+    // Reloads replace the programme and bump the generation
+    if (cached->generation != shader.generation) {
+        cached->generation = shader.generation;
+        cached->draw_data = glGetUniformLocation(shader.programme, "draw_data");
+        cached->draw_base = glGetUniformLocation(shader.programme, "draw_base");
+        cached->data_unit = -1;
+    }
+    if (cached->data_unit != data_unit) {
+        if (cached->draw_data != -1) glUniform1i(cached->draw_data, data_unit);
+        cached->data_unit = data_unit;
+    }
+    return *cached;
+}
+
+void MultiDrawBatch::submit(const Shader& shader, int data_unit) {
+    auto start = std::chrono::high_resolution_clock::now();
+    bool indirect = isIndirect();
+    stats.draws = (int)draws.size();
+    stats.commands = 0;
+    stats.calls = 0;
+    stats.pages = 0;
+    stats.indirect = indirect;
+    stats.data_bytes = 0;
+    if (draws.empty()) {
+        stats.sort_ms = stats.upload_ms = stats.submit_ms = 0.0;
+        return;
+    }
+
+    // By page, then mesh, so each page's commands are contiguous and
+    // repeats of a mesh sit next to each other
+    std::sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) {
+        if (a.page != b.page) return a.page < b.page;
+        if (a.first_index != b.first_index) return a.first_index < b.first_index;
+        if (a.index_count != b.index_count) return a.index_count < b.index_count;
+        return a.source < b.source;
+    });
+
+    // Draw i of the sorted list owns row i of the data buffer, so a run of
+    // one mesh is one command whose instances walk consecutive rows
+    size_t floats = (size_t)texels_per_draw * 4;
+    sorted.resize(staged.size());
+    commands.clear();
+    page_starts.clear();
+    page_vaos.clear();
+    for (size_t i = 0; i < draws.size(); i++) {
+        const Draw& draw = draws[i];
+        memcpy(&sorted[i * floats], &staged[(size_t)draw.source * floats], floats * sizeof(float));
+
+        bool new_page = i == 0 || draw.page != draws[i - 1].page;
+        if (new_page) {
+            page_starts.push_back((uint32_t)commands.size());
+            page_vaos.push_back(draw.vao);
+        }
+        if (!new_page) {
+            IndirectCommand& last = commands.back();
+            if (last.first_index == draw.first_index && last.count == draw.index_count &&
+                last.base_vertex == draw.base_vertex) {
+                last.instance_count++;
+                continue;
+            }
+        }
+        IndirectCommand command = {draw.index_count, 1, draw.first_index, draw.base_vertex, (GLuint)i};
+        commands.push_back(command);
+    }
+    page_starts.push_back((uint32_t)commands.size());
+    stats.sort_ms = ms_since(start);
+
+    // Orphan and refill; the buffers grow to the largest frame
+    auto upload_start = std::chrono::high_resolution_clock::now();
+    size_t data_bytes = sorted.size() * sizeof(float);
+    if (data_bytes > data_capacity) {
+        data_capacity = std::max(data_bytes, data_capacity * 2);
+    }
+    gpu_buffer_data(data_buffer, GL_TEXTURE_BUFFER, (GLsizeiptr)data_capacity, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_TEXTURE_BUFFER, 0, (GLsizeiptr)data_bytes, sorted.data());
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    stats.data_bytes = data_bytes;
+
+    if (indirect) {
+        size_t command_bytes = commands.size() * sizeof(IndirectCommand);
+        if (command_bytes > indirect_capacity) {
+            indirect_capacity = std::max(command_bytes, indirect_capacity * 2);
+        }
+        gpu_buffer_data(indirect_buffer, GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)indirect_capacity, nullptr,
+                        GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)command_bytes, commands.data());
+    }
+    stats.upload_ms = ms_since(upload_start);
+
+    glActiveTexture(GL_TEXTURE0 + data_unit);
+    glBindTexture(GL_TEXTURE_BUFFER, data_texture);
+    glActiveTexture(GL_TEXTURE0);
+    GLint draw_base = lookupUniforms(shader, data_unit).draw_base;
+
+    stats.commands = (int)commands.size();
+    stats.pages = (int)page_vaos.size();
+    if (indirect) {
+        // The base instance offsets the draw index
+        if (draw_base != -1) glUniform1i(draw_base, 0);
+        for (size_t p = 0; p < page_vaos.size(); p++) {
+            glBindVertexArray(page_vaos[p]);
+            s_multi_draw_elements_indirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+                                           (const void*)(page_starts[p] * sizeof(IndirectCommand)),
+                                           (GLsizei)(page_starts[p + 1] - page_starts[p]), 0);
+            stats.calls++;
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    } else {
+        // No base instance on 4.1: draw_base does its job, one call per command
+        for (size_t p = 0; p < page_vaos.size(); p++) {
+            glBindVertexArray(page_vaos[p]);
+            for (uint32_t c = page_starts[p]; c < page_starts[p + 1]; c++) {
+                const IndirectCommand& command = commands[c];
+                if (draw_base != -1) glUniform1i(draw_base, (GLint)command.base_instance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (GLsizei)command.count, GL_UNSIGNED_INT,
+                                                  (const void*)((size_t)command.first_index * sizeof(uint32_t)),
+                                                  (GLsizei)command.instance_count, command.base_vertex);
+                stats.calls++;
+            }
+        }
+    }
+    stats.submit_ms = ms_since(start);
+}
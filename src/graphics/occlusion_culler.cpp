@@ -0,0 +1,343 @@
+#include "graphics/occlusion_culler.h"
+#include "core/JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define OCCLUSION_USE_SSE 1
+#endif
+
+// Rows rasterized per job - each job owns its rows, so no locking
+static const int STRIP_HEIGHT = 8;
+
+// Texel footprint at which box tests stop descending the pyramid
+static const int MAX_TEST_TEXELS = 4;
+
+static double elapsed_ms(std::chrono::high_resolution_clock::time_point start) {
+    auto now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(now - start).count();
+}
+
+// Column-major mat4 * (x, y, z, 1)
+static void transform_point(const mat4& m, float x, float y, float z, float* out) {
+    out[0] = m.m[0] * x + m.m[4] * y + m.m[8] * z + m.m[12];
+    out[1] = m.m[1] * x + m.m[5] * y + m.m[9] * z + m.m[13];
+    out[2] = m.m[2] * x + m.m[6] * y + m.m[10] * z + m.m[14];
+    out[3] = m.m[3] * x + m.m[7] * y + m.m[11] * z + m.m[15];
+}
+
+OcclusionCuller::OcclusionCuller(int width, int height)
+    : width((width + 3) & ~3), height(height) {
+    depth.resize(this->width * this->height, 1.0f);
+
+    // Level 0 is the depth buffer itself; coarser levels halve each step
+    int w = this->width;
+    int h = this->height;
+    levels.push_back({w, h, {}, {}});
+    while (w > 1 || h > 1) {
+        w = std::max(1, (w + 1) / 2);
+        h = std::max(1, (h + 1) / 2);
+        Level level;
+        level.width = w;
+        level.height = h;
+        level.max_depth.resize(w * h, 1.0f);
+        level.min_depth.resize(w * h, 1.0f);
+        levels.push_back(level);
+    }
+
+    triangles.reserve(1024);
+    stats = {0, 0, 0, 0.0, 0.0};
+}
+
+void OcclusionCuller::beginFrame(const mat4& proj_view) {
+    this->proj_view = proj_view;
+    triangles.clear();
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    stats = {0, 0, 0, 0.0, 0.0};
+}
+
+void OcclusionCuller::addOccluder(const float* positions, int vertex_count,
+                                  const unsigned int* indices, int index_count,
+                                  const mat4& model) {
+    mat4 mvp = proj_view * model;
+    int count = indices ? index_count : vertex_count;
+
+    for (int i = 0; i + 2 < count; i += 3) {
+        float clip[3][4];
+        for (int k = 0; k < 3; k++) {
+            int v = indices ? (int)indices[i + k] : i + k;
+            if (v >= vertex_count) {
+                return;
+            }
+            transform_point(mvp, positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2], clip[k]);
+        }
+        addClippedTriangle(clip[0], clip[1], clip[2]);
+    }
+}
+
+// Clip against the near plane (z >= -w) so every emitted vertex has w > 0
+void OcclusionCuller::addClippedTriangle(const float* a, const float* b, const float* c) {
+    const float* in[3] = {a, b, c};
+    float dist[3];
+    int inside = 0;
+    for (int i = 0; i < 3; i++) {
+        dist[i] = in[i][2] + in[i][3];
+        if (dist[i] >= 0.0f) inside++;
+    }
+
+    if (inside == 0) {
+        return;
+    }
+    if (inside == 3) {
+        emitTriangle(a, b, c);
+        return;
+    }
+
+    // Sutherland-Hodgman against one plane: at most 4 output vertices
+    float poly[4][4];
+    int n = 0;
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        if (dist[i] >= 0.0f) {
+            for (int k = 0; k < 4; k++) poly[n][k] = in[i][k];
+            n++;
+        }
+        if ((dist[i] >= 0.0f) != (dist[j] >= 0.0f)) {
+            float t = dist[i] / (dist[i] - dist[j]);
+            for (int k = 0; k < 4; k++) poly[n][k] = in[i][k] + (in[j][k] - in[i][k]) * t;
+            n++;
+        }
+    }
+
+    for (int i = 1; i + 1 < n; i++) {
+        emitTriangle(poly[0], poly[i], poly[i + 1]);
+    }
+}
+
+void OcclusionCuller::emitTriangle(const float* a, const float* b, const float* c) {
+    const float* v[3] = {a, b, c};
+    ScreenTri tri;
+    for (int i = 0; i < 3; i++) {
+        float inv_w = 1.0f / std::max(v[i][3], 1e-6f);
+        tri.x[i] = (v[i][0] * inv_w * 0.5f + 0.5f) * width;
+        tri.y[i] = (v[i][1] * inv_w * 0.5f + 0.5f) * height;
+        tri.z[i] = std::min(std::max(v[i][2] * inv_w * 0.5f + 0.5f, 0.0f), 1.0f);
+    }
+
+    // Occluders are treated as double-sided: normalise to CCW winding
+    float area = (tri.x[1] - tri.x[0]) * (tri.y[2] - tri.y[0]) - (tri.x[2] - tri.x[0]) * (tri.y[1] - tri.y[0]);
+    if (area == 0.0f) {
+        return;
+    }
+    if (area < 0.0f) {
+        std::swap(tri.x[1], tri.x[2]);
+        std::swap(tri.y[1], tri.y[2]);
+        std::swap(tri.z[1], tri.z[2]);
+    }
+
+    triangles.push_back(tri);
+}
+
+void OcclusionCuller::finalize() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    stats.occluder_triangles = (int)triangles.size();
+
+    int strips = (height + STRIP_HEIGHT - 1) / STRIP_HEIGHT;
+    JobSystem::instance().parallelFor((uint32_t)strips, 1, [this](uint32_t begin, uint32_t end) {
+        for (uint32_t s = begin; s < end; s++) {
+            int row_begin = (int)s * STRIP_HEIGHT;
+            rasterizeRows(row_begin, std::min(row_begin + STRIP_HEIGHT, height));
+        }
+    });
+
+    buildPyramid();
+
+    stats.raster_ms = elapsed_ms(start);
+}
+
+// Half-space rasterizer, 4 pixels per step. Each triangle is set up as
+// three edge functions and a depth plane, all evaluated at pixel centres.
+void OcclusionCuller::rasterizeRows(int row_begin, int row_end) {
+    for (const ScreenTri& tri : triangles) {
+        float min_y = std::min(tri.y[0], std::min(tri.y[1], tri.y[2]));
+        float max_y = std::max(tri.y[0], std::max(tri.y[1], tri.y[2]));
+        int y0 = std::max(row_begin, (int)floorf(min_y));
+        int y1 = std::min(row_end - 1, (int)ceilf(max_y));
+        if (y0 > y1) {
+            continue;
+        }
+
+        float min_x = std::min(tri.x[0], std::min(tri.x[1], tri.x[2]));
+        float max_x = std::max(tri.x[0], std::max(tri.x[1], tri.x[2]));
+        int x0 = std::max(0, (int)floorf(min_x)) & ~3;
+        int x1 = std::min(width - 1, (int)ceilf(max_x));
+        if (x0 > x1) {
+            continue;
+        }
+
+        // Edge i runs from vertex i to vertex i+1: E(p) = A*px + B*py + C
+        float ea[3], eb[3], ec[3];
+        for (int i = 0; i < 3; i++) {
+            int j = (i + 1) % 3;
+            ea[i] = -(tri.y[j] - tri.y[i]);
+            eb[i] = tri.x[j] - tri.x[i];
+            ec[i] = -(ea[i] * tri.x[i] + eb[i] * tri.y[i]);
+        }
+
+        // Depth plane from barycentrics: edge i is opposite vertex (i+2)%3
+        float area = ea[0] * tri.x[2] + eb[0] * tri.y[2] + ec[0];
+        float inv_area = 1.0f / area;
+        float za = (ea[1] * tri.z[0] + ea[2] * tri.z[1] + ea[0] * tri.z[2]) * inv_area;
+        float zb = (eb[1] * tri.z[0] + eb[2] * tri.z[1] + eb[0] * tri.z[2]) * inv_area;
+        float zc = (ec[1] * tri.z[0] + ec[2] * tri.z[1] + ec[0] * tri.z[2]) * inv_area;
+
+        for (int y = y0; y <= y1; y++) {
+            float py = y + 0.5f;
+            float* row = &depth[y * width];
+
+#ifdef OCCLUSION_USE_SSE
+            __m128 lane = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+            __m128 zero = _mm_setzero_ps();
+            __m128 a0 = _mm_set1_ps(ea[0]), a1 = _mm_set1_ps(ea[1]), a2 = _mm_set1_ps(ea[2]);
+            __m128 r0 = _mm_set1_ps(eb[0] * py + ec[0]);
+            __m128 r1 = _mm_set1_ps(eb[1] * py + ec[1]);
+            __m128 r2 = _mm_set1_ps(eb[2] * py + ec[2]);
+            __m128 az = _mm_set1_ps(za);
+            __m128 rz = _mm_set1_ps(zb * py + zc);
+
+            for (int x = x0; x <= x1; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps((float)x), lane);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), r0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), r1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), r2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                           _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) {
+                    continue;
+                }
+                __m128 z = _mm_add_ps(_mm_mul_ps(az, px), rz);
+                __m128 old_z = _mm_loadu_ps(row + x);
+                __m128 new_z = _mm_min_ps(old_z, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_z), _mm_andnot_ps(inside, old_z)));
+            }
+#else
+            for (int x = x0; x <= x1; x++) {
+                float px = x + 0.5f;
+                float e0 = ea[0] * px + eb[0] * py + ec[0];
+                float e1 = ea[1] * px + eb[1] * py + ec[1];
+                float e2 = ea[2] * px + eb[2] * py + ec[2];
+                if (e0 >= 0.0f && e1 >= 0.0f && e2 >= 0.0f) {
+                    float z = za * px + zb * py + zc;
+                    if (z < row[x]) row[x] = z;
+                }
+            }
+#endif
+        }
+    }
+}
+
+void OcclusionCuller::buildPyramid() {
+    for (size_t l = 1; l < levels.size(); l++) {
+        const Level& src = levels[l - 1];
+        Level& dst = levels[l];
+        const float* src_max = (l == 1) ? depth.data() : src.max_depth.data();
+        const float* src_min = (l == 1) ? depth.data() : src.min_depth.data();
+
+        for (int y = 0; y < dst.height; y++) {
+            int sy0 = std::min(y * 2, src.height - 1);
+            int sy1 = std::min(y * 2 + 1, src.height - 1);
+            for (int x = 0; x < dst.width; x++) {
+                int sx0 = std::min(x * 2, src.width - 1);
+                int sx1 = std::min(x * 2 + 1, src.width - 1);
+                int i00 = sy0 * src.width + sx0, i01 = sy0 * src.width + sx1;
+                int i10 = sy1 * src.width + sx0, i11 = sy1 * src.width + sx1;
+                dst.max_depth[y * dst.width + x] = std::max(std::max(src_max[i00], src_max[i01]),
+                                                            std::max(src_max[i10], src_max[i11]));
+                dst.min_depth[y * dst.width + x] = std::min(std::min(src_min[i00], src_min[i01]),
+                                                            std::min(src_min[i10], src_min[i11]));
+            }
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const AABB& box) const {
+    float min_x = 1e30f, min_y = 1e30f, max_x = -1e30f, max_y = -1e30f;
+    float min_z = 1.0f;
+
+    for (int i = 0; i < 8; i++) {
+        float clip[4];
+        transform_point(proj_view,
+                        (i & 1) ? box.max.v[0] : box.min.v[0],
+                        (i & 2) ? box.max.v[1] : box.min.v[1],
+                        (i & 4) ? box.max.v[2] : box.min.v[2], clip);
+
+        // Box crosses the near plane - the camera is inside or touching it
+        if (clip[2] < -clip[3] || clip[3] <= 1e-6f) {
+            return true;
+        }
+
+        float inv_w = 1.0f / clip[3];
+        float sx = (clip[0] * inv_w * 0.5f + 0.5f) * width;
+        float sy = (clip[1] * inv_w * 0.5f + 0.5f) * height;
+        float sz = clip[2] * inv_w * 0.5f + 0.5f;
+        min_x = std::min(min_x, sx);
+        max_x = std::max(max_x, sx);
+        min_y = std::min(min_y, sy);
+        max_y = std::max(max_y, sy);
+        min_z = std::min(min_z, sz);
+    }
+
+    int x0 = std::max(0, (int)floorf(min_x));
+    int y0 = std::max(0, (int)floorf(min_y));
+    int x1 = std::min(width - 1, (int)floorf(max_x));
+    int y1 = std::min(height - 1, (int)floorf(max_y));
+    if (x0 > x1 || y0 > y1) {
+        return true;  // Off screen - nothing here can occlude it
+    }
+
+    // Nearer than every occluder on screen: trivially visible
+    if (min_z < levels.back().min_depth[0]) {
+        return true;
+    }
+
+    // Coarsest level where the box covers at most MAX_TEST_TEXELS per axis
+    size_t l = 0;
+    while (l + 1 < levels.size() &&
+           ((x1 >> l) - (x0 >> l) >= MAX_TEST_TEXELS || (y1 >> l) - (y0 >> l) >= MAX_TEST_TEXELS)) {
+        l++;
+    }
+
+    const Level& level = levels[l];
+    const float* max_depth = (l == 0) ? depth.data() : level.max_depth.data();
+    for (int y = y0 >> l; y <= (y1 >> l); y++) {
+        for (int x = x0 >> l; x <= (x1 >> l); x++) {
+            if (min_z <= max_depth[y * level.width + x]) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void OcclusionCuller::testVisibility(const AABB* boxes, uint32_t count, uint8_t* visible) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::atomic<int> occluded(0);
+    JobSystem::instance().parallelFor(count, 64, [&](uint32_t begin, uint32_t end) {
+        int local_occluded = 0;
+        for (uint32_t i = begin; i < end; i++) {
+            visible[i] = isVisible(boxes[i]) ? 1 : 0;
+            if (!visible[i]) local_occluded++;
+        }
+        occluded.fetch_add(local_occluded);
+    });
+
+    stats.objects_tested += (int)count;
+    stats.objects_occluded += occluded.load();
+    stats.test_ms += elapsed_ms(start);
+}
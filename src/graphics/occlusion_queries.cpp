@@ -0,0 +1,161 @@
+#include "graphics/occlusion_queries.h"
+#include "graphics/gpu_handles.h"
+#include "utils/frame_stats.h"
+#include "utils/log.h"
+
+// Unit cube, 12 triangles (winding does not matter, culling is off)
+static const GLfloat unit_cube[] = {
+    0,0,0, 1,0,0, 1,1,0,   0,0,0, 1,1,0, 0,1,0,   // -Z
+    0,0,1, 1,1,1, 1,0,1,   0,0,1, 0,1,1, 1,1,1,   // +Z
+    0,0,0, 0,1,1, 0,0,1,   0,0,0, 0,1,0, 0,1,1,   // -X
+    1,0,0, 1,0,1, 1,1,1,   1,0,0, 1,1,1, 1,1,0,   // +X
+    0,0,0, 0,0,1, 1,0,1,   0,0,0, 1,0,1, 1,0,0,   // -Y
+    0,1,0, 1,1,1, 0,1,1,   0,1,0, 1,1,0, 1,1,1    // +Y
+};
+
+OcclusionQueryManager::OcclusionQueryManager()
+    : pending_pool(256), pending_list(nullptr), frame(1), box_vao(0), box_vbo(0), proj_view_loc(-1),
+      box_min_loc(-1), box_max_loc(-1), conditional_render(false), hide_after_frames(3) {}
+
+OcclusionQueryManager::~OcclusionQueryManager() {
+    for (auto& obj : objects) {
+        glDeleteQueries(1, &obj.query);
+    }
+    gpu_release_vertex_array(box_vao);
+    gpu_release_buffer(box_vbo);
+}
+
+bool OcclusionQueryManager::init(int object_count) {
+    if (!box_shader.loadFromFiles("shaders/engine/bounding_box/vertex.glsl",
+                                  "shaders/engine/bounding_box/fragment.glsl")) {
+        gl_log_err("ERROR: could not load bounding box shader for occlusion queries\n");
+        return false;
+    }
+    proj_view_loc = glGetUniformLocation(box_shader.programme, "proj_view");
+    box_min_loc = glGetUniformLocation(box_shader.programme, "box_min");
+    box_max_loc = glGetUniformLocation(box_shader.programme, "box_max");
+
+    box_vbo = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, "occlusion query box");
+    gpu_buffer_data(box_vbo, GL_ARRAY_BUFFER, sizeof(unit_cube), unit_cube, GL_STATIC_DRAW);
+
+    box_vao = gpu_create_vertex_array("occlusion query box");
+    glBindVertexArray(box_vao);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+
+    objects.resize(object_count);
+    for (auto& obj : objects) {
+        glGenQueries(1, &obj.query);
+        obj.pending = false;
+        obj.visible = true;  // Assume visible until proven otherwise
+        obj.occluded_frames = 0;
+        obj.issued_frame = 0;
+    }
+    // At most one query per object is in flight
+    pending_pool.reserve(objects.size());
+
+    gl_log("Occlusion query manager: %d objects\n", object_count);
+    return true;
+}
+
+void OcclusionQueryManager::beginFrame(const mat4& proj_view) {
+    this->proj_view = proj_view;
+    frame++;
+
+    PendingQuery** link = &pending_list;
+    while (PendingQuery* record = *link) {
+        QueryObject& obj = objects[record->id];
+        GLuint available = 0;
+        glGetQueryObjectuiv(obj.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            link = &record->next;
+            continue;  // Keep the old answer rather than stall
+        }
+
+        GLuint any_samples = 0;
+        glGetQueryObjectuiv(obj.query, GL_QUERY_RESULT, &any_samples);
+        obj.pending = false;
+        *link = record->next;
+        pending_pool.destroy(record);
+
+        // Show immediately, hide only after several occluded results
+        if (any_samples) {
+            obj.occluded_frames = 0;
+            obj.visible = true;
+        } else if (++obj.occluded_frames >= hide_after_frames) {
+            obj.visible = false;
+        }
+    }
+}
+
+void OcclusionQueryManager::beginQueries() {
+    box_shader.use();
+    glUniformMatrix4fv(proj_view_loc, 1, GL_FALSE, proj_view.m);
+    glBindVertexArray(box_vao);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+}
+
+void OcclusionQueryManager::endQueries() {
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+}
+
+// Any corner behind the near plane (z < -w in clip space) means the box
+// is clipped there, which also covers the camera being inside it
+bool OcclusionQueryManager::reachesNearPlane(const AABB& box) const {
+    const float* m = proj_view.m;
+    for (int i = 0; i < 8; i++) {
+        float x = (i & 1) ? box.max.v[0] : box.min.v[0];
+        float y = (i & 2) ? box.max.v[1] : box.min.v[1];
+        float z = (i & 4) ? box.max.v[2] : box.min.v[2];
+        float clip_z = m[2] * x + m[6] * y + m[10] * z + m[14];
+        float clip_w = m[3] * x + m[7] * y + m[11] * z + m[15];
+        if (clip_z < -clip_w || clip_w <= 1e-6f) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void OcclusionQueryManager::queryObject(int id, const AABB& box) {
+    QueryObject& obj = objects[id];
+    if (reachesNearPlane(box)) {
+        // A clipped box passes no samples, so it cannot be queried
+        obj.visible = true;
+        obj.occluded_frames = 0;
+        return;
+    }
+    if (obj.pending) {
+        return;  // Previous result still in flight
+    }
+
+    glUniform3f(box_min_loc, box.min.v[0], box.min.v[1], box.min.v[2]);
+    glUniform3f(box_max_loc, box.max.v[0], box.max.v[1], box.max.v[2]);
+
+    glBeginQuery(GL_ANY_SAMPLES_PASSED, obj.query);
+    glDrawArrays(GL_TRIANGLES, 0, 36);
+    glEndQuery(GL_ANY_SAMPLES_PASSED);
+
+    obj.pending = true;
+    obj.issued_frame = frame;
+    pending_list = pending_pool.create(PendingQuery{id, pending_list});
+    g_frame_stats.occlusion_queries++;
+}
+
+bool OcclusionQueryManager::isVisible(int id) const {
+    return objects[id].visible;
+}
+
+void OcclusionQueryManager::beginConditional(int id) {
+    if (conditional_render && objects[id].issued_frame == frame) {
+        glBeginConditionalRender(objects[id].query, GL_QUERY_NO_WAIT);
+    }
+}
+
+void OcclusionQueryManager::endConditional(int id) {
+    if (conditional_render && objects[id].issued_frame == frame) {
+        glEndConditionalRender();
+    }
+}
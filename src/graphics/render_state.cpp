@@ -0,0 +1,60 @@
+#include "graphics/render_state.h"
+#include "utils/frame_stats.h"
+
+RenderStateCache::RenderStateCache() : programme(0), vertex_array(0), stats() {
+    invalidate();
+}
+
+void RenderStateCache::invalidate() {
+    valid_programme = false;
+    valid_vertex_array = false;
+    for (int i = 0; i < MAX_UNIFORM_BINDINGS; i++) {
+        valid_ranges[i] = false;
+    }
+}
+
+void RenderStateCache::useProgram(GLuint programme) {
+    if (valid_programme && this->programme == programme) {
+        stats.redundant++;
+        return;
+    }
+    glUseProgram(programme);
+    this->programme = programme;
+    valid_programme = true;
+    stats.programme_binds++;
+    g_frame_stats.state_changes++;
+}
+
+void RenderStateCache::bindVertexArray(GLuint vertex_array) {
+    if (valid_vertex_array && this->vertex_array == vertex_array) {
+        stats.redundant++;
+        return;
+    }
+    glBindVertexArray(vertex_array);
+    this->vertex_array = vertex_array;
+    valid_vertex_array = true;
+    stats.vertex_array_binds++;
+    g_frame_stats.state_changes++;
+}
+
+void RenderStateCache::bindUniformRange(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+    if (binding >= (GLuint)MAX_UNIFORM_BINDINGS) {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+        stats.uniform_range_binds++;
+        g_frame_stats.state_changes++;
+        return;
+    }
+
+    UniformRange& range = uniform_ranges[binding];
+    if (valid_ranges[binding] && range.buffer == buffer && range.offset == offset && range.size == size) {
+        stats.redundant++;
+        return;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, size);
+    range.buffer = buffer;
+    range.offset = offset;
+    range.size = size;
+    valid_ranges[binding] = true;
+    stats.uniform_range_binds++;
+    g_frame_stats.state_changes++;
+}
@@ -1,99 +1,296 @@
 #include "graphics/shader.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/shader_preprocessor.h"
 #include "utils/log.h"
 #include "utils/utils.h"
 #include <iostream>
 
-Shader::Shader() : programme(0), vertex_shader(0), fragment_shader(0) {}
+Shader::Shader() : programme(0), generation(0), vertex_shader(0), fragment_shader(0) {}
 
 Shader::~Shader() {
+    ShaderDependencyGraph::instance().remove(this);
     if (vertex_shader) glDeleteShader(vertex_shader);
     if (fragment_shader) glDeleteShader(fragment_shader);
-    if (programme) glDeleteProgram(programme);
+    gpu_release_program(programme);
 }
 
 bool Shader::loadFromFiles(const std::string& vertex_path, const std::string& fragment_path) {
-    // Store paths for reload functionality
+    return loadFromFiles(vertex_path, fragment_path, std::vector<std::string>());
+}
+
+bool Shader::loadFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                           const std::vector<std::string>& defines) {
+    // Store paths and defines for reload functionality
     this->vertex_path = vertex_path;
     this->fragment_path = fragment_path;
+    this->defines = defines;
     
     gl_log("Loading shaders: %s, %s\n", vertex_path.c_str(), fragment_path.c_str());
     
-    // Read shader source files
-    std::string vertex_source = readShaderFile(vertex_path);
-    std::string fragment_source = readShaderFile(fragment_path);
+    ShaderBuild result;
+    bool ok = build(result);
+    
+    // Register the files even if compilation fails, so fixing any of them
+    // triggers another attempt
+    if (!result.files.empty()) {
+        ShaderDependencyGraph::instance().setDependencies(this, result.files);
+    }
+    if (!ok) {
+        discardBuild(result);
+        return false;
+    }
+    
+    install(result, false);
+    gl_log("Shader programme %i loaded successfully\n", programme);
+    return true;
+}
+
+bool Shader::build(ShaderBuild& out) const {
+    return buildFromFiles(vertex_path, fragment_path, defines, out);
+}
+
+bool Shader::buildFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                            const std::vector<std::string>& defines, ShaderBuild& out) {
+    if (!submitFromFiles(vertex_path, fragment_path, defines, out)) {
+        return false;
+    }
+    return completeBuild(out);
+}
+
+bool Shader::submitFromFiles(const std::string& vertex_path, const std::string& fragment_path,
+                             const std::vector<std::string>& defines, ShaderBuild& out) {
+    out = ShaderBuild();
+    
+    // Read shader source files and resolve #include
+    ShaderSource vertex, fragment;
+    std::string error;
+    bool read_ok = preprocess_shader(vertex_path, vertex, &error) && preprocess_shader(fragment_path, fragment, &error);
+    out.files = vertex.files;
+    out.files.insert(out.files.end(), fragment.files.begin(), fragment.files.end());
+    out.vertex_file_count = vertex.files.size();
+    if (!read_ok) {
+        gl_log_err("Failed to load shader files: %s\n", error.c_str());
+        std::cerr << "ERROR: " << error << std::endl;
+        return false;
+    }
+    
+    std::string vertex_source = vertex.code;
+    std::string fragment_source = fragment.code;
+    if (!defines.empty()) {
+        vertex_source = injectDefines(vertex_source, defines);
+        fragment_source = injectDefines(fragment_source, defines);
+    }
     
-    if (vertex_source.empty() || fragment_source.empty()) {
-        gl_log_err("Failed to load shader files\n");
+    // Create shader objects and start compiling. Nothing here asks for a
+    // result, so the driver does not have to finish before we return
+    out.vertex_shader = glCreateShader(GL_VERTEX_SHADER);
+    out.fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    const char* src = vertex_source.c_str();
+    glShaderSource(out.vertex_shader, 1, &src, nullptr);
+    glCompileShader(out.vertex_shader);
+    src = fragment_source.c_str();
+    glShaderSource(out.fragment_shader, 1, &src, nullptr);
+    glCompileShader(out.fragment_shader);
+    
+    // Linking a programme with a failed stage just fails the link;
+    // completeBuild reports the compile error first
+    out.programme = gpu_create_program(fragment_path.c_str());
+    glAttachShader(out.programme, out.vertex_shader);
+    glAttachShader(out.programme, out.fragment_shader);
+    glLinkProgram(out.programme);
+    return true;
+}
+
+bool Shader::completeBuild(ShaderBuild& result) {
+    result.ok = false;
+    if (!result.programme) {
         return false;
     }
     
-    // Create shader objects
-    vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
+    std::vector<std::string> vertex_files(result.files.begin(), result.files.begin() + result.vertex_file_count);
+    std::vector<std::string> fragment_files(result.files.begin() + result.vertex_file_count, result.files.end());
     
-    // Compile shaders
-    if (!compileShader(vertex_shader, vertex_source)) {
+    if (!checkCompile(result.vertex_shader)) {
         gl_log_err("Vertex shader compilation failed\n");
+        printSourceFiles(vertex_files);
         return false;
     }
     
-    if (!compileShader(fragment_shader, fragment_source)) {
+    if (!checkCompile(result.fragment_shader)) {
         gl_log_err("Fragment shader compilation failed\n");
+        printSourceFiles(fragment_files);
         return false;
     }
     
-    // Create and link program
-    programme = glCreateProgram();
-    glAttachShader(programme, vertex_shader);
-    glAttachShader(programme, fragment_shader);
-    
-    if (!linkProgram()) {
+    if (!checkLink(result.programme)) {
         gl_log_err("Shader program linking failed\n");
         return false;
     }
     
-    gl_log("Shader programme %i loaded successfully\n", programme);
+    result.ok = true;
     return true;
 }
 
-bool Shader::reload() {
-    gl_log("Reloading shaders: %s, %s\n", vertex_path.c_str(), fragment_path.c_str());
+void Shader::setSources(const std::string& vertex_path, const std::string& fragment_path,
+                        const std::vector<std::string>& defines) {
+    this->vertex_path = vertex_path;
+    this->fragment_path = fragment_path;
+    this->defines = defines;
+}
+
+void Shader::install(ShaderBuild& result, bool keep_uniforms) {
+    if (keep_uniforms && programme) {
+        copyUniforms(programme, result.programme);
+    }
     
-    // Save old programme in case reload fails
-    GLuint old_programme = programme;
-    GLuint old_vs = vertex_shader;
-    GLuint old_fs = fragment_shader;
+    // Delete old shaders. Frames still in flight may draw with the old
+    // programme, so it goes once their fence has signalled
+    if (vertex_shader) glDeleteShader(vertex_shader);
+    if (fragment_shader) glDeleteShader(fragment_shader);
+    gpu_release_program(programme);
     
-    // Reset IDs
-    programme = 0;
-    vertex_shader = 0;
-    fragment_shader = 0;
+    programme = result.programme;
+    vertex_shader = result.vertex_shader;
+    fragment_shader = result.fragment_shader;
+    generation++;
+    ShaderDependencyGraph::instance().setDependencies(this, result.files);
+    result = ShaderBuild();
+}
+
+void Shader::discardBuild(ShaderBuild& result) {
+    if (result.vertex_shader) glDeleteShader(result.vertex_shader);
+    if (result.fragment_shader) glDeleteShader(result.fragment_shader);
+    gpu_delete_program(result.programme);
+    result = ShaderBuild();
+}
+
+bool Shader::reload() {
+    gl_log("Reloading shaders: %s, %s\n", vertex_path.c_str(), fragment_path.c_str());
     
-    // Try to reload
-    if (!loadFromFiles(vertex_path, fragment_path)) {
+    // Build next to the old programme so a failure keeps it
+    ShaderBuild result;
+    bool ok = build(result);
+    if (!result.files.empty()) {
+        ShaderDependencyGraph::instance().setDependencies(this, result.files);
+    }
+    if (!ok) {
         gl_log_err("Shader reload failed, keeping old shaders\n");
-        // Restore old shaders
-        programme = old_programme;
-        vertex_shader = old_vs;
-        fragment_shader = old_fs;
+        discardBuild(result);
         return false;
     }
     
-    // Delete old shaders
-    glDeleteShader(old_vs);
-    glDeleteShader(old_fs);
-    glDeleteProgram(old_programme);
+    install(result, true);
     
     gl_log("Shaders reloaded successfully!\n");
     std::cout << "✓ Shaders reloaded successfully!" << std::endl;
     return true;
 }
 
-bool Shader::compileShader(GLuint shader_index, const std::string& source) {
-    const char* src = source.c_str();
-    glShaderSource(shader_index, 1, &src, nullptr);
-    glCompileShader(shader_index);
-    
+void Shader::copyUniforms(GLuint from, GLuint to) {
+    GLint previous = 0;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &previous);
+    glUseProgram(to);
+
+    GLint count = 0;
+    glGetProgramiv(from, GL_ACTIVE_UNIFORMS, &count);
+    for (GLint i = 0; i < count; i++) {
+        char name[128];
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(from, (GLuint)i, sizeof(name), nullptr, &size, &type, name);
+
+        // Array uniforms are reported as "name[0]"; copy each element
+        std::string base = name;
+        size_t bracket = base.find('[');
+        if (bracket != std::string::npos) base = base.substr(0, bracket);
+
+        for (GLint e = 0; e < size; e++) {
+            std::string element = size > 1 ? base + "[" + std::to_string(e) + "]" : std::string(name);
+            GLint src = glGetUniformLocation(from, element.c_str());
+            GLint dst = glGetUniformLocation(to, element.c_str());
+            if (src == -1 || dst == -1) continue;
+
+            GLfloat f[16];
+            GLdouble d[16];
+            GLint n[4];
+            GLuint u[4];
+            switch (type) {
+                case GL_FLOAT: glGetUniformfv(from, src, f); glUniform1fv(dst, 1, f); break;
+                case GL_FLOAT_VEC2: glGetUniformfv(from, src, f); glUniform2fv(dst, 1, f); break;
+                case GL_FLOAT_VEC3: glGetUniformfv(from, src, f); glUniform3fv(dst, 1, f); break;
+                case GL_FLOAT_VEC4: glGetUniformfv(from, src, f); glUniform4fv(dst, 1, f); break;
+                case GL_FLOAT_MAT2: glGetUniformfv(from, src, f); glUniformMatrix2fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3: glGetUniformfv(from, src, f); glUniformMatrix3fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4: glGetUniformfv(from, src, f); glUniformMatrix4fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT2x3: glGetUniformfv(from, src, f); glUniformMatrix2x3fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT2x4: glGetUniformfv(from, src, f); glUniformMatrix2x4fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3x2: glGetUniformfv(from, src, f); glUniformMatrix3x2fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT3x4: glGetUniformfv(from, src, f); glUniformMatrix3x4fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4x2: glGetUniformfv(from, src, f); glUniformMatrix4x2fv(dst, 1, GL_FALSE, f); break;
+                case GL_FLOAT_MAT4x3: glGetUniformfv(from, src, f); glUniformMatrix4x3fv(dst, 1, GL_FALSE, f); break;
+                case GL_DOUBLE: glGetUniformdv(from, src, d); glUniform1dv(dst, 1, d); break;
+                case GL_DOUBLE_VEC2: glGetUniformdv(from, src, d); glUniform2dv(dst, 1, d); break;
+                case GL_DOUBLE_VEC3: glGetUniformdv(from, src, d); glUniform3dv(dst, 1, d); break;
+                case GL_DOUBLE_VEC4: glGetUniformdv(from, src, d); glUniform4dv(dst, 1, d); break;
+                case GL_DOUBLE_MAT2: glGetUniformdv(from, src, d); glUniformMatrix2dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT3: glGetUniformdv(from, src, d); glUniformMatrix3dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT4: glGetUniformdv(from, src, d); glUniformMatrix4dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT2x3: glGetUniformdv(from, src, d); glUniformMatrix2x3dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT2x4: glGetUniformdv(from, src, d); glUniformMatrix2x4dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT3x2: glGetUniformdv(from, src, d); glUniformMatrix3x2dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT3x4: glGetUniformdv(from, src, d); glUniformMatrix3x4dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT4x2: glGetUniformdv(from, src, d); glUniformMatrix4x2dv(dst, 1, GL_FALSE, d); break;
+                case GL_DOUBLE_MAT4x3: glGetUniformdv(from, src, d); glUniformMatrix4x3dv(dst, 1, GL_FALSE, d); break;
+                case GL_INT_VEC2: case GL_BOOL_VEC2: glGetUniformiv(from, src, n); glUniform2iv(dst, 1, n); break;
+                case GL_INT_VEC3: case GL_BOOL_VEC3: glGetUniformiv(from, src, n); glUniform3iv(dst, 1, n); break;
+                case GL_INT_VEC4: case GL_BOOL_VEC4: glGetUniformiv(from, src, n); glUniform4iv(dst, 1, n); break;
+                case GL_UNSIGNED_INT: glGetUniformuiv(from, src, u); glUniform1uiv(dst, 1, u); break;
+                case GL_UNSIGNED_INT_VEC2: glGetUniformuiv(from, src, u); glUniform2uiv(dst, 1, u); break;
+                case GL_UNSIGNED_INT_VEC3: glGetUniformuiv(from, src, u); glUniform3uiv(dst, 1, u); break;
+                case GL_UNSIGNED_INT_VEC4: glGetUniformuiv(from, src, u); glUniform4uiv(dst, 1, u); break;
+                case GL_INT:
+                case GL_BOOL:
+                default:
+                    // Every other type in GL 4.1 is a sampler, set as one int
+                    glGetUniformiv(from, src, n);
+                    glUniform1iv(dst, 1, n);
+                    break;
+            }
+        }
+    }
+
+    glUseProgram((GLuint)previous == from ? to : (GLuint)previous);
+}
+
+std::string Shader::injectDefines(const std::string& source, const std::vector<std::string>& defines) {
+    std::string block;
+    for (const std::string& define : defines) {
+        size_t space = define.find(' ');
+        if (space == std::string::npos) {
+            block += "#define " + define + " 1\n";
+        } else {
+            block += "#define " + define.substr(0, space) + " " + define.substr(space + 1) + "\n";
+        }
+    }
+
+    // #version must stay the first statement
+    size_t version = source.find("#version");
+    if (version == std::string::npos) {
+        return block + "#line 1\n" + source;
+    }
+    size_t line_end = source.find('\n', version);
+    if (line_end == std::string::npos) {
+        return source + "\n" + block;
+    }
+    int version_line = 1;
+    for (size_t i = 0; i < line_end; i++) {
+        if (source[i] == '\n') version_line++;
+    }
+    return source.substr(0, line_end + 1) + block + "#line " + std::to_string(version_line + 1) + "\n" +
+           source.substr(line_end + 1);
+}
+
+bool Shader::checkCompile(GLuint shader_index) {
     // Check for compile errors
     int params = -1;
     glGetShaderiv(shader_index, GL_COMPILE_STATUS, &params);
@@ -107,9 +304,7 @@ bool Shader::compileShader(GLuint shader_index, const std::string& source) {
     return true;
 }
 
-bool Shader::linkProgram() {
-    glLinkProgram(programme);
-    
+bool Shader::checkLink(GLuint programme) {
     // Check if link was successful
     int params = -1;
     glGetProgramiv(programme, GL_LINK_STATUS, &params);
@@ -145,18 +340,18 @@ bool Shader::validate() {
     return true;
 }
 
-GLint Shader::getUniformLocation(const std::string& name) {
-    GLint location = glGetUniformLocation(programme, name.c_str());
+GLint Shader::getUniformLocation(const char* name) {
+    GLint location = glGetUniformLocation(programme, name);
     if (location == -1) {
-        gl_log_err("Warning: uniform '%s' not found or not active\n", name.c_str());
+        gl_log_err("Warning: uniform '%s' not found or not active\n", name);
     }
     return location;
 }
 
 // Uniform setters with automatic shader activation check
-void Shader::setUniform(const std::string& name, int value) {
+void Shader::setUniform(const char* name, int value) {
     if (!isInUse()) {
-        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name.c_str(), programme);
+        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name, programme);
         return;
     }
     GLint location = getUniformLocation(name);
@@ -165,9 +360,9 @@ void Shader::setUniform(const std::string& name, int value) {
     }
 }
 
-void Shader::setUniform(const std::string& name, float value) {
+void Shader::setUniform(const char* name, float value) {
     if (!isInUse()) {
-        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name.c_str(), programme);
+        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name, programme);
         return;
     }
     GLint location = getUniformLocation(name);
@@ -176,9 +371,9 @@ void Shader::setUniform(const std::string& name, float value) {
     }
 }
 
-void Shader::setUniform(const std::string& name, float x, float y) {
+void Shader::setUniform(const char* name, float x, float y) {
     if (!isInUse()) {
-        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name.c_str(), programme);
+        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name, programme);
         return;
     }
     GLint location = getUniformLocation(name);
@@ -187,9 +382,9 @@ void Shader::setUniform(const std::string& name, float x, float y) {
     }
 }
 
-void Shader::setUniform(const std::string& name, float x, float y, float z) {
+void Shader::setUniform(const char* name, float x, float y, float z) {
     if (!isInUse()) {
-        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name.c_str(), programme);
+        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name, programme);
         return;
     }
     GLint location = getUniformLocation(name);
@@ -198,9 +393,9 @@ void Shader::setUniform(const std::string& name, float x, float y, float z) {
     }
 }
 
-void Shader::setUniform(const std::string& name, float x, float y, float z, float w) {
+void Shader::setUniform(const char* name, float x, float y, float z, float w) {
     if (!isInUse()) {
-        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name.c_str(), programme);
+        gl_log_err("ERROR: Trying to set uniform '%s' but shader %i is not in use!\n", name, programme);
         return;
     }
     GLint location = getUniformLocation(name);
@@ -209,6 +404,14 @@ void Shader::setUniform(const std::string& name, float x, float y, float z, floa
     }
 }
 
+void Shader::printSourceFiles(const std::vector<std::string>& files) {
+    // Error locations are "source:line"; source numbers index this list
+    for (size_t i = 0; i < files.size(); i++) {
+        gl_log_err("  source %zu: %s\n", i, files[i].c_str());
+        std::cerr << "  source " << i << ": " << files[i] << std::endl;
+    }
+}
+
 void Shader::printShaderInfoLog(GLuint shader_index) {
     int max_length = 2048;
     int actual_length = 0;
@@ -0,0 +1,140 @@
+#include "graphics/shader_batch.h"
+#include "graphics/shader_preprocessor.h"
+#include "utils/log.h"
+#include <GLFW/glfw3.h>
+#include <iostream>
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile share the
+// token; glad was generated without either extension
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+typedef void (*MaxShaderCompilerThreadsProc)(GLuint count);
+
+static bool s_parallel_compile = false;
+
+bool ShaderBatch::initParallelCompile() {
+    const char* entry = nullptr;
+    if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+        entry = "glMaxShaderCompilerThreadsKHR";
+    } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+        entry = "glMaxShaderCompilerThreadsARB";
+    }
+    s_parallel_compile = entry != nullptr;
+    if (!s_parallel_compile) {
+        gl_log("Parallel shader compile: not supported, status checks are deferred instead\n");
+        return false;
+    }
+
+    // 0xFFFFFFFF = as many threads as the implementation supports
+    MaxShaderCompilerThreadsProc max_threads = (MaxShaderCompilerThreadsProc)glfwGetProcAddress(entry);
+    if (max_threads) {
+        max_threads(0xFFFFFFFFu);
+    }
+    gl_log("Parallel shader compile: %s\n", entry);
+    return true;
+}
+
+bool ShaderBatch::isParallelCompileSupported() {
+    return s_parallel_compile;
+}
+
+ShaderBatch::ShaderBatch() : stats() {}
+
+ShaderBatch::~ShaderBatch() {
+    for (Entry& entry : pending) {
+        Shader::discardBuild(entry.build);
+    }
+}
+
+void ShaderBatch::add(Shader* target, const std::string& vertex_path, const std::string& fragment_path,
+                      const std::vector<std::string>& defines) {
+    Entry entry;
+    entry.target = target;
+    entry.vertex_path = vertex_path;
+    entry.fragment_path = fragment_path;
+    entry.defines = defines;
+    queued.push_back(std::move(entry));
+}
+
+double ShaderBatch::elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+void ShaderBatch::submit() {
+    if (queued.empty()) {
+        return;
+    }
+    if (pending.empty()) {
+        start = std::chrono::high_resolution_clock::now();
+        stats = Stats();
+    }
+
+    auto submit_start = std::chrono::high_resolution_clock::now();
+    for (Entry& entry : queued) {
+        entry.target->setSources(entry.vertex_path, entry.fragment_path, entry.defines);
+        stats.submitted++;
+        if (!Shader::submitFromFiles(entry.vertex_path, entry.fragment_path, entry.defines, entry.build)) {
+            // Unreadable source: nothing was submitted, report it now
+            complete(entry);
+            continue;
+        }
+        pending.push_back(std::move(entry));
+    }
+    queued.clear();
+    stats.submit_ms += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() -
+                                                                 submit_start).count();
+    gl_log("Shader batch: submitted %d programmes in %.2f ms (%s)\n", stats.submitted, stats.submit_ms,
+           s_parallel_compile ? "parallel compile" : "deferred status checks");
+}
+
+void ShaderBatch::complete(Entry& entry) {
+    // Register the files even on failure so hot reload can retry
+    if (!entry.build.files.empty()) {
+        ShaderDependencyGraph::instance().setDependencies(entry.target, entry.build.files);
+    }
+
+    if (entry.build.programme && Shader::completeBuild(entry.build)) {
+        entry.target->install(entry.build, false);
+        stats.installed++;
+        if (stats.installed == 1) {
+            stats.first_ready_ms = elapsedMs();
+        }
+    } else {
+        gl_log_err("ERROR: batched shader %s / %s failed\n", entry.vertex_path.c_str(), entry.fragment_path.c_str());
+        Shader::discardBuild(entry.build);
+        stats.failed++;
+    }
+    stats.total_ms = elapsedMs();
+}
+
+int ShaderBatch::poll() {
+    size_t kept = 0;
+    for (size_t i = 0; i < pending.size(); i++) {
+        Entry& entry = pending[i];
+        if (s_parallel_compile) {
+            GLint done = GL_FALSE;
+            glGetProgramiv(entry.build.programme, GL_COMPLETION_STATUS_KHR, &done);
+            if (!done) {
+                if (kept != i) pending[kept] = std::move(entry);
+                kept++;
+                continue;
+            }
+        }
+        complete(entry);
+    }
+    pending.resize(kept);
+    return getPendingCount();
+}
+
+bool ShaderBatch::finish() {
+    submit();
+    for (Entry& entry : pending) {
+        complete(entry);
+    }
+    pending.clear();
+    gl_log("Shader batch: %d installed, %d failed, first ready %.2f ms, all done %.2f ms\n", stats.installed,
+           stats.failed, stats.first_ready_ms, stats.total_ms);
+    return stats.failed == 0;
+}
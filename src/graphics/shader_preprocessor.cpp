@@ -0,0 +1,227 @@
+#include "graphics/shader_preprocessor.h"
+#include "graphics/shader.h"
+#include "utils/log.h"
+#include <fstream>
+#include <sstream>
+
+std::string normalize_shader_path(const std::string& path) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t slash = path.find('/', start);
+        if (slash == std::string::npos) slash = path.size();
+        std::string part = path.substr(start, slash - start);
+        if (part == "..") {
+            if (!parts.empty() && parts.back() != "..") {
+                parts.pop_back();
+            } else {
+                parts.push_back(part);
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = slash + 1;
+    }
+
+    std::string result = (!path.empty() && path[0] == '/') ? "/" : "";
+    for (size_t i = 0; i < parts.size(); i++) {
+        if (i > 0) result += '/';
+        result += parts[i];
+    }
+    return result;
+}
+
+static bool read_text_file(const std::string& path, std::string& out) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    out = buffer.str();
+    return true;
+}
+
+static std::string directory_of(const std::string& path) {
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+namespace {
+
+struct IncludeContext {
+    ShaderSource& out;
+    std::unordered_map<std::string, int> source_numbers;
+    std::string* error;
+};
+
+}
+
+static bool fail(IncludeContext& ctx, const std::string& file, int line, const std::string& message) {
+    if (ctx.error) {
+        *ctx.error = file + ":" + std::to_string(line) + ": " + message;
+    }
+    return false;
+}
+
+static bool process_file(IncludeContext& ctx, const std::string& path, const std::string& text, int source_number) {
+    std::string& code = ctx.out.code;
+    int line_number = 0;
+    size_t start = 0;
+
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size();
+        std::string line = text.substr(start, end - start);
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        start = end + 1;
+        line_number++;
+
+        size_t first = line.find_first_not_of(" \t");
+        if (first == std::string::npos || line[first] != '#') {
+            code += line;
+            code += '\n';
+            continue;
+        }
+
+        // "#  include" is valid preprocessor spelling
+        size_t directive = line.find_first_not_of(" \t", first + 1);
+        if (directive == std::string::npos || line.compare(directive, 7, "include") != 0) {
+            // Only the root file may declare the version
+            if (source_number != 0 && directive != std::string::npos && line.compare(directive, 7, "version") == 0) {
+                code += '\n';
+            } else {
+                code += line;
+                code += '\n';
+            }
+            continue;
+        }
+
+        size_t open = line.find_first_of("\"<", directive + 7);
+        size_t close = open == std::string::npos ? std::string::npos
+                                                 : line.find(line[open] == '"' ? '"' : '>', open + 1);
+        if (close == std::string::npos) {
+            return fail(ctx, path, line_number, "malformed #include");
+        }
+        std::string name = line.substr(open + 1, close - open - 1);
+
+        // Relative to the including file first, then the shared include directory
+        std::string resolved = normalize_shader_path(directory_of(path) + name);
+        std::string include_text;
+        if (ctx.source_numbers.count(resolved) == 0 && !read_text_file(resolved, include_text)) {
+            resolved = normalize_shader_path(std::string(SHADER_INCLUDE_DIR) + "/" + name);
+            if (ctx.source_numbers.count(resolved) == 0 && !read_text_file(resolved, include_text)) {
+                return fail(ctx, path, line_number, "cannot open include \"" + name + "\"");
+            }
+        }
+
+        // Implicit include guard: paste every file once
+        if (ctx.source_numbers.count(resolved)) {
+            code += '\n';
+            continue;
+        }
+
+        int include_number = (int)ctx.out.files.size();
+        ctx.source_numbers[resolved] = include_number;
+        ctx.out.files.push_back(resolved);
+
+        code += "#line 1 " + std::to_string(include_number) + "\n";
+        if (!process_file(ctx, resolved, include_text, include_number)) {
+            return false;
+        }
+        code += "#line " + std::to_string(line_number + 1) + " " + std::to_string(source_number) + "\n";
+    }
+    return true;
+}
+
+bool preprocess_shader(const std::string& path, ShaderSource& out, std::string* error) {
+    out.code.clear();
+    out.files.clear();
+
+    std::string root = normalize_shader_path(path);
+    std::string text;
+    if (!read_text_file(root, text)) {
+        if (error) *error = root + ": cannot open file";
+        return false;
+    }
+
+    IncludeContext ctx = {out, {}, error};
+    out.files.push_back(root);
+    ctx.source_numbers[root] = 0;
+    return process_file(ctx, root, text, 0);
+}
+
+ShaderDependencyGraph& ShaderDependencyGraph::instance() {
+    static ShaderDependencyGraph graph;
+    return graph;
+}
+
+void ShaderDependencyGraph::setDependencies(Shader* shader, const std::vector<std::string>& files) {
+    std::lock_guard<std::mutex> lock(mutex);
+    removeLocked(shader);
+    std::vector<std::string>& deps = shader_to_files[shader];
+    for (const std::string& file : files) {
+        std::string path = normalize_shader_path(file);
+        if (file_to_shaders[path].insert(shader).second) {
+            deps.push_back(path);
+        }
+    }
+}
+
+void ShaderDependencyGraph::remove(Shader* shader) {
+    std::lock_guard<std::mutex> lock(mutex);
+    removeLocked(shader);
+}
+
+void ShaderDependencyGraph::removeLocked(Shader* shader) {
+    auto it = shader_to_files.find(shader);
+    if (it == shader_to_files.end()) {
+        return;
+    }
+    for (const std::string& file : it->second) {
+        auto users = file_to_shaders.find(file);
+        if (users == file_to_shaders.end()) continue;
+        users->second.erase(shader);
+        if (users->second.empty()) {
+            file_to_shaders.erase(users);
+        }
+    }
+    shader_to_files.erase(it);
+}
+
+std::vector<Shader*> ShaderDependencyGraph::dependents(const std::string& file) const {
+    std::string path = normalize_shader_path(file);
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = file_to_shaders.find(path);
+    if (it == file_to_shaders.end()) {
+        return std::vector<Shader*>();
+    }
+    return std::vector<Shader*>(it->second.begin(), it->second.end());
+}
+
+std::vector<std::string> ShaderDependencyGraph::dependencies(Shader* shader) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = shader_to_files.find(shader);
+    return it == shader_to_files.end() ? std::vector<std::string>() : it->second;
+}
+
+std::vector<std::string> ShaderDependencyGraph::files() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> result;
+    result.reserve(file_to_shaders.size());
+    for (const auto& entry : file_to_shaders) {
+        result.push_back(entry.first);
+    }
+    return result;
+}
+
+int reload_shaders_depending_on(const std::string& file) {
+    // Copy first: reload() re-registers each shader's dependencies
+    std::vector<Shader*> shaders = ShaderDependencyGraph::instance().dependents(file);
+    int reloaded = 0;
+    for (Shader* shader : shaders) {
+        if (shader->reload()) reloaded++;
+    }
+    gl_log("%s changed: %d of %zu dependent shaders rebuilt\n", file.c_str(), reloaded, shaders.size());
+    return reloaded;
+}
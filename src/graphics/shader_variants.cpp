@@ -0,0 +1,114 @@
+#include "graphics/shader_variants.h"
+#include "graphics/shader_batch.h"
+#include "utils/log.h"
+#include <chrono>
+
+ShaderVariants::ShaderVariants() : total_compile_ms(0.0), last_compile_ms(0.0) {}
+
+void ShaderVariants::init(const std::string& vertex_path, const std::string& fragment_path,
+                          const std::vector<std::string>& options) {
+    this->vertex_path = vertex_path;
+    this->fragment_path = fragment_path;
+    this->options = options;
+    if (this->options.size() > (size_t)MAX_OPTIONS) {
+        gl_log_err("WARNING: %zu shader options, only the first %d are addressable\n", options.size(), MAX_OPTIONS);
+        this->options.resize(MAX_OPTIONS);
+    }
+    cache.clear();
+    total_compile_ms = 0.0;
+    last_compile_ms = 0.0;
+}
+
+std::vector<std::string> ShaderVariants::definesFor(uint32_t key) const {
+    std::vector<std::string> defines;
+    for (size_t i = 0; i < options.size(); i++) {
+        if (key & (1u << i)) {
+            defines.push_back(options[i]);
+        }
+    }
+    return defines;
+}
+
+Shader* ShaderVariants::get(uint32_t key) {
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second->programme ? it->second.get() : nullptr;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<Shader> shader(new Shader());
+    bool ok = shader->loadFromFiles(vertex_path, fragment_path, definesFor(key));
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+    last_compile_ms = ms;
+    total_compile_ms += ms;
+    Shader* result = shader.get();
+    cache[key] = std::move(shader);
+    if (!ok) {
+        // Kept so that a hot reload of the fixed source can install it
+        gl_log_err("ERROR: shader variant 0x%x of %s failed to compile\n", key, fragment_path.c_str());
+        return nullptr;
+    }
+
+    gl_log("Shader variant 0x%x of %s compiled in %.2f ms (%d cached)\n", key, fragment_path.c_str(), ms,
+           getVariantCount());
+    return result;
+}
+
+bool ShaderVariants::precompile(const std::vector<uint32_t>& keys) {
+    // Submit every missing variant before checking any of them, so the
+    // driver can compile them concurrently (see ShaderBatch)
+    ShaderBatch batch;
+    std::vector<uint32_t> submitted;
+    for (uint32_t key : keys) {
+        if (cache.count(key)) continue;
+        std::unique_ptr<Shader> shader(new Shader());
+        batch.add(shader.get(), vertex_path, fragment_path, definesFor(key));
+        cache[key] = std::move(shader);
+        submitted.push_back(key);
+    }
+    if (submitted.empty()) {
+        return true;
+    }
+    batch.finish();
+
+    bool ok = true;
+    for (uint32_t key : submitted) {
+        if (cache[key]->programme == 0) {
+            gl_log_err("ERROR: shader variant 0x%x of %s failed to compile\n", key, fragment_path.c_str());
+            ok = false;
+        }
+    }
+
+    const ShaderBatch::Stats& batch_stats = batch.getStats();
+    last_compile_ms = batch_stats.total_ms;
+    total_compile_ms += batch_stats.total_ms;
+    gl_log("Precompiled %zu variants of %s in %.2f ms (%d cached)\n", submitted.size(), fragment_path.c_str(),
+           batch_stats.total_ms, getVariantCount());
+    return ok;
+}
+
+void ShaderVariants::reloadAll() {
+    for (auto& entry : cache) {
+        entry.second->reload();
+    }
+}
+
+int ShaderVariants::getVariantCount() const {
+    int count = 0;
+    for (const auto& entry : cache) {
+        if (entry.second->programme) count++;
+    }
+    return count;
+}
+
+// Counted on request, since hot reload can fix a failed variant without
+// going through this class
+ShaderVariants::Stats ShaderVariants::getStats() const {
+    Stats stats;
+    stats.variants = getVariantCount();
+    stats.failed = (int)cache.size() - stats.variants;
+    stats.total_compile_ms = total_compile_ms;
+    stats.last_compile_ms = last_compile_ms;
+    return stats;
+}
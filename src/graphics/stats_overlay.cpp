@@ -0,0 +1,474 @@
+#include "graphics/stats_overlay.h"
+#include "core/FramePacer.h"
+#include "graphics/gpu_handles.h"
+#include "graphics/gpu_resources.h"
+#include "graphics/gpu_timer.h"
+#include "utils/frame_stats.h"
+#include "utils/log.h"
+#include "utils/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+// Printable ASCII 0x20-0x7E of the KC85/4 font in sokol_debugtext.h
+// (zlib licence, Andre Weissflog): 8 rows per glyph, bit 7 is the
+// leftmost pixel
+static const uint8_t s_font[95 * 8] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // 20
+    0x30, 0x30, 0x30, 0x30, 0x30, 0x00, 0x30, 0x00, // 21
+    0x77, 0x33, 0x66, 0x00, 0x00, 0x00, 0x00, 0x00, // 22
+    0x36, 0x36, 0xFE, 0x6C, 0xFE, 0xD8, 0xD8, 0x00, // 23
+    0x18, 0x3E, 0x6C, 0x3E, 0x1B, 0x1B, 0x7E, 0x18, // 24
+    0x00, 0xC6, 0xCC, 0x18, 0x30, 0x66, 0xC6, 0x00, // 25
+    0x38, 0x6C, 0x38, 0x76, 0xDC, 0xCC, 0x76, 0x00, // 26
+    0x1C, 0x0C, 0x18, 0x00, 0x00, 0x00, 0x00, 0x00, // 27
+    0x18, 0x30, 0x60, 0x60, 0x60, 0x30, 0x18, 0x00, // 28
+    0x60, 0x30, 0x18, 0x18, 0x18, 0x30, 0x60, 0x00, // 29
+    0x00, 0x66, 0x3C, 0xFF, 0x3C, 0x66, 0x00, 0x00, // 2A
+    0x00, 0x30, 0x30, 0xFC, 0x30, 0x30, 0x00, 0x00, // 2B
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x1C, 0x0C, 0x18, // 2C
+    0x00, 0x00, 0x00, 0xFE, 0x00, 0x00, 0x00, 0x00, // 2D
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x30, 0x30, 0x00, // 2E
+    0x06, 0x0C, 0x18, 0x30, 0x60, 0xC0, 0x80, 0x00, // 2F
+    0x7C, 0xC6, 0xCE, 0xDE, 0xF6, 0xE6, 0x7C, 0x00, // 30
+    0x30, 0x70, 0x30, 0x30, 0x30, 0x30, 0xFC, 0x00, // 31
+    0x78, 0xCC, 0x0C, 0x38, 0x60, 0xCC, 0xFC, 0x00, // 32
+    0xFC, 0x18, 0x30, 0x78, 0x0C, 0xCC, 0x78, 0x00, // 33
+    0x1C, 0x3C, 0x6C, 0xCC, 0xFE, 0x0C, 0x1E, 0x00, // 34
+    0xFC, 0xC0, 0xF8, 0x0C, 0x0C, 0xCC, 0x78, 0x00, // 35
+    0x38, 0x60, 0xC0, 0xF8, 0xCC, 0xCC, 0x78, 0x00, // 36
+    0xFC, 0xCC, 0x0C, 0x18, 0x30, 0x30, 0x30, 0x00, // 37
+    0x78, 0xCC, 0xCC, 0x78, 0xCC, 0xCC, 0x78, 0x00, // 38
+    0x78, 0xCC, 0xCC, 0x7C, 0x0C, 0x18, 0x70, 0x00, // 39
+    0x00, 0x00, 0x30, 0x30, 0x00, 0x30, 0x30, 0x00, // 3A
+    0x00, 0x00, 0x30, 0x30, 0x00, 0x30, 0x30, 0x60, // 3B
+    0x18, 0x30, 0x60, 0xC0, 0x60, 0x30, 0x18, 0x00, // 3C
+    0x00, 0x00, 0xFC, 0x00, 0xFC, 0x00, 0x00, 0x00, // 3D
+    0x60, 0x30, 0x18, 0x0C, 0x18, 0x30, 0x60, 0x00, // 3E
+    0x78, 0xCC, 0x0C, 0x18, 0x30, 0x00, 0x30, 0x00, // 3F
+    0x7C, 0xC6, 0xDE, 0xDE, 0xDE, 0xC0, 0x78, 0x00, // 40
+    0x30, 0x78, 0xCC, 0xCC, 0xFC, 0xCC, 0xCC, 0x00, // 41
+    0xFC, 0x66, 0x66, 0x7C, 0x66, 0x66, 0xFC, 0x00, // 42
+    0x3C, 0x66, 0xC0, 0xC0, 0xC0, 0x66, 0x3C, 0x00, // 43
+    0xF8, 0x6C, 0x66, 0x66, 0x66, 0x6C, 0xF8, 0x00, // 44
+    0xFE, 0x62, 0x68, 0x78, 0x68, 0x62, 0xFE, 0x00, // 45
+    0xFE, 0x62, 0x68, 0x78, 0x68, 0x60, 0xF0, 0x00, // 46
+    0x3C, 0x66, 0xC0, 0xC0, 0xCE, 0x66, 0x3C, 0x00, // 47
+    0xCC, 0xCC, 0xCC, 0xFC, 0xCC, 0xCC, 0xCC, 0x00, // 48
+    0x78, 0x30, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00, // 49
+    0x1E, 0x0C, 0x0C, 0x0C, 0xCC, 0xCC, 0x78, 0x00, // 4A
+    0xE6, 0x66, 0x6C, 0x70, 0x6C, 0x66, 0xE6, 0x00, // 4B
+    0xF0, 0x60, 0x60, 0x60, 0x62, 0x66, 0xFE, 0x00, // 4C
+    0xC6, 0xEE, 0xFE, 0xD6, 0xC6, 0xC6, 0xC6, 0x00, // 4D
+    0xC6, 0xE6, 0xF6, 0xDE, 0xCE, 0xC6, 0xC6, 0x00, // 4E
+    0x38, 0x6C, 0xC6, 0xC6, 0xC6, 0x6C, 0x38, 0x00, // 4F
+    0xFC, 0x66, 0x66, 0x7C, 0x60, 0x60, 0xF0, 0x00, // 50
+    0x78, 0xCC, 0xCC, 0xCC, 0xDC, 0x78, 0x1C, 0x00, // 51
+    0xFC, 0x66, 0x66, 0x7C, 0x6C, 0x66, 0xE6, 0x00, // 52
+    0x7C, 0xC6, 0xF0, 0x3C, 0x0E, 0xC6, 0x7C, 0x00, // 53
+    0xFC, 0xB4, 0x30, 0x30, 0x30, 0x30, 0x78, 0x00, // 54
+    0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0xCC, 0x78, 0x00, // 55
+    0xCC, 0xCC, 0xCC, 0x78, 0x78, 0x30, 0x30, 0x00, // 56
+    0xC6, 0xC6, 0xC6, 0xD6, 0xFE, 0xEE, 0xC6, 0x00, // 57
+    0xC6, 0xC6, 0x6C, 0x38, 0x6C, 0xC6, 0xC6, 0x00, // 58
+    0xCC, 0xCC, 0xCC, 0x78, 0x30, 0x30, 0x78, 0x00, // 59
+    0xFE, 0xC6, 0x8C, 0x18, 0x32, 0x66, 0xFE, 0x00, // 5A
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, // 5B
+    0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x00, // 5C
+    0x00, 0xFE, 0x06, 0x06, 0x00, 0x00, 0x00, 0x00, // 5D
+    0x10, 0x38, 0x6C, 0xC6, 0x00, 0x00, 0x00, 0x00, // 5E
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, // 5F
+    0x3C, 0x42, 0x99, 0xA1, 0xA1, 0x99, 0x42, 0x3C, // 60
+    0x00, 0x00, 0x78, 0x0C, 0x7C, 0xCC, 0x76, 0x00, // 61
+    0xE0, 0x60, 0x7C, 0x66, 0x66, 0x66, 0xDC, 0x00, // 62
+    0x00, 0x00, 0x78, 0xCC, 0xC0, 0xCC, 0x78, 0x00, // 63
+    0x1C, 0x0C, 0x7C, 0xCC, 0xCC, 0xCC, 0x76, 0x00, // 64
+    0x00, 0x00, 0x78, 0xCC, 0xFC, 0xC0, 0x78, 0x00, // 65
+    0x38, 0x6C, 0x60, 0xF0, 0x60, 0x60, 0xF0, 0x00, // 66
+    0x00, 0x00, 0x76, 0xCC, 0xCC, 0x7C, 0x0C, 0xF8, // 67
+    0xE0, 0x60, 0x6C, 0x76, 0x66, 0x66, 0xE6, 0x00, // 68
+    0x30, 0x00, 0x70, 0x30, 0x30, 0x30, 0xFC, 0x00, // 69
+    0x0C, 0x00, 0x1C, 0x0C, 0x0C, 0xCC, 0xCC, 0x78, // 6A
+    0xE0, 0x60, 0x66, 0x6C, 0x78, 0x6C, 0xE6, 0x00, // 6B
+    0x70, 0x30, 0x30, 0x30, 0x30, 0x30, 0xFC, 0x00, // 6C
+    0x00, 0x00, 0xCC, 0xFE, 0xFE, 0xD6, 0xC6, 0x00, // 6D
+    0x00, 0x00, 0xF8, 0xCC, 0xCC, 0xCC, 0xCC, 0x00, // 6E
+    0x00, 0x00, 0x78, 0xCC, 0xCC, 0xCC, 0x78, 0x00, // 6F
+    0x00, 0x00, 0xDC, 0x66, 0x66, 0x7C, 0x60, 0xF0, // 70
+    0x00, 0x00, 0x76, 0xCC, 0xCC, 0x7C, 0x0C, 0x1E, // 71
+    0x00, 0x00, 0xDC, 0x76, 0x66, 0x60, 0xF0, 0x00, // 72
+    0x00, 0x00, 0x7C, 0xC0, 0x78, 0x0C, 0xF8, 0x00, // 73
+    0x10, 0x30, 0x7C, 0x30, 0x30, 0x34, 0x18, 0x00, // 74
+    0x00, 0x00, 0xCC, 0xCC, 0xCC, 0xCC, 0x76, 0x00, // 75
+    0x00, 0x00, 0xCC, 0xCC, 0xCC, 0x78, 0x30, 0x00, // 76
+    0x00, 0x00, 0xC6, 0xD6, 0xFE, 0xFE, 0x6C, 0x00, // 77
+    0x00, 0x00, 0xC6, 0x6C, 0x38, 0x6C, 0xC6, 0x00, // 78
+    0x00, 0x00, 0xCC, 0xCC, 0xCC, 0x7C, 0x0C, 0xF8, // 79
+    0x00, 0x00, 0xFC, 0x98, 0x30, 0x64, 0xFC, 0x00, // 7A
+    0x6C, 0x00, 0x78, 0x0C, 0x7C, 0xCC, 0x76, 0x00, // 7B
+    0xCC, 0x00, 0x78, 0xCC, 0xCC, 0xCC, 0x78, 0x00, // 7C
+    0xCC, 0x00, 0xCC, 0xCC, 0xCC, 0xCC, 0x76, 0x00, // 7D
+    0x3C, 0x66, 0x66, 0x6C, 0x66, 0x66, 0x6C, 0xF0, // 7E
+};
+
+static const int GLYPH_FIRST = 0x20;
+static const int GLYPH_SOLID = 95;          // after the font, all rows set
+static const int GLYPH_COUNT = 96;
+static const int GLYPH_SIZE = 8;
+
+// 0xRRGGBBAA
+static const uint32_t COLOUR_PANEL = 0x000000b0;
+static const uint32_t COLOUR_GRAPH = 0x202020c0;
+static const uint32_t COLOUR_GRID = 0x808080a0;
+static const uint32_t COLOUR_TEXT = 0xffffffff;
+static const uint32_t COLOUR_PASS = 0x9fd0ffff;
+static const uint32_t COLOUR_DIM = 0xa0a0a0ff;
+static const uint32_t COLOUR_GOOD = 0x40d040ff;
+static const uint32_t COLOUR_SLOW = 0xe0c030ff;
+static const uint32_t COLOUR_BAD = 0xe04040ff;
+static const uint32_t COLOUR_GPU = 0x40e0ffff;
+
+static double ms_between(std::chrono::high_resolution_clock::time_point a,
+                         std::chrono::high_resolution_clock::time_point b) {
+    return std::chrono::duration<double, std::milli>(b - a).count();
+}
+
+StatsOverlay& StatsOverlay::instance() {
+    static StatsOverlay overlay;
+    return overlay;
+}
+
+StatsOverlay::StatsOverlay()
+    : visible(false), active(false), created(false), failed(false), has_last_end(false), history_index(0),
+      history_count(0), font_texture(0), vertex_buffer(0), vertex_array(0), screen_size_loc(-1),
+      glyph_count_loc(-1), font_loc(-1), shader_generation(0), scale(1), memory(), stats() {
+    memset(frame_ms, 0, sizeof(frame_ms));
+    memset(cpu_ms, 0, sizeof(cpu_ms));
+    memset(gpu_ms, 0, sizeof(gpu_ms));
+}
+
+void StatsOverlay::setVisible(bool show) {
+    visible.store(show, std::memory_order_relaxed);
+}
+
+void StatsOverlay::toggle() {
+    setVisible(!isVisible());
+}
+
+void StatsOverlay::setMemoryStats(const MemoryStats& stats) {
+    std::lock_guard<std::mutex> lock(memory_mutex);
+    memory = stats;
+}
+
+bool StatsOverlay::createResources() {
+    shader.reset(new Shader());
+    if (!shader->loadFromFiles("shaders/engine/overlay/vertex.glsl", "shaders/engine/overlay/fragment.glsl")) {
+        gl_log_err("ERROR: could not load the stats overlay shader\n");
+        shader.reset();
+        return false;
+    }
+    lookupUniforms();
+
+    // One row of glyphs, GLYPH_SIZE texels square each
+    const int atlas_width = GLYPH_COUNT * GLYPH_SIZE;
+    std::vector<uint8_t> atlas((size_t)atlas_width * GLYPH_SIZE, 0);
+    for (int glyph = 0; glyph < GLYPH_COUNT; glyph++) {
+        for (int row = 0; row < GLYPH_SIZE; row++) {
+            uint8_t bits = glyph == GLYPH_SOLID ? 0xff : s_font[glyph * GLYPH_SIZE + row];
+            for (int column = 0; column < GLYPH_SIZE; column++) {
+                if (bits & (0x80 >> column)) {
+                    atlas[(size_t)row * atlas_width + glyph * GLYPH_SIZE + column] = 0xff;
+                }
+            }
+        }
+    }
+    font_texture = gpu_create_texture(RESOURCE_TEXTURE, "stats overlay font");
+    glBindTexture(GL_TEXTURE_2D, font_texture);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, atlas_width, GLYPH_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    gpu_texture_size(font_texture, atlas.size());
+
+    vertex_buffer = gpu_create_buffer(RESOURCE_VERTEX_BUFFER, "stats overlay");
+    gpu_buffer_data(vertex_buffer, GL_ARRAY_BUFFER, (GLsizeiptr)(MAX_QUADS * sizeof(Quad)), nullptr,
+                    GL_STREAM_DRAW);
+    vertex_array = gpu_create_vertex_array("stats overlay");
+    glBindVertexArray(vertex_array);
+    glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE, sizeof(Quad), (const void*)offsetof(Quad, x));
+    glVertexAttribIPointer(1, 1, GL_UNSIGNED_SHORT, sizeof(Quad), (const void*)offsetof(Quad, glyph));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Quad), (const void*)offsetof(Quad, colour));
+    for (GLuint i = 0; i < 3; i++) {
+        glEnableVertexAttribArray(i);
+        glVertexAttribDivisor(i, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    quads.reserve(MAX_QUADS);
+    gl_log("Stats overlay: %d quads max, %zu bytes per quad\n", MAX_QUADS, sizeof(Quad));
+    return true;
+}
+
+void StatsOverlay::lookupUniforms() {
+    screen_size_loc = glGetUniformLocation(shader->programme, "screen_size");
+    glyph_count_loc = glGetUniformLocation(shader->programme, "glyph_count");
+    font_loc = glGetUniformLocation(shader->programme, "font");
+    shader_generation = shader->generation;
+}
+
+void StatsOverlay::shutdown() {
+    gpu_release_texture(font_texture);
+    gpu_release_buffer(vertex_buffer);
+    gpu_release_vertex_array(vertex_array);
+    shader.reset();
+    created = false;
+    active = false;
+}
+
+void StatsOverlay::beginFrame() {
+    bool show = isVisible();
+    if (show != active) {
+        active = show;
+        GpuTimers::instance().setEnabled(show);
+    }
+    frame_start = Clock::now();
+    GpuTimers::instance().beginFrame();
+}
+
+void StatsOverlay::endFrame() {
+    Clock::time_point now = Clock::now();
+    if (has_last_end) {
+        frame_ms[history_index] = (float)ms_between(last_end, now);
+        cpu_ms[history_index] = (float)ms_between(frame_start, now);
+        gpu_ms[history_index] = active ? (float)GpuTimers::instance().getFrameMs() : 0.0f;
+        history_index = (history_index + 1) % HISTORY;
+        history_count = std::min(history_count + 1, (int)HISTORY);
+    }
+    last_end = now;
+    has_last_end = true;
+
+    if (!active) {
+        return;
+    }
+    if (!created && !failed) {
+        created = createResources();
+        failed = !created;
+    }
+    if (created) {
+        quads.clear();
+        build();
+        draw();
+    }
+    GpuTimers::instance().endFrame();
+
+    stats.quads = (int)quads.size();
+    stats.cpu_ms = ms_between(now, Clock::now());
+    GpuTimers& timers = GpuTimers::instance();
+    for (int i = 0; i < timers.getPassCount(); i++) {
+        if (strcmp(timers.getPass(i).name, "overlay") == 0) {
+            stats.gpu_ms = timers.getPass(i).ms;
+        }
+    }
+}
+
+void StatsOverlay::rect(int x, int y, int width, int height, uint32_t colour) {
+    if (quads.size() >= (size_t)MAX_QUADS || width <= 0 || height <= 0) {
+        return;
+    }
+    Quad quad = {(int16_t)x, (int16_t)y, (int16_t)width, (int16_t)height, (uint16_t)GLYPH_SOLID, 0,
+                 {(uint8_t)(colour >> 24), (uint8_t)(colour >> 16), (uint8_t)(colour >> 8), (uint8_t)colour}};
+    quads.push_back(quad);
+}
+
+int StatsOverlay::text(int x, int y, uint32_t colour, const char* format, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    length = std::max(0, std::min(length, (int)sizeof(line) - 1));
+
+    int size = GLYPH_SIZE * scale;
+    for (int i = 0; i < length && quads.size() < (size_t)MAX_QUADS; i++) {
+        int c = (unsigned char)line[i];
+        if (c == ' ') {
+            continue;
+        }
+        int glyph = (c >= GLYPH_FIRST && c < GLYPH_FIRST + GLYPH_SOLID) ? c - GLYPH_FIRST : '?' - GLYPH_FIRST;
+        rect(x + i * size, y, size, size, colour);
+        quads.back().glyph = (uint16_t)glyph;
+    }
+    return x + length * size;
+}
+
+// Shortened count: 950, 12.3k, 4.56M
+static const char* format_count(char* buffer, size_t size, long long count) {
+    if (count >= 1000000) {
+        snprintf(buffer, size, "%.2fM", count / 1.0e6);
+    } else if (count >= 10000) {
+        snprintf(buffer, size, "%.1fk", count / 1.0e3);
+    } else {
+        snprintf(buffer, size, "%lld", count);
+    }
+    return buffer;
+}
+
+void StatsOverlay::build() {
+    scale = g_fb_height >= 1440 ? 2 : 1;
+    const int pad = 4 * scale;
+    const int line = 10 * scale;
+    const int columns = 38;
+    const int graph_height = 64 * scale;
+    const int width = std::max(columns * GLYPH_SIZE * scale, HISTORY * scale) + 2 * pad;
+
+    // Frame time over the history, oldest first
+    int count = history_count;
+    float ordered[HISTORY];
+    double sum = 0.0, sq_sum = 0.0, cpu_sum = 0.0, gpu_sum = 0.0;
+    int gpu_count = 0;
+    float min_ms = 0.0f, max_ms = 0.0f;
+    for (int i = 0; i < count; i++) {
+        int index = (history_index - count + i + HISTORY) % HISTORY;
+        float ms = frame_ms[index];
+        ordered[i] = ms;
+        sum += ms;
+        sq_sum += (double)ms * ms;
+        cpu_sum += cpu_ms[index];
+        if (gpu_ms[index] > 0.0f) {
+            gpu_sum += gpu_ms[index];
+            gpu_count++;
+        }
+        min_ms = i == 0 ? ms : std::min(min_ms, ms);
+        max_ms = std::max(max_ms, ms);
+    }
+    double mean = count ? sum / count : 0.0;
+    double jitter = count ? sqrt(std::max(sq_sum / count - mean * mean, 0.0)) : 0.0;
+    float sorted[HISTORY];
+    memcpy(sorted, ordered, sizeof(float) * (size_t)count);
+    std::sort(sorted, sorted + count);
+    auto percentile = [&](double p) { return count ? sorted[std::min((int)(p * count), count - 1)] : 0.0f; };
+
+    GpuTimers& timers = GpuTimers::instance();
+    MemoryStats memory_now;
+    {
+        std::lock_guard<std::mutex> lock(memory_mutex);
+        memory_now = memory;
+    }
+
+    int passes = timers.getPassCount();
+    int lines = 9 + passes;
+    int x0 = 8 * scale, y0 = 8 * scale;
+    int height = pad + lines * line + pad + graph_height + pad;
+    rect(x0, y0, width, height, COLOUR_PANEL);
+
+    int x = x0 + pad, y = y0 + pad;
+    char tris[16];
+    text(x, y, COLOUR_TEXT, "%6.2f ms %6.1f fps  vsync %s", mean, mean > 0.0 ? 1000.0 / mean : 0.0,
+         FramePacer::vsyncName(FramePacer::instance().getPacing().vsync));
+    y += line;
+    text(x, y, COLOUR_TEXT, "p50 %5.2f  p95 %5.2f  p99 %5.2f", percentile(0.50), percentile(0.95),
+         percentile(0.99));
+    y += line;
+    text(x, y, COLOUR_DIM, "jitter %5.2f  min %5.2f  max %5.2f", jitter, min_ms, max_ms);
+    y += line;
+    text(x, y, COLOUR_TEXT, "cpu submit %5.2f ms  gpu %5.2f ms", count ? cpu_sum / count : 0.0,
+         gpu_count ? gpu_sum / gpu_count : 0.0);
+    y += line;
+    for (int i = 0; i < passes; i++) {
+        const GpuTimers::Pass& pass = timers.getPass(i);
+        int indent = 2 + 2 * pass.depth;
+        text(x, y, COLOUR_PASS, "%*s%-*s %6.3f ms", indent, "", 20 - indent, pass.name, pass.ms);
+        y += line;
+    }
+    text(x, y, COLOUR_TEXT, "draws %d  tris %s  states %d", g_frame_stats.draw_calls,
+         format_count(tris, sizeof(tris), g_frame_stats.triangles), g_frame_stats.state_changes);
+    y += line;
+    text(x, y, COLOUR_TEXT, "queries %d  draws saved %d", g_frame_stats.occlusion_queries,
+         g_frame_stats.draw_calls_saved);
+    y += line;
+    text(x, y, COLOUR_TEXT, "gpu mem %.1f MB  heap %llu/frame", GpuResources::instance().getTotalBytes() / 1048576.0,
+         (unsigned long long)memory_now.frame_heap_allocs);
+    y += line;
+    text(x, y, COLOUR_TEXT, "arena %zu / %zu KB", memory_now.frame_arena_used / 1024,
+         memory_now.frame_arena_capacity / 1024);
+    y += line;
+    text(x, y, COLOUR_DIM, "overlay cpu %.3f gpu %.3f ms", stats.cpu_ms, stats.gpu_ms);
+    y += line + pad;
+
+    // Graph: one bar per frame, newest on the right, GPU time as a mark;
+    // the scale doubles when a frame misses 30 fps
+    int graph_x = x0 + pad;
+    rect(graph_x, y, HISTORY * scale, graph_height, COLOUR_GRAPH);
+    double range_ms = max_ms > 100.0 / 3.0 ? 200.0 / 3.0 : 100.0 / 3.0;
+    for (double grid = 50.0 / 3.0; grid < range_ms; grid += 50.0 / 3.0) {
+        rect(graph_x, y + graph_height - (int)(grid / range_ms * graph_height), HISTORY * scale, scale,
+             COLOUR_GRID);
+    }
+    for (int i = 0; i < count; i++) {
+        int index = (history_index - count + i + HISTORY) % HISTORY;
+        int bar_x = graph_x + (HISTORY - count + i) * scale;
+        float ms = ordered[i];
+        int bar = (int)(std::min(ms / range_ms, 1.0) * graph_height);
+        uint32_t colour = ms <= 17.5f ? COLOUR_GOOD : (ms <= 34.0f ? COLOUR_SLOW : COLOUR_BAD);
+        rect(bar_x, y + graph_height - bar, scale, bar, colour);
+        if (gpu_ms[index] > 0.0f) {
+            int mark = (int)(std::min(gpu_ms[index] / range_ms, 1.0) * graph_height);
+            rect(bar_x, y + graph_height - std::max(mark, scale), scale, scale, COLOUR_GPU);
+        }
+    }
+}
+
+void StatsOverlay::draw() {
+    if (quads.empty()) {
+        return;
+    }
+    GpuTimers::instance().beginPass("overlay");
+
+    // Orphan and refill: the previous frame's draw may still be reading it
+    gpu_buffer_data(vertex_buffer, GL_ARRAY_BUFFER, (GLsizeiptr)(MAX_QUADS * sizeof(Quad)), nullptr,
+                    GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, (GLsizeiptr)(quads.size() * sizeof(Quad)), quads.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    GLboolean depth_test = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cull_face = glIsEnabled(GL_CULL_FACE);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, g_fb_width, g_fb_height);
+    if (shader->generation != shader_generation) {
+        lookupUniforms();   // hot reloaded
+    }
+    shader->use();
+    glUniform2f(screen_size_loc, (float)g_fb_width, (float)g_fb_height);
+    glUniform1f(glyph_count_loc, (float)GLYPH_COUNT);
+    glUniform1i(font_loc, 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, font_texture);
+
+    glBindVertexArray(vertex_array);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)quads.size());
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+
+    // Nothing else in the engine changes the blend function
+    glBlendFunc(GL_ONE, GL_ZERO);
+    if (!blend) glDisable(GL_BLEND);
+    if (cull_face) glEnable(GL_CULL_FACE);
+    if (depth_test) glEnable(GL_DEPTH_TEST);
+
+    GpuTimers::instance().endPass();
+}
@@ -1,63 +1,94 @@
 #include "graphics/texture.h"
+#include "core/AssetWatcher.h"
+#include "graphics/gpu_handles.h"
 #include <iostream>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
-Texture::Texture() : id(0), width(0), height(0), channels(0), loaded(false) {
+Texture::Texture() : id(0), width(0), height(0), channels(0), bytes(0), loaded(false), flip(true) {
 }
 
 Texture::~Texture() {
-    if (loaded && id != 0) {
-        glDeleteTextures(1, &id);
+    AssetWatcher::instance().unwatchTexture(this);
+    if (loaded) {
+        gpu_release_texture(id);
     }
 }
 
 bool Texture::loadFromFile(const char* filename, bool flip_vertically) {
-    // Set flip flag (OpenGL expects 0,0 at bottom-left, images are usually top-left)
-    stbi_set_flip_vertically_on_load(flip_vertically);
-    
-    // Force 4 channels (RGBA)
-    int force_channels = 4;
-    unsigned char* image_data = stbi_load(filename, &width, &height, &channels, force_channels);
-    
-    if (!image_data) {
+    TextureImage image;
+    if (!decode(filename, flip_vertically, image)) {
         std::cerr << "ERROR: Could not load texture: " << filename << std::endl;
         return false;
     }
     
     std::cout << "Loaded texture: " << filename << std::endl;
-    std::cout << "  Size: " << width << "x" << height << std::endl;
-    std::cout << "  Channels: " << channels << " (forced to 4)" << std::endl;
+    std::cout << "  Size: " << image.width << "x" << image.height << std::endl;
+    std::cout << "  Channels: " << image.channels << " (forced to 4)" << std::endl;
+    
+    replace(upload(image, filename), image.width, image.height, image.channels);
+    freeImage(image);
     
+    path = filename;
+    flip = flip_vertically;
+    AssetWatcher::instance().watchTexture(this);
+    return true;
+}
+
+bool Texture::decode(const char* filename, bool flip_vertically, TextureImage& out) {
+    // Set flip flag (OpenGL expects 0,0 at bottom-left, images are usually top-left).
+    // The per-thread flag keeps concurrent decodes independent
+    stbi_set_flip_vertically_on_load_thread(flip_vertically);
+    
+    // Force 4 channels (RGBA)
+    int force_channels = 4;
+    out.pixels = stbi_load(filename, &out.width, &out.height, &out.channels, force_channels);
+    return out.pixels != nullptr;
+}
+
+void Texture::freeImage(TextureImage& image) {
+    stbi_image_free(image.pixels);
+    image.pixels = nullptr;
+}
+
+GLuint Texture::upload(const TextureImage& image, const char* label) {
     // Generate OpenGL texture
-    glGenTextures(1, &id);
-    glBindTexture(GL_TEXTURE_2D, id);
+    GLuint texture = gpu_create_texture(RESOURCE_TEXTURE, label);
+    glBindTexture(GL_TEXTURE_2D, texture);
     
     // Copy image data to GPU
     glTexImage2D(
         GL_TEXTURE_2D,
         0,
         GL_SRGB_ALPHA,  // Use sRGB for automatic gamma correction
-        width,
-        height,
+        image.width,
+        image.height,
         0,
         GL_RGBA,
         GL_UNSIGNED_BYTE,
-        image_data
+        image.pixels
     );
+    gpu_texture_size(texture, gpu_texture_bytes(GL_SRGB8_ALPHA8, image.width, image.height));
     
     // Set texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    // Free image data
-    stbi_image_free(image_data);
-    
+    return texture;
+}
+
+void Texture::replace(GLuint new_id, int new_width, int new_height, int new_channels) {
+    if (loaded) {
+        gpu_release_texture(id);
+    }
+    id = new_id;
+    width = new_width;
+    height = new_height;
+    channels = new_channels;
+    bytes = gpu_texture_bytes(GL_SRGB8_ALPHA8, new_width, new_height);
     loaded = true;
-    return true;
 }
 
 void Texture::bind(GLuint texture_unit) {
@@ -0,0 +1,313 @@
+#include "graphics/vertex_format.h"
+#include "graphics/gpu_resources.h"
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+uint32_t vertex_encoding_size(VertexEncoding encoding) {
+    switch (encoding) {
+        case VERTEX_FLOAT2: return 8;
+        case VERTEX_FLOAT3: return 12;
+        case VERTEX_FLOAT4: return 16;
+        case VERTEX_HALF4: return 8;
+        case VERTEX_SNORM16X4: return 8;
+        case VERTEX_OCT_2_10_10_10: return 4;
+        case VERTEX_UNORM16X2: return 4;
+        case VERTEX_UNORM8X4: return 4;
+    }
+    return 0;
+}
+
+void VertexDequant::setUniforms(GLuint programme) const {
+    GLint loc = glGetUniformLocation(programme, "pos_offset");
+    if (loc != -1) glUniform3fv(loc, 1, pos_offset);
+    loc = glGetUniformLocation(programme, "pos_scale");
+    if (loc != -1) glUniform3fv(loc, 1, pos_scale);
+    loc = glGetUniformLocation(programme, "uv_offset");
+    if (loc != -1) glUniform2fv(loc, 1, uv_offset);
+    loc = glGetUniformLocation(programme, "uv_scale");
+    if (loc != -1) glUniform2fv(loc, 1, uv_scale);
+}
+
+VertexFormat::VertexFormat() : count(0), vertex_stride(0) {}
+
+VertexFormat& VertexFormat::add(VertexSemantic semantic, VertexEncoding encoding, uint32_t location) {
+    if (count < VERTEX_FORMAT_MAX_ATTRIBS) {
+        attribs[count] = {semantic, encoding, location, vertex_stride};
+        count++;
+        vertex_stride += vertex_encoding_size(encoding);
+    }
+    return *this;
+}
+
+const VertexAttrib* VertexFormat::find(VertexSemantic semantic) const {
+    for (int i = 0; i < count; i++) {
+        if (attribs[i].semantic == semantic) return &attribs[i];
+    }
+    return nullptr;
+}
+
+void VertexFormat::apply(size_t base_offset) const {
+    for (int i = 0; i < count; i++) {
+        const VertexAttrib& a = attribs[i];
+        const void* ptr = (const void*)(base_offset + a.offset);
+        GLsizei stride = (GLsizei)vertex_stride;
+        switch (a.encoding) {
+            case VERTEX_FLOAT2: glVertexAttribPointer(a.location, 2, GL_FLOAT, GL_FALSE, stride, ptr); break;
+            case VERTEX_FLOAT3: glVertexAttribPointer(a.location, 3, GL_FLOAT, GL_FALSE, stride, ptr); break;
+            case VERTEX_FLOAT4: glVertexAttribPointer(a.location, 4, GL_FLOAT, GL_FALSE, stride, ptr); break;
+            case VERTEX_HALF4: glVertexAttribPointer(a.location, 4, GL_HALF_FLOAT, GL_FALSE, stride, ptr); break;
+            case VERTEX_SNORM16X4: glVertexAttribPointer(a.location, 4, GL_SHORT, GL_TRUE, stride, ptr); break;
+            case VERTEX_OCT_2_10_10_10:
+                glVertexAttribPointer(a.location, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, ptr);
+                break;
+            case VERTEX_UNORM16X2:
+                glVertexAttribPointer(a.location, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, ptr);
+                break;
+            case VERTEX_UNORM8X4: glVertexAttribPointer(a.location, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, ptr); break;
+        }
+        glEnableVertexAttribArray(a.location);
+    }
+}
+
+GLuint VertexFormat::createVAO(GLuint vbo, GLuint ibo) const {
+    GLuint vao = gpu_create_vertex_array("vertex format");
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    apply();
+    if (ibo) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+    glBindVertexArray(0);
+    return vao;
+}
+
+VertexFormat VertexFormat::standard(bool normals, bool texcoords, bool colors) {
+    VertexFormat format;
+    format.add(VERTEX_POSITION, VERTEX_FLOAT3, 0);
+    if (normals) format.add(VERTEX_NORMAL, VERTEX_FLOAT3, 1);
+    if (texcoords) format.add(VERTEX_TEXCOORD, VERTEX_FLOAT2, 2);
+    if (colors) format.add(VERTEX_COLOR, VERTEX_FLOAT3, 3);
+    return format;
+}
+
+VertexFormat VertexFormat::compact(bool normals, bool texcoords, bool colors) {
+    VertexFormat format;
+    format.add(VERTEX_POSITION, VERTEX_SNORM16X4, 0);
+    if (normals) format.add(VERTEX_NORMAL, VERTEX_OCT_2_10_10_10, 1);
+    if (texcoords) format.add(VERTEX_TEXCOORD, VERTEX_UNORM16X2, 2);
+    if (colors) format.add(VERTEX_COLOR, VERTEX_UNORM8X4, 3);
+    return format;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar encoders
+// ---------------------------------------------------------------------------
+
+uint16_t float_to_half(float f) {
+    uint32_t bits;
+    memcpy(&bits, &f, 4);
+    uint32_t sign = (bits >> 16) & 0x8000u;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFFu;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        // Inf / NaN
+        return (uint16_t)(sign | 0x7C00u | (mantissa ? 0x200u : 0u));
+    }
+    if (exponent >= 31) {
+        return (uint16_t)(sign | 0x7C00u);
+    }
+    if (exponent <= 0) {
+        // Denormal or zero: shift the implicit 1 in, round to nearest even
+        if (exponent < -10) return (uint16_t)sign;
+        mantissa |= 0x800000u;
+        uint32_t shift = (uint32_t)(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t midpoint = 1u << (shift - 1);
+        if (rest > midpoint || (rest == midpoint && (half & 1))) half++;
+        return (uint16_t)(sign | half);
+    }
+
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t rest = mantissa & 0x1FFFu;
+    // Round to nearest even; a carry into the exponent is still correct
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1))) half++;
+    return (uint16_t)half;
+}
+
+static float clampf(float v, float lo, float hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+int16_t quantize_snorm16(float v) {
+    return (int16_t)lrintf(clampf(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+uint16_t quantize_unorm16(float v) {
+    return (uint16_t)lrintf(clampf(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+uint8_t quantize_unorm8(float v) {
+    return (uint8_t)lrintf(clampf(v, 0.0f, 1.0f) * 255.0f);
+}
+
+// Octahedral mapping (Meyer et al. 2010): project onto the L1 unit
+// octahedron and fold the lower hemisphere over the diagonals. x/y go into
+// the 10-bit signed fields, z and w are left zero.
+uint32_t encode_oct_normal(float x, float y, float z) {
+    float l1 = fabsf(x) + fabsf(y) + fabsf(z);
+    if (l1 <= 0.0f) {
+        x = 0.0f;
+        y = 0.0f;
+        z = 1.0f;
+        l1 = 1.0f;
+    }
+    float u = x / l1;
+    float v = y / l1;
+    if (z < 0.0f) {
+        float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+        float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+        u = fu;
+        v = fv;
+    }
+    int32_t iu = (int32_t)lrintf(clampf(u, -1.0f, 1.0f) * 511.0f);
+    int32_t iv = (int32_t)lrintf(clampf(v, -1.0f, 1.0f) * 511.0f);
+    return ((uint32_t)iu & 0x3FFu) | (((uint32_t)iv & 0x3FFu) << 10);
+}
+
+// ---------------------------------------------------------------------------
+// Packing
+// ---------------------------------------------------------------------------
+
+static void compute_ranges(const VertexFormat& format, const VertexSource& source, VertexDequant& dq) {
+    const VertexAttrib* pos = format.find(VERTEX_POSITION);
+    const float* positions = source.data[VERTEX_POSITION];
+    if (pos && positions && (pos->encoding == VERTEX_HALF4 || pos->encoding == VERTEX_SNORM16X4)) {
+        int pc = source.components[VERTEX_POSITION];
+        float mn[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float mx[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        for (size_t i = 0; i < source.vertex_count; i++) {
+            for (int c = 0; c < 3 && c < pc; c++) {
+                float v = positions[i * pc + c];
+                mn[c] = v < mn[c] ? v : mn[c];
+                mx[c] = v > mx[c] ? v : mx[c];
+            }
+        }
+        for (int c = 0; c < 3; c++) {
+            if (mn[c] > mx[c]) {
+                mn[c] = 0.0f;
+                mx[c] = 0.0f;
+            }
+            // Centre the range so [-1,1] covers the bounds exactly
+            dq.pos_offset[c] = 0.5f * (mn[c] + mx[c]);
+            float extent = 0.5f * (mx[c] - mn[c]);
+            dq.pos_scale[c] = extent > 1e-20f ? extent : 1.0f;
+        }
+    }
+
+    const VertexAttrib* uv = format.find(VERTEX_TEXCOORD);
+    const float* texcoords = source.data[VERTEX_TEXCOORD];
+    if (uv && texcoords && uv->encoding == VERTEX_UNORM16X2) {
+        int tc = source.components[VERTEX_TEXCOORD];
+        float mn[2] = {FLT_MAX, FLT_MAX};
+        float mx[2] = {-FLT_MAX, -FLT_MAX};
+        for (size_t i = 0; i < source.vertex_count; i++) {
+            for (int c = 0; c < 2 && c < tc; c++) {
+                float v = texcoords[i * tc + c];
+                mn[c] = v < mn[c] ? v : mn[c];
+                mx[c] = v > mx[c] ? v : mx[c];
+            }
+        }
+        for (int c = 0; c < 2; c++) {
+            if (mn[c] > mx[c]) {
+                mn[c] = 0.0f;
+                mx[c] = 1.0f;
+            }
+            // UVs that already lie in [0,1] keep an identity mapping
+            if (mn[c] >= 0.0f && mx[c] <= 1.0f) {
+                mn[c] = 0.0f;
+                mx[c] = 1.0f;
+            }
+            dq.uv_offset[c] = mn[c];
+            dq.uv_scale[c] = mx[c] - mn[c] > 1e-20f ? mx[c] - mn[c] : 1.0f;
+        }
+    }
+}
+
+// Fetch up to 4 components of a source attribute, padding with defaults
+static void fetch(const VertexSource& source, VertexSemantic semantic, size_t i, float out[4]) {
+    static const float defaults[VERTEX_SEMANTIC_COUNT][4] = {
+        {0.0f, 0.0f, 0.0f, 1.0f},   // position
+        {0.0f, 0.0f, 1.0f, 0.0f},   // normal
+        {0.0f, 0.0f, 0.0f, 0.0f},   // texcoord
+        {1.0f, 1.0f, 1.0f, 1.0f}    // colour
+    };
+    memcpy(out, defaults[semantic], sizeof(float) * 4);
+    const float* data = source.data[semantic];
+    if (!data) return;
+    int n = source.components[semantic];
+    for (int c = 0; c < n && c < 4; c++) out[c] = data[i * n + c];
+}
+
+void pack_vertices(const VertexFormat& format, const VertexSource& source, std::vector<uint8_t>& out,
+                   VertexDequant* dequant) {
+    VertexDequant dq;
+    compute_ranges(format, source, dq);
+    if (dequant) *dequant = dq;
+
+    uint32_t stride = format.stride();
+    out.assign(source.vertex_count * stride, 0);
+
+    for (int a = 0; a < format.attribCount(); a++) {
+        const VertexAttrib& attr = format.attrib(a);
+        uint8_t* dst = out.data() + attr.offset;
+
+        for (size_t i = 0; i < source.vertex_count; i++, dst += stride) {
+            float v[4];
+            fetch(source, attr.semantic, i, v);
+
+            // Quantized positions/UVs are stored relative to their range
+            if (attr.semantic == VERTEX_POSITION &&
+                (attr.encoding == VERTEX_HALF4 || attr.encoding == VERTEX_SNORM16X4)) {
+                for (int c = 0; c < 3; c++) v[c] = (v[c] - dq.pos_offset[c]) / dq.pos_scale[c];
+                v[3] = 1.0f;
+            } else if (attr.semantic == VERTEX_TEXCOORD && attr.encoding == VERTEX_UNORM16X2) {
+                for (int c = 0; c < 2; c++) v[c] = (v[c] - dq.uv_offset[c]) / dq.uv_scale[c];
+            }
+
+            switch (attr.encoding) {
+                case VERTEX_FLOAT2: memcpy(dst, v, 8); break;
+                case VERTEX_FLOAT3: memcpy(dst, v, 12); break;
+                case VERTEX_FLOAT4: memcpy(dst, v, 16); break;
+                case VERTEX_HALF4: {
+                    uint16_t h[4] = {float_to_half(v[0]), float_to_half(v[1]), float_to_half(v[2]),
+                                     float_to_half(v[3])};
+                    memcpy(dst, h, 8);
+                    break;
+                }
+                case VERTEX_SNORM16X4: {
+                    int16_t s[4] = {quantize_snorm16(v[0]), quantize_snorm16(v[1]), quantize_snorm16(v[2]),
+                                    quantize_snorm16(v[3])};
+                    memcpy(dst, s, 8);
+                    break;
+                }
+                case VERTEX_OCT_2_10_10_10: {
+                    uint32_t packed = encode_oct_normal(v[0], v[1], v[2]);
+                    memcpy(dst, &packed, 4);
+                    break;
+                }
+                case VERTEX_UNORM16X2: {
+                    uint16_t u[2] = {quantize_unorm16(v[0]), quantize_unorm16(v[1])};
+                    memcpy(dst, u, 4);
+                    break;
+                }
+                case VERTEX_UNORM8X4: {
+                    uint8_t b[4] = {quantize_unorm8(v[0]), quantize_unorm8(v[1]), quantize_unorm8(v[2]),
+                                    quantize_unorm8(v[3])};
+                    memcpy(dst, b, 4);
+                    break;
+                }
+            }
+        }
+    }
+}
@@ -1,6 +1,8 @@
 #include <iostream>
 #include <algorithm>
+#include <cstring>
 #include "core/Engine.h"  
+#include "core/Memory.h"
 #include "exercises/ExerciseRegistry.h"
 #include "exercises/AllExercises.h"
 
@@ -15,11 +17,43 @@ int main(int argc, char* argv[]) {
               });
     
     int choice = -1;
+    RenderPath render_path = RENDER_PATH_FORWARD;
+    bool render_thread = true;
+    bool heap_check = false;
+    FramePacing pacing;
     
-    // Command line argument
-    if (argc > 1) {
-        choice = std::atoi(argv[1]);
-    } else {
+    // Command line arguments: exercise number, --forward / --deferred,
+    // --serial (no render thread), --heap-check (assert on steady-state
+    // heap allocations), --vsync off|on|adaptive, --fps N (frame limiter),
+    // --frames-ahead N (fence latency bound), --finish (glFinish per frame)
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--deferred") == 0) {
+            render_path = RENDER_PATH_DEFERRED;
+        } else if (std::strcmp(argv[i], "--forward") == 0) {
+            render_path = RENDER_PATH_FORWARD;
+        } else if (std::strcmp(argv[i], "--serial") == 0) {
+            render_thread = false;
+        } else if (std::strcmp(argv[i], "--heap-check") == 0) {
+            heap_check = true;
+        } else if (std::strcmp(argv[i], "--vsync") == 0 && i + 1 < argc) {
+            i++;
+            for (int mode = 0; mode < VSYNC_MODE_COUNT; mode++) {
+                if (std::strcmp(argv[i], FramePacer::vsyncName((VsyncMode)mode)) == 0) {
+                    pacing.vsync = (VsyncMode)mode;
+                }
+            }
+        } else if (std::strcmp(argv[i], "--fps") == 0 && i + 1 < argc) {
+            pacing.max_fps = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--frames-ahead") == 0 && i + 1 < argc) {
+            pacing.max_frames_ahead = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--finish") == 0) {
+            pacing.finish = true;
+        } else {
+            choice = std::atoi(argv[i]);
+        }
+    }
+    
+    if (choice < 0) {
         // Show menu
         std::cout << "\n=== AceEngine - OpenGL Exercises ===" << std::endl;
         for (size_t i = 0; i < exercises.size(); i++) {
@@ -45,6 +79,10 @@ int main(int argc, char* argv[]) {
     if (!engine.init(640, 480, false)) {
         return 1;
     }
+    engine.setRenderPath(render_path);
+    engine.setRenderThread(render_thread);
+    engine.setFramePacing(pacing);
+    Memory::setHeapCheck(heap_check);
     
     // Run selected exercise
     exercises[choice - 1].run(engine.getWindow());
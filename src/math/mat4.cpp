@@ -52,6 +52,14 @@ float dot(const vec3& a, const vec3& b) {
     return a.v[0] * b.v[0] + a.v[1] * b.v[1] + a.v[2] * b.v[2];
 }
 
+float lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+vec3 lerp(const vec3& a, const vec3& b, float t) {
+    return vec3(lerp(a.v[0], b.v[0], t), lerp(a.v[1], b.v[1], t), lerp(a.v[2], b.v[2], t));
+}
+
 // mat4 implementation
 mat4::mat4() {
     memset(m, 0, sizeof(m));
@@ -276,4 +284,18 @@ bool sphere_in_frustum(const Frustum& frustum, const vec3& center, float radius)
         }
     }
     return true; // Sphere intersects or is inside frustum
+}
+
+bool aabb_in_frustum(const Frustum& frustum, const AABB& box) {
+    for (int i = 0; i < 6; i++) {
+        const vec3& n = frustum.planes[i].normal;
+        // Corner furthest along the plane normal
+        vec3 p(n.v[0] >= 0.0f ? box.max.v[0] : box.min.v[0],
+               n.v[1] >= 0.0f ? box.max.v[1] : box.min.v[1],
+               n.v[2] >= 0.0f ? box.max.v[2] : box.min.v[2]);
+        if (dot(n, p) + frustum.planes[i].distance < 0.0f) {
+            return false; // Box is completely outside this plane
+        }
+    }
+    return true;
 }
\ No newline at end of file
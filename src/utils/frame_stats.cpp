@@ -0,0 +1,8 @@
+#include "utils/frame_stats.h"
+#include <cstring>
+
+FrameStats g_frame_stats = {};
+
+void reset_frame_stats() {
+    memset(&g_frame_stats, 0, sizeof(g_frame_stats));
+}
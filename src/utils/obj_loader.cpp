@@ -0,0 +1,430 @@
+#include "utils/obj_loader.h"
+#include "core/JobSystem.h"
+#include "graphics/mesh_format.h"
+#include "utils/log.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Chunks smaller than this are not worth a job
+const size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+const int MISSING_INDEX = INT_MIN;
+
+// Face corner as parsed. Relative (negative) OBJ indices are stored against
+// the chunk's local counts and flagged so they can be rebased after all
+// chunks are known.
+struct Corner {
+    int p, t, n;
+    uint8_t relative;  // bit 0 = p, bit 1 = t, bit 2 = n
+};
+
+struct GroupMark {
+    std::string name;
+    size_t first_corner;
+};
+
+struct Chunk {
+    const char* begin;
+    const char* end;
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<Corner> corners;     // 3 per triangle
+    std::vector<GroupMark> groups;
+    int error_line;                  // line within the chunk, 0 = ok
+};
+
+struct VertexKey {
+    int p, t, n;
+};
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline const char* skip_space(const char* s, const char* end) {
+    while (s < end && is_space(*s)) s++;
+    return s;
+}
+
+inline const char* next_line(const char* s, const char* end) {
+    const char* nl = (const char*)memchr(s, '\n', end - s);
+    return nl ? nl + 1 : end;
+}
+
+inline const char* parse_float(const char* s, const char* end, float& value) {
+    s = skip_space(s, end);
+    if (s < end && *s == '+') s++;  // from_chars rejects a leading '+'
+    auto result = std::from_chars(s, end, value);
+    if (result.ec != std::errc()) {
+        value = 0.0f;
+        return s;
+    }
+    return result.ptr;
+}
+
+inline const char* parse_int(const char* s, const char* end, int& value) {
+    auto result = std::from_chars(s, end, value);
+    if (result.ec != std::errc()) {
+        value = 0;
+        return s;
+    }
+    return result.ptr;
+}
+
+// "p", "p/t", "p//n" or "p/t/n"; local counts resolve negative indices
+const char* parse_corner(const char* s, const char* end, const Chunk& chunk, Corner& corner) {
+    int raw[3] = {0, 0, 0};
+    s = parse_int(s, end, raw[0]);
+    if (s < end && *s == '/') {
+        s++;
+        if (s < end && *s != '/') s = parse_int(s, end, raw[1]);
+        if (s < end && *s == '/') s = parse_int(s + 1, end, raw[2]);
+    }
+
+    size_t counts[3] = {chunk.positions.size() / 3, chunk.texcoords.size() / 2, chunk.normals.size() / 3};
+    int* out[3] = {&corner.p, &corner.t, &corner.n};
+    corner.relative = 0;
+    for (int i = 0; i < 3; i++) {
+        if (raw[i] > 0) {
+            *out[i] = raw[i] - 1;
+        } else if (raw[i] < 0) {
+            *out[i] = (int)counts[i] + raw[i];
+            corner.relative |= (uint8_t)(1 << i);
+        } else {
+            *out[i] = MISSING_INDEX;
+        }
+    }
+    return s;
+}
+
+void parse_chunk(Chunk& chunk) {
+    // Reused across faces; grows for n-gons of any size
+    std::vector<Corner> face;
+    face.reserve(64);
+    int line = 0;
+    const char* end = chunk.end;
+
+    for (const char* s = chunk.begin; s < end; s = next_line(s, end)) {
+        line++;
+        const char* p = skip_space(s, end);
+        if (p >= end || *p == '#' || *p == '\n') {
+            continue;
+        }
+
+        if (p[0] == 'v' && p + 1 < end) {
+            if (is_space(p[1])) {
+                float x, y, z;
+                p = parse_float(p + 2, end, x);
+                p = parse_float(p, end, y);
+                parse_float(p, end, z);
+                chunk.positions.insert(chunk.positions.end(), {x, y, z});
+            } else if (p[1] == 'n') {
+                float x, y, z;
+                p = parse_float(p + 2, end, x);
+                p = parse_float(p, end, y);
+                parse_float(p, end, z);
+                chunk.normals.insert(chunk.normals.end(), {x, y, z});
+            } else if (p[1] == 't') {
+                float u, v;
+                p = parse_float(p + 2, end, u);
+                parse_float(p, end, v);
+                chunk.texcoords.insert(chunk.texcoords.end(), {u, v});
+            }
+        } else if (p[0] == 'f' && p + 1 < end && is_space(p[1])) {
+            face.clear();
+            p += 2;
+            for (;;) {
+                p = skip_space(p, end);
+                if (p >= end || *p == '\n' || *p == '#') break;
+                const char* before = p;
+                Corner corner;
+                p = parse_corner(p, end, chunk, corner);
+                face.push_back(corner);
+                if (p == before) {
+                    chunk.error_line = line;
+                    return;
+                }
+                while (p < end && !is_space(*p) && *p != '\n') p++;
+            }
+            // Triangle fan
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[i]);
+                chunk.corners.push_back(face[i + 1]);
+            }
+        } else if ((p[0] == 'o' || p[0] == 'g') && p + 1 < end && is_space(p[1])) {
+            const char* name = skip_space(p + 2, end);
+            const char* name_end = name;
+            while (name_end < end && *name_end != '\n' && *name_end != '\r') name_end++;
+            chunk.groups.push_back({std::string(name, name_end), chunk.corners.size()});
+        } else if (end - p > 7 && strncmp(p, "usemtl", 6) == 0 && is_space(p[6])) {
+            const char* name = skip_space(p + 7, end);
+            const char* name_end = name;
+            while (name_end < end && *name_end != '\n' && *name_end != '\r') name_end++;
+            chunk.groups.push_back({std::string(name, name_end), chunk.corners.size()});
+        }
+    }
+}
+
+// Open addressing map from vertex tuple to output index
+class VertexMap {
+public:
+    explicit VertexMap(size_t expected) {
+        size_t capacity = 16;
+        while (capacity < expected * 2) capacity <<= 1;
+        mask = capacity - 1;
+        keys.resize(capacity);
+        values.assign(capacity, UINT32_MAX);
+    }
+
+    // Returns the existing index, or inserts next_index and returns it
+    uint32_t findOrInsert(const VertexKey& key, uint32_t next_index) {
+        uint64_t h = (uint64_t)(uint32_t)key.p * 0x9E3779B97F4A7C15ull;
+        h ^= (uint64_t)(uint32_t)key.t * 0xC2B2AE3D27D4EB4Full;
+        h ^= (uint64_t)(uint32_t)key.n * 0x165667B19E3779F9ull;
+        size_t slot = (size_t)(h ^ (h >> 29)) & mask;
+        for (;;) {
+            if (values[slot] == UINT32_MAX) {
+                keys[slot] = key;
+                values[slot] = next_index;
+                return next_index;
+            }
+            const VertexKey& k = keys[slot];
+            if (k.p == key.p && k.t == key.t && k.n == key.n) {
+                return values[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+private:
+    std::vector<VertexKey> keys;
+    std::vector<uint32_t> values;
+    size_t mask;
+};
+
+void begin_group(ObjMesh& mesh, const std::string& name) {
+    if (!mesh.groups.empty() && mesh.groups.back().index_count == 0) {
+        mesh.groups.back().name = name;  // Replace an empty group
+        return;
+    }
+    mesh.groups.push_back({name, (uint32_t)mesh.indices.size(), 0});
+}
+
+double ms_since(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+}  // namespace
+
+bool load_obj(const char* path, ObjMesh& mesh, ObjImportStats* stats) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        gl_log_err("ERROR: Could not open OBJ file: %s\n", path);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        gl_log_err("ERROR: Could not stat OBJ file: %s\n", path);
+        return false;
+    }
+    size_t size = (size_t)st.st_size;
+    const char* data = nullptr;
+    if (size > 0) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            close(fd);
+            gl_log_err("ERROR: Could not mmap OBJ file: %s\n", path);
+            return false;
+        }
+        data = (const char*)mapping;
+    }
+    close(fd);
+
+    // Split into line-aligned chunks, a few per thread for load balancing
+    size_t threads = JobSystem::instance().getWorkerCount() + 1;
+    size_t chunk_count = std::max<size_t>(1, std::min(threads * 4, size / MIN_CHUNK_BYTES));
+    std::vector<Chunk> chunks(chunk_count);
+    const char* cursor = data;
+    const char* data_end = data + size;
+    for (size_t i = 0; i < chunk_count; i++) {
+        const char* chunk_end = (i + 1 == chunk_count) ? data_end : data + size * (i + 1) / chunk_count;
+        if (chunk_end < cursor) chunk_end = cursor;
+        if (chunk_end < data_end) chunk_end = next_line(chunk_end, data_end);
+        chunks[i].begin = cursor;
+        chunks[i].end = chunk_end;
+        chunks[i].error_line = 0;
+        cursor = chunk_end;
+    }
+
+    JobSystem::instance().parallelFor((uint32_t)chunk_count, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            parse_chunk(chunks[i]);
+        }
+    });
+    double parse_ms = ms_since(start);
+
+    if (data) {
+        munmap((void*)data, size);
+    }
+
+    for (size_t i = 0; i < chunk_count; i++) {
+        if (chunks[i].error_line) {
+            gl_log_err("ERROR: %s: malformed face in chunk %zu, line %d\n", path, i, chunks[i].error_line);
+            return false;
+        }
+    }
+
+    // Prefix sums give each chunk's base attribute indices
+    std::vector<size_t> base_p(chunk_count), base_t(chunk_count), base_n(chunk_count);
+    size_t total_p = 0, total_t = 0, total_n = 0, total_corners = 0;
+    for (size_t i = 0; i < chunk_count; i++) {
+        base_p[i] = total_p;
+        base_t[i] = total_t;
+        base_n[i] = total_n;
+        total_p += chunks[i].positions.size() / 3;
+        total_t += chunks[i].texcoords.size() / 2;
+        total_n += chunks[i].normals.size() / 3;
+        total_corners += chunks[i].corners.size();
+    }
+
+    std::vector<float> in_positions, in_normals, in_texcoords;
+    in_positions.reserve(total_p * 3);
+    in_normals.reserve(total_n * 3);
+    in_texcoords.reserve(total_t * 2);
+    for (const Chunk& chunk : chunks) {
+        in_positions.insert(in_positions.end(), chunk.positions.begin(), chunk.positions.end());
+        in_normals.insert(in_normals.end(), chunk.normals.begin(), chunk.normals.end());
+        in_texcoords.insert(in_texcoords.end(), chunk.texcoords.begin(), chunk.texcoords.end());
+    }
+
+    // Deduplicate corners in file order so output is deterministic
+    mesh = ObjMesh();
+    mesh.indices.reserve(total_corners);
+    mesh.positions.reserve(total_p * 3);
+    mesh.normals.reserve(total_p * 3);
+    mesh.texcoords.reserve(total_p * 2);
+    VertexMap vertex_map(total_corners + 16);
+    begin_group(mesh, "default");
+
+    for (size_t c = 0; c < chunk_count; c++) {
+        const Chunk& chunk = chunks[c];
+        size_t next_group = 0;
+        for (size_t i = 0; i < chunk.corners.size(); i++) {
+            while (next_group < chunk.groups.size() && chunk.groups[next_group].first_corner == i) {
+                begin_group(mesh, chunk.groups[next_group++].name);
+            }
+
+            const Corner& corner = chunk.corners[i];
+            VertexKey key;
+            key.p = corner.p + ((corner.relative & 1) ? (int)base_p[c] : 0);
+            key.t = corner.t == MISSING_INDEX ? -1 : corner.t + ((corner.relative & 2) ? (int)base_t[c] : 0);
+            key.n = corner.n == MISSING_INDEX ? -1 : corner.n + ((corner.relative & 4) ? (int)base_n[c] : 0);
+            if (key.p < 0 || (size_t)key.p >= total_p) {
+                gl_log_err("ERROR: %s: vertex index out of range\n", path);
+                return false;
+            }
+            if (key.t >= (int)total_t) key.t = -1;
+            if (key.n >= (int)total_n) key.n = -1;
+
+            uint32_t next_index = mesh.vertexCount();
+            uint32_t index = vertex_map.findOrInsert(key, next_index);
+            if (index == next_index) {
+                const float* p = &in_positions[key.p * 3];
+                mesh.positions.insert(mesh.positions.end(), p, p + 3);
+                if (key.n >= 0) {
+                    const float* n = &in_normals[key.n * 3];
+                    mesh.normals.insert(mesh.normals.end(), n, n + 3);
+                    mesh.has_normals = true;
+                } else {
+                    mesh.normals.insert(mesh.normals.end(), {0.0f, 0.0f, 0.0f});
+                }
+                if (key.t >= 0) {
+                    const float* t = &in_texcoords[key.t * 2];
+                    mesh.texcoords.insert(mesh.texcoords.end(), t, t + 2);
+                    mesh.has_texcoords = true;
+                } else {
+                    mesh.texcoords.insert(mesh.texcoords.end(), {0.0f, 0.0f});
+                }
+            }
+            mesh.indices.push_back(index);
+            mesh.groups.back().index_count++;
+        }
+        // Group statements after the chunk's last face
+        while (next_group < chunk.groups.size()) {
+            begin_group(mesh, chunk.groups[next_group++].name);
+        }
+    }
+
+    if (mesh.groups.back().index_count == 0) {
+        mesh.groups.pop_back();
+    }
+
+    double total_ms = ms_since(start);
+    double mb = size / (1024.0 * 1024.0);
+    double mb_per_s = total_ms > 0.0 ? mb / (total_ms / 1000.0) : 0.0;
+
+    if (stats) {
+        stats->file_mb = mb;
+        stats->parse_ms = parse_ms;
+        stats->total_ms = total_ms;
+        stats->mb_per_s = mb_per_s;
+        stats->chunks = (int)chunk_count;
+    }
+
+    gl_log("Loaded OBJ %s: %u vertices, %zu triangles, %zu groups\n",
+           path, mesh.vertexCount(), mesh.indices.size() / 3, mesh.groups.size());
+    gl_log("  %.2f MB in %.2f ms (%.1f MB/s, %zu chunks, parse %.2f ms)\n",
+           mb, total_ms, mb_per_s, chunk_count, parse_ms);
+    return true;
+}
+
+void obj_to_mesh_data(const ObjMesh& obj, MeshData& mesh) {
+    mesh = MeshData();
+    mesh.vertex_count = obj.vertexCount();
+    mesh.indices = obj.indices;
+
+    auto add_stream = [&](uint32_t location, uint32_t components, const std::vector<float>& values) {
+        MeshData::Stream stream;
+        stream.location = location;
+        stream.components = components;
+        stream.type = MESH_TYPE_FLOAT;
+        stream.normalized = false;
+        stream.data.resize(values.size() * sizeof(float));
+        if (!values.empty()) memcpy(stream.data.data(), values.data(), stream.data.size());
+        mesh.streams.push_back(stream);
+    };
+
+    add_stream(0, 3, obj.positions);
+    if (obj.has_normals) add_stream(1, 3, obj.normals);
+    if (obj.has_texcoords) add_stream(2, 2, obj.texcoords);
+
+    for (const auto& group : obj.groups) {
+        mesh.submeshes.push_back({group.index_offset, group.index_count, (uint32_t)mesh.submeshes.size(), 0});
+    }
+    mesh.lods.push_back({0, (uint32_t)mesh.indices.size(), 0.0f, 0});
+
+    for (int k = 0; k < 3; k++) {
+        mesh.bounds_min[k] = obj.positions.empty() ? 0.0f : obj.positions[k];
+        mesh.bounds_max[k] = mesh.bounds_min[k];
+    }
+    for (size_t i = 0; i < obj.positions.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            if (obj.positions[i + k] < mesh.bounds_min[k]) mesh.bounds_min[k] = obj.positions[i + k];
+            if (obj.positions[i + k] > mesh.bounds_max[k]) mesh.bounds_max[k] = obj.positions[i + k];
+        }
+    }
+}
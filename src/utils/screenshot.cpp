@@ -1,4 +1,5 @@
 #include "utils/screenshot.h"
+#include "core/Memory.h"
 #include <iostream>
 #include <ctime>
 #include <cstdlib>
@@ -8,12 +9,10 @@
 #include "stb_image_write.h"
 
 bool take_screenshot(int fb_width, int fb_height, const char* custom_name) {
-    // Allocate memory for RGB image (3 bytes per pixel)
-    unsigned char* buffer = (unsigned char*)malloc(fb_width * fb_height * 3);
-    if (!buffer) {
-        std::cerr << "ERROR: Could not allocate memory for screenshot" << std::endl;
-        return false;
-    }
+    // RGB image (3 bytes per pixel) in this thread's scratch arena, which
+    // keeps the block for the next screenshot
+    ScratchScope scratch;
+    unsigned char* buffer = scratch.arena().allocArray<unsigned char>((size_t)fb_width * fb_height * 3);
     
     // Read pixels from framebuffer
     glReadPixels(0, 0, fb_width, fb_height, GL_RGB, GL_UNSIGNED_BYTE, buffer);
@@ -38,13 +37,11 @@ bool take_screenshot(int fb_width, int fb_height, const char* custom_name) {
     // Parameters: filename, width, height, components, data, stride_in_bytes
     if (!stbi_write_png(name, fb_width, fb_height, 3, last_row, -3 * fb_width)) {
         std::cerr << "ERROR: Could not write screenshot file: " << name << std::endl;
-        free(buffer);
         return false;
     }
     
     std::cout << "Screenshot saved: " << name 
               << " (" << fb_width << "x" << fb_height << ")" << std::endl;
     
-    free(buffer);
     return true;
 }
\ No newline at end of file
@@ -4,16 +4,23 @@
 #include "utils/screenshot.h"
 #include "utils/gl_debug.h"  
 #include "graphics/shader.h"
+#include "graphics/gpu_resources.h"
+#include "graphics/stats_overlay.h"
+#include "core/AssetWatcher.h"
+#include "core/FramePacer.h"
+#include "core/Input.h"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <cstdio>
+#include <mutex>
+#include <vector>
 
 // Global window dimensions
 int g_win_width = 640;
 int g_win_height = 480;
-int g_fb_width = 640;
-int g_fb_height = 480;
+std::atomic<int> g_fb_width(640);
+std::atomic<int> g_fb_height(480);
 
 // Global window title (stored so FPS counter can append to it)
 std::string g_window_title = "AceEngine";
@@ -36,68 +43,106 @@ std::string readShaderFile(const std::string& filepath) {
     return buffer.str();
 }
 
-// Update function - handles ESC to quit AND P for screenshot
+// Requests from updateInput that need the GL context (see updateInputGL)
+static std::mutex gl_request_mutex;
+static bool screenshot_requested = false;
+static std::vector<Shader*> reload_requests;
+static std::atomic<bool> viewport_dirty(false);
+
+// Update function - handles ESC to quit, P for screenshot, F1 for the resource report
+// and F4 for the stats overlay
 void updateInput(GLFWwindow* window) {
-    // Check for ESC key press to close the window
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+    Input& input = Input::instance();
+    static const int quit = input.addAction("quit", GLFW_KEY_ESCAPE);
+    static const int screenshot = input.addAction("screenshot", GLFW_KEY_P);
+    static const int resource_report = input.addAction("resource_report", GLFW_KEY_F1);
+    static const int frame_report = input.addAction("frame_report", GLFW_KEY_F2);
+    static const int cycle_vsync = input.addAction("cycle_vsync", GLFW_KEY_F3);
+    static const int stats_overlay = input.addAction("stats_overlay", GLFW_KEY_F4);
+
+    // ESC closes the window
+    if (input.wasPressed(quit)) {
         glfwSetWindowShouldClose(window, 1);
     }
     
-    // Check for P key press to take screenshot
-    static bool p_key_was_pressed = false;
-    bool p_key_is_pressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
-    
-    if (p_key_is_pressed && !p_key_was_pressed) {
-        take_screenshot(g_fb_width, g_fb_height);
+    // P takes a screenshot
+    if (input.wasPressed(screenshot)) {
+        std::lock_guard<std::mutex> lock(gl_request_mutex);
+        screenshot_requested = true;
     }
     
-    p_key_was_pressed = p_key_is_pressed;
+    // F1 prints the GPU/CPU resource report
+    if (input.wasPressed(resource_report)) {
+        GpuResources::instance().logReport();
+    }
     
-    // Periodic OpenGL error checking (every 5 seconds)
-    static double last_error_check = 0.0;
-    double current_time = glfwGetTime();
+    // F2 logs the swap interval histogram, F3 cycles vsync off / on / adaptive
+    if (input.wasPressed(frame_report)) {
+        FramePacer::instance().logReport();
+    }
+    if (input.wasPressed(cycle_vsync)) {
+        FramePacing pacing = FramePacer::instance().getPacing();
+        pacing.vsync = (VsyncMode)((pacing.vsync + 1) % VSYNC_MODE_COUNT);
+        FramePacer::instance().setPacing(pacing);
+        FramePacer::instance().resetStats();
+        std::cout << "Vsync: " << FramePacer::vsyncName(pacing.vsync) << std::endl;
+    }
+
+    // F4 shows or hides the stats overlay
+    if (input.wasPressed(stats_overlay)) {
+        StatsOverlay::instance().toggle();
+    }
     
-    if (current_time - last_error_check > 5.0) {
-        check_and_clear_gl_errors("Periodic check");
-        last_error_check = current_time;
+    // With a render thread the context lives there, and so does the GL work
+    if (glfwGetCurrentContext() == window) {
+        updateInputGL();
     }
 }
 
 // Update input with shader reload (R key) AND screenshot (P key)
 void updateInputWithShaderReload(GLFWwindow* window, Shader* shader1, Shader* shader2) {
-    // Check for ESC key press to close the window
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-        glfwSetWindowShouldClose(window, 1);
-    }
+    // R reloads the given shaders
+    static const int reload = Input::instance().addAction("reload_shaders", GLFW_KEY_R);
     
-    // Check for R key press to reload shaders
-    static bool r_key_was_pressed = false;
-    bool r_key_is_pressed = glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS;
-    
-    if (r_key_is_pressed && !r_key_was_pressed) {
+    if (Input::instance().wasPressed(reload)) {
         std::cout << "\n=== Reloading Shaders ===" << std::endl;
         gl_log("=== Reloading Shaders ===\n");
         
+        std::lock_guard<std::mutex> lock(gl_request_mutex);
         if (shader1) {
-            shader1->reload();
+            reload_requests.push_back(shader1);
         }
         if (shader2) {
-            shader2->reload();
+            reload_requests.push_back(shader2);
         }
     }
     
-    r_key_was_pressed = r_key_is_pressed;
-    
-    // Check for P key press to take screenshot
-    static bool p_key_was_pressed = false;
-    bool p_key_is_pressed = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
-    
-    if (p_key_is_pressed && !p_key_was_pressed) {
+    // ESC, P and the GL work
+    updateInput(window);
+}
+
+void updateInputGL() {
+    // Frame boundary: swap in shaders/textures rebuilt in the background
+    AssetWatcher::instance().applyPending();
+    
+    std::vector<Shader*> reloads;
+    bool screenshot = false;
+    {
+        std::lock_guard<std::mutex> lock(gl_request_mutex);
+        reloads.swap(reload_requests);
+        screenshot = screenshot_requested;
+        screenshot_requested = false;
+    }
+    for (Shader* shader : reloads) {
+        shader->reload();
+    }
+    if (viewport_dirty.exchange(false)) {
+        glViewport(0, 0, g_fb_width, g_fb_height);
+    }
+    if (screenshot) {
         take_screenshot(g_fb_width, g_fb_height);
     }
     
-    p_key_was_pressed = p_key_is_pressed;
-    
     // Periodic OpenGL error checking (every 5 seconds)
     static double last_error_check = 0.0;
     double current_time = glfwGetTime();
@@ -125,8 +170,9 @@ void update_fps_counter(GLFWwindow* window) {
         double ms_per_frame = 1000.0 / fps;
         
         char tmp[256];
-        snprintf(tmp, sizeof(tmp), "%s @ fps: %.2f | ms/frame: %.2f", 
-                 g_window_title.c_str(), fps, ms_per_frame);
+        snprintf(tmp, sizeof(tmp), "%s @ fps: %.2f | ms/frame: %.2f | GPU: %.1f MB", 
+                 g_window_title.c_str(), fps, ms_per_frame,
+                 GpuResources::instance().getTotalBytes() / (1024.0 * 1024.0));
         glfwSetWindowTitle(window, tmp);
         
         frame_count = 0;
@@ -143,11 +189,13 @@ void glfw_window_size_callback(GLFWwindow* /*window*/, int width, int height) {
     std::cout << "Window resized to " << width << "x" << height << std::endl;
 }
 
-// Framebuffer resize callback - called when framebuffer is resized
+// Framebuffer resize callback - called when framebuffer is resized. Runs in
+// glfwPollEvents on the main thread, which may not own the context, so the
+// viewport is left to updateInputGL
 void glfw_framebuffer_resize_callback(GLFWwindow* /*window*/, int width, int height) {
     g_fb_width = width;
     g_fb_height = height;
-    glViewport(0, 0, width, height);
+    viewport_dirty = true;
     gl_log("Framebuffer resized to %dx%d\n", width, height);
     std::cout << "Framebuffer resized to " << width << "x" << height << std::endl;
 }
\ No newline at end of file
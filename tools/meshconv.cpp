@@ -0,0 +1,106 @@
+// meshconv - convert Wavefront OBJ files to AceEngine binary meshes (.amesh)
+//
+// Usage: meshconv input.obj output.amesh [--bench] [--no-optimize] [--lods N]
+//
+// A LOD chain of up to N levels (default 5, 1 disables it) is generated
+// with the QEM simplifier, then meshes are optimised for the vertex cache,
+// overdraw and vertex fetch unless --no-optimize is given (both then happen
+// at load time instead).
+// --bench times the text OBJ parse against opening the written .amesh
+// through a memory mapping (the same path Mesh::loadFromFile uses, minus
+// the GL upload).
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "core/JobSystem.h"
+#include "graphics/mesh_format.h"
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_simplifier.h"
+#include "utils/obj_loader.h"
+
+static double now_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+// Read every byte the GL upload would read, so page faults are counted
+static uint64_t touch_mesh(const MeshFileView& view) {
+    uint64_t sum = 0;
+    for (uint32_t i = 0; i < view.header()->stream_count; i++) {
+        const uint8_t* p = (const uint8_t*)view.streamData(i);
+        for (uint64_t b = 0; b < view.streams()[i].size; b += 64) sum += p[b];
+    }
+    const uint8_t* idx = (const uint8_t*)view.indexData();
+    for (size_t b = 0; b < view.indexDataSize(); b += 64) sum += idx[b];
+    return sum;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        printf("Usage: %s input.obj output.amesh [--bench] [--no-optimize] [--lods N]\n", argv[0]);
+        return 1;
+    }
+    const char* input = argv[1];
+    const char* output = argv[2];
+    bool bench = false;
+    bool optimize = true;
+    int max_lods = 5;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) bench = true;
+        else if (strcmp(argv[i], "--no-optimize") == 0) optimize = false;
+        else if (strcmp(argv[i], "--lods") == 0 && i + 1 < argc) max_lods = atoi(argv[++i]);
+    }
+
+    JobSystem::instance().init();
+
+    double t0 = now_ms();
+    ObjMesh obj;
+    ObjImportStats import_stats;
+    if (!load_obj(input, obj, &import_stats)) {
+        return 1;
+    }
+    double obj_ms = now_ms() - t0;
+
+    MeshData mesh;
+    obj_to_mesh_data(obj, mesh);
+    if (optimize && max_lods > 1) {
+        double t_lod = now_ms();
+        generate_lods(mesh, max_lods);
+        printf("Generated %zu LODs in %.1f ms\n", mesh.lods.size(), now_ms() - t_lod);
+        for (const MeshLod& lod : mesh.lods) {
+            printf("  %8u triangles, error %g\n", lod.index_count / 3, lod.error);
+        }
+    }
+    if (optimize) {
+        MeshOptimizeStats stats;
+        double t_opt = now_ms();
+        optimize_mesh(mesh, &stats);
+        printf("Optimised in %.1f ms (%d clusters)\n", now_ms() - t_opt, stats.clusters);
+        printf("  ACMR: %.3f -> %.3f\n", stats.before.acmr, stats.after.acmr);
+        printf("  ATVR: %.3f -> %.3f\n", stats.before.atvr, stats.after.atvr);
+    }
+    if (!write_mesh_file(output, mesh)) {
+        return 1;
+    }
+
+    printf("%s -> %s: %u vertices, %zu triangles, %zu submeshes\n",
+           input, output, mesh.vertex_count, mesh.indices.size() / 3, mesh.submeshes.size());
+
+    if (bench) {
+        double t1 = now_ms();
+        MeshFileView view;
+        if (!view.open(output)) {
+            return 1;
+        }
+        uint64_t checksum = touch_mesh(view);
+        double bin_ms = now_ms() - t1;
+
+        printf("OBJ text parse:   %8.3f ms (%.1f MB/s, %d chunks on %u threads)\n",
+               obj_ms, import_stats.mb_per_s, import_stats.chunks, JobSystem::instance().getWorkerCount() + 1);
+        printf("amesh mmap load:  %8.3f ms (%zu bytes, checksum %llu)\n",
+               bin_ms, view.fileSize(), (unsigned long long)checksum);
+        if (bin_ms > 0.0) printf("Speedup:          %8.1fx\n", obj_ms / bin_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+// meshtest - check that mesh optimisation keeps every LOD intact
+//
+// Usage: meshtest [input.obj ...]
+//
+// Runs generate_lods and optimize_mesh on a UV sphere without submeshes
+// (the LOD sphere in exercise 4), the same sphere split into two
+// submeshes, and any OBJ files given. optimize_mesh may reorder triangles
+// and renumber vertices, but every LOD and submesh range must still hold
+// the same set of triangles. Triangles are compared by the bytes of their
+// corners in every stream, so renumbering does not matter. Exits with 1
+// on any difference. Needs no GL context or window.
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "core/JobSystem.h"
+#include "graphics/mesh_format.h"
+#include "graphics/mesh_optimizer.h"
+#include "graphics/mesh_simplifier.h"
+#include "utils/obj_loader.h"
+
+typedef std::vector<std::string> TriangleSet;
+
+// Unit UV sphere, positions only, poles shared so it simplifies cleanly
+static void make_sphere(MeshData& mesh, int rings, int segments) {
+    std::vector<float> positions;
+    for (int r = 0; r <= rings; r++) {
+        float theta = (float)M_PI * r / rings;
+        int count = (r == 0 || r == rings) ? 1 : segments;
+        for (int s = 0; s < count; s++) {
+            float phi = 2.0f * (float)M_PI * s / segments;
+            positions.insert(positions.end(), {sinf(theta) * cosf(phi), cosf(theta), sinf(theta) * sinf(phi)});
+        }
+    }
+
+    auto ring_vertex = [&](int r, int s) { return (uint32_t)(1 + (r - 1) * segments + s % segments); };
+    uint32_t south = (uint32_t)(positions.size() / 3 - 1);
+    for (int s = 0; s < segments; s++) {
+        mesh.indices.insert(mesh.indices.end(), {0u, ring_vertex(1, s + 1), ring_vertex(1, s)});
+        mesh.indices.insert(mesh.indices.end(), {south, ring_vertex(rings - 1, s), ring_vertex(rings - 1, s + 1)});
+    }
+    for (int r = 1; r < rings - 1; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = ring_vertex(r, s), b = ring_vertex(r, s + 1);
+            uint32_t c = ring_vertex(r + 1, s), d = ring_vertex(r + 1, s + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, b, c, b, d, c});
+        }
+    }
+
+    mesh.vertex_count = (uint32_t)(positions.size() / 3);
+    const uint8_t* p = (const uint8_t*)positions.data();
+    mesh.streams.push_back({0, 3, MESH_TYPE_FLOAT, false, std::vector<uint8_t>(p, p + positions.size() * 4)});
+    for (int i = 0; i < 3; i++) {
+        mesh.bounds_min[i] = -1.0f;
+        mesh.bounds_max[i] = 1.0f;
+    }
+}
+
+// Every triangle in [offset, offset + count) as the bytes of its corners,
+// rotated to start at the smallest corner so the winding is kept
+static TriangleSet triangle_set(const MeshData& mesh, uint32_t offset, uint32_t count) {
+    TriangleSet set;
+    for (uint32_t i = offset; i + 2 < offset + count; i += 3) {
+        std::string corners[3];
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = mesh.indices[i + k];
+            for (const MeshData::Stream& stream : mesh.streams) {
+                size_t stride = stream.components * mesh_type_size(stream.type);
+                corners[k].append((const char*)&stream.data[v * stride], stride);
+            }
+        }
+        int first = 0;
+        for (int k = 1; k < 3; k++) {
+            if (corners[k] < corners[first]) first = k;
+        }
+        set.push_back(corners[first] + corners[(first + 1) % 3] + corners[(first + 2) % 3]);
+    }
+    std::sort(set.begin(), set.end());
+    return set;
+}
+
+// LOD and submesh ranges before optimisation, checked against after
+static bool check_mesh(const char* name, MeshData& mesh) {
+    generate_lods(mesh);
+    std::vector<TriangleSet> lods, submeshes;
+    for (const MeshLod& lod : mesh.lods) lods.push_back(triangle_set(mesh, lod.index_offset, lod.index_count));
+    for (const MeshSubmesh& submesh : mesh.submeshes) {
+        submeshes.push_back(triangle_set(mesh, submesh.index_offset, submesh.index_count));
+    }
+
+    optimize_mesh(mesh);
+
+    int failures = 0;
+    for (size_t i = 0; i < mesh.lods.size(); i++) {
+        if (triangle_set(mesh, mesh.lods[i].index_offset, mesh.lods[i].index_count) != lods[i]) {
+            printf("  %s: LOD %zu triangles changed\n", name, i);
+            failures++;
+        }
+    }
+    for (size_t i = 0; i < mesh.submeshes.size(); i++) {
+        if (triangle_set(mesh, mesh.submeshes[i].index_offset, mesh.submeshes[i].index_count) != submeshes[i]) {
+            printf("  %s: submesh %zu triangles changed\n", name, i);
+            failures++;
+        }
+    }
+    printf("%-24s %zu LODs, %zu submeshes, %u vertices: %s\n", name, mesh.lods.size(), mesh.submeshes.size(),
+           mesh.vertex_count, failures ? "FAIL" : "ok");
+    return failures == 0;
+}
+
+int main(int argc, char* argv[]) {
+    JobSystem::instance().init();
+    bool ok = true;
+
+    MeshData sphere;
+    make_sphere(sphere, 64, 128);
+    ok &= check_mesh("sphere", sphere);
+
+    // Northern and southern halves as separate materials
+    MeshData split;
+    make_sphere(split, 64, 128);
+    uint32_t half = (uint32_t)split.indices.size() / 6 * 3;
+    split.submeshes.push_back({0, half, 0, 0});
+    split.submeshes.push_back({half, (uint32_t)split.indices.size() - half, 1, 0});
+    ok &= check_mesh("sphere, two submeshes", split);
+
+    for (int i = 1; i < argc; i++) {
+        ObjMesh obj;
+        if (!load_obj(argv[i], obj)) {
+            ok = false;
+            continue;
+        }
+        MeshData mesh;
+        obj_to_mesh_data(obj, mesh);
+        ok &= check_mesh(argv[i], mesh);
+    }
+
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    JobSystem::instance().shutdown();
+    return ok ? 0 : 1;
+}
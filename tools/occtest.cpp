@@ -0,0 +1,236 @@
+// occtest - check the CPU occlusion culler against a brute-force reference
+//
+// Usage: occtest [--frames N]
+//
+// Rasterizes a fixed scene of occluders (three walls and a tessellated
+// ground) with OcclusionCuller and, independently, with a per-pixel double
+// precision reference. Compares:
+//   - the depth buffers (pixels differing by more than DEPTH_TOLERANCE)
+//   - the visibility of a grid of boxes: the reference rasterizes each box
+//     and depth tests every covered pixel. The culler may keep a hidden
+//     box (it is conservative) but must never hide a visible one.
+// Then times finalize and testVisibility over N frames (default 200) and
+// the reference once. Exits with 1 on any wrongly hidden box or too many
+// differing depth pixels. Needs no GL context or window.
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "core/JobSystem.h"
+#include "graphics/occlusion_culler.h"
+
+static const int WIDTH = 256;
+static const int HEIGHT = 128;
+static const float DEPTH_TOLERANCE = 1e-4f;
+// Pixel centres that sit on an edge can land either way in float and
+// double; anything more than this share means the rasterizer is wrong
+static const double MAX_DEPTH_MISMATCH = 0.005;
+
+static double now_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+// Window-space vertex: x, y in pixels, z in [0, 1]
+struct WindowVertex {
+    double x, y, z;
+};
+
+static WindowVertex project(const mat4& m, const float* p) {
+    double clip[4];
+    for (int r = 0; r < 4; r++) {
+        clip[r] = (double)m.m[r] * p[0] + (double)m.m[4 + r] * p[1] + (double)m.m[8 + r] * p[2] + m.m[12 + r];
+    }
+    WindowVertex v;
+    v.x = (clip[0] / clip[3] * 0.5 + 0.5) * WIDTH;
+    v.y = (clip[1] / clip[3] * 0.5 + 0.5) * HEIGHT;
+    v.z = std::min(std::max(clip[2] / clip[3] * 0.5 + 0.5, 0.0), 1.0);
+    return v;
+}
+
+// Calls visit(x, y, z) for every pixel centre inside the triangle, either
+// winding. Every vertex must be in front of the near plane
+template <typename Visit>
+static void reference_triangle(const WindowVertex& a, const WindowVertex& b, const WindowVertex& c,
+                               const Visit& visit) {
+    double area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+    if (area == 0.0) {
+        return;
+    }
+    int x0 = std::max(0, (int)floor(std::min(a.x, std::min(b.x, c.x))));
+    int x1 = std::min(WIDTH - 1, (int)ceil(std::max(a.x, std::max(b.x, c.x))));
+    int y0 = std::max(0, (int)floor(std::min(a.y, std::min(b.y, c.y))));
+    int y1 = std::min(HEIGHT - 1, (int)ceil(std::max(a.y, std::max(b.y, c.y))));
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            double px = x + 0.5, py = y + 0.5;
+            double wa = ((b.x - px) * (c.y - py) - (c.x - px) * (b.y - py)) / area;
+            double wb = ((c.x - px) * (a.y - py) - (a.x - px) * (c.y - py)) / area;
+            double wc = 1.0 - wa - wb;
+            if (wa >= 0.0 && wb >= 0.0 && wc >= 0.0) {
+                visit(x, y, wa * a.z + wb * b.z + wc * c.z);
+            }
+        }
+    }
+}
+
+struct Scene {
+    std::vector<float> positions;       // occluder triangles, xyz
+    std::vector<AABB> boxes;
+};
+
+static void add_quad(std::vector<float>& out, const float* a, const float* b, const float* c, const float* d) {
+    const float* corners[6] = {a, b, c, a, c, d};
+    for (const float* p : corners) {
+        out.insert(out.end(), p, p + 3);
+    }
+}
+
+static Scene build_scene() {
+    Scene scene;
+    // Walls: one facing the camera, one turned, one far and wide
+    float w0[4][3] = {{-6, -2, -12}, {2, -2, -12}, {2, 4, -12}, {-6, 4, -12}};
+    float w1[4][3] = {{3, -2, -8}, {9, -2, -16}, {9, 5, -16}, {3, 5, -8}};
+    float w2[4][3] = {{-30, -2, -40}, {30, -2, -40}, {30, 1, -40}, {-30, 1, -40}};
+    add_quad(scene.positions, w0[0], w0[1], w0[2], w0[3]);
+    add_quad(scene.positions, w1[0], w1[1], w1[2], w1[3]);
+    add_quad(scene.positions, w2[0], w2[1], w2[2], w2[3]);
+
+    // Ground rising away from the camera, 32x32 quads
+    const int N = 32;
+    for (int j = 0; j < N; j++) {
+        for (int i = 0; i < N; i++) {
+            float x0 = -24.0f + 48.0f * i / N, x1 = -24.0f + 48.0f * (i + 1) / N;
+            float z0 = -3.0f - 50.0f * j / N, z1 = -3.0f - 50.0f * (j + 1) / N;
+            float y0 = -3.0f + 0.04f * (3.0f - z0) + 0.3f * sinf(x0 * 0.7f);
+            float y1 = -3.0f + 0.04f * (3.0f - z1) + 0.3f * sinf(x0 * 0.7f);
+            float y2 = -3.0f + 0.04f * (3.0f - z1) + 0.3f * sinf(x1 * 0.7f);
+            float y3 = -3.0f + 0.04f * (3.0f - z0) + 0.3f * sinf(x1 * 0.7f);
+            float a[3] = {x0, y0, z0}, b[3] = {x0, y1, z1}, c[3] = {x1, y2, z1}, d[3] = {x1, y3, z0};
+            add_quad(scene.positions, a, b, c, d);
+        }
+    }
+
+    // Boxes of assorted sizes from just in front of the walls to far behind
+    uint32_t seed = 12345;
+    auto next = [&seed]() {
+        seed = seed * 1664525u + 1013904223u;
+        return (seed >> 8) * (1.0f / 16777216.0f);
+    };
+    for (int i = 0; i < 4096; i++) {
+        float x = -20.0f + 40.0f * next();
+        float y = -3.0f + 9.0f * next();
+        float z = -4.0f - 56.0f * next();
+        float size = 0.1f + 1.4f * next();
+        scene.boxes.push_back(AABB(vec3(x, y, z), vec3(x + size, y + size * 0.8f, z + size)));
+    }
+    return scene;
+}
+
+static const int s_box_faces[12][3] = {{0, 1, 3}, {0, 3, 2}, {4, 6, 7}, {4, 7, 5}, {0, 4, 5}, {0, 5, 1},
+                                       {2, 3, 7}, {2, 7, 6}, {0, 2, 6}, {0, 6, 4}, {1, 5, 7}, {1, 7, 3}};
+
+// Per-pixel reference: occluder depth, then each box rasterized and depth
+// tested against it
+static void reference(const Scene& scene, const mat4& proj_view, std::vector<double>& depth,
+                      std::vector<uint8_t>& visible) {
+    depth.assign((size_t)WIDTH * HEIGHT, 1.0);
+    for (size_t i = 0; i + 8 < scene.positions.size(); i += 9) {
+        WindowVertex a = project(proj_view, &scene.positions[i]);
+        WindowVertex b = project(proj_view, &scene.positions[i + 3]);
+        WindowVertex c = project(proj_view, &scene.positions[i + 6]);
+        reference_triangle(a, b, c, [&](int x, int y, double z) {
+            double& d = depth[(size_t)y * WIDTH + x];
+            d = std::min(d, z);
+        });
+    }
+
+    visible.assign(scene.boxes.size(), 0);
+    for (size_t b = 0; b < scene.boxes.size(); b++) {
+        const AABB& box = scene.boxes[b];
+        WindowVertex corners[8];
+        for (int i = 0; i < 8; i++) {
+            float p[3] = {(i & 1) ? box.max.v[0] : box.min.v[0], (i & 2) ? box.max.v[1] : box.min.v[1],
+                          (i & 4) ? box.max.v[2] : box.min.v[2]};
+            corners[i] = project(proj_view, p);
+        }
+        bool seen = false;
+        for (int f = 0; f < 12 && !seen; f++) {
+            reference_triangle(corners[s_box_faces[f][0]], corners[s_box_faces[f][1]], corners[s_box_faces[f][2]],
+                               [&](int x, int y, double z) {
+                                   if (z < depth[(size_t)y * WIDTH + x]) seen = true;
+                               });
+        }
+        visible[b] = seen ? 1 : 0;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    int frames = 200;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = std::max(1, atoi(argv[++i]));
+    }
+
+    JobSystem::instance().init();
+
+    Scene scene = build_scene();
+    mat4 proj_view = perspective(67.0f, (float)WIDTH / HEIGHT, 0.1f, 100.0f) *
+                     look_at(vec3(0.0f, 0.5f, 0.0f), vec3(0.0f, 0.0f, -10.0f), vec3(0.0f, 1.0f, 0.0f));
+    int vertex_count = (int)scene.positions.size() / 3;
+    uint32_t box_count = (uint32_t)scene.boxes.size();
+
+    OcclusionCuller culler(WIDTH, HEIGHT);
+    std::vector<uint8_t> visible(box_count);
+    double raster_ms = 0.0, test_ms = 0.0;
+    for (int f = 0; f < frames; f++) {
+        culler.beginFrame(proj_view);
+        culler.addOccluder(scene.positions.data(), vertex_count);
+        culler.finalize();
+        culler.testVisibility(scene.boxes.data(), box_count, visible.data());
+        raster_ms += culler.getStats().raster_ms;
+        test_ms += culler.getStats().test_ms;
+    }
+
+    double t0 = now_ms();
+    std::vector<double> ref_depth;
+    std::vector<uint8_t> ref_visible;
+    reference(scene, proj_view, ref_depth, ref_visible);
+    double reference_ms = now_ms() - t0;
+
+    int depth_mismatches = 0;
+    const float* depth = culler.getDepthBuffer();
+    for (size_t i = 0; i < ref_depth.size(); i++) {
+        if (fabs(depth[i] - ref_depth[i]) > DEPTH_TOLERANCE) depth_mismatches++;
+    }
+
+    int wrongly_hidden = 0, conservative = 0, ref_hidden = 0;
+    for (uint32_t i = 0; i < box_count; i++) {
+        if (!ref_visible[i]) ref_hidden++;
+        if (!visible[i] && ref_visible[i]) {
+            wrongly_hidden++;
+            if (wrongly_hidden <= 5) {
+                const AABB& b = scene.boxes[i];
+                printf("  box %u (%.2f %.2f %.2f)-(%.2f %.2f %.2f) hidden but visible\n", i, b.min.v[0], b.min.v[1],
+                       b.min.v[2], b.max.v[0], b.max.v[1], b.max.v[2]);
+            }
+        }
+        if (visible[i] && !ref_visible[i]) conservative++;
+    }
+
+    printf("%dx%d, %d occluder triangles, %u boxes, %u threads\n", culler.getWidth(), culler.getHeight(),
+           culler.getStats().occluder_triangles, box_count, JobSystem::instance().getWorkerCount() + 1);
+    printf("depth: %d of %zu pixels differ by more than %g\n", depth_mismatches, ref_depth.size(), DEPTH_TOLERANCE);
+    printf("boxes: %d hidden by the reference, %d by the culler, %d kept conservatively, %d wrongly hidden\n",
+           ref_hidden, ref_hidden - conservative + wrongly_hidden, conservative, wrongly_hidden);
+    printf("culler: raster + pyramid %.3f ms, tests %.3f ms (%.1f ns per box), mean of %d frames\n",
+           raster_ms / frames, test_ms / frames, test_ms / frames * 1.0e6 / box_count, frames);
+    printf("reference: %.1f ms\n", reference_ms);
+
+    bool ok = wrongly_hidden == 0 && depth_mismatches <= (int)(ref_depth.size() * MAX_DEPTH_MISMATCH);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    JobSystem::instance().shutdown();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,229 @@
+// texconv - gamma-correct texture processing for the asset pipeline
+//
+// Usage: texconv input.png output.png [--linear | --normal] [--premultiply]
+//                [--resize W H] [--box] [--mips] [--bench]
+//        texconv --orm occlusion.png roughness.png metallic.png output.png [--bench]
+//
+// Colour images are decoded from sRGB; data (--linear) and normal maps
+// (--normal) are plain unorm. Filtering happens on linear floats:
+// --resize uses the Kaiser filter, --box halves with a 2x2 box instead,
+// and --mips also writes every smaller level as output_mipN.png. Normal
+// maps are renormalised after filtering. --orm packs the red channels of
+// three maps into one RGB image (alpha 255).
+// --bench times every kernel on the input in Mpix/s: plain floats on one
+// thread, vectors on one thread, and vectors on all threads.
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "core/JobSystem.h"
+#include "graphics/image_processing.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+
+static double now_ms() {
+    using namespace std::chrono;
+    return duration<double, std::milli>(high_resolution_clock::now().time_since_epoch()).count();
+}
+
+static bool load_image(const char* path, Image8& image) {
+    int channels = 0;
+    unsigned char* pixels = stbi_load(path, &image.width, &image.height, &channels, 4);
+    if (!pixels) {
+        fprintf(stderr, "ERROR: could not load %s: %s\n", path, stbi_failure_reason());
+        return false;
+    }
+    image.pixels.assign(pixels, pixels + (size_t)image.width * image.height * 4);
+    stbi_image_free(pixels);
+    return true;
+}
+
+static bool save_image(const char* path, const Image8& image) {
+    if (!stbi_write_png(path, image.width, image.height, 4, image.pixels.data(), image.width * 4)) {
+        fprintf(stderr, "ERROR: could not write %s\n", path);
+        return false;
+    }
+    printf("  %s: %dx%d\n", path, image.width, image.height);
+    return true;
+}
+
+// out.png -> out_mip2.png
+static std::string mip_path(const char* output, int level) {
+    std::string path = output;
+    size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? "" : path.substr(dot);
+    path = path.substr(0, dot);
+    return path + "_mip" + std::to_string(level) + extension;
+}
+
+// Mpix/s of func over pixels, repeated for at least 200 ms
+template <typename Func>
+static double measure(size_t pixels, const Func& func) {
+    func();     // warm-up: allocations and tables
+    int runs = 0;
+    double start = now_ms(), elapsed = 0.0;
+    do {
+        func();
+        runs++;
+        elapsed = now_ms() - start;
+    } while (elapsed < 200.0 || runs < 3);
+    return (double)pixels * runs / (elapsed * 1000.0);
+}
+
+static const int BENCH_KERNELS = 9;
+static const char* s_kernel_names[BENCH_KERNELS] = {
+    "decode sRGB", "decode normal", "encode sRGB", "encode linear", "premultiply",
+    "box 1/2", "Kaiser 1/2", "renormalize", "pack ORM"};
+
+static void bench_kernels(const Image8& image, double* results) {
+    size_t pixels = (size_t)image.width * image.height;
+    ImageF linear, scratch;
+    Image8 encoded;
+    image_decode(image, IMAGE_SRGB, linear);
+    ChannelSource orm[4] = {{&image, 0, 0}, {&image, 1, 0}, {&image, 2, 0}, {nullptr, 0, 255}};
+
+    results[0] = measure(pixels, [&] { image_decode(image, IMAGE_SRGB, scratch); });
+    results[1] = measure(pixels, [&] { image_decode(image, IMAGE_NORMAL, scratch); });
+    results[2] = measure(pixels, [&] { image_encode(linear, IMAGE_SRGB, encoded); });
+    results[3] = measure(pixels, [&] { image_encode(linear, IMAGE_LINEAR, encoded); });
+    results[4] = measure(pixels, [&] {
+        scratch = linear;
+        image_premultiply(scratch);
+    });
+    results[5] = measure(pixels, [&] { image_downscale_box(linear, scratch); });
+    results[6] = measure(pixels, [&] { image_downscale_kaiser(linear, image.width / 2, image.height / 2, scratch); });
+    results[7] = measure(pixels, [&] {
+        scratch = linear;
+        image_renormalize(scratch);
+    });
+    results[8] = measure(pixels, [&] { image_pack_channels(orm, image.width, image.height, encoded); });
+}
+
+static void bench(const Image8& image) {
+    // Vectors on every thread first; stopping the workers leaves the
+    // kernels on this thread
+    double results[3][BENCH_KERNELS];
+    unsigned int threads = JobSystem::instance().getWorkerCount() + 1;
+    image_set_simd(true);
+    bench_kernels(image, results[2]);
+    JobSystem::instance().shutdown();
+    bench_kernels(image, results[1]);
+    image_set_simd(false);
+    bench_kernels(image, results[0]);
+    image_set_simd(true);
+
+    const char* simd = image_simd_name();
+    printf("\n%dx%d, Mpix/s of input (premultiply and renormalize include a copy)\n", image.width, image.height);
+    printf("%-16s %10s %7s 1T %7s %uT\n", "", "scalar 1T", simd, simd, threads);
+    for (int k = 0; k < BENCH_KERNELS; k++) {
+        printf("%-16s %10.1f %10.1f %10.1f\n", s_kernel_names[k], results[0][k], results[1][k], results[2][k]);
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--orm") == 0) {
+        if (argc < 6) {
+            printf("Usage: %s --orm occlusion.png roughness.png metallic.png output.png [--bench]\n", argv[0]);
+            return 1;
+        }
+        JobSystem::instance().init();
+        Image8 maps[3], packed;
+        for (int i = 0; i < 3; i++) {
+            if (!load_image(argv[2 + i], maps[i])) return 1;
+        }
+        ChannelSource sources[4] = {{&maps[0], 0, 0}, {&maps[1], 0, 0}, {&maps[2], 0, 0}, {nullptr, 0, 255}};
+        double t0 = now_ms();
+        if (!image_pack_channels(sources, maps[0].width, maps[0].height, packed)) {
+            fprintf(stderr, "ERROR: occlusion, roughness and metallic maps differ in size\n");
+            return 1;
+        }
+        printf("Packed ORM in %.2f ms\n", now_ms() - t0);
+        if (!save_image(argv[5], packed)) return 1;
+        if (argc > 6 && strcmp(argv[6], "--bench") == 0) bench(packed);
+        return 0;
+    }
+
+    if (argc < 3) {
+        printf("Usage: %s input.png output.png [--linear | --normal] [--premultiply] [--resize W H] [--box] "
+               "[--mips] [--bench]\n", argv[0]);
+        printf("       %s --orm occlusion.png roughness.png metallic.png output.png [--bench]\n", argv[0]);
+        return 1;
+    }
+    const char* input = argv[1];
+    const char* output = argv[2];
+    ImageEncoding encoding = IMAGE_SRGB;
+    bool premultiply = false, box = false, mips = false, do_bench = false;
+    int width = 0, height = 0;
+    for (int i = 3; i < argc; i++) {
+        if (strcmp(argv[i], "--linear") == 0) encoding = IMAGE_LINEAR;
+        else if (strcmp(argv[i], "--normal") == 0) encoding = IMAGE_NORMAL;
+        else if (strcmp(argv[i], "--premultiply") == 0) premultiply = true;
+        else if (strcmp(argv[i], "--box") == 0) box = true;
+        else if (strcmp(argv[i], "--mips") == 0) mips = true;
+        else if (strcmp(argv[i], "--bench") == 0) do_bench = true;
+        else if (strcmp(argv[i], "--resize") == 0 && i + 2 < argc) {
+            width = atoi(argv[++i]);
+            height = atoi(argv[++i]);
+        }
+    }
+
+    JobSystem::instance().init();
+
+    Image8 source;
+    if (!load_image(input, source)) {
+        return 1;
+    }
+    printf("%s: %dx%d, %s kernels on %u threads\n", input, source.width, source.height, image_simd_name(),
+           JobSystem::instance().getWorkerCount() + 1);
+
+    double t0 = now_ms();
+    ImageF level;
+    image_decode(source, encoding, level);
+    if (premultiply && encoding != IMAGE_NORMAL) {
+        image_premultiply(level);
+    }
+    if (width > 0 && height > 0) {
+        ImageF resized;
+        if (box) image_downscale_box(level, resized);
+        else image_downscale_kaiser(level, width, height, resized);
+        level.width = resized.width;
+        level.height = resized.height;
+        level.pixels.swap(resized.pixels);
+        if (encoding == IMAGE_NORMAL) image_renormalize(level);
+    }
+
+    Image8 encoded;
+    image_encode(level, encoding, encoded);
+    double process_ms = now_ms() - t0;
+    if (!save_image(output, encoded)) {
+        return 1;
+    }
+
+    // Each level from the one above
+    for (int mip = 1; mips && (level.width > 1 || level.height > 1); mip++) {
+        ImageF next;
+        double t1 = now_ms();
+        if (box) image_downscale_box(level, next);
+        else image_downscale_kaiser(level, std::max(level.width / 2, 1), std::max(level.height / 2, 1), next);
+        if (encoding == IMAGE_NORMAL) image_renormalize(next);
+        image_encode(next, encoding, encoded);
+        process_ms += now_ms() - t1;
+        if (!save_image(mip_path(output, mip).c_str(), encoded)) {
+            return 1;
+        }
+        level.width = next.width;
+        level.height = next.height;
+        level.pixels.swap(next.pixels);
+    }
+    printf("Processed in %.2f ms\n", process_ms);
+
+    if (do_bench) {
+        bench(source);
+    }
+    return 0;
+}